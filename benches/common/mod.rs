@@ -0,0 +1,133 @@
+//! Offline fixtures shared by the benchmarks.
+
+#![allow(dead_code, reason = "each benchmark uses a subset of the fixtures")]
+
+use std::collections::HashMap;
+use std::fmt::Write as _;
+use std::sync::{Mutex, MutexGuard, Once, OnceLock, PoisonError};
+use std::time::Duration;
+
+use maplibre_native::file_source::Response;
+use maplibre_native::{
+    register_file_source, FileSource, FileSourceType, RequestHandle, ResourceRequest, Responder,
+};
+
+/// Host the mock network source answers for.
+pub const HOST: &str = "https://bench.invalid";
+
+/// URL of the benchmark style.
+pub fn style_url() -> url::Url {
+    format!("{HOST}/style.json").parse().expect("valid benchmark URL")
+}
+
+/// A style with a background, filled polygons, outlines and circles, all
+/// backed by the GeoJSON served at `/data.geojson`.
+const STYLE: &str = r##"{
+    "version": 8,
+    "name": "bench",
+    "sources": {
+        "grid": { "type": "geojson", "data": "https://bench.invalid/data.geojson" }
+    },
+    "layers": [
+        { "id": "background", "type": "background", "paint": { "background-color": "#e0dfdf" } },
+        { "id": "cells", "type": "fill", "source": "grid",
+          "filter": ["==", ["geometry-type"], "Polygon"],
+          "paint": { "fill-color": ["interpolate", ["linear"], ["get", "rank"],
+                                    0, "#1a9850", 50, "#fee08b", 100, "#d73027"],
+                     "fill-opacity": 0.8 } },
+        { "id": "outlines", "type": "line", "source": "grid",
+          "filter": ["==", ["geometry-type"], "Polygon"],
+          "paint": { "line-color": "#333333", "line-width": ["interpolate", ["linear"], ["zoom"], 0, 0.5, 6, 2] } },
+        { "id": "points", "type": "circle", "source": "grid",
+          "filter": ["==", ["geometry-type"], "Point"],
+          "paint": { "circle-radius": 3, "circle-color": "#2166ac" } }
+    ]
+}"##;
+
+/// Serves the benchmark style, its data and padded payloads from memory.
+struct MockSource;
+
+impl FileSource for MockSource {
+    fn can_request(&self, request: &ResourceRequest) -> bool {
+        request.url.starts_with(HOST)
+    }
+
+    fn request(&self, request: ResourceRequest, responder: Responder) -> RequestHandle {
+        let body = bodies().get(&request.url).cloned();
+        responder.complete(body.map_or_else(Response::no_content, Response::data));
+        RequestHandle::Done
+    }
+}
+
+fn bodies() -> MutexGuard<'static, HashMap<String, Vec<u8>>> {
+    static BODIES: OnceLock<Mutex<HashMap<String, Vec<u8>>>> = OnceLock::new();
+    BODIES
+        .get_or_init(|| {
+            Mutex::new(HashMap::from([
+                (format!("{HOST}/style.json"), STYLE.as_bytes().to_vec()),
+                (format!("{HOST}/data.geojson"), grid_geojson(64).into_bytes()),
+            ]))
+        })
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+}
+
+/// Registers the mock network source. Call before building renderers.
+pub fn install() {
+    static REGISTER: Once = Once::new();
+    REGISTER.call_once(|| register_file_source(FileSourceType::Network, MockSource));
+}
+
+/// Serves a style of roughly `len` bytes at the returned URL, padded with
+/// metadata so that the body size dominates.
+pub fn serve_padded_style(len: usize) -> url::Url {
+    let url = format!("{HOST}/padded-{len}.json");
+    let padding = "x".repeat(len.saturating_sub(STYLE.len()));
+    let style =
+        STYLE.replacen(r#""name": "bench""#, &format!(r#""metadata": {{"pad": "{padding}"}}"#), 1);
+    bodies().insert(url.clone(), style.into_bytes());
+    url.parse().expect("valid benchmark URL")
+}
+
+/// A feature collection of `side * side` square cells covering the world,
+/// plus one point per cell.
+pub fn grid_geojson(side: u32) -> String {
+    let step = 340.0 / f64::from(side);
+    let mut json = String::from(r#"{"type":"FeatureCollection","features":["#);
+    for row in 0..side {
+        for col in 0..side {
+            let west = -170.0 + f64::from(col) * step;
+            let south = -80.0 + f64::from(row) * step * 160.0 / 340.0;
+            let east = west + step * 0.9;
+            let north = south + step * 0.9 * 160.0 / 340.0;
+            let rank = (row * side + col) % 101;
+            if row > 0 || col > 0 {
+                json.push(',');
+            }
+            write!(
+                json,
+                r#"{{"type":"Feature","properties":{{"rank":{rank}}},"geometry":{{"type":"Polygon","coordinates":[[[{west},{south}],[{east},{south}],[{east},{north}],[{west},{north}],[{west},{south}]]]}}}},"#
+            )
+            .unwrap();
+            write!(
+                json,
+                r#"{{"type":"Feature","properties":{{"rank":{rank}}},"geometry":{{"type":"Point","coordinates":[{},{}]}}}}"#,
+                (west + east) / 2.0,
+                (south + north) / 2.0
+            )
+            .unwrap();
+        }
+    }
+    json.push_str("]}");
+    json
+}
+
+/// Prints the median and 99th percentile of `samples`.
+pub fn report_latency(name: &str, samples: &mut [Duration]) {
+    if samples.is_empty() {
+        return;
+    }
+    samples.sort_unstable();
+    let at = |quantile: usize| samples[(samples.len() - 1) * quantile / 100];
+    println!("{name}: p50 {:?}, p99 {:?} over {} renders", at(50), at(99), samples.len());
+}
@@ -0,0 +1,100 @@
+//! Microbenchmarks for data crossing the Rust/C++ bridge.
+//!
+//! Run with `just bench`.
+
+use std::hint::black_box;
+use std::num::NonZeroUsize;
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use maplibre_native::{AnyLayer, GeoJson, ImageRendererBuilder};
+
+mod common;
+
+/// A file source response delivered to MapLibre Native and parsed as a style.
+fn response_marshalling(c: &mut Criterion) {
+    common::install();
+    let mut group = c.benchmark_group("file_source_response");
+    let mut renderer = ImageRendererBuilder::new().build_static_renderer();
+    for len in [4 << 10, 256 << 10, 4 << 20] {
+        let url = common::serve_padded_style(len);
+        group.throughput(Throughput::Bytes(len as u64));
+        group.bench_function(BenchmarkId::from_parameter(len), |b| {
+            b.iter(|| renderer.load_style_from_url(&url).wait().expect("padded style loads"));
+        });
+    }
+    group.finish();
+}
+
+fn geojson_parse(c: &mut Criterion) {
+    let mut group = c.benchmark_group("geojson_parse");
+    for side in [8, 32, 128] {
+        let json = common::grid_geojson(side);
+        group.throughput(Throughput::Bytes(json.len() as u64));
+        group.bench_function(BenchmarkId::from_parameter(2 * side * side), |b| {
+            b.iter(|| GeoJson::from_json_str(black_box(&json)).expect("grid is valid GeoJSON"));
+        });
+    }
+    group.finish();
+
+    // Large enough to be split across threads.
+    let json = common::grid_geojson(256);
+    let threads = std::thread::available_parallelism().unwrap_or(NonZeroUsize::MIN);
+    let mut group = c.benchmark_group("geojson_parse_parallel");
+    group.throughput(Throughput::Bytes(json.len() as u64));
+    group.bench_function(BenchmarkId::from_parameter(threads), |b| {
+        b.iter(|| {
+            GeoJson::from_slice_parallel(black_box(json.as_bytes()), threads)
+                .expect("grid is valid GeoJSON")
+        });
+    });
+    group.finish();
+}
+
+fn layer_from_value(c: &mut Criterion) {
+    let layers = [
+        (
+            "background",
+            serde_json::json!({"id": "bg", "type": "background", "paint": {"background-color": "#e0dfdf"}}),
+        ),
+        (
+            "fill_expressions",
+            serde_json::json!({
+                "id": "cells", "type": "fill", "source": "grid", "source-layer": "cells",
+                "minzoom": 4, "maxzoom": 14,
+                "filter": ["all", ["==", ["geometry-type"], "Polygon"], [">=", ["get", "rank"], 10]],
+                "layout": {"visibility": "visible"},
+                "paint": {
+                    "fill-color": ["interpolate", ["linear"], ["get", "rank"],
+                                   0, "#1a9850", 50, "#fee08b", 100, "#d73027"],
+                    "fill-opacity": ["interpolate", ["linear"], ["zoom"], 4, 0.2, 14, 0.9],
+                    "fill-outline-color": ["case", ["boolean", ["feature-state", "hover"], false],
+                                           "#000000", "#333333"]
+                }
+            }),
+        ),
+        (
+            "symbol",
+            serde_json::json!({
+                "id": "labels", "type": "symbol", "source": "grid", "source-layer": "places",
+                "layout": {
+                    "text-field": ["format", ["get", "name"], {"font-scale": 1.2}, "\n", {},
+                                   ["get", "name:en"], {"font-scale": 0.8}],
+                    "text-font": ["Open Sans Regular"],
+                    "text-size": ["interpolate", ["exponential", 1.5], ["zoom"], 6, 10, 16, 18],
+                    "text-variable-anchor": ["top", "bottom", "left", "right"]
+                },
+                "paint": {"text-color": "#333333", "text-halo-color": "#ffffff", "text-halo-width": 1}
+            }),
+        ),
+    ];
+    let mut group = c.benchmark_group("layer_from_value");
+    for (name, layer) in &layers {
+        group.bench_function(BenchmarkId::from_parameter(name), |b| {
+            b.iter(|| AnyLayer::from_json_value(black_box(layer)).expect("layer is valid"));
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, response_marshalling, geojson_parse, layer_from_value);
+criterion_main!(benches);
@@ -0,0 +1,132 @@
+//! Render throughput and latency against an offline style.
+//!
+//! Run with `just bench`. Each case prints its p50 and p99 latency next to
+//! Criterion's throughput estimate.
+
+use std::hint::black_box;
+use std::num::NonZeroU32;
+use std::time::{Duration, Instant};
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use maplibre_native::{
+    CameraUpdate, ImageRenderer, ImageRendererBuilder, LatLng, RunLoopHandle, Static, Tile,
+};
+
+mod common;
+
+const SIZES: [u32; 3] = [256, 512, 1024];
+const PIXEL_RATIOS: [f32; 2] = [1.0, 2.0];
+
+fn builder(size: u32, pixel_ratio: f32) -> ImageRendererBuilder {
+    let size = NonZeroU32::new(size).expect("benchmark sizes are non-zero");
+    ImageRendererBuilder::new().with_size(size, size).with_pixel_ratio(pixel_ratio)
+}
+
+fn with_style<S>(mut renderer: ImageRenderer<S>) -> ImageRenderer<S> {
+    renderer.load_style_from_url(&common::style_url()).wait().expect("benchmark style loads");
+    renderer
+}
+
+/// The zoom 3 tiles, in an endless loop so that consecutive renders differ.
+fn tiles() -> impl Iterator<Item = (u8, u32, u32)> {
+    (0..64).map(|i| (3, i % 8, i / 8)).cycle()
+}
+
+/// Times each call of `render` and records it in `samples`.
+fn timed(iters: u64, samples: &mut Vec<Duration>, mut render: impl FnMut()) -> Duration {
+    let mut total = Duration::ZERO;
+    for _ in 0..iters {
+        let start = Instant::now();
+        render();
+        let elapsed = start.elapsed();
+        samples.push(elapsed);
+        total += elapsed;
+    }
+    total
+}
+
+fn render_tile(c: &mut Criterion) {
+    common::install();
+    let mut group = c.benchmark_group("render_tile");
+    group.throughput(Throughput::Elements(1));
+    for size in SIZES {
+        for pixel_ratio in PIXEL_RATIOS {
+            let mut renderer: ImageRenderer<Tile> =
+                with_style(builder(size, pixel_ratio).build_tile_renderer());
+            let mut tiles = tiles();
+            let id = format!("{size}px@{pixel_ratio}x");
+            let mut samples = Vec::new();
+            group.bench_function(BenchmarkId::from_parameter(&id), |b| {
+                b.iter_custom(|iters| {
+                    timed(iters, &mut samples, || {
+                        let (z, x, y) = tiles.next().expect("endless");
+                        black_box(renderer.render_tile(z, x, y).expect("tile renders"));
+                    })
+                });
+            });
+            common::report_latency(&format!("render_tile/{id}"), &mut samples);
+        }
+    }
+    group.finish();
+}
+
+fn render_static(c: &mut Criterion) {
+    common::install();
+    let mut group = c.benchmark_group("render_static");
+    group.throughput(Throughput::Elements(1));
+    for size in SIZES {
+        for pixel_ratio in PIXEL_RATIOS {
+            let mut renderer: ImageRenderer<Static> =
+                with_style(builder(size, pixel_ratio).build_static_renderer());
+            let mut step = 0_u32;
+            let id = format!("{size}px@{pixel_ratio}x");
+            let mut samples = Vec::new();
+            group.bench_function(BenchmarkId::from_parameter(&id), |b| {
+                b.iter_custom(|iters| {
+                    timed(iters, &mut samples, || {
+                        step = (step + 1) % 36;
+                        let camera = CameraUpdate::new()
+                            .center(LatLng { lat: 0.0, lng: f64::from(step) * 10.0 - 180.0 })
+                            .zoom(2.0);
+                        black_box(renderer.render_static(&camera).expect("view renders"));
+                    })
+                });
+            });
+            common::report_latency(&format!("render_static/{id}"), &mut samples);
+        }
+    }
+    group.finish();
+}
+
+/// Queued tile renders collected by polling, as a tile server does.
+fn render_queue(c: &mut Criterion) {
+    const DEPTH: u32 = 8;
+
+    common::install();
+    let mut group = c.benchmark_group("render_queue");
+    group.throughput(Throughput::Elements(DEPTH.into()));
+    let mut renderer: ImageRenderer<Tile> = with_style(builder(512, 1.0).build_tile_renderer());
+    let run_loop = RunLoopHandle::current();
+    let mut tiles = tiles();
+    group.bench_function(BenchmarkId::from_parameter(DEPTH), |b| {
+        b.iter(|| {
+            let mut queue = renderer.render_queue().expect("style is loaded");
+            let requests: Vec<_> = (0..DEPTH)
+                .map(|_| {
+                    let (z, x, y) = tiles.next().expect("endless");
+                    queue.push_tile(z, x, y)
+                })
+                .collect();
+            while !requests.iter().all(|request| request.is_ready()) {
+                run_loop.tick();
+            }
+            for request in requests {
+                black_box(request.finish_image_ptr().expect("tile renders"));
+            }
+        });
+    });
+    group.finish();
+}
+
+criterion_group!(benches, render_tile, render_static, render_queue);
+criterion_main!(benches);
@@ -0,0 +1,195 @@
+//! Tolerant comparison of RGBA frames.
+//!
+//! Colours are compared by their perceived difference, measured in the YIQ
+//! colour space after blending over white, so small anti-aliasing and
+//! rounding differences between GPUs and drivers pass while visible changes
+//! do not. The metric matches [pixelmatch](https://github.com/mapbox/pixelmatch),
+//! which `maplibre-native`'s own render tests use.
+
+/// Pixels compared at once before falling back to the colour metric.
+///
+/// Identical runs, usually most of a frame, are skipped with one slice
+/// comparison per block, which compiles to vectorized `memcmp`.
+const BLOCK_PIXELS: usize = 64;
+const BLOCK_BYTES: usize = BLOCK_PIXELS * 4;
+
+/// The largest possible YIQ delta.
+const MAX_DELTA: f64 = 35215.0;
+
+/// The outcome of comparing two frames of the same size.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Diff {
+    /// Pixels whose colour differs by more than the threshold.
+    pub differing_pixels: u64,
+    /// Pixels compared.
+    pub total_pixels: u64,
+    /// The largest colour difference found, from `0.0` (identical) to `1.0`
+    /// (the largest possible difference).
+    pub max_delta: f64,
+}
+
+impl Diff {
+    /// The share of differing pixels, from `0.0` to `1.0`.
+    #[must_use]
+    pub fn ratio(&self) -> f64 {
+        if self.total_pixels == 0 {
+            return 0.0;
+        }
+        #[allow(clippy::cast_precision_loss, reason = "pixel counts fit f64 exactly")]
+        let ratio = self.differing_pixels as f64 / self.total_pixels as f64;
+        ratio
+    }
+}
+
+/// Compares two straight-alpha RGBA buffers of equal length.
+///
+/// A pixel differs if its colour difference exceeds `threshold`, on the same
+/// `0.0..=1.0` scale as [`Diff::max_delta`].
+///
+/// # Panics
+///
+/// If the buffers have different lengths.
+#[must_use]
+pub fn compare(expected: &[u8], actual: &[u8], threshold: f64) -> Diff {
+    assert_eq!(expected.len(), actual.len(), "frames must have the same size");
+    let limit = MAX_DELTA * threshold * threshold;
+    let mut diff =
+        Diff { differing_pixels: 0, total_pixels: (expected.len() / 4) as u64, max_delta: 0.0 };
+    let mut max_delta = 0.0_f64;
+
+    let mut expected_blocks = expected.chunks_exact(BLOCK_BYTES);
+    let mut actual_blocks = actual.chunks_exact(BLOCK_BYTES);
+    for (expected, actual) in expected_blocks.by_ref().zip(actual_blocks.by_ref()) {
+        if expected != actual {
+            compare_pixels(expected, actual, limit, &mut diff.differing_pixels, &mut max_delta);
+        }
+    }
+    compare_pixels(
+        expected_blocks.remainder(),
+        actual_blocks.remainder(),
+        limit,
+        &mut diff.differing_pixels,
+        &mut max_delta,
+    );
+    diff.max_delta = (max_delta / MAX_DELTA).sqrt();
+    diff
+}
+
+/// Renders the differences of two frames as an RGBA image: differing pixels
+/// in red, the others as a faded grey copy of `expected`.
+///
+/// # Panics
+///
+/// If the buffers have different lengths.
+#[must_use]
+pub fn diff_image(expected: &[u8], actual: &[u8], threshold: f64) -> Vec<u8> {
+    assert_eq!(expected.len(), actual.len(), "frames must have the same size");
+    let limit = MAX_DELTA * threshold * threshold;
+    expected
+        .chunks_exact(4)
+        .zip(actual.chunks_exact(4))
+        .flat_map(|(expected, actual)| {
+            if delta(expected, actual) > limit {
+                [0xff, 0x00, 0x00, 0xff]
+            } else {
+                #[allow(clippy::cast_possible_truncation, reason = "luma is within 0..=255")]
+                #[allow(clippy::cast_sign_loss, reason = "luma is within 0..=255")]
+                let grey = (255.0 - (255.0 - luma(expected)) * 0.1) as u8;
+                [grey, grey, grey, 0xff]
+            }
+        })
+        .collect()
+}
+
+fn compare_pixels(expected: &[u8], actual: &[u8], limit: f64, differing: &mut u64, max: &mut f64) {
+    for (expected, actual) in expected.chunks_exact(4).zip(actual.chunks_exact(4)) {
+        if expected == actual {
+            continue;
+        }
+        let delta = delta(expected, actual);
+        *max = max.max(delta);
+        if delta > limit {
+            *differing += 1;
+        }
+    }
+}
+
+/// The squared, weighted YIQ distance of two pixels blended over white.
+fn delta(expected: &[u8], actual: &[u8]) -> f64 {
+    let [y1, i1, q1] = yiq(expected);
+    let [y2, i2, q2] = yiq(actual);
+    let (y, i, q) = (y1 - y2, i1 - i2, q1 - q2);
+    0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q
+}
+
+fn luma(pixel: &[u8]) -> f64 {
+    yiq(pixel)[0]
+}
+
+fn yiq(pixel: &[u8]) -> [f64; 3] {
+    let alpha = f64::from(pixel[3]) / 255.0;
+    let blend = |channel: u8| 255.0 + (f64::from(channel) - 255.0) * alpha;
+    let (r, g, b) = (blend(pixel[0]), blend(pixel[1]), blend(pixel[2]));
+    [
+        r * 0.298_895_31 + g * 0.586_622_47 + b * 0.114_482_23,
+        r * 0.595_977_99 - g * 0.274_176_10 - b * 0.321_801_89,
+        r * 0.211_470_17 - g * 0.522_617_11 + b * 0.311_146_94,
+    ]
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{compare, diff_image};
+
+    fn frame(pixels: usize, colour: [u8; 4]) -> Vec<u8> {
+        colour.repeat(pixels)
+    }
+
+    #[test]
+    fn identical_frames_match() {
+        let frame = frame(100, [0xff, 0x00, 0xf0, 0xff]);
+        let diff = compare(&frame, &frame, 0.0);
+        assert_eq!(diff.differing_pixels, 0);
+        assert_eq!(diff.total_pixels, 100);
+        assert!(diff.max_delta.abs() < f64::EPSILON);
+    }
+
+    #[test]
+    fn small_differences_are_tolerated() {
+        let expected = frame(100, [0x80, 0x80, 0x80, 0xff]);
+        let mut actual = expected.clone();
+        actual[0] = 0x81;
+        assert_eq!(compare(&expected, &actual, 0.1).differing_pixels, 0);
+        assert_eq!(compare(&expected, &actual, 0.0).differing_pixels, 1);
+    }
+
+    #[test]
+    fn visible_differences_are_counted_in_blocks_and_remainder() {
+        let expected = frame(100, [0xff, 0xff, 0xff, 0xff]);
+        let mut actual = expected.clone();
+        // One pixel in the first block, one in the remainder.
+        actual[4..8].copy_from_slice(&[0, 0, 0, 0xff]);
+        actual[396..400].copy_from_slice(&[0, 0, 0, 0xff]);
+        let diff = compare(&expected, &actual, 0.1);
+        assert_eq!(diff.differing_pixels, 2);
+        assert!(diff.max_delta > 0.9, "black on white is a large difference");
+        assert!((diff.ratio() - 0.02).abs() < f64::EPSILON);
+    }
+
+    #[test]
+    fn transparent_pixels_blend_over_white() {
+        let transparent = frame(1, [0x00, 0x00, 0x00, 0x00]);
+        let white = frame(1, [0xff, 0xff, 0xff, 0xff]);
+        assert_eq!(compare(&transparent, &white, 0.0).differing_pixels, 0);
+    }
+
+    #[test]
+    fn diff_image_marks_differing_pixels() {
+        let expected = frame(2, [0xff, 0xff, 0xff, 0xff]);
+        let mut actual = expected.clone();
+        actual[..4].copy_from_slice(&[0, 0, 0, 0xff]);
+        let image = diff_image(&expected, &actual, 0.1);
+        assert_eq!(image[..4], [0xff, 0x00, 0x00, 0xff]);
+        assert_eq!(image[4..], [0xff, 0xff, 0xff, 0xff]);
+    }
+}
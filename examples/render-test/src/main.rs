@@ -0,0 +1,286 @@
+//! Render regression and performance harness on top of [`ImageRenderer`].
+//!
+//! Renders every case of a manifest (see [`manifest`]), compares the frame
+//! against its golden image with a tolerant perceptual diff, records the
+//! median render phases of several runs, and writes a JSON report. The exit
+//! status is non-zero if any case differs visibly, exceeds its time limit,
+//! or got slower than in a baseline report.
+//!
+//! For example, check the bundled fixtures with
+//! `cargo run -p render-test -- examples/render-test/fixtures/manifest.json`,
+//! or update their goldens after an intended change with `--bless`. Cases
+//! without a golden fail until one is blessed from a trusted render.
+//! Styles should only reference local files so runs are reproducible
+//! offline; `asset://` URLs resolve relative to the manifest.
+//!
+//! The bundled `features` style draws a local GeoJSON source with fill, line
+//! and icon layers from a local sprite, so its cases exercise tile parsing,
+//! layout and placement, not just a cleared frame. They live in
+//! `fixtures/features-manifest.json` until their goldens have been blessed
+//! from a trusted build; then move them into `manifest.json`.
+
+mod diff;
+mod manifest;
+mod report;
+
+use std::collections::HashMap;
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::process::ExitCode;
+
+use clap::Parser;
+use env_logger::Env;
+use image::RgbaImage;
+use maplibre_native::{
+    CameraUpdate, Image, ImageRenderer, ImageRendererBuilder, LatLng, RenderRequest, RenderStats,
+    ResourceOptions, RunLoopHandle, Static, Tile,
+};
+
+use crate::manifest::{Case, Manifest, View};
+use crate::report::{millis, CaseReport, Timings};
+
+/// Render regression and performance harness
+#[derive(Parser, Debug)]
+struct Args {
+    /// Manifest listing the cases to run
+    manifest: PathBuf,
+
+    /// Where to write the JSON report
+    #[arg(long, default_value = "render-test-report.json")]
+    report: PathBuf,
+
+    /// Directory for the actual and diff images of failed cases
+    #[arg(long, default_value = "render-test-output")]
+    output: PathBuf,
+
+    /// Timed renders per case, after one warm-up render
+    #[arg(long, default_value_t = 5, value_parser = clap::value_parser!(u16).range(1..))]
+    runs: u16,
+
+    /// Overwrite the goldens with the rendered frames instead of comparing
+    #[arg(long)]
+    bless: bool,
+
+    /// Earlier report to compare the render times against
+    #[arg(long)]
+    baseline: Option<PathBuf>,
+
+    /// Fail cases whose median total time exceeds the baseline's by this factor
+    #[arg(long, default_value_t = 1.2)]
+    max_slowdown: f64,
+}
+
+/// The renderers of a run, created when a case first needs them.
+struct Renderers<'a> {
+    manifest: &'a Manifest,
+    assets: PathBuf,
+    camera: Option<ImageRenderer<Static>>,
+    tile: Option<ImageRenderer<Tile>>,
+}
+
+fn builder(manifest: &Manifest, assets: &Path) -> ImageRendererBuilder {
+    ImageRendererBuilder::new()
+        .with_size(manifest.width, manifest.height)
+        .with_pixel_ratio(manifest.pixel_ratio)
+        .with_resource_options(ResourceOptions::default().with_asset_path(assets.to_owned()))
+}
+
+impl Renderers<'_> {
+    /// Loads the style of `case`, then renders it `runs + 1` times.
+    fn render(&mut self, case: &Case, runs: u16) -> Result<(Vec<RenderStats>, Image), String> {
+        match case.view {
+            View::Camera { lat, lng, zoom, bearing, pitch } => {
+                let camera = CameraUpdate::new()
+                    .center(LatLng { lat, lng })
+                    .zoom(zoom)
+                    .bearing(bearing)
+                    .pitch(pitch);
+                let renderer = self.camera.get_or_insert_with(|| {
+                    builder(self.manifest, &self.assets).build_static_renderer()
+                });
+                load_style(renderer, &case.style)?;
+                measure(runs, || complete(renderer.submit_render_static(&camera)))
+            }
+            View::Tile { z, x, y } => {
+                let renderer = self.tile.get_or_insert_with(|| {
+                    builder(self.manifest, &self.assets).build_tile_renderer()
+                });
+                load_style(renderer, &case.style)?;
+                measure(runs, || complete(renderer.submit_render_tile(z, x, y)))
+            }
+        }
+    }
+}
+
+fn load_style<S>(renderer: &mut ImageRenderer<S>, style: &Path) -> Result<(), String> {
+    renderer
+        .load_style_from_path(style)
+        .map_err(|error| error.to_string())?
+        .wait()
+        .map_err(|error| format!("style failed to load: {error}"))
+}
+
+/// Renders once to warm caches, then `runs` times, keeping the last frame.
+fn measure(
+    runs: u16,
+    mut render: impl FnMut() -> Result<(RenderStats, Image), String>,
+) -> Result<(Vec<RenderStats>, Image), String> {
+    let (_, mut image) = render()?;
+    let mut samples = Vec::with_capacity(usize::from(runs));
+    for _ in 0..runs {
+        let (stats, frame) = render()?;
+        samples.push(stats);
+        image = frame;
+    }
+    Ok((samples, image))
+}
+
+fn complete<S>(
+    request: Result<RenderRequest<'_, S>, maplibre_native::RenderingError>,
+) -> Result<(RenderStats, Image), String> {
+    let request = request.map_err(|error| error.to_string())?;
+    let run_loop = RunLoopHandle::current();
+    while !request.is_ready() {
+        run_loop.tick();
+    }
+    let stats = request.stats();
+    let image = request.finish().map_err(|error| error.to_string())?;
+    Ok((stats.expect("a successful render has stats"), image))
+}
+
+fn run_case(
+    renderers: &mut Renderers<'_>,
+    case: &Case,
+    args: &Args,
+    baseline: &HashMap<String, f64>,
+) -> CaseReport {
+    let mut report = CaseReport::new(&case.name);
+    let (samples, frame) = match renderers.render(case, args.runs) {
+        Ok(result) => result,
+        Err(error) => {
+            report.failures.push(format!("render failed: {error}"));
+            return report;
+        }
+    };
+    let actual = frame.as_image();
+
+    let timings = Timings::median(&samples);
+    report.runs = samples.len();
+    report.timings = Some(timings);
+    let total_ms = millis(timings.total);
+    if let Some(limit) = case.max_total_ms.filter(|&limit| total_ms > limit) {
+        report.failures.push(format!("median render took {total_ms:.1} ms, limit {limit} ms"));
+    }
+    report.baseline_total_ms = baseline.get(&case.name).copied();
+    if let Some(before) = report.baseline_total_ms {
+        if total_ms > before * args.max_slowdown {
+            report.failures.push(format!(
+                "median render took {total_ms:.1} ms, {:.0}% over the baseline's {before:.1} ms",
+                (total_ms / before - 1.0) * 100.0
+            ));
+        }
+    }
+
+    if args.bless {
+        if let Err(error) = save(&case.golden, actual) {
+            report.failures.push(format!("failed writing golden: {error}"));
+        }
+        return report;
+    }
+    let golden = match image::open(&case.golden) {
+        Ok(golden) => golden.to_rgba8(),
+        Err(error) => {
+            report.failures.push(format!(
+                "failed reading golden {}: {error}; run with --bless to create it",
+                case.golden.display()
+            ));
+            return report;
+        }
+    };
+    if golden.dimensions() != actual.dimensions() {
+        report.failures.push(format!(
+            "golden is {:?} pixels, frame is {:?}",
+            golden.dimensions(),
+            actual.dimensions()
+        ));
+        return report;
+    }
+    let diff = diff::compare(golden.as_raw(), actual.as_raw(), case.threshold);
+    report.diff = Some(diff);
+    if diff.differing_pixels > case.max_diff_pixels {
+        report.failures.push(format!(
+            "{} pixels differ, {} allowed",
+            diff.differing_pixels, case.max_diff_pixels
+        ));
+        let (width, height) = actual.dimensions();
+        let diff_image = diff::diff_image(golden.as_raw(), actual.as_raw(), case.threshold);
+        let diff_image =
+            RgbaImage::from_raw(width, height, diff_image).expect("same size as frame");
+        for (suffix, output) in [("actual", actual), ("diff", &diff_image)] {
+            let path = args.output.join(format!("{}.{suffix}.png", case.name));
+            if let Err(error) = save(&path, output) {
+                report.failures.push(format!("failed writing {}: {error}", path.display()));
+            }
+        }
+    }
+    report
+}
+
+fn save(path: &Path, image: &RgbaImage) -> Result<(), String> {
+    if let Some(dir) = path.parent() {
+        fs::create_dir_all(dir).map_err(|error| error.to_string())?;
+    }
+    image.save(path).map_err(|error| error.to_string())
+}
+
+fn main() -> ExitCode {
+    env_logger::Builder::from_env(Env::new().default_filter_or("warn")).init();
+    let args = Args::parse();
+
+    let manifest = match Manifest::load(&args.manifest) {
+        Ok(manifest) => manifest,
+        Err(error) => {
+            eprintln!("{error}");
+            return ExitCode::FAILURE;
+        }
+    };
+    let baseline = match args.baseline.as_deref().map(report::read_baseline).transpose() {
+        Ok(baseline) => baseline.unwrap_or_default(),
+        Err(error) => {
+            eprintln!("{error}");
+            return ExitCode::FAILURE;
+        }
+    };
+
+    let assets = args.manifest.parent().unwrap_or(Path::new(".")).to_owned();
+    let mut renderers = Renderers { manifest: &manifest, assets, camera: None, tile: None };
+    let reports: Vec<CaseReport> = manifest
+        .cases
+        .iter()
+        .map(|case| {
+            let report = run_case(&mut renderers, case, &args, &baseline);
+            let status = if report.passed() { "ok" } else { "FAILED" };
+            println!("{} ... {status}", case.name);
+            for failure in &report.failures {
+                println!("    {failure}");
+            }
+            report
+        })
+        .collect();
+
+    if let Err(error) = report::write(&args.report, &reports) {
+        eprintln!("failed writing {}: {error}", args.report.display());
+        return ExitCode::FAILURE;
+    }
+    let failed = reports.iter().filter(|report| !report.passed()).count();
+    println!(
+        "{} passed, {failed} failed; report in {}",
+        reports.len() - failed,
+        args.report.display()
+    );
+    if failed == 0 {
+        ExitCode::SUCCESS
+    } else {
+        ExitCode::FAILURE
+    }
+}
@@ -0,0 +1,300 @@
+//! The render-test manifest: which styles to render where, and how strictly
+//! to compare them.
+//!
+//! ```json
+//! {
+//!   "width": 256,
+//!   "height": 256,
+//!   "threshold": 0.1,
+//!   "cases": [
+//!     { "name": "background", "style": "styles/background.json",
+//!       "camera": { "lat": 0, "lng": 0, "zoom": 1 } },
+//!     { "name": "tile-2-1-1", "style": "styles/background.json",
+//!       "tile": { "z": 2, "x": 1, "y": 1 }, "max_diff_pixels": 16, "max_total_ms": 500 }
+//!   ]
+//! }
+//! ```
+//!
+//! Paths are relative to the manifest. Goldens default to
+//! `golden/<name>.png`. `threshold`, `max_diff_pixels` and `max_total_ms`
+//! can be set for the whole manifest and overridden per case.
+
+use std::fs;
+use std::num::NonZeroU32;
+use std::path::{Path, PathBuf};
+
+use serde_json::{Map, Value};
+
+/// Errors returned while reading a manifest.
+#[derive(Debug, thiserror::Error)]
+pub enum ManifestError {
+    /// The manifest could not be read.
+    #[error("failed reading {path}: {source}")]
+    Io { path: PathBuf, source: std::io::Error },
+    /// The manifest is not valid JSON.
+    #[error("{path} is not valid JSON: {source}")]
+    Json { path: PathBuf, source: serde_json::Error },
+    /// A field is missing or has the wrong type.
+    #[error("{0}")]
+    Invalid(String),
+}
+
+/// A parsed manifest.
+#[derive(Debug)]
+pub struct Manifest {
+    /// Frame width in pixels.
+    pub width: NonZeroU32,
+    /// Frame height in pixels.
+    pub height: NonZeroU32,
+    /// Pixel ratio of every render.
+    pub pixel_ratio: f32,
+    /// The cases, in manifest order.
+    pub cases: Vec<Case>,
+}
+
+/// One render to compare against its golden image.
+#[derive(Debug)]
+pub struct Case {
+    /// Unique name, used for the golden and output file names.
+    pub name: String,
+    /// Style JSON file.
+    pub style: PathBuf,
+    /// Where to render.
+    pub view: View,
+    /// Golden PNG.
+    pub golden: PathBuf,
+    /// Colour difference a pixel may have, from `0.0` to `1.0`.
+    pub threshold: f64,
+    /// Pixels that may exceed the threshold.
+    pub max_diff_pixels: u64,
+    /// Upper bound of the median render time, in milliseconds.
+    pub max_total_ms: Option<f64>,
+}
+
+/// The view of a case.
+#[derive(Debug, Clone, Copy)]
+pub enum View {
+    /// A static render of an arbitrary camera.
+    Camera { lat: f64, lng: f64, zoom: f64, bearing: f64, pitch: f64 },
+    /// A tile render.
+    Tile { z: u8, x: u32, y: u32 },
+}
+
+impl Manifest {
+    /// Reads the manifest at `path`.
+    pub fn load(path: &Path) -> Result<Self, ManifestError> {
+        let text = fs::read_to_string(path)
+            .map_err(|source| ManifestError::Io { path: path.to_owned(), source })?;
+        let value: Value = serde_json::from_str(&text)
+            .map_err(|source| ManifestError::Json { path: path.to_owned(), source })?;
+        let root = path.parent().unwrap_or(Path::new("."));
+        Self::from_value(&value, root)
+    }
+
+    fn from_value(value: &Value, root: &Path) -> Result<Self, ManifestError> {
+        let object = as_object(value, "manifest")?;
+        let defaults = Limits::read(object, &Limits::default(), "manifest")?;
+        let cases = object
+            .get("cases")
+            .and_then(Value::as_array)
+            .ok_or_else(|| invalid("manifest needs a `cases` array"))?
+            .iter()
+            .map(|case| Case::read(case, root, &defaults))
+            .collect::<Result<Vec<_>, _>>()?;
+        for (index, case) in cases.iter().enumerate() {
+            if cases[..index].iter().any(|other| other.name == case.name) {
+                return Err(invalid(format!("case name `{}` is used twice", case.name)));
+            }
+        }
+        Ok(Self {
+            width: dimension(object, "width")?,
+            height: dimension(object, "height")?,
+            #[allow(clippy::cast_possible_truncation, reason = "pixel ratios are small")]
+            pixel_ratio: number(object, "pixel_ratio", "manifest")?.unwrap_or(1.0) as f32,
+            cases,
+        })
+    }
+}
+
+impl Case {
+    fn read(value: &Value, root: &Path, defaults: &Limits) -> Result<Self, ManifestError> {
+        let object = as_object(value, "case")?;
+        let name = string(object, "name", "case")?
+            .ok_or_else(|| invalid("every case needs a `name`"))?
+            .to_owned();
+        let context = format!("case `{name}`");
+        let style = string(object, "style", &context)?
+            .ok_or_else(|| invalid(format!("{context} needs a `style`")))?;
+        let golden = string(object, "golden", &context)?
+            .map_or_else(|| PathBuf::from("golden").join(format!("{name}.png")), PathBuf::from);
+        let view = match (object.get("camera"), object.get("tile")) {
+            (Some(camera), None) => {
+                let camera = as_object(camera, &context)?;
+                let coordinate = |key| number(camera, key, &context).map(Option::unwrap_or_default);
+                View::Camera {
+                    lat: coordinate("lat")?,
+                    lng: coordinate("lng")?,
+                    zoom: coordinate("zoom")?,
+                    bearing: coordinate("bearing")?,
+                    pitch: coordinate("pitch")?,
+                }
+            }
+            (None, Some(tile)) => {
+                let tile = as_object(tile, &context)?;
+                let coordinate = |key| {
+                    tile.get(key)
+                        .and_then(Value::as_u64)
+                        .ok_or_else(|| invalid(format!("{context}: tile needs an integer `{key}`")))
+                };
+                View::Tile {
+                    z: u8::try_from(coordinate("z")?)
+                        .map_err(|_| invalid(format!("{context}: tile zoom is too large")))?,
+                    x: u32::try_from(coordinate("x")?)
+                        .map_err(|_| invalid(format!("{context}: tile x is too large")))?,
+                    y: u32::try_from(coordinate("y")?)
+                        .map_err(|_| invalid(format!("{context}: tile y is too large")))?,
+                }
+            }
+            _ => return Err(invalid(format!("{context} needs either a `camera` or a `tile`"))),
+        };
+        let limits = Limits::read(object, defaults, &context)?;
+        Ok(Self {
+            style: root.join(style),
+            golden: root.join(golden),
+            view,
+            threshold: limits.threshold,
+            max_diff_pixels: limits.max_diff_pixels,
+            max_total_ms: limits.max_total_ms,
+            name,
+        })
+    }
+}
+
+/// Comparison limits, set for the manifest and overridden per case.
+struct Limits {
+    threshold: f64,
+    max_diff_pixels: u64,
+    max_total_ms: Option<f64>,
+}
+
+impl Default for Limits {
+    fn default() -> Self {
+        Self { threshold: 0.1, max_diff_pixels: 0, max_total_ms: None }
+    }
+}
+
+impl Limits {
+    fn read(
+        object: &Map<String, Value>,
+        defaults: &Self,
+        context: &str,
+    ) -> Result<Self, ManifestError> {
+        let max_diff_pixels = match object.get("max_diff_pixels") {
+            None => defaults.max_diff_pixels,
+            Some(value) => value.as_u64().ok_or_else(|| {
+                invalid(format!("{context}: `max_diff_pixels` must be a non-negative integer"))
+            })?,
+        };
+        Ok(Self {
+            threshold: number(object, "threshold", context)?.unwrap_or(defaults.threshold),
+            max_diff_pixels,
+            max_total_ms: number(object, "max_total_ms", context)?.or(defaults.max_total_ms),
+        })
+    }
+}
+
+fn invalid(message: impl Into<String>) -> ManifestError {
+    ManifestError::Invalid(message.into())
+}
+
+fn as_object<'a>(value: &'a Value, context: &str) -> Result<&'a Map<String, Value>, ManifestError> {
+    value.as_object().ok_or_else(|| invalid(format!("{context} must be a JSON object")))
+}
+
+fn number(
+    object: &Map<String, Value>,
+    key: &str,
+    context: &str,
+) -> Result<Option<f64>, ManifestError> {
+    object
+        .get(key)
+        .map(|value| {
+            value.as_f64().ok_or_else(|| invalid(format!("{context}: `{key}` must be a number")))
+        })
+        .transpose()
+}
+
+fn string<'a>(
+    object: &'a Map<String, Value>,
+    key: &str,
+    context: &str,
+) -> Result<Option<&'a str>, ManifestError> {
+    object
+        .get(key)
+        .map(|value| {
+            value.as_str().ok_or_else(|| invalid(format!("{context}: `{key}` must be a string")))
+        })
+        .transpose()
+}
+
+fn dimension(object: &Map<String, Value>, key: &str) -> Result<NonZeroU32, ManifestError> {
+    let Some(value) = object.get(key) else {
+        return Ok(NonZeroU32::new(512).unwrap());
+    };
+    value
+        .as_u64()
+        .and_then(|value| u32::try_from(value).ok())
+        .and_then(NonZeroU32::new)
+        .ok_or_else(|| invalid(format!("manifest: `{key}` must be a positive integer")))
+}
+
+#[cfg(test)]
+mod tests {
+    use std::path::Path;
+
+    use serde_json::json;
+
+    use super::{Manifest, View};
+
+    #[test]
+    fn reads_cases_with_defaults_and_overrides() {
+        let manifest = Manifest::from_value(
+            &json!({
+                "width": 256,
+                "threshold": 0.2,
+                "cases": [
+                    { "name": "a", "style": "s.json", "camera": { "zoom": 3 } },
+                    { "name": "b", "style": "s.json", "tile": { "z": 1, "x": 1, "y": 0 },
+                      "golden": "other.png", "threshold": 0.05, "max_total_ms": 40 }
+                ]
+            }),
+            Path::new("fixtures"),
+        )
+        .unwrap();
+        assert_eq!(manifest.width.get(), 256);
+        assert_eq!(manifest.height.get(), 512);
+        let [a, b] = &manifest.cases[..] else { panic!("two cases") };
+        assert_eq!(a.golden, Path::new("fixtures/golden/a.png"));
+        assert!((a.threshold - 0.2).abs() < f64::EPSILON);
+        assert!(matches!(a.view, View::Camera { zoom, .. } if (zoom - 3.0).abs() < f64::EPSILON));
+        assert_eq!(b.golden, Path::new("fixtures/other.png"));
+        assert!((b.threshold - 0.05).abs() < f64::EPSILON);
+        assert_eq!(b.max_total_ms, Some(40.0));
+        assert!(matches!(b.view, View::Tile { z: 1, x: 1, y: 0 }));
+    }
+
+    #[test]
+    fn rejects_invalid_cases() {
+        for cases in [
+            json!([{ "style": "s.json", "tile": { "z": 0, "x": 0, "y": 0 } }]),
+            json!([{ "name": "a", "style": "s.json" }]),
+            json!([{ "name": "a", "style": "s.json", "tile": { "z": 300, "x": 0, "y": 0 } }]),
+            json!([
+                { "name": "a", "style": "s.json", "camera": {} },
+                { "name": "a", "style": "s.json", "camera": {} }
+            ]),
+        ] {
+            assert!(Manifest::from_value(&json!({ "cases": cases }), Path::new(".")).is_err());
+        }
+    }
+}
@@ -0,0 +1,168 @@
+//! Per-case results and the JSON report.
+
+use std::collections::HashMap;
+use std::fs;
+use std::path::Path;
+use std::time::Duration;
+
+use maplibre_native::RenderStats;
+use serde_json::{json, Value};
+
+use crate::diff::Diff;
+
+/// Median render phases of one case.
+#[derive(Debug, Clone, Copy)]
+pub struct Timings {
+    pub queued: Duration,
+    pub loading: Duration,
+    pub frame: Duration,
+    pub readback: Duration,
+    pub total: Duration,
+}
+
+impl Timings {
+    /// Takes the median of every phase on its own, so one slow tile load
+    /// does not hide a slower draw.
+    ///
+    /// # Panics
+    ///
+    /// If `samples` is empty.
+    pub fn median(samples: &[RenderStats]) -> Self {
+        let median = |phase: fn(&RenderStats) -> Duration| {
+            let mut values: Vec<Duration> = samples.iter().map(phase).collect();
+            values.sort_unstable();
+            values[values.len() / 2]
+        };
+        Self {
+            queued: median(|stats| stats.queued),
+            loading: median(|stats| stats.loading),
+            frame: median(|stats| stats.frame),
+            readback: median(|stats| stats.readback),
+            total: median(RenderStats::total),
+        }
+    }
+
+    fn to_json(self) -> Value {
+        json!({
+            "queued_ms": millis(self.queued),
+            "loading_ms": millis(self.loading),
+            "frame_ms": millis(self.frame),
+            "readback_ms": millis(self.readback),
+            "total_ms": millis(self.total),
+        })
+    }
+}
+
+/// The outcome of one case.
+#[derive(Debug, Default)]
+pub struct CaseReport {
+    pub name: String,
+    pub diff: Option<Diff>,
+    pub timings: Option<Timings>,
+    pub runs: usize,
+    /// Median total time of the case in the baseline report, in milliseconds.
+    pub baseline_total_ms: Option<f64>,
+    /// Why the case failed; empty if it passed.
+    pub failures: Vec<String>,
+}
+
+impl CaseReport {
+    pub fn new(name: &str) -> Self {
+        Self { name: name.to_owned(), ..Self::default() }
+    }
+
+    pub fn passed(&self) -> bool {
+        self.failures.is_empty()
+    }
+
+    fn to_json(&self) -> Value {
+        json!({
+            "name": self.name,
+            "passed": self.passed(),
+            "failures": self.failures,
+            "diff": self.diff.map(|diff| json!({
+                "differing_pixels": diff.differing_pixels,
+                "ratio": diff.ratio(),
+                "max_delta": diff.max_delta,
+            })),
+            "runs": self.runs,
+            "timings": self.timings.map(Timings::to_json),
+            "baseline_total_ms": self.baseline_total_ms,
+        })
+    }
+}
+
+/// Writes the report for `cases` to `path`.
+pub fn write(path: &Path, cases: &[CaseReport]) -> std::io::Result<()> {
+    let report = json!({
+        "passed": cases.iter().all(CaseReport::passed),
+        "cases": cases.iter().map(CaseReport::to_json).collect::<Vec<_>>(),
+    });
+    let mut text = serde_json::to_string_pretty(&report).map_err(std::io::Error::other)?;
+    text.push('\n');
+    fs::write(path, text)
+}
+
+/// Reads the median total time of every case of an earlier report, in
+/// milliseconds.
+pub fn read_baseline(path: &Path) -> Result<HashMap<String, f64>, String> {
+    let text = fs::read_to_string(path)
+        .map_err(|error| format!("failed reading baseline {}: {error}", path.display()))?;
+    let report: Value = serde_json::from_str(&text)
+        .map_err(|error| format!("baseline {} is not valid JSON: {error}", path.display()))?;
+    let cases = report["cases"]
+        .as_array()
+        .ok_or_else(|| format!("baseline {} has no `cases`", path.display()))?;
+    Ok(cases
+        .iter()
+        .filter_map(|case| {
+            let name = case["name"].as_str()?;
+            let total = case["timings"]["total_ms"].as_f64()?;
+            Some((name.to_owned(), total))
+        })
+        .collect())
+}
+
+pub fn millis(duration: Duration) -> f64 {
+    duration.as_secs_f64() * 1000.0
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::Duration;
+
+    use maplibre_native::RenderStats;
+
+    use super::{read_baseline, write, CaseReport, Timings};
+
+    #[test]
+    fn medians_each_phase() {
+        let stats = |loading, frame| RenderStats {
+            loading: Duration::from_millis(loading),
+            frame: Duration::from_millis(frame),
+            ..RenderStats::default()
+        };
+        let timings = Timings::median(&[stats(90, 1), stats(10, 3), stats(20, 2)]);
+        assert_eq!(timings.loading, Duration::from_millis(20));
+        assert_eq!(timings.frame, Duration::from_millis(2));
+        assert_eq!(timings.total, Duration::from_millis(22));
+    }
+
+    #[test]
+    fn reports_read_back_as_baselines() {
+        let mut case = CaseReport::new("background");
+        case.timings = Some(Timings::median(&[RenderStats {
+            frame: Duration::from_millis(12),
+            ..RenderStats::default()
+        }]));
+        // Unique per process so parallel runs on one host do not collide.
+        let path =
+            std::env::temp_dir().join(format!("render-test-baseline-{}.json", std::process::id()));
+        write(&path, &[case, CaseReport::new("failed-to-render")]).unwrap();
+        let baseline = read_baseline(&path);
+        std::fs::remove_file(&path).unwrap();
+        let baseline = baseline.unwrap();
+        assert_eq!(baseline.len(), 1);
+        assert!((baseline["background"] - 12.0).abs() < 1e-9);
+    }
+}
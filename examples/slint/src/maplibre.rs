@@ -1,8 +1,8 @@
 use crate::{MainWindow, MapAdapter};
 use image::ImageReader;
 use maplibre_native::{
-    CircleLayer, Color, FillLayer, GeoJson, GeoJsonSource, LineLayer, ScreenCoordinate,
-    SymbolAnchor, SymbolLayer,
+    CircleLayer, Color, FillLayer, GeoJson, GeoJsonSource, LineLayer, RingFrame, ScreenCoordinate,
+    SymbolAnchor, SymbolLayer, TextureRing,
 };
 use std::cell::{Cell, RefCell};
 use std::path::Path;
@@ -40,6 +40,11 @@ pub fn init(
             let frame_requested = frame_requested.clone();
             let ui_weak = ui.as_weak();
             let styled = Cell::new(false);
+            // Frames are copied into a ring on the GPU, so the UI samples one
+            // slot while MapLibre Native renders the next frame. The frame on
+            // screen keeps its slot leased until the next one replaces it.
+            let ring = RefCell::new(None);
+            let shown = RefCell::new(None::<RingFrame>);
             move |state, graphics_api| match state {
                 slint::RenderingState::RenderingSetup => {
                     if lifecycle.get() != Lifecycle::Uninitialized {
@@ -56,6 +61,7 @@ pub fn init(
                     // Build the renderer now that the pixel ratio (scale factor) is known.
                     map.build_renderer(ui.window().scale_factor());
                     map.renderer().set_device_queue(device.clone(), queue.clone());
+                    *ring.borrow_mut() = Some(TextureRing::new(device.clone(), queue.clone(), 3));
 
                     map.renderer().set_render_requested_callback({
                         let lifecycle = lifecycle.clone();
@@ -96,19 +102,26 @@ pub fn init(
                         styled.set(true);
                     }
 
-                    if let Some(image) = map.renderer().take_texture()
-                        && let Ok(image) = image.try_into()
+                    let mut ring = ring.borrow_mut();
+                    let Some(ring) = ring.as_mut() else {
+                        return;
+                    };
+                    if let Ok(Some(frame)) = map.renderer().take_frame(ring)
+                        && let Ok(image) = frame.texture().clone().try_into()
                     {
                         ui_weak
                             .upgrade()
                             .unwrap()
                             .global::<MapAdapter>()
                             .set_map_texture(image);
+                        // Releases the slot of the frame shown so far.
+                        *shown.borrow_mut() = Some(frame);
                     }
                 }
                 slint::RenderingState::RenderingTeardown => {
                     lifecycle.set(Lifecycle::Stopped);
                     frame_requested.set(false);
+                    shown.borrow_mut().take();
                 }
                 _ => {}
             }
@@ -1,14 +1,14 @@
 //! Tile rendering server example.
 //!
-//! Serves rendered tiles from a MapLibre style over HTTP. It shows one simple
-//! way to use [`ImageRenderer`] from an async,
-//! multi-threaded server.
+//! Serves rendered tiles from a MapLibre style over HTTP. It shows how to use
+//! a [`RenderPool`] and an [`EncoderPool`] from an async, multi-threaded
+//! server.
 //!
 //! Run with `cargo run -p tile-server`, then open <http://127.0.0.1:3000>.
 
-use std::io::Cursor;
-use std::sync::atomic::{AtomicUsize, Ordering};
-use std::sync::Arc;
+use std::collections::HashMap;
+use std::num::NonZeroUsize;
+use std::sync::{Arc, Mutex, PoisonError};
 use std::thread;
 
 use axum::body::Body;
@@ -18,11 +18,16 @@ use axum::response::{Html, Response};
 use axum::routing::get;
 use axum::Router;
 use clap::Parser;
-use maplibre_native::{ImageRenderer, ImageRendererBuilder, RenderingError, Tile};
-use tokio::sync::{mpsc, oneshot};
+use maplibre_native::{
+    EncodeError, EncodeFormat, EncoderPool, ImageRendererBuilder, JobHandle, PngCompression,
+    RenderPool, RenderPoolBuilder, RenderPoolError, TileCoord,
+};
+use tokio::sync::oneshot;
 
-const WORKER_QUEUE_SIZE: usize = 128;
 const DEFAULT_STYLE_URL: &str = "https://demotiles.maplibre.org/style.json";
+const TILE_FORMAT: EncodeFormat = EncodeFormat::Png(PngCompression::Fast);
+/// Distinct flat colours (ocean, land, ...) whose encoded tile is kept.
+const SOLID_TILE_CACHE_SIZE: usize = 64;
 
 #[derive(Parser, Debug)]
 struct Args {
@@ -31,91 +36,115 @@ struct Args {
     style: url::Url,
 }
 
-/// A render job: a tile coordinate plus a channel to return the encoded PNG.
-struct RenderJob {
-    z: u8,
-    x: u32,
-    y: u32,
-    response: oneshot::Sender<Result<Vec<u8>, RenderError>>,
+struct TileRenderer {
+    pool: RenderPool,
+    // PNG encoding runs here, so render threads can start the next tile right away.
+    encoder: Arc<EncoderPool>,
+    // Every tile has the same size, so a flat tile is fully described by its colour.
+    solid_tiles: Arc<Mutex<HashMap<[u8; 4], Vec<u8>>>>,
 }
 
-struct SimpleRenderPool {
-    workers: Vec<mpsc::Sender<RenderJob>>,
-    next_worker: AtomicUsize,
-}
-
-impl SimpleRenderPool {
-    fn new(style_url: url::Url, worker_count: usize) -> Self {
-        assert!(worker_count > 0, "render pool must have at least one worker");
-
-        let workers = (0..worker_count)
-            .map(|_| {
-                let (tx, rx) = mpsc::channel(WORKER_QUEUE_SIZE);
-                let style_url = style_url.clone();
-                thread::spawn(move || render_worker(&style_url, rx));
-                tx
-            })
-            .collect();
-
-        Self { workers, next_worker: AtomicUsize::new(0) }
+impl TileRenderer {
+    fn new(style_url: url::Url, worker_count: NonZeroUsize) -> Self {
+        // Fetch the style once; the workers load it from memory.
+        let style = thread::spawn(move || {
+            let mut renderer = ImageRendererBuilder::default().build_tile_renderer();
+            renderer.load_style_from_url(&style_url).wait().expect("failed to load the style");
+            renderer.style_template().expect("the style has loaded")
+        })
+        .join()
+        .expect("style loader panicked");
+
+        let pool = RenderPoolBuilder::new().with_workers(worker_count).build(move |_| {
+            let mut renderer =
+                ImageRendererBuilder::default().with_pixel_ratio(2.0).build_tile_renderer();
+            renderer.load_style_template(&style);
+            renderer
+        });
+        Self {
+            pool,
+            encoder: Arc::new(EncoderPool::new(worker_count)),
+            solid_tiles: Arc::default(),
+        }
     }
 
     async fn render_tile(&self, z: u8, x: u32, y: u32) -> Result<Vec<u8>, RenderError> {
         let (response_tx, response_rx) = oneshot::channel();
 
-        // round-robin
-        let worker = self.next_worker.fetch_add(1, Ordering::Relaxed) % self.workers.len();
-
-        self.workers[worker]
-            .send(RenderJob { z, x, y, response: response_tx })
-            .await
-            .map_err(|_| RenderError::WorkerUnavailable)?;
-
+        let encoder = Arc::clone(&self.encoder);
+        let solid_tiles = Arc::clone(&self.solid_tiles);
+        let job =
+            self.pool.submit_tile(TileCoord::new(z, x, y), move |rendered| match rendered {
+                Ok(image) => {
+                    // Flat tiles are detected during readback; reuse their encoding.
+                    let color = image.uniform_color();
+                    let cached = color.and_then(|color| {
+                        solid_tiles
+                            .lock()
+                            .unwrap_or_else(PoisonError::into_inner)
+                            .get(&color)
+                            .cloned()
+                    });
+                    if let Some(png) = cached {
+                        let _ = response_tx.send(Ok(png));
+                        return;
+                    }
+                    encoder.encode_with(image, TILE_FORMAT, move |png| {
+                        if let (Some(color), Ok(png)) = (color, &png) {
+                            let mut solid_tiles =
+                                solid_tiles.lock().unwrap_or_else(PoisonError::into_inner);
+                            if solid_tiles.len() < SOLID_TILE_CACHE_SIZE {
+                                solid_tiles.insert(color, png.clone());
+                            }
+                        }
+                        let _ = response_tx.send(png.map_err(RenderError::from));
+                    });
+                }
+                Err(error) => {
+                    let _ = response_tx.send(Err(error.into()));
+                }
+            })?;
+
+        // If the client goes away, this future is dropped and the job is
+        // cancelled unless a worker has already started it.
+        let _cancel = CancelOnDrop(job);
         response_rx.await.map_err(|_| RenderError::WorkerUnavailable)?
     }
 }
 
-fn render_worker(style_url: &url::Url, mut rx: mpsc::Receiver<RenderJob>) {
-    let mut renderer = ImageRendererBuilder::default().with_pixel_ratio(2.0).build_tile_renderer();
-    renderer.load_style_from_url(style_url);
+/// Cancels a render job when dropped. Cancelling a finished job is a no-op.
+struct CancelOnDrop(JobHandle);
 
-    while let Some(job) = rx.blocking_recv() {
-        let result = render_and_encode(&mut renderer, &job);
-        let _ = job.response.send(result);
+impl Drop for CancelOnDrop {
+    fn drop(&mut self) {
+        self.0.cancel();
     }
 }
 
-fn render_and_encode(
-    renderer: &mut ImageRenderer<Tile>,
-    job: &RenderJob,
-) -> Result<Vec<u8>, RenderError> {
-    let image = renderer.render_tile(job.z, job.x, job.y)?;
-    let mut png = Vec::new();
-    image.as_image().write_to(&mut Cursor::new(&mut png), image::ImageFormat::Png)?;
-    Ok(png)
-}
-
 #[derive(thiserror::Error, Debug)]
 enum RenderError {
     #[error(transparent)]
-    Rendering(#[from] RenderingError),
+    Render(#[from] RenderPoolError),
     #[error(transparent)]
-    Encode(#[from] image::ImageError),
+    Encode(#[from] EncodeError),
     #[error("render worker is unavailable")]
     WorkerUnavailable,
 }
 
 async fn rendered_style_tile(
-    State(pool): State<Arc<SimpleRenderPool>>,
+    State(renderer): State<Arc<TileRenderer>>,
     Path((z, x, y)): Path<(u8, u32, u32)>,
 ) -> Result<Response, StatusCode> {
-    let png = pool.render_tile(z, x, y).await.map_err(|e| {
+    let png = renderer.render_tile(z, x, y).await.map_err(|e| {
         eprintln!("failed to render tile {z}/{x}/{y}: {e}");
-        StatusCode::INTERNAL_SERVER_ERROR
+        match e {
+            RenderError::Render(RenderPoolError::QueueFull) => StatusCode::SERVICE_UNAVAILABLE,
+            _ => StatusCode::INTERNAL_SERVER_ERROR,
+        }
     })?;
 
     Ok(Response::builder()
-        .header(header::CONTENT_TYPE, "image/png")
+        .header(header::CONTENT_TYPE, TILE_FORMAT.mime_type())
         .header(header::CACHE_CONTROL, "max-age=3600")
         .body(Body::from(png))
         .expect("valid response"))
@@ -129,8 +158,8 @@ async fn index() -> Html<&'static str> {
 async fn main() {
     let args = Args::parse();
 
-    let worker_count = thread::available_parallelism().map_or(1, usize::from);
-    let pool = Arc::new(SimpleRenderPool::new(args.style.clone(), worker_count));
+    let worker_count = thread::available_parallelism().unwrap_or(NonZeroUsize::MIN);
+    let renderer = Arc::new(TileRenderer::new(args.style.clone(), worker_count));
 
     let addr = "127.0.0.1:3000";
     println!("Server running on http://{addr}");
@@ -140,6 +169,6 @@ async fn main() {
     let app = Router::new()
         .route("/", get(index))
         .route("/{z}/{x}/{y}", get(rendered_style_tile))
-        .with_state(pool);
+        .with_state(renderer);
     axum::serve(listener, app).await.unwrap();
 }
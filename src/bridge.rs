@@ -6,7 +6,8 @@ use crate::renderer::callbacks::{
     render_requested_callback, void_callback, CameraDidChangeCallback, FailingLoadingMapCallback,
     FinishRenderingFrameCallback, RenderRequestedCallback, VoidCallback,
 };
-use crate::renderer::file_source::{BoxedFileSource, RequestHandleFfi};
+use crate::renderer::file_source::{bytes_from_native, BoxedFileSource, RequestHandleFfi};
+use crate::trace::{trace_begin, trace_end};
 
 // https://maplibre.org/maplibre-native/docs/book/design/ten-thousand-foot-view.html
 
@@ -53,7 +54,7 @@ impl Sub for ScreenCoordinate {
 
 /// A size
 #[repr(C)]
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub struct Size {
     /// Width in pixels.
     pub width: u32,
@@ -73,8 +74,78 @@ pub mod geojson {
 
         /// Parses a GeoJSON string into a MapLibre Native GeoJSON value.
         fn parse(json: &str) -> Result<UniquePtr<GeoJson>>;
+        /// Parses GeoJSON bytes into a MapLibre Native GeoJSON value.
+        fn parse_bytes(json: &[u8]) -> Result<UniquePtr<GeoJson>>;
+        /// Reads and parses a GeoJSON file.
+        fn parse_file(path: &str) -> Result<UniquePtr<GeoJson>>;
+        /// Parses the comma-separated elements of a `features` array as a `FeatureCollection`.
+        fn parse_features(features: &[u8]) -> Result<UniquePtr<GeoJson>>;
+        /// Moves the features of one `FeatureCollection` to the end of another.
+        fn append_features(target: Pin<&mut GeoJson>, features: UniquePtr<GeoJson>) -> Result<()>;
+
+        include!("geojson/columns.h");
+
+        /// Builds one point feature per coordinate.
+        fn points_from_columns(xy: &[f64]) -> Result<UniquePtr<GeoJson>>;
+        /// Builds line string features from GeoArrow offsets.
+        fn line_strings_from_columns(
+            xy: &[f64],
+            geom_offsets: &[i32],
+        ) -> Result<UniquePtr<GeoJson>>;
+        /// Builds polygon features from GeoArrow offsets.
+        fn polygons_from_columns(
+            xy: &[f64],
+            geom_offsets: &[i32],
+            ring_offsets: &[i32],
+        ) -> Result<UniquePtr<GeoJson>>;
+        /// Builds multi-point features from GeoArrow offsets.
+        fn multi_points_from_columns(
+            xy: &[f64],
+            geom_offsets: &[i32],
+        ) -> Result<UniquePtr<GeoJson>>;
+        /// Builds multi-line string features from GeoArrow offsets.
+        fn multi_line_strings_from_columns(
+            xy: &[f64],
+            geom_offsets: &[i32],
+            part_offsets: &[i32],
+        ) -> Result<UniquePtr<GeoJson>>;
+        /// Builds multi-polygon features from GeoArrow offsets.
+        fn multi_polygons_from_columns(
+            xy: &[f64],
+            geom_offsets: &[i32],
+            part_offsets: &[i32],
+            ring_offsets: &[i32],
+        ) -> Result<UniquePtr<GeoJson>>;
+        /// Sets one id per feature.
+        fn set_feature_ids(features: Pin<&mut GeoJson>, ids: &[u64]) -> Result<()>;
+        /// Sets a number property from a column with an optional validity bitmap.
+        fn set_number_property(
+            features: Pin<&mut GeoJson>,
+            name: &str,
+            values: &[f64],
+            validity: &[u8],
+        ) -> Result<()>;
+        /// Sets an integer property from a column with an optional validity bitmap.
+        fn set_integer_property(
+            features: Pin<&mut GeoJson>,
+            name: &str,
+            values: &[i64],
+            validity: &[u8],
+        ) -> Result<()>;
+        /// Sets a string property from an Arrow UTF-8 column.
+        fn set_string_property(
+            features: Pin<&mut GeoJson>,
+            name: &str,
+            data: &[u8],
+            offsets: &[i32],
+            validity: &[u8],
+        ) -> Result<()>;
+
         /// Copies a MapLibre Native GeoJSON value.
         fn clone(geojson: &GeoJson) -> UniquePtr<GeoJson>;
+        /// Compares two MapLibre Native GeoJSON values.
+        #[allow(dead_code)]
+        fn equals_for_test(a: &GeoJson, b: &GeoJson) -> bool;
         // TODO(maplibre-native#4345): can be restored once the precompiled core exposes
         // a public GeoJSON serializer
         // /// Serializes a MapLibre Native GeoJSON value to a JSON string.
@@ -88,6 +159,11 @@ impl std::fmt::Debug for geojson::GeoJson {
     }
 }
 
+// SAFETY: a `GeoJson` owns a plain value tree with no references to a renderer
+// or run loop. Property arrays that clones share are never mutated and are
+// reference-counted atomically, so the value may move across threads.
+unsafe impl Send for geojson::GeoJson {}
+
 /// FFI bindings for map source operations.
 ///
 /// This module provides C++/Rust interoperability for various source types.
@@ -159,6 +235,33 @@ pub mod sources {
         fn sourceId(self: &GeoJSONSourceHandle) -> String;
         /// Sets the GeoJSON data for this source.
         fn setGeoJson(self: Pin<&mut GeoJSONSourceHandle>, geojson: &CxxGeoJson);
+        /// Hands the store's features to this source.
+        fn setFeatures(self: Pin<&mut GeoJSONSourceHandle>, store: &FeatureStore);
+        /// Hands the store's features to this source if they changed since
+        /// they were last handed to any source.
+        fn setFeaturesIfChanged(
+            self: Pin<&mut GeoJSONSourceHandle>,
+            store: Pin<&mut FeatureStore>,
+        ) -> bool;
+
+        /// GeoJSON features keyed by id, for incremental source updates.
+        type FeatureStore;
+        /// Creates an empty feature store.
+        fn feature_store_new() -> UniquePtr<FeatureStore>;
+        /// Inserts or replaces the features of a `Feature` or `FeatureCollection` by id.
+        fn upsert(self: Pin<&mut FeatureStore>, geojson: &CxxGeoJson) -> Result<usize>;
+        /// Removes the feature with an unsigned integer id.
+        fn removeUnsigned(self: Pin<&mut FeatureStore>, id: u64) -> bool;
+        /// Removes the feature with a signed integer id.
+        fn removeSigned(self: Pin<&mut FeatureStore>, id: i64) -> bool;
+        /// Removes the feature with a floating-point id.
+        fn removeDouble(self: Pin<&mut FeatureStore>, id: f64) -> bool;
+        /// Removes the feature with a string id.
+        fn removeString(self: Pin<&mut FeatureStore>, id: &str) -> bool;
+        /// Removes every feature.
+        fn clear(self: Pin<&mut FeatureStore>);
+        /// Returns the number of features.
+        fn len(self: &FeatureStore) -> usize;
 
         /// Upcasts a GeoJSON source handle to the base `Source` type.
         fn geojson_into_source(source: UniquePtr<GeoJSONSource>) -> UniquePtr<Source>;
@@ -174,6 +277,14 @@ pub mod sources {
         fn setURL(source: &UniquePtr<GeoJSONSource>, url: &str);
         /// Sets the GeoJSON data for the source.
         fn setGeoJson(source: Pin<&mut GeoJSONSource>, geojson: &CxxGeoJson);
+        /// Hands the store's features to the source.
+        fn setFeatures(source: Pin<&mut GeoJSONSource>, store: &FeatureStore);
+        /// Hands the store's features to the source if they changed since
+        /// they were last handed to any source.
+        fn setFeaturesIfChanged(
+            source: Pin<&mut GeoJSONSource>,
+            store: Pin<&mut FeatureStore>,
+        ) -> bool;
     }
 
     // Generate `UniquePtr<SourceHandle>` support. cxx emits it only in the
@@ -378,8 +489,9 @@ pub mod layers {
 #[cxx::bridge(namespace = "mln::bridge")]
 /// FFI bindings for the style-spec value adapter.
 ///
-/// Rust builds a C++ `StyleValue` tree, and MapLibre Native's conversion layer
-/// reads it through `ConversionTraits<const StyleValue*>`.
+/// Rust serializes a value that C++ decodes into a flat `StyleDocument`, and
+/// MapLibre Native's conversion layer reads it through
+/// `ConversionTraits<StyleValue>`.
 pub mod style_value {
     #[namespace = "mbgl::style"]
     extern "C++" {
@@ -395,53 +507,33 @@ pub mod style_value {
     unsafe extern "C++" {
         include!("style_value.h");
 
-        /// Opaque C++ JSON-like value used as input to MapLibre's conversion layer.
-        type StyleValue;
+        /// Flat C++ JSON-like value used as input to MapLibre's conversion layer.
+        type StyleDocument;
 
-        /// Constructs a null `StyleValue`.
-        #[must_use]
-        fn make_null() -> UniquePtr<StyleValue>;
-        /// Constructs a boolean `StyleValue`.
-        #[must_use]
-        fn make_bool(b: bool) -> UniquePtr<StyleValue>;
-        /// Constructs a numeric `StyleValue`.
-        #[must_use]
-        fn make_number(n: f64) -> UniquePtr<StyleValue>;
-        /// Constructs a string `StyleValue`.
-        #[must_use]
-        fn make_string(s: &str) -> UniquePtr<StyleValue>;
-        /// Constructs an empty array `StyleValue`.
-        #[must_use]
-        fn make_array() -> UniquePtr<StyleValue>;
-        /// Appends a child to an array `StyleValue`.
-        fn array_push(arr: Pin<&mut StyleValue>, child: UniquePtr<StyleValue>);
-        /// Constructs an empty object `StyleValue`.
-        #[must_use]
-        fn make_object() -> UniquePtr<StyleValue>;
-        /// Inserts a child under `key` in an object `StyleValue`.
-        fn object_insert(obj: Pin<&mut StyleValue>, key: &str, child: UniquePtr<StyleValue>);
+        /// Decodes a style value serialized by `style::value`.
+        fn decode_style_document(buffer: &[u8]) -> Result<UniquePtr<StyleDocument>>;
 
-        /// Parses a style-spec layer object from a `StyleValue` tree.
+        /// Parses a style-spec layer object from a `StyleDocument`.
         /// On failure, `error_message` is populated and the returned pointer is null.
         fn layer_from_value(
-            value: &StyleValue,
+            value: &StyleDocument,
             error_message: &mut String,
         ) -> UniquePtr<StyleLayer>;
 
-        /// Parses a style-spec source object from a `StyleValue` tree.
+        /// Parses a style-spec source object from a `StyleDocument`.
         /// On failure, `error_message` is populated and the returned pointer is null.
         fn source_from_value(
             id: &str,
-            value: &StyleValue,
+            value: &StyleDocument,
             error_message: &mut String,
         ) -> UniquePtr<StyleSource>;
     }
 }
 
 #[cfg(feature = "json")]
-impl std::fmt::Debug for style_value::StyleValue {
+impl std::fmt::Debug for style_value::StyleDocument {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.debug_struct("StyleValue").finish()
+        f.debug_struct("StyleDocument").finish()
     }
 }
 
@@ -840,25 +932,28 @@ pub mod file_source {
         type RequestHandleFfi;
 
         /// Whether this source can serve the resource.
-        fn can_request(self: &BoxedFileSource, request: &RawResourceRequest) -> bool;
+        fn can_request(self: &BoxedFileSource, request: RawResourceRequest) -> bool;
 
-        /// Begin a request.
+        /// Begin a request. Taken by value so the prior body moves into Rust.
         fn request(
             self: &BoxedFileSource,
-            request: &RawResourceRequest,
+            request: RawResourceRequest,
             responder: SharedPtr<RequestState>,
         ) -> Box<RequestHandleFfi>;
 
         /// Store a response into a cache source (`FileSource::forward`).
         fn forward(
             self: &BoxedFileSource,
-            request: &RawResourceRequest,
-            response: &RawResponse,
+            request: RawResourceRequest,
+            response: RawResponse,
             completion: SharedPtr<ForwardState>,
         );
 
         /// Run the request's cancellation hook.
         fn cancel(self: &RequestHandleFfi);
+
+        /// Copy a native buffer into a `Vec<u8>` in one pass.
+        fn bytes_from_native(data: &[u8]) -> Vec<u8>;
     }
 
     unsafe extern "C++" {
@@ -973,6 +1068,18 @@ pub mod ffi {
         pub right: f64,
     }
 
+    /// FFI representation of a renderer's memory use.
+    #[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+    pub struct FfiMemoryUsage {
+        pub texture_bytes: u64,
+        pub vertex_buffer_bytes: u64,
+        pub index_buffer_bytes: u64,
+        pub uniform_buffer_bytes: u64,
+        pub other_buffer_bytes: u64,
+        pub held_image_bytes: u64,
+        pub evictions: u64,
+    }
+
     /// FFI representation of partial camera options.
     #[derive(Debug, Clone, Copy, PartialEq, Default)]
     pub struct FfiCameraOptions {
@@ -1100,6 +1207,12 @@ pub mod ffi {
         type GeoJson = super::geojson::GeoJson;
     }
 
+    extern "C++" {
+        /// Decoded style-spec value opaque type.
+        #[cfg(feature = "json")]
+        type StyleDocument = super::style_value::StyleDocument;
+    }
+
     #[namespace = "mbgl::webgpu"]
     extern "C++" {
         #[cfg(feature = "wgpu")]
@@ -1140,6 +1253,11 @@ pub mod ffi {
         /// Wakes a thread blocked in `currentThreadRunLoopWait`. Only needed on the
         /// CoreFoundation (non-libuv) run loop; a no-op on the libuv backend.
         fn currentThreadRunLoopStop();
+        /// The libuv loop's polling file descriptor, or -1 on other backends.
+        fn currentThreadRunLoopBackendFd() -> i32;
+        /// Milliseconds until the libuv loop's next timer, 0 if work is pending,
+        /// or -1 if no timer is armed or on other backends.
+        fn currentThreadRunLoopBackendTimeout() -> i32;
         /// Creates a new map renderer instance.
         #[allow(clippy::too_many_arguments)]
         fn MapRenderer_new(
@@ -1157,6 +1275,8 @@ pub mod ffi {
         fn size(self: &BridgeImage) -> Size;
         /// Gets the buffer length of a bridge image.
         fn bufferLength(self: &BridgeImage) -> usize;
+        /// Returns whether every pixel of a bridge image has the same colour.
+        fn isUniform(self: &BridgeImage) -> bool;
         /// Renders a single frame.
         fn render_once(self: Pin<&mut MapRenderer>);
         /// Sets the callback invoked when MapLibre Native requests a frame.
@@ -1164,8 +1284,12 @@ pub mod ffi {
             self: Pin<&mut MapRenderer>,
             callback: Box<RenderRequestedCallback>,
         );
-        /// Submits a render request without waiting for completion.
-        fn submitRender(self: Pin<&mut MapRenderer>) -> UniquePtr<RenderRequest>;
+        /// Queues a render at `camera` without waiting for completion. Queued
+        /// renders run back to back in submission order.
+        fn submitRender(
+            self: Pin<&mut MapRenderer>,
+            camera: &FfiCameraOptions,
+        ) -> UniquePtr<RenderRequest>;
         /// Calculates camera options that fit geographic bounds.
         fn cameraForLatLngBounds(
             self: Pin<&mut MapRenderer>,
@@ -1196,12 +1320,34 @@ pub mod ffi {
         fn hasError(self: &RenderRequest) -> bool;
         /// Returns the native error message for a failed render request.
         fn errorMessage(self: &RenderRequest) -> String;
-        /// Takes the rendered image bytes from a completed render request.
-        fn takeImage(self: Pin<&mut RenderRequest>) -> UniquePtr<CxxString>;
+        /// Returns whether a completed render produced a single-colour frame.
+        fn isUniform(self: &RenderRequest) -> bool;
+        /// Returns the RGBA bytes of a uniform frame in native byte order.
+        fn uniformPixel(self: &RenderRequest) -> u32;
+        /// Nanoseconds a completed render waited behind earlier renders.
+        fn queuedNanos(self: &RenderRequest) -> u64;
+        /// Nanoseconds from the start of a completed render to its last map update.
+        fn loadingNanos(self: &RenderRequest) -> u64;
+        /// Nanoseconds from the last map update to the finished frame.
+        fn frameNanos(self: &RenderRequest) -> u64;
+        /// Nanoseconds spent reading the finished frame back.
+        fn readbackNanos(self: &RenderRequest) -> u64;
+        /// Draw calls issued for the frame of a completed render.
+        fn drawCalls(self: &RenderRequest) -> u64;
+        /// Texture memory in use after a completed render, in bytes.
+        fn textureBytes(self: &RenderRequest) -> u64;
+        /// Buffer memory in use after a completed render, in bytes.
+        fn bufferBytes(self: &RenderRequest) -> u64;
+        /// Takes the rendered image from a completed render request.
+        fn takeImage(self: Pin<&mut RenderRequest>) -> UniquePtr<BridgeImage>;
         /// Sets debug visualization flags.
         fn setDebugFlags(self: Pin<&mut MapRenderer>, flags: MapDebugOptions);
+        /// Clears the style and camera, optionally dropping cached render data.
+        fn reset(self: Pin<&mut MapRenderer>, keep_caches: bool);
         /// Jumps to the requested camera options.
         fn jumpTo(self: Pin<&mut MapRenderer>, camera: &FfiCameraOptions);
+        /// Returns the current camera options.
+        fn cameraOptions(self: &MapRenderer) -> FfiCameraOptions;
         /// Moves the camera by the given delta.
         fn moveBy(self: Pin<&mut MapRenderer>, delta: &ScreenCoordinate);
         /// Scales the camera based on the given scale factor.
@@ -1214,10 +1360,22 @@ pub mod ffi {
             first: &ScreenCoordinate,
             second: &ScreenCoordinate,
         );
+        /// Sets how many zoom levels above the ideal tiles parent tiles are loaded.
+        fn setPrefetchZoomDelta(self: Pin<&mut MapRenderer>, delta: u8);
+        /// Requests an XYZ tile at low priority to warm the file source chain.
+        fn prefetchTile(self: Pin<&mut MapRenderer>, url_template: &str, x: i32, y: i32, z: u8);
+        /// Cancels every prefetch request still in flight.
+        fn cancelPrefetches(self: Pin<&mut MapRenderer>);
+        /// Caps GPU memory and unclaimed readbacks at `max_bytes` (0 for no cap).
+        fn setMemoryBudget(self: Pin<&mut MapRenderer>, max_bytes: u64, tile_cache: bool);
+        /// Returns the renderer's current memory use.
+        fn memoryUsage(self: Pin<&mut MapRenderer>) -> FfiMemoryUsage;
         /// Loads a style from a URL.
         fn style_load_from_url(self: Pin<&mut MapRenderer>, url: &str);
         /// Loads a style from a JSON string.
         fn style_load_from_json(self: Pin<&mut MapRenderer>, json: &str);
+        /// The JSON of the loaded style, or an empty string before it loads.
+        fn style_json(self: &MapRenderer) -> String;
         /// Sets the renderer size.
         fn setSize(self: Pin<&mut MapRenderer>, size: &Size);
         /// Gets the map observer.
@@ -1254,6 +1412,12 @@ pub mod ffi {
         ) -> Result<()>;
         /// Removes a layer from the style by ID and returns it.
         fn style_remove_layer(self: Pin<&mut MapRenderer>, id: &str) -> UniquePtr<CxxLayer>;
+        /// Applies a batch of `[layer id, property, value]` edits to the style.
+        #[cfg(feature = "json")]
+        fn style_set_layer_properties(
+            self: Pin<&mut MapRenderer>,
+            edits: &StyleDocument,
+        ) -> Result<()>;
 
         #[cfg(feature = "wgpu")]
         fn setDeviceAndQueue(self: Pin<&mut MapRenderer>, device: WGPUDevice, queue: WGPUQueue);
@@ -1278,6 +1442,29 @@ pub mod ffi {
 
         /// Bridge logging from C++ to Rust log crate
         fn log_from_cpp(severity: EventSeverity, event: Event, code: i64, message: &str);
+
+        /// Opens a native tracing span.
+        fn trace_begin(span: u8, id: u64, detail: &str);
+        /// Closes a native tracing span.
+        fn trace_end(span: u8, id: u64);
+    }
+
+    unsafe extern "C++" {
+        include!("trace.h");
+
+        /// Switches native span reporting on or off.
+        #[allow(dead_code)]
+        fn setTraceEnabled(enabled: bool);
+    }
+
+    unsafe extern "C++" {
+        include!("premultiply.h");
+
+        #[allow(dead_code)]
+        fn unpremultiply_for_test(data: &mut [u8]) -> bool;
+
+        #[allow(dead_code)]
+        fn premultiply_for_test(data: &mut [u8]);
     }
 
     unsafe extern "C++" {
@@ -1294,6 +1481,12 @@ impl std::fmt::Debug for ffi::BridgeImage {
     }
 }
 
+// SAFETY: a `BridgeImage` exclusively owns a plain pixel buffer and holds no
+// references into the renderer or its run loop, so it may move across threads.
+unsafe impl Send for ffi::BridgeImage {}
+// SAFETY: all `BridgeImage` methods take `&self` and only read the buffer.
+unsafe impl Sync for ffi::BridgeImage {}
+
 impl std::fmt::Debug for ffi::MapObserver {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
         f.debug_struct("MapObserver").finish()
@@ -1318,8 +1511,69 @@ unsafe impl cxx::ExternType for ScreenCoordinate {
 
 #[cfg(test)]
 mod test {
+    use super::ffi::{premultiply_for_test, unpremultiply_for_test};
     use crate::ScreenCoordinate;
 
+    /// Every colour/alpha combination, padded so the SIMD tails are exercised too.
+    fn all_pixels() -> Vec<u8> {
+        let mut data = Vec::with_capacity(256 * 256 * 4 + 12);
+        for alpha in 0..=255_u8 {
+            for colour in 0..=255_u8 {
+                data.extend_from_slice(&[colour, !colour, colour ^ 0x55, alpha]);
+            }
+        }
+        data.extend_from_slice(&[10, 20, 30, 40, 50, 60, 70, 255, 80, 90, 100, 0]);
+        data
+    }
+
+    #[test]
+    #[allow(clippy::cast_possible_truncation)]
+    fn unpremultiply_matches_scalar_reference() {
+        let mut data = all_pixels();
+        let mut expected = data.clone();
+        for px in expected.chunks_exact_mut(4) {
+            let alpha = u32::from(px[3]);
+            if alpha != 0 {
+                for c in &mut px[..3] {
+                    *c = ((255 * u32::from(*c) + alpha / 2) / alpha) as u8;
+                }
+            }
+        }
+        assert!(!unpremultiply_for_test(&mut data));
+        assert_eq!(data, expected);
+    }
+
+    #[test]
+    fn unpremultiply_detects_uniform_frames() {
+        // Lengths covering the AVX2, SSE4.1 and scalar paths.
+        for pixels in [1, 3, 4, 8, 13, 64, 67] {
+            let mut data = [40, 30, 20, 128].repeat(pixels);
+            assert!(unpremultiply_for_test(&mut data), "{pixels} equal pixels");
+
+            for index in [0, pixels / 2, pixels - 1] {
+                let mut data = [40, 30, 20, 128].repeat(pixels);
+                data[index * 4 + 1] ^= 1;
+                assert_eq!(unpremultiply_for_test(&mut data), pixels == 1, "{pixels} pixels");
+            }
+        }
+        assert!(!unpremultiply_for_test(&mut []));
+    }
+
+    #[test]
+    #[allow(clippy::cast_possible_truncation)]
+    fn premultiply_matches_scalar_reference() {
+        let mut data = all_pixels();
+        let mut expected = data.clone();
+        for px in expected.chunks_exact_mut(4) {
+            let alpha = u32::from(px[3]);
+            for c in &mut px[..3] {
+                *c = ((u32::from(*c) * alpha + 127) / 255) as u8;
+            }
+        }
+        premultiply_for_test(&mut data);
+        assert_eq!(data, expected);
+    }
+
     #[test]
     fn screen_coordinate_diff() {
         let s1 = ScreenCoordinate { x: 5., y: -1. };
@@ -132,5 +132,13 @@ void MapRenderer::jumpTo(const FfiCameraOptions& cameraOptions) {
     map->jumpTo(toCameraOptions(cameraOptions));
 }
 
+FfiCameraOptions MapRenderer::cameraOptions() const {
+    return fromCameraOptions(map->getCameraOptions());
+}
+
+std::unique_ptr<RenderRequest> MapRenderer::submitRender(const FfiCameraOptions& camera) {
+    return enqueueRender(toCameraOptions(camera));
+}
+
 } // namespace bridge
 } // namespace mln
@@ -0,0 +1,218 @@
+#include "columns.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace mln::bridge::geojson {
+
+namespace {
+
+using Features = mapbox::feature::feature_collection<double>;
+using Offsets = rust::Slice<const int32_t>;
+
+// Checks that `offsets` split `count` children into runs and returns the
+// number of runs.
+std::size_t runs(Offsets offsets, std::size_t count, const char* name) {
+    if (offsets.empty()) {
+        throw std::invalid_argument(std::string(name) + " must hold at least one offset");
+    }
+    if (offsets[0] < 0) {
+        throw std::invalid_argument(std::string(name) + " must not be negative");
+    }
+    for (std::size_t i = 1; i < offsets.size(); ++i) {
+        if (offsets[i] < offsets[i - 1]) {
+            throw std::invalid_argument(std::string(name) + " must not decrease");
+        }
+    }
+    if (static_cast<std::size_t>(offsets[offsets.size() - 1]) > count) {
+        throw std::invalid_argument(std::string(name) + " exceed the data they index");
+    }
+    return offsets.size() - 1;
+}
+
+std::size_t coordinateCount(rust::Slice<const double> xy) {
+    if (xy.size() % 2 != 0) {
+        throw std::invalid_argument("coordinates must hold x, y pairs");
+    }
+    return xy.size() / 2;
+}
+
+// The points `begin..end` of `xy` as a `Container` of points.
+template <class Container>
+Container points(rust::Slice<const double> xy, std::size_t begin, std::size_t end) {
+    Container container;
+    container.reserve(end - begin);
+    for (std::size_t i = begin; i < end; ++i) {
+        container.emplace_back(xy[2 * i], xy[2 * i + 1]);
+    }
+    return container;
+}
+
+// The runs `begin..end` of `offsets`, each built by `child(first, last)`.
+template <class Container, class Child>
+Container nested(Offsets offsets, std::size_t begin, std::size_t end, Child child) {
+    Container container;
+    container.reserve(end - begin);
+    for (std::size_t i = begin; i < end; ++i) {
+        container.push_back(child(static_cast<std::size_t>(offsets[i]), static_cast<std::size_t>(offsets[i + 1])));
+    }
+    return container;
+}
+
+template <class Geometry>
+std::unique_ptr<GeoJson> collect(std::size_t count, Geometry geometry) {
+    Features features;
+    features.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        mapbox::feature::feature<double> feature;
+        feature.geometry = geometry(i);
+        features.push_back(std::move(feature));
+    }
+    return std::make_unique<GeoJson>(std::move(features));
+}
+
+Features& featuresOf(GeoJson& geojson, std::size_t columnSize, const char* column) {
+    if (!geojson.get().is<Features>()) {
+        throw std::invalid_argument("expected a GeoJSON FeatureCollection");
+    }
+    auto& features = geojson.get().get<Features>();
+    if (columnSize != features.size()) {
+        throw std::invalid_argument(std::string(column) + " must hold one value per feature");
+    }
+    return features;
+}
+
+bool isValid(rust::Slice<const uint8_t> validity, std::size_t i) {
+    return validity.empty() || ((validity[i / 8] >> (i % 8)) & 1) != 0;
+}
+
+void checkValidity(rust::Slice<const uint8_t> validity, std::size_t count) {
+    if (!validity.empty() && validity.size() < (count + 7) / 8) {
+        throw std::invalid_argument("validity bitmap is shorter than its column");
+    }
+}
+
+template <class Value>
+void setProperty(GeoJson& geojson,
+                 rust::Str name,
+                 rust::Slice<const Value> values,
+                 rust::Slice<const uint8_t> validity) {
+    auto& features = featuresOf(geojson, values.size(), "property column");
+    checkValidity(validity, values.size());
+    const std::string key(name);
+    for (std::size_t i = 0; i < features.size(); ++i) {
+        if (isValid(validity, i)) {
+            features[i].properties.insert_or_assign(key, mapbox::feature::value(values[i]));
+        }
+    }
+}
+
+} // namespace
+
+std::unique_ptr<GeoJson> points_from_columns(rust::Slice<const double> xy) {
+    return collect(coordinateCount(xy), [&](std::size_t i) {
+        return mapbox::geometry::point<double>(xy[2 * i], xy[2 * i + 1]);
+    });
+}
+
+std::unique_ptr<GeoJson> line_strings_from_columns(rust::Slice<const double> xy, Offsets geomOffsets) {
+    const auto count = runs(geomOffsets, coordinateCount(xy), "geometry offsets");
+    return collect(count, [&](std::size_t i) {
+        return points<mapbox::geometry::line_string<double>>(xy, geomOffsets[i], geomOffsets[i + 1]);
+    });
+}
+
+std::unique_ptr<GeoJson> polygons_from_columns(rust::Slice<const double> xy,
+                                               Offsets geomOffsets,
+                                               Offsets ringOffsets) {
+    const auto rings = runs(ringOffsets, coordinateCount(xy), "ring offsets");
+    const auto count = runs(geomOffsets, rings, "geometry offsets");
+    return collect(count, [&](std::size_t i) {
+        return nested<mapbox::geometry::polygon<double>>(
+            ringOffsets, geomOffsets[i], geomOffsets[i + 1], [&](std::size_t begin, std::size_t end) {
+                return points<mapbox::geometry::linear_ring<double>>(xy, begin, end);
+            });
+    });
+}
+
+std::unique_ptr<GeoJson> multi_points_from_columns(rust::Slice<const double> xy, Offsets geomOffsets) {
+    const auto count = runs(geomOffsets, coordinateCount(xy), "geometry offsets");
+    return collect(count, [&](std::size_t i) {
+        return points<mapbox::geometry::multi_point<double>>(xy, geomOffsets[i], geomOffsets[i + 1]);
+    });
+}
+
+std::unique_ptr<GeoJson> multi_line_strings_from_columns(rust::Slice<const double> xy,
+                                                         Offsets geomOffsets,
+                                                         Offsets partOffsets) {
+    const auto parts = runs(partOffsets, coordinateCount(xy), "part offsets");
+    const auto count = runs(geomOffsets, parts, "geometry offsets");
+    return collect(count, [&](std::size_t i) {
+        return nested<mapbox::geometry::multi_line_string<double>>(
+            partOffsets, geomOffsets[i], geomOffsets[i + 1], [&](std::size_t begin, std::size_t end) {
+                return points<mapbox::geometry::line_string<double>>(xy, begin, end);
+            });
+    });
+}
+
+std::unique_ptr<GeoJson> multi_polygons_from_columns(rust::Slice<const double> xy,
+                                                     Offsets geomOffsets,
+                                                     Offsets partOffsets,
+                                                     Offsets ringOffsets) {
+    const auto rings = runs(ringOffsets, coordinateCount(xy), "ring offsets");
+    const auto parts = runs(partOffsets, rings, "part offsets");
+    const auto count = runs(geomOffsets, parts, "geometry offsets");
+    return collect(count, [&](std::size_t i) {
+        return nested<mapbox::geometry::multi_polygon<double>>(
+            partOffsets, geomOffsets[i], geomOffsets[i + 1], [&](std::size_t polygonBegin, std::size_t polygonEnd) {
+                return nested<mapbox::geometry::polygon<double>>(
+                    ringOffsets, polygonBegin, polygonEnd, [&](std::size_t begin, std::size_t end) {
+                        return points<mapbox::geometry::linear_ring<double>>(xy, begin, end);
+                    });
+            });
+    });
+}
+
+void set_feature_ids(GeoJson& geojson, rust::Slice<const uint64_t> ids) {
+    auto& features = featuresOf(geojson, ids.size(), "id column");
+    for (std::size_t i = 0; i < features.size(); ++i) {
+        features[i].id = ids[i];
+    }
+}
+
+void set_number_property(GeoJson& geojson,
+                         rust::Str name,
+                         rust::Slice<const double> values,
+                         rust::Slice<const uint8_t> validity) {
+    setProperty(geojson, name, values, validity);
+}
+
+void set_integer_property(GeoJson& geojson,
+                          rust::Str name,
+                          rust::Slice<const int64_t> values,
+                          rust::Slice<const uint8_t> validity) {
+    setProperty(geojson, name, values, validity);
+}
+
+void set_string_property(GeoJson& geojson,
+                         rust::Str name,
+                         rust::Slice<const uint8_t> data,
+                         Offsets offsets,
+                         rust::Slice<const uint8_t> validity) {
+    const auto count = runs(offsets, data.size(), "string offsets");
+    auto& features = featuresOf(geojson, count, "property column");
+    checkValidity(validity, count);
+    const std::string key(name);
+    const auto* chars = reinterpret_cast<const char*>(data.data());
+    for (std::size_t i = 0; i < count; ++i) {
+        if (isValid(validity, i)) {
+            const auto begin = static_cast<std::size_t>(offsets[i]);
+            const auto end = static_cast<std::size_t>(offsets[i + 1]);
+            features[i].properties.insert_or_assign(key, mapbox::feature::value(std::string(chars + begin, end - begin)));
+        }
+    }
+}
+
+} // namespace mln::bridge::geojson
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "geojson.h"
+#include "rust/cxx.h"
+#include <cstdint>
+#include <memory>
+
+namespace mln::bridge::geojson {
+
+// Builds FeatureCollections from columnar buffers in GeoArrow's native
+// layout: interleaved x, y coordinates, with Arrow offset arrays that split
+// them into rings, parts and geometries. Geometry `i` spans
+// `offsets[i]..offsets[i + 1]` of the next level down. Every buffer is
+// borrowed and read once; the features are built with exact reserves.
+
+std::unique_ptr<GeoJson> points_from_columns(rust::Slice<const double> xy);
+
+std::unique_ptr<GeoJson> line_strings_from_columns(rust::Slice<const double> xy,
+                                                   rust::Slice<const int32_t> geomOffsets);
+
+std::unique_ptr<GeoJson> polygons_from_columns(rust::Slice<const double> xy,
+                                               rust::Slice<const int32_t> geomOffsets,
+                                               rust::Slice<const int32_t> ringOffsets);
+
+std::unique_ptr<GeoJson> multi_points_from_columns(rust::Slice<const double> xy,
+                                                   rust::Slice<const int32_t> geomOffsets);
+
+std::unique_ptr<GeoJson> multi_line_strings_from_columns(rust::Slice<const double> xy,
+                                                         rust::Slice<const int32_t> geomOffsets,
+                                                         rust::Slice<const int32_t> partOffsets);
+
+std::unique_ptr<GeoJson> multi_polygons_from_columns(rust::Slice<const double> xy,
+                                                     rust::Slice<const int32_t> geomOffsets,
+                                                     rust::Slice<const int32_t> partOffsets,
+                                                     rust::Slice<const int32_t> ringOffsets);
+
+// Property columns hold one value per feature. `validity` is an Arrow
+// validity bitmap (bit `i`, least significant first, is set for valid values)
+// or empty when every value is valid; null values are left out.
+
+void set_feature_ids(GeoJson& features, rust::Slice<const uint64_t> ids);
+
+void set_number_property(GeoJson& features,
+                         rust::Str name,
+                         rust::Slice<const double> values,
+                         rust::Slice<const uint8_t> validity);
+
+void set_integer_property(GeoJson& features,
+                          rust::Str name,
+                          rust::Slice<const int64_t> values,
+                          rust::Slice<const uint8_t> validity);
+
+// `data` holds the UTF-8 strings back to back, split by Arrow `offsets`.
+void set_string_property(GeoJson& features,
+                         rust::Str name,
+                         rust::Slice<const uint8_t> data,
+                         rust::Slice<const int32_t> offsets,
+                         rust::Slice<const uint8_t> validity);
+
+} // namespace mln::bridge::geojson
@@ -2,8 +2,12 @@
 
 #include <mbgl/style/conversion/geojson.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <iterator>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace mln::bridge::geojson {
@@ -14,19 +18,81 @@ const mbgl::GeoJSON& GeoJson::get() const {
     return value_;
 }
 
-std::unique_ptr<GeoJson> parse(rust::Str json) {
+mbgl::GeoJSON& GeoJson::get() {
+    return value_;
+}
+
+namespace {
+
+std::unique_ptr<GeoJson> parseString(const std::string& json) {
     mbgl::style::conversion::Error error;
-    auto geojson = mbgl::style::conversion::parseGeoJSON(std::string(json), error);
+    auto geojson = mbgl::style::conversion::parseGeoJSON(json, error);
     if (!geojson) {
         throw std::runtime_error(error.message.empty() ? "failed to parse GeoJSON" : error.message);
     }
     return std::make_unique<GeoJson>(std::move(*geojson));
 }
 
+mapbox::feature::feature_collection<double>& featureCollection(GeoJson& geojson) {
+    if (!geojson.get().is<mapbox::feature::feature_collection<double>>()) {
+        throw std::invalid_argument("expected a GeoJSON FeatureCollection");
+    }
+    return geojson.get().get<mapbox::feature::feature_collection<double>>();
+}
+
+} // namespace
+
+std::unique_ptr<GeoJson> parse(rust::Str json) {
+    return parseString(std::string(json));
+}
+
+std::unique_ptr<GeoJson> parse_bytes(rust::Slice<const uint8_t> json) {
+    return parseString(std::string(reinterpret_cast<const char*>(json.data()), json.size()));
+}
+
+std::unique_ptr<GeoJson> parse_file(rust::Str path) {
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("failed to open GeoJSON file " + std::string(path));
+    }
+    const auto size = file.tellg();
+    if (size < 0) {
+        throw std::runtime_error("failed to read GeoJSON file " + std::string(path));
+    }
+    std::string json(static_cast<std::size_t>(size), '\0');
+    file.seekg(0);
+    if (!file.read(json.data(), static_cast<std::streamsize>(json.size()))) {
+        throw std::runtime_error("failed to read GeoJSON file " + std::string(path));
+    }
+    return parseString(json);
+}
+
+std::unique_ptr<GeoJson> parse_features(rust::Slice<const uint8_t> features) {
+    static constexpr std::string_view prefix = R"({"type":"FeatureCollection","features":[)";
+    static constexpr std::string_view suffix = "]}";
+    std::string json;
+    json.reserve(prefix.size() + features.size() + suffix.size());
+    json.append(prefix);
+    json.append(reinterpret_cast<const char*>(features.data()), features.size());
+    json.append(suffix);
+    return parseString(json);
+}
+
+void append_features(GeoJson& target, std::unique_ptr<GeoJson> features) {
+    auto& into = featureCollection(target);
+    auto& from = featureCollection(*features);
+    into.reserve(into.size() + from.size());
+    std::move(from.begin(), from.end(), std::back_inserter(into));
+}
+
 std::unique_ptr<GeoJson> clone(const GeoJson& geojson) {
     return std::make_unique<GeoJson>(geojson.get());
 }
 
+bool equals_for_test(const GeoJson& a, const GeoJson& b) {
+    return a.get() == b.get();
+}
+
 // TODO(maplibre-native#4345): can be restored once the precompiled core exposes a
 // public GeoJSON serializer. `mapbox::geojson::stringify` is localized (hidden) by the
 // amalgam, and maplibre-native#4345 adds `mbgl::style::conversion::stringifyGeoJSON`.
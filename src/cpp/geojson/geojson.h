@@ -2,6 +2,7 @@
 
 #include <mbgl/util/geojson.hpp>
 #include "rust/cxx.h"
+#include <cstdint>
 #include <memory>
 
 namespace mln::bridge::geojson {
@@ -11,6 +12,7 @@ public:
     explicit GeoJson(mbgl::GeoJSON value);
 
     const mbgl::GeoJSON& get() const;
+    mbgl::GeoJSON& get();
 
 private:
     mbgl::GeoJSON value_;
@@ -18,8 +20,25 @@ private:
 
 std::unique_ptr<GeoJson> parse(rust::Str json);
 
+std::unique_ptr<GeoJson> parse_bytes(rust::Slice<const uint8_t> json);
+
+// Reads and parses a file into one buffer, without a copy on the Rust side.
+std::unique_ptr<GeoJson> parse_file(rust::Str path);
+
+// Parses the comma-separated features of a FeatureCollection's `features`
+// array as a FeatureCollection of their own.
+std::unique_ptr<GeoJson> parse_features(rust::Slice<const uint8_t> features);
+
+// Moves the features of the FeatureCollection `features` to the end of the
+// FeatureCollection `target`.
+void append_features(GeoJson& target, std::unique_ptr<GeoJson> features);
+
 std::unique_ptr<GeoJson> clone(const GeoJson& geojson);
 
+// Whether two values hold the same geometries, ids and properties; numbers
+// only match if they have the same type.
+bool equals_for_test(const GeoJson& a, const GeoJson& b);
+
 // TODO(maplibre-native#4345): can be restored alongside the implementation in geojson.cpp.
 // rust::String stringify(const GeoJson& geojson);
 
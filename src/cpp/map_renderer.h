@@ -2,18 +2,20 @@
 
 #include <mbgl/actor/scheduler.hpp>
 #include <mbgl/gfx/backend_scope.hpp>
+#include <mbgl/gfx/context.hpp>
 #include <mbgl/gfx/headless_frontend.hpp>
 #include <mbgl/gfx/renderer_backend.hpp>
+#include <mbgl/gfx/rendering_stats.hpp>
 #include <mbgl/style/image.hpp>
 #include <mbgl/style/layer.hpp>
 #include <mbgl/map/map.hpp>
 #include <mbgl/map/map_observer.hpp>
 #include <mbgl/map/map_options.hpp>
+#include <mbgl/renderer/renderer.hpp>
 #include <mbgl/style/style.hpp>
 #include <mbgl/style/source.hpp>
 #include <mbgl/util/image.hpp>
 #include <mbgl/util/run_loop.hpp>
-#include <mbgl/util/premultiply.hpp>
 #include <mbgl/util/tile_server_options.hpp>
 #include <mbgl/util/size.hpp>
 #include <mbgl/storage/resource_options.hpp>
@@ -25,8 +27,12 @@
 #endif
 
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <cassert>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -34,7 +40,11 @@
 #include "rust/cxx.h"
 #include "rust_log_observer.h"
 #include "map_observer.h"
+#include "prefetch.h"
+#include "premultiply.h"
 #include "sources/sources.h"
+#include "style_value.h"
+#include "trace.h"
 
 #if (!defined(__APPLE__) || defined(MLN_DARWIN_USE_LIBUV)) && __has_include(<uv.h>)
 #include <uv.h>
@@ -43,6 +53,8 @@ struct uv_loop_s;
 using uv_loop_t = uv_loop_s;
 enum uv_run_mode { UV_RUN_DEFAULT = 0, UV_RUN_ONCE, UV_RUN_NOWAIT };
 extern "C" int uv_run(uv_loop_t*, uv_run_mode);
+extern "C" int uv_backend_fd(const uv_loop_t*);
+extern "C" int uv_backend_timeout(const uv_loop_t*);
 #endif
 
 namespace mln {
@@ -55,9 +67,9 @@ void render_requested_callback(const RenderRequestedCallback& callback) noexcept
 
 constexpr size_t BYTES_PER_PIXEL = 4; // rgba
 
-struct BridgeImage;
 class RenderRequest;
 struct FfiCameraOptions;
+struct FfiMemoryUsage;
 struct LatLng;
 struct LatLngBounds;
 struct EdgeInsets;
@@ -108,6 +120,28 @@ inline void currentThreadRunLoopStop() {
 #endif
 }
 
+// The libuv loop's polling file descriptor (an epoll or kqueue fd), which is
+// readable whenever the loop has I/O to process, or -1 on other backends.
+inline int currentThreadRunLoopBackendFd() {
+#if defined(__APPLE__) && !defined(MLN_DARWIN_USE_LIBUV)
+    return -1;
+#else
+    bindThreadRunLoop();
+    return uv_backend_fd(static_cast<uv_loop_t*>(mbgl::util::RunLoop::getLoopHandle()));
+#endif
+}
+
+// Milliseconds until the libuv loop's next timer is due: 0 if it has work
+// pending already, -1 if no timer is armed or on other backends.
+inline int currentThreadRunLoopBackendTimeout() {
+#if defined(__APPLE__) && !defined(MLN_DARWIN_USE_LIBUV)
+    return -1;
+#else
+    bindThreadRunLoop();
+    return uv_backend_timeout(static_cast<uv_loop_t*>(mbgl::util::RunLoop::getLoopHandle()));
+#endif
+}
+
 inline bool run_loop_uses_libuv() noexcept {
 #if defined(__APPLE__) && !defined(MLN_DARWIN_USE_LIBUV)
     return false;
@@ -116,24 +150,80 @@ inline bool run_loop_uses_libuv() noexcept {
 #endif
 }
 
-inline std::unique_ptr<std::string> encodeImage(mbgl::PremultipliedImage image) {
-    auto unpremultipliedImage = mbgl::util::unpremultiply(std::move(image));
+struct BridgeImage {
+    public:
+        BridgeImage(std::unique_ptr<uint8_t[]> data, mbgl::Size size, bool uniform = false)
+            : mSize(size), mData(std::move(data)), mUniform(uniform) {}
+
+        const uint8_t* get() const {
+            return mData.get();
+        }
+
+        size_t bufferLength() const {
+            const size_t pixelCount = mSize.width * mSize.height;
+            return pixelCount * BYTES_PER_PIXEL;
+        }
 
-    const size_t pixelCount = unpremultipliedImage.size.width * unpremultipliedImage.size.height;
-    std::string data;
-    data.reserve(2 * sizeof(uint32_t) + pixelCount * BYTES_PER_PIXEL);
+        mbgl::Size size() const {
+            return mSize;
+        }
 
-    uint32_t width = unpremultipliedImage.size.width;
-    uint32_t height = unpremultipliedImage.size.height;
-    data.append(reinterpret_cast<const char*>(&width), sizeof(uint32_t));
-    data.append(reinterpret_cast<const char*>(&height), sizeof(uint32_t));
+        // Whether every pixel has the same colour, e.g. an open-ocean tile.
+        bool isUniform() const {
+            return mUniform;
+        }
 
-    const char* pixelData = reinterpret_cast<const char*>(unpremultipliedImage.data.get());
-    data.append(pixelData, pixelCount * BYTES_PER_PIXEL);
+    private:
+        mbgl::Size mSize;
+        std::unique_ptr<uint8_t[]> mData;
+        bool mUniform;
+};
 
-    return std::make_unique<std::string>(std::move(data));
+// Unpremultiplies the frame in place and hands its pixel buffer to a
+// BridgeImage, so the readback reaches Rust without further copies. The same
+// pass records whether the frame is a single flat colour.
+inline std::unique_ptr<BridgeImage> makeBridgeImage(mbgl::PremultipliedImage image) {
+    const bool uniform = unpremultiplyInPlace(image.data.get(), image.bytes());
+    return std::make_unique<BridgeImage>(std::move(image.data), image.size, uniform);
 }
 
+using RenderClock = std::chrono::steady_clock;
+
+// Phase boundaries and GPU resource counts of one still render.
+struct RenderMetrics {
+    RenderClock::time_point submitted = RenderClock::now();
+    RenderClock::time_point started;
+    // The last map update before the frame, i.e. when the final tile, glyph
+    // or sprite finished loading and laying out.
+    RenderClock::time_point settled;
+    RenderClock::time_point rendered;
+    RenderClock::duration readback{};
+    uint64_t drawCalls = 0;
+    uint64_t textureBytes = 0;
+    uint64_t bufferBytes = 0;
+};
+
+inline uint64_t toNanos(RenderClock::duration duration) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+// Completion state shared between a RenderRequest and its renderStill callback.
+struct RenderState {
+    // Closes the spans of a render that never finished, such as one still
+    // queued when its MapRenderer goes away; finished spans are no-ops here.
+    ~RenderState() {
+        traceEnd(TraceSpan::Readback, traceId);
+        traceEnd(TraceSpan::RenderStill, traceId);
+        traceEnd(TraceSpan::Render, traceId);
+    }
+
+    bool ready = false;
+    std::exception_ptr error;
+    std::unique_ptr<BridgeImage> image;
+    RenderMetrics metrics;
+    uint64_t traceId = nextTraceId();
+};
+
 class HostFrontend final : public mbgl::HeadlessFrontend {
 public:
     HostFrontend(mbgl::Size size, float pixelRatio, bool invalidateOnUpdate)
@@ -149,14 +239,20 @@ public:
     }
 
     void update(std::shared_ptr<mbgl::UpdateParameters> updateParameters) override {
+        lastUpdate = RenderClock::now();
         mbgl::HeadlessFrontend::update(std::move(updateParameters));
         if (renderRequestedCallback) {
             render_requested_callback(*(*renderRequestedCallback));
         }
     }
 
+    RenderClock::time_point lastUpdateTime() const {
+        return lastUpdate;
+    }
+
 private:
     std::optional<rust::Box<RenderRequestedCallback>> renderRequestedCallback;
+    RenderClock::time_point lastUpdate;
 };
 
 class MapRenderer {
@@ -198,7 +294,9 @@ public:
                          mbgl::Size size,
                          float pixel_ratio,
                          bool signed_distance_field) {
+        // Rust hands over straight-alpha RGBA; MapLibre Native expects premultiplied.
         mbgl::PremultipliedImage image(size, data.data(), data.size());
+        premultiplyInPlace(image.data.get(), image.bytes());
 
         map->getStyle().addImage(std::make_unique<mbgl::style::Image>(
             std::string(id), std::move(image), pixel_ratio, signed_distance_field));
@@ -235,6 +333,10 @@ public:
         return map->getStyle().removeLayer(std::string(id));
     }
 
+    void style_set_layer_properties(const StyleDocument& edits) {
+        set_layer_properties(map->getStyle(), edits);
+    }
+
     void style_load_from_url(const rust::Str styleUrl) {
         map->getStyle().loadURL((std::string)styleUrl);
     }
@@ -243,10 +345,12 @@ public:
         map->getStyle().loadJSON((std::string)styleJson);
     }
 
+    rust::String style_json() const {
+        return rust::String::lossy(map->getStyle().getJSON());
+    }
+
     std::unique_ptr<BridgeImage> readStillImage() {
-        auto image = frontend->readStillImage();
-        auto unpremultipliedImage = mbgl::util::unpremultiply(std::move(image));
-        return std::make_unique<BridgeImage>(std::move(unpremultipliedImage.data), unpremultipliedImage.size);
+        return makeBridgeImage(frontend->readStillImage());
     }
 
     void render_once() {
@@ -254,13 +358,17 @@ public:
         currentThreadRunLoopTick();
 #endif
         frontend->renderFrame();
+        enforceMemoryBudget();
     }
 
     void setRenderRequestedCallback(rust::Box<RenderRequestedCallback> callback) {
         frontend->setRenderRequestedCallback(std::move(callback));
     }
 
-    std::unique_ptr<RenderRequest> submitRender();
+    // Queues a still render at `camera`. Queued renders run back to back: each
+    // one is started from the completion callback of the previous one, so the
+    // GPU does not wait for the host between frames.
+    std::unique_ptr<RenderRequest> submitRender(const FfiCameraOptions& camera);
 
     FfiCameraOptions cameraForLatLngBounds(const LatLngBounds& bounds,
                                            const EdgeInsets& padding,
@@ -277,10 +385,6 @@ public:
                                       double bearing,
                                       double pitch);
 
-    std::unique_ptr<std::string> readStillImageBytes() {
-        return encodeImage(frontend->readStillImage());
-    }
-
     void setSize(const mbgl::Size& size) {
         if (size.width == 0 || size.height == 0)
             return;
@@ -292,7 +396,29 @@ public:
         map->setDebug(debugFlags);
     }
 
+    // Swaps in a blank style and the default camera, keeping the frontend with
+    // its GPU context and compiled programs. HeadlessFrontend::reset() would
+    // destroy the renderer for good, so cached render data is dropped through
+    // Renderer::clearData() instead, and only when asked to.
+    void reset(bool keepCaches) {
+        map->getStyle().loadJSON(R"({"version":8,"sources":{},"layers":[]})");
+        map->jumpTo(mbgl::CameraOptions()
+                        .withCenter(mbgl::LatLng())
+                        .withPadding(mbgl::EdgeInsets())
+                        .withZoom(0.0)
+                        .withBearing(0.0)
+                        .withPitch(0.0));
+        map->setDebug(mbgl::MapDebugOptions::NoDebug);
+        cancelPrefetches();
+        if (!keepCaches) {
+            if (auto* renderer = frontend->getRenderer()) {
+                renderer->clearData();
+            }
+        }
+    }
+
     void jumpTo(const FfiCameraOptions& cameraOptions);
+    FfiCameraOptions cameraOptions() const;
 
     void moveBy(const mbgl::ScreenCoordinate& delta) {
         map->moveBy(delta);
@@ -310,6 +436,37 @@ public:
         map->rotateBy(first, second);
     }
 
+    // How many zoom levels above the ideal tiles MapLibre Native loads parent
+    // tiles for, as placeholders while the ideal tiles load.
+    void setPrefetchZoomDelta(uint8_t delta) {
+        map->setPrefetchZoomDelta(delta);
+    }
+
+    void prefetchTile(rust::Str urlTemplate, int32_t x, int32_t y, uint8_t z) {
+        if (!prefetcher) {
+            prefetcher = std::make_unique<TilePrefetcher>(map->getResourceOptions(), map->getClientOptions());
+        }
+        prefetcher->request(std::string(urlTemplate), map->getMapOptions().pixelRatio(), x, y, z);
+    }
+
+    void cancelPrefetches() {
+        if (prefetcher) {
+            prefetcher->cancelAll();
+        }
+    }
+
+    // Caps the GPU memory of this renderer at `maxBytes`, or lifts the cap
+    // with 0. A render that ends over the cap releases the cached tiles
+    // outside the view. Unclaimed readbacks are reported but not counted, as
+    // releasing tiles cannot free them. MapLibre Native sizes its tile cache
+    // from the viewport, so it can only be turned off, not resized.
+    void setMemoryBudget(uint64_t maxBytes, bool tileCache) {
+        memoryBudget = maxBytes;
+        map->setTileCacheEnabled(tileCache);
+    }
+
+    FfiMemoryUsage memoryUsage();
+
     // Set the wgpu device and queue required for rendering when using the wgpu ffi backend
     #if defined(MLN_WEBGPU_IMPL_FFI)
     void setDeviceAndQueue(WGPUDevice device, WGPUQueue queue) {
@@ -323,15 +480,94 @@ public:
     std::unique_ptr<HostFrontend> frontend;
     std::shared_ptr<MapObserver> mapObserverInstance;
     std::unique_ptr<mbgl::Map> map;
+
+private:
+    std::unique_ptr<TilePrefetcher> prefetcher;
+
+    struct QueuedRender {
+        mbgl::CameraOptions camera;
+        std::shared_ptr<RenderState> state;
+    };
+
+    std::unique_ptr<RenderRequest> enqueueRender(mbgl::CameraOptions camera);
+    void startNextRender();
+
+    void recordFrameStats(RenderMetrics& metrics) {
+        const auto stats = renderingStats();
+        metrics.drawCalls = static_cast<uint64_t>(stats.numDrawCalls);
+        metrics.textureBytes = static_cast<uint64_t>(stats.memTextures);
+        metrics.bufferBytes = bufferBytes(stats);
+    }
+
+    mbgl::gfx::RenderingStats renderingStats() {
+        mbgl::gfx::BackendScope scope{*frontend->getBackend()};
+        return frontend->getBackend()->getContext().renderingStats();
+    }
+
+    static uint64_t bufferBytes(const mbgl::gfx::RenderingStats& stats) {
+        return static_cast<uint64_t>(stats.memBuffers) + static_cast<uint64_t>(stats.memIndexBuffers) +
+               static_cast<uint64_t>(stats.memVertexBuffers) + static_cast<uint64_t>(stats.memUniformBuffers);
+    }
+
+    // Remembers a finished readback until its RenderRequest takes it, first
+    // forgetting the ones already taken so the list stays as short as the
+    // number of unclaimed frames.
+    void holdImage(const std::shared_ptr<RenderState>& state) {
+        pruneHeldImages(nullptr);
+        heldImages.push_back(state);
+    }
+
+    // Bytes of finished readbacks that no RenderRequest has taken yet.
+    uint64_t heldImageBytes() {
+        uint64_t bytes = 0;
+        pruneHeldImages(&bytes);
+        return bytes;
+    }
+
+    void pruneHeldImages(uint64_t* bytes) {
+        heldImages.erase(std::remove_if(heldImages.begin(),
+                                        heldImages.end(),
+                                        [bytes](const std::weak_ptr<RenderState>& held) {
+                                            auto state = held.lock();
+                                            if (!state || !state->image) {
+                                                return true;
+                                            }
+                                            if (bytes) {
+                                                *bytes += state->image->bufferLength();
+                                            }
+                                            return false;
+                                        }),
+                         heldImages.end());
+    }
+
+    // Only GPU memory is compared against the budget: it is what releasing
+    // tiles frees, while unclaimed readbacks stay until their requests go.
+    void enforceMemoryBudget() {
+        if (memoryBudget == 0) {
+            return;
+        }
+        const auto stats = renderingStats();
+        const uint64_t used = static_cast<uint64_t>(stats.memTextures) + bufferBytes(stats);
+        if (used <= memoryBudget) {
+            return;
+        }
+        if (auto* renderer = frontend->getRenderer()) {
+            renderer->reduceMemoryUse();
+            ++evictions;
+        }
+    }
+
+    std::deque<QueuedRender> renderQueue;
+    bool rendering = false;
+
+    uint64_t memoryBudget = 0;
+    uint64_t evictions = 0;
+    std::vector<std::weak_ptr<RenderState>> heldImages;
 };
 
 class RenderRequest {
 public:
-    struct State {
-        bool ready = false;
-        std::exception_ptr error;
-        std::unique_ptr<std::string> image;
-    };
+    using State = RenderState;
 
     RenderRequest()
         : state(std::make_shared<State>()) {}
@@ -371,7 +607,51 @@ public:
         }
     }
 
-    std::unique_ptr<std::string> takeImage() {
+    bool isUniform() const {
+        return state->ready && state->image && state->image->isUniform();
+    }
+
+    // Phase durations in nanoseconds and resource counts of a completed
+    // render; all zero until it is ready.
+    uint64_t queuedNanos() const {
+        return state->ready ? toNanos(state->metrics.started - state->metrics.submitted) : 0;
+    }
+
+    uint64_t loadingNanos() const {
+        return state->ready ? toNanos(state->metrics.settled - state->metrics.started) : 0;
+    }
+
+    uint64_t frameNanos() const {
+        return state->ready ? toNanos(state->metrics.rendered - state->metrics.settled) : 0;
+    }
+
+    uint64_t readbackNanos() const {
+        return state->ready ? toNanos(state->metrics.readback) : 0;
+    }
+
+    uint64_t drawCalls() const {
+        return state->ready ? state->metrics.drawCalls : 0;
+    }
+
+    uint64_t textureBytes() const {
+        return state->ready ? state->metrics.textureBytes : 0;
+    }
+
+    uint64_t bufferBytes() const {
+        return state->ready ? state->metrics.bufferBytes : 0;
+    }
+
+    // The colour of a uniform frame as the four RGBA bytes loaded into one
+    // integer in native byte order; 0 when the frame is not uniform.
+    uint32_t uniformPixel() const {
+        uint32_t pixel = 0;
+        if (isUniform()) {
+            std::memcpy(&pixel, state->image->get(), sizeof(pixel));
+        }
+        return pixel;
+    }
+
+    std::unique_ptr<BridgeImage> takeImage() {
         assert(state->ready);
         assert(!state->error);
         assert(state->image);
@@ -385,23 +665,53 @@ private:
     bool taken = false;
 };
 
-inline std::unique_ptr<RenderRequest> MapRenderer::submitRender() {
+inline std::unique_ptr<RenderRequest> MapRenderer::enqueueRender(mbgl::CameraOptions camera) {
     auto request = std::make_unique<RenderRequest>();
-    auto state = request->getState();
+    traceBegin(TraceSpan::Render, request->getState()->traceId);
+    renderQueue.push_back({std::move(camera), request->getState()});
+    if (!rendering) {
+        startNextRender();
+    }
+    return request;
+}
 
-    map->renderStill([this, state](const std::exception_ptr& error) {
+inline void MapRenderer::startNextRender() {
+    if (renderQueue.empty()) {
+        rendering = false;
+        return;
+    }
+    rendering = true;
+    auto next = std::move(renderQueue.front());
+    renderQueue.pop_front();
+
+    next.state->metrics.started = RenderClock::now();
+    traceBegin(TraceSpan::RenderStill, next.state->traceId);
+    map->jumpTo(next.camera);
+    // MapLibre Native clears its pending still-image request before invoking
+    // this callback, so the next render can be started from inside it.
+    map->renderStill([this, state = std::move(next.state)](const std::exception_ptr& error) {
+        auto& metrics = state->metrics;
+        metrics.rendered = RenderClock::now();
+        metrics.settled = std::clamp(frontend->lastUpdateTime(), metrics.started, metrics.rendered);
+        traceEnd(TraceSpan::RenderStill, state->traceId);
         state->error = error;
         if (!error) {
-            state->image = readStillImageBytes();
+            recordFrameStats(metrics);
+            traceBegin(TraceSpan::Readback, state->traceId);
+            state->image = readStillImage();
+            traceEnd(TraceSpan::Readback, state->traceId);
+            metrics.readback = RenderClock::now() - metrics.rendered;
+            holdImage(state);
+            enforceMemoryBudget();
         }
+        traceEnd(TraceSpan::Render, state->traceId);
         state->ready = true;
+        startNextRender();
 #if defined(__APPLE__) && !defined(MLN_DARWIN_USE_LIBUV)
         // Wake a thread blocked in currentThreadRunLoopWait() (Darwin non-libuv).
         currentThreadRunLoopStop();
 #endif
     });
-
-    return request;
 }
 
 inline std::unique_ptr<MapRenderer> MapRenderer_new(
@@ -415,27 +725,5 @@ inline std::unique_ptr<MapRenderer> MapRenderer_new(
     return std::make_unique<MapRenderer>(mapMode, size, pixelRatio, resourceOptions);
 }
 
-struct BridgeImage {
-    public:
-        BridgeImage(std::unique_ptr<uint8_t[]> data, mbgl::Size size): mSize(size), mData(std::move(data)) {}
-
-        const uint8_t* get() const {
-            return mData.get();
-        }
-
-        size_t bufferLength() const {
-            const size_t pixelCount = mSize.width * mSize.height;
-            return pixelCount * BYTES_PER_PIXEL;
-        }
-
-        mbgl::Size size() const {
-            return mSize;
-        }
-
-    private:
-        mbgl::Size mSize;
-        std::unique_ptr<uint8_t[]> mData;
-};
-
 } // namespace bridge
 } // namespace mln
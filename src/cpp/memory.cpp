@@ -0,0 +1,20 @@
+#include "maplibre_native/src/bridge.rs.h"
+
+namespace mln {
+namespace bridge {
+
+FfiMemoryUsage MapRenderer::memoryUsage() {
+    const auto stats = renderingStats();
+    FfiMemoryUsage usage;
+    usage.texture_bytes = static_cast<uint64_t>(stats.memTextures);
+    usage.vertex_buffer_bytes = static_cast<uint64_t>(stats.memVertexBuffers);
+    usage.index_buffer_bytes = static_cast<uint64_t>(stats.memIndexBuffers);
+    usage.uniform_buffer_bytes = static_cast<uint64_t>(stats.memUniformBuffers);
+    usage.other_buffer_bytes = static_cast<uint64_t>(stats.memBuffers);
+    usage.held_image_bytes = heldImageBytes();
+    usage.evictions = evictions;
+    return usage;
+}
+
+} // namespace bridge
+} // namespace mln
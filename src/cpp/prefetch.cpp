@@ -0,0 +1,47 @@
+#include "prefetch.h"
+
+#include <mbgl/storage/file_source_manager.hpp>
+#include <mbgl/storage/resource.hpp>
+#include <mbgl/storage/response.hpp>
+#include <mbgl/util/tileset.hpp>
+
+#include <utility>
+
+namespace mln {
+namespace bridge {
+
+TilePrefetcher::TilePrefetcher(const mbgl::ResourceOptions& resourceOptions,
+                               const mbgl::ClientOptions& clientOptions)
+    : fileSource(mbgl::FileSourceManager::get()->getFileSource(
+          mbgl::FileSourceType::ResourceLoader, resourceOptions, clientOptions)) {}
+
+void TilePrefetcher::request(const std::string& urlTemplate, float pixelRatio, int32_t x, int32_t y, uint8_t z) {
+    collectFinished();
+    if (!fileSource) {
+        return;
+    }
+    std::string key = urlTemplate + '\n' + std::to_string(z) + '/' + std::to_string(x) + '/' + std::to_string(y);
+    if (requests.count(key) != 0) {
+        return;
+    }
+    auto resource = mbgl::Resource::tile(
+        urlTemplate, pixelRatio, x, y, static_cast<int8_t>(z), mbgl::Tileset::Scheme::XYZ);
+    resource.priority = mbgl::Resource::Priority::Low;
+    auto request = fileSource->request(resource, [this, key](const mbgl::Response&) { finished.push_back(key); });
+    requests.emplace(std::move(key), std::move(request));
+}
+
+void TilePrefetcher::cancelAll() {
+    requests.clear();
+    finished.clear();
+}
+
+void TilePrefetcher::collectFinished() {
+    for (const auto& key : finished) {
+        requests.erase(key);
+    }
+    finished.clear();
+}
+
+} // namespace bridge
+} // namespace mln
@@ -0,0 +1,47 @@
+#pragma once
+
+// Speculative, low-priority tile requests for tiles that are about to enter
+// the viewport. Rust decides which tiles to warm; this only issues and
+// cancels the requests.
+//
+// Requests go through the ResourceLoader file source, i.e. the same cache and
+// (Rust or online) file source chain as MapLibre Native's own tile requests,
+// so a later regular request for the same tile finds it cached or joins the
+// one in flight. Responses are dropped once the chain has seen them.
+
+#include <mbgl/storage/file_source.hpp>
+#include <mbgl/storage/resource_options.hpp>
+#include <mbgl/util/async_request.hpp>
+#include <mbgl/util/client_options.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mln {
+namespace bridge {
+
+class TilePrefetcher {
+public:
+    TilePrefetcher(const mbgl::ResourceOptions& resourceOptions, const mbgl::ClientOptions& clientOptions);
+
+    // Requests an XYZ tile at low priority, unless it is already in flight.
+    void request(const std::string& urlTemplate, float pixelRatio, int32_t x, int32_t y, uint8_t z);
+
+    // Cancels every request that has not completed yet.
+    void cancelAll();
+
+private:
+    void collectFinished();
+
+    std::shared_ptr<mbgl::FileSource> fileSource;
+    std::unordered_map<std::string, std::unique_ptr<mbgl::AsyncRequest>> requests;
+    // Keys of completed requests; their handles are released outside the
+    // callback that reports them.
+    std::vector<std::string> finished;
+};
+
+} // namespace bridge
+} // namespace mln
@@ -0,0 +1,328 @@
+#include "premultiply.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MLN_BRIDGE_PREMULTIPLY_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define MLN_BRIDGE_PREMULTIPLY_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace mln {
+namespace bridge {
+
+namespace {
+
+constexpr std::size_t CHANNELS = 4;
+
+// Unpremultiply kernels also report whether every input pixel equals
+// `reference`, so uniform frames are found in the same pass over the buffer.
+using UnpremultiplyKernel = bool (*)(uint8_t*, std::size_t, uint32_t reference);
+using PremultiplyKernel = void (*)(uint8_t*, std::size_t);
+
+uint32_t loadPixel(const uint8_t* data) {
+    uint32_t pixel;
+    std::memcpy(&pixel, data, sizeof(pixel));
+    return pixel;
+}
+
+// Reference implementations, matching mbgl::util::unpremultiply/premultiply.
+// Fully opaque pixels are fixed points of both conversions.
+bool unpremultiplyScalar(uint8_t* data, std::size_t pixels, uint32_t reference) {
+    bool uniform = true;
+    for (std::size_t i = 0; i < pixels * CHANNELS; i += CHANNELS) {
+        uniform = uniform && loadPixel(data + i) == reference;
+        const unsigned alpha = data[i + 3];
+        if (alpha == 0 || alpha == 255) {
+            continue;
+        }
+        for (std::size_t c = 0; c < 3; ++c) {
+            data[i + c] = static_cast<uint8_t>((255 * data[i + c] + alpha / 2) / alpha);
+        }
+    }
+    return uniform;
+}
+
+void premultiplyScalar(uint8_t* data, std::size_t pixels) {
+    for (std::size_t i = 0; i < pixels * CHANNELS; i += CHANNELS) {
+        const unsigned alpha = data[i + 3];
+        if (alpha == 255) {
+            continue;
+        }
+        for (std::size_t c = 0; c < 3; ++c) {
+            data[i + c] = static_cast<uint8_t>((data[i + c] * alpha + 127) / 255);
+        }
+    }
+}
+
+#if defined(MLN_BRIDGE_PREMULTIPLY_X86)
+
+// Unpremultiply divides in single precision: with colour and alpha below 256
+// the exact quotient is never within rounding distance of an integer, so the
+// truncated float result equals the scalar integer division. Premultiply uses
+// x / 255 == (x + 1 + (x >> 8)) >> 8, which holds for every x < 65535.
+
+__attribute__((target("sse4.1"))) inline __m128i unpremultiplyPixelSSE41(__m128i pixel) {
+    // One pixel widened to four 32-bit lanes.
+    const __m128i alpha = _mm_shuffle_epi32(pixel, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 numerator = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(pixel), _mm_set1_ps(255.0f)),
+                                        _mm_cvtepi32_ps(_mm_srli_epi32(alpha, 1)));
+    const __m128i quotient = _mm_cvttps_epi32(_mm_div_ps(numerator, _mm_cvtepi32_ps(alpha)));
+    // Keep the alpha lane, and the whole pixel when it is fully transparent.
+    const __m128i keep = _mm_or_si128(_mm_cmpeq_epi32(alpha, _mm_setzero_si128()), _mm_setr_epi32(0, 0, 0, -1));
+    // The scalar code truncates to uint8_t; do the same before packing.
+    return _mm_and_si128(_mm_blendv_epi8(quotient, pixel, keep), _mm_set1_epi32(0xFF));
+}
+
+__attribute__((target("sse4.1"))) inline __m128i premultiplyPairSSE41(__m128i pixels) {
+    // Two pixels widened to eight 16-bit lanes.
+    const __m128i alpha =
+        _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(127));
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(product, _mm_set1_epi16(1)), _mm_srli_epi16(product, 8)), 8);
+}
+
+__attribute__((target("sse4.1"))) bool unpremultiplySSE41(uint8_t* data, std::size_t pixels, uint32_t reference) {
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m128i expected = _mm_set1_epi32(static_cast<int>(reference));
+    __m128i differs = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        auto* block = reinterpret_cast<__m128i*>(data + i * CHANNELS);
+        const __m128i value = _mm_loadu_si128(block);
+        differs = _mm_or_si128(differs, _mm_xor_si128(value, expected));
+        const __m128i alpha = _mm_and_si128(value, alphaMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF || _mm_testz_si128(value, alphaMask)) {
+            continue;
+        }
+        const __m128i p0 = unpremultiplyPixelSSE41(_mm_cvtepu8_epi32(value));
+        const __m128i p1 = unpremultiplyPixelSSE41(_mm_cvtepu8_epi32(_mm_srli_si128(value, 4)));
+        const __m128i p2 = unpremultiplyPixelSSE41(_mm_cvtepu8_epi32(_mm_srli_si128(value, 8)));
+        const __m128i p3 = unpremultiplyPixelSSE41(_mm_cvtepu8_epi32(_mm_srli_si128(value, 12)));
+        _mm_storeu_si128(block, _mm_packus_epi16(_mm_packus_epi32(p0, p1), _mm_packus_epi32(p2, p3)));
+    }
+    const bool tailUniform = unpremultiplyScalar(data + i * CHANNELS, pixels - i, reference);
+    return tailUniform && _mm_testz_si128(differs, differs);
+}
+
+__attribute__((target("sse4.1"))) void premultiplySSE41(uint8_t* data, std::size_t pixels) {
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        auto* block = reinterpret_cast<__m128i*>(data + i * CHANNELS);
+        const __m128i value = _mm_loadu_si128(block);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(value, alphaMask), alphaMask)) == 0xFFFF) {
+            continue;
+        }
+        const __m128i lo = premultiplyPairSSE41(_mm_cvtepu8_epi16(value));
+        const __m128i hi = premultiplyPairSSE41(_mm_cvtepu8_epi16(_mm_srli_si128(value, 8)));
+        _mm_storeu_si128(block, _mm_blendv_epi8(_mm_packus_epi16(lo, hi), value, alphaMask));
+    }
+    premultiplyScalar(data + i * CHANNELS, pixels - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i unpremultiplyPixelsAVX2(__m256i pixels) {
+    // Two pixels, one per 128-bit lane, each widened to four 32-bit lanes.
+    const __m256i alpha = _mm256_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m256 numerator = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(pixels), _mm256_set1_ps(255.0f)),
+                                           _mm256_cvtepi32_ps(_mm256_srli_epi32(alpha, 1)));
+    const __m256i quotient = _mm256_cvttps_epi32(_mm256_div_ps(numerator, _mm256_cvtepi32_ps(alpha)));
+    const __m256i keep = _mm256_or_si256(_mm256_cmpeq_epi32(alpha, _mm256_setzero_si256()),
+                                         _mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+    return _mm256_and_si256(_mm256_blendv_epi8(quotient, pixels, keep), _mm256_set1_epi32(0xFF));
+}
+
+__attribute__((target("avx2"))) inline __m256i premultiplyPixelsAVX2(__m256i pixels) {
+    // Four pixels, two per 128-bit lane, widened to 16-bit lanes.
+    const __m256i alpha =
+        _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), _mm256_set1_epi16(127));
+    return _mm256_srli_epi16(
+        _mm256_add_epi16(_mm256_add_epi16(product, _mm256_set1_epi16(1)), _mm256_srli_epi16(product, 8)), 8);
+}
+
+__attribute__((target("avx2"))) bool unpremultiplyAVX2(uint8_t* data, std::size_t pixels, uint32_t reference) {
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m256i expected = _mm256_set1_epi32(static_cast<int>(reference));
+    __m256i differs = _mm256_setzero_si256();
+    // Packing works per 128-bit lane; this restores the original pixel order.
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        auto* block = reinterpret_cast<__m256i*>(data + i * CHANNELS);
+        const __m256i value = _mm256_loadu_si256(block);
+        differs = _mm256_or_si256(differs, _mm256_xor_si256(value, expected));
+        const __m256i alpha = _mm256_and_si256(value, alphaMask);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1 ||
+            _mm256_testz_si256(value, alphaMask)) {
+            continue;
+        }
+        const __m128i lo = _mm256_castsi256_si128(value);
+        const __m128i hi = _mm256_extracti128_si256(value, 1);
+        const __m256i p01 = unpremultiplyPixelsAVX2(_mm256_cvtepu8_epi32(lo));
+        const __m256i p23 = unpremultiplyPixelsAVX2(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+        const __m256i p45 = unpremultiplyPixelsAVX2(_mm256_cvtepu8_epi32(hi));
+        const __m256i p67 = unpremultiplyPixelsAVX2(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+        const __m256i packed =
+            _mm256_packus_epi16(_mm256_packus_epi32(p01, p23), _mm256_packus_epi32(p45, p67));
+        _mm256_storeu_si256(block, _mm256_permutevar8x32_epi32(packed, order));
+    }
+    const bool tailUniform = unpremultiplySSE41(data + i * CHANNELS, pixels - i, reference);
+    return tailUniform && _mm256_testz_si256(differs, differs);
+}
+
+__attribute__((target("avx2"))) void premultiplyAVX2(uint8_t* data, std::size_t pixels) {
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        auto* block = reinterpret_cast<__m256i*>(data + i * CHANNELS);
+        const __m256i value = _mm256_loadu_si256(block);
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(value, alphaMask), alphaMask)) == -1) {
+            continue;
+        }
+        const __m256i lo = premultiplyPixelsAVX2(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(value)));
+        const __m256i hi = premultiplyPixelsAVX2(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(value, 1)));
+        // Packing works per 128-bit lane; this restores the original pixel order.
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(block, _mm256_blendv_epi8(packed, value, alphaMask));
+    }
+    premultiplySSE41(data + i * CHANNELS, pixels - i);
+}
+
+#elif defined(MLN_BRIDGE_PREMULTIPLY_NEON)
+
+// See the x86 kernels above for why these match the scalar code exactly.
+
+inline uint16x4_t unpremultiplyQuarterNEON(uint16x4_t colour, uint16x4_t alpha) {
+    const uint32x4_t alpha32 = vmovl_u16(alpha);
+    const float32x4_t numerator =
+        vaddq_f32(vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(colour)), 255.0f), vcvtq_f32_u32(vshrq_n_u32(alpha32, 1)));
+    // Narrowing keeps the low bits, which matches the scalar uint8_t store.
+    return vmovn_u32(vcvtq_u32_f32(vdivq_f32(numerator, vcvtq_f32_u32(alpha32))));
+}
+
+inline uint8x8_t unpremultiplyHalfNEON(uint16x8_t colour, uint16x8_t alpha) {
+    return vmovn_u16(vcombine_u16(unpremultiplyQuarterNEON(vget_low_u16(colour), vget_low_u16(alpha)),
+                                  unpremultiplyQuarterNEON(vget_high_u16(colour), vget_high_u16(alpha))));
+}
+
+inline uint8x8_t divide255NEON(uint16x8_t value) {
+    return vshrn_n_u16(vaddq_u16(vaddq_u16(value, vdupq_n_u16(1)), vshrq_n_u16(value, 8)), 8);
+}
+
+bool unpremultiplyNEON(uint8_t* data, std::size_t pixels, uint32_t reference) {
+    uint8_t expected[CHANNELS];
+    std::memcpy(expected, &reference, sizeof(expected));
+    uint8x16_t differs = vdupq_n_u8(0);
+    std::size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8_t* block = data + i * CHANNELS;
+        uint8x16x4_t value = vld4q_u8(block);
+        for (std::size_t c = 0; c < CHANNELS; ++c) {
+            differs = vorrq_u8(differs, veorq_u8(value.val[c], vdupq_n_u8(expected[c])));
+        }
+        const uint8x16_t alpha = value.val[3];
+        if (vminvq_u8(alpha) == 255 || vmaxvq_u8(alpha) == 0) {
+            continue;
+        }
+        const uint8x16_t transparent = vceqzq_u8(alpha);
+        const uint16x8_t alphaLo = vmovl_u8(vget_low_u8(alpha));
+        const uint16x8_t alphaHi = vmovl_high_u8(alpha);
+        for (int c = 0; c < 3; ++c) {
+            const uint8x16_t colour = value.val[c];
+            const uint8x16_t converted = vcombine_u8(unpremultiplyHalfNEON(vmovl_u8(vget_low_u8(colour)), alphaLo),
+                                                     unpremultiplyHalfNEON(vmovl_high_u8(colour), alphaHi));
+            value.val[c] = vbslq_u8(transparent, colour, converted);
+        }
+        vst4q_u8(block, value);
+    }
+    const bool tailUniform = unpremultiplyScalar(data + i * CHANNELS, pixels - i, reference);
+    return tailUniform && vmaxvq_u8(differs) == 0;
+}
+
+void premultiplyNEON(uint8_t* data, std::size_t pixels) {
+    const uint16x8_t bias = vdupq_n_u16(127);
+    std::size_t i = 0;
+    for (; i + 16 <= pixels; i += 16) {
+        uint8_t* block = data + i * CHANNELS;
+        uint8x16x4_t value = vld4q_u8(block);
+        const uint8x16_t alpha = value.val[3];
+        if (vminvq_u8(alpha) == 255) {
+            continue;
+        }
+        for (int c = 0; c < 3; ++c) {
+            const uint8x16_t colour = value.val[c];
+            value.val[c] = vcombine_u8(divide255NEON(vmlal_u8(bias, vget_low_u8(colour), vget_low_u8(alpha))),
+                                       divide255NEON(vmlal_high_u8(bias, colour, alpha)));
+        }
+        vst4q_u8(block, value);
+    }
+    premultiplyScalar(data + i * CHANNELS, pixels - i);
+}
+
+#endif
+
+UnpremultiplyKernel selectUnpremultiply() {
+#if defined(MLN_BRIDGE_PREMULTIPLY_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return unpremultiplyAVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return unpremultiplySSE41;
+    }
+    return unpremultiplyScalar;
+#elif defined(MLN_BRIDGE_PREMULTIPLY_NEON)
+    return unpremultiplyNEON;
+#else
+    return unpremultiplyScalar;
+#endif
+}
+
+PremultiplyKernel selectPremultiply() {
+#if defined(MLN_BRIDGE_PREMULTIPLY_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return premultiplyAVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return premultiplySSE41;
+    }
+    return premultiplyScalar;
+#elif defined(MLN_BRIDGE_PREMULTIPLY_NEON)
+    return premultiplyNEON;
+#else
+    return premultiplyScalar;
+#endif
+}
+
+} // namespace
+
+bool unpremultiplyInPlace(uint8_t* data, std::size_t length) {
+    static const UnpremultiplyKernel kernel = selectUnpremultiply();
+    const std::size_t pixels = length / CHANNELS;
+    if (pixels == 0) {
+        return false;
+    }
+    // Equal premultiplied pixels stay equal after conversion, so comparing
+    // the input is enough.
+    return kernel(data, pixels, loadPixel(data));
+}
+
+void premultiplyInPlace(uint8_t* data, std::size_t length) {
+    static const PremultiplyKernel kernel = selectPremultiply();
+    kernel(data, length / CHANNELS);
+}
+
+bool unpremultiply_for_test(rust::Slice<uint8_t> data) {
+    return unpremultiplyInPlace(data.data(), data.size());
+}
+
+void premultiply_for_test(rust::Slice<uint8_t> data) {
+    premultiplyInPlace(data.data(), data.size());
+}
+
+} // namespace bridge
+} // namespace mln
@@ -0,0 +1,27 @@
+#pragma once
+
+// In-place RGBA alpha conversion for readback and style images.
+//
+// Results are bit-identical to mbgl::util::premultiply/unpremultiply, but the
+// buffer is converted where it lives and a SIMD kernel (AVX2, SSE4.1 or NEON)
+// is picked at runtime. Blocks of fully opaque pixels, the common case for
+// basemap tiles, are skipped without touching the colour channels.
+
+#include "rust/cxx.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace mln {
+namespace bridge {
+
+// `length` is in bytes; a trailing partial pixel is left untouched.
+// unpremultiplyInPlace returns whether the buffer holds at least one pixel and
+// every pixel is the same colour.
+bool unpremultiplyInPlace(uint8_t *data, std::size_t length);
+void premultiplyInPlace(uint8_t *data, std::size_t length);
+
+bool unpremultiply_for_test(rust::Slice<uint8_t> data);
+void premultiply_for_test(rust::Slice<uint8_t> data);
+
+} // namespace bridge
+} // namespace mln
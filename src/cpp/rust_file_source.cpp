@@ -19,12 +19,19 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace mln {
 namespace bridge {
 
 namespace {
 
+// rust::Vec only grows one element at a time from C++; let Rust do the copy.
+rust::Vec<std::uint8_t> toRustBytes(const std::string& data) {
+    return bytes_from_native(rust::Slice<const std::uint8_t>(
+        reinterpret_cast<const std::uint8_t*>(data.data()), data.size()));
+}
+
 mbgl::Response buildResponse(const RawResponse& r) {
     mbgl::Response response;
     if (r.has_error) {
@@ -71,10 +78,7 @@ RawResponse toRustResponse(const mbgl::Response& response) {
     out.must_revalidate = response.mustRevalidate;
     if (response.data) {
         out.has_data = true;
-        out.data.reserve(response.data->size());
-        for (unsigned char byte : *response.data) {
-            out.data.push_back(byte);
-        }
+        out.data = toRustBytes(*response.data);
     }
     if (response.modified) {
         out.has_modified = true;
@@ -128,10 +132,7 @@ RawResourceRequest toRustResourceRequest(const mbgl::Resource& resource, bool in
     }
     if (include_prior_data && resource.priorData) {
         out.has_prior_data = true;
-        out.prior_data.reserve(resource.priorData->size());
-        for (unsigned char byte : *resource.priorData) {
-            out.prior_data.push_back(byte);
-        }
+        out.prior_data = toRustBytes(*resource.priorData);
     }
     out.minimum_update_interval_ms =
         std::chrono::duration_cast<mbgl::Milliseconds>(resource.minimumUpdateInterval).count();
@@ -144,11 +145,13 @@ void completeState(const std::shared_ptr<RequestState>& state, mbgl::Response re
         return;
     }
 
+    traceEnd(TraceSpan::FileRequest, state->traceId);
+    traceBegin(TraceSpan::FileDelivery, state->traceId);
     {
         std::scoped_lock lock(state->response_mutex);
         state->response.emplace(std::move(response));
     }
-    state->dispatch();
+    state->queue->push(state);
 }
 
 void completeForwardState(const std::shared_ptr<ForwardState>& state) {
@@ -165,6 +168,9 @@ public:
     ~RustAsyncRequest() override {
         state_->cancelled.store(true);
         handle_->cancel();
+        // Closes whichever span is still open; the other one is a no-op.
+        traceEnd(TraceSpan::FileRequest, state_->traceId);
+        traceEnd(TraceSpan::FileDelivery, state_->traceId);
     }
 
 private:
@@ -185,36 +191,17 @@ public:
                                                 Callback cb) override {
         auto state = std::make_shared<RequestState>();
         state->cb = std::move(cb);
-
         // FileSource callbacks must run on the thread that issued request().
-        // Capture the scheduler's weak binding while that scheduler is known to
-        // be alive. A late completion becomes a no-op after scheduler teardown.
-        std::weak_ptr<RequestState> weakState = state;
-        state->dispatch = mbgl::Scheduler::GetCurrent()->bindOnce([weakState]() mutable {
-            auto state = weakState.lock();
-            if (!state || state->cancelled.load()) {
-                return;
-            }
-
-            std::optional<mbgl::Response> response;
-            {
-                std::scoped_lock lock(state->response_mutex);
-                response = std::move(state->response);
-                state->response.reset();
-            }
-            if (response && !state->cancelled.load()) {
-                state->cb(std::move(*response));
-            }
-        });
+        state->queue = CompletionQueue::forCurrentScheduler();
+        traceBegin(TraceSpan::FileRequest, state->traceId, resource.url);
 
-        auto request = toRustResourceRequest(resource, true);
-        rust::Box<RequestHandleFfi> handle = (**source_).request(request, state);
+        rust::Box<RequestHandleFfi> handle =
+            (**source_).request(toRustResourceRequest(resource, true), state);
         return std::make_unique<RustAsyncRequest>(std::move(handle), std::move(state));
     }
 
     bool canRequest(const mbgl::Resource& resource) const override {
-        auto request = toRustResourceRequest(resource, false);
-        return (**source_).can_request(request);
+        return (**source_).can_request(toRustResourceRequest(resource, false));
     }
 
     void forward(const mbgl::Resource& resource,
@@ -225,8 +212,8 @@ public:
             state->cb = mbgl::Scheduler::GetCurrent()->bindOnce(std::move(callback));
         }
 
-        auto request = toRustResourceRequest(resource, true);
-        (**source_).forward(request, toRustResponse(response), std::move(state));
+        (**source_).forward(
+            toRustResourceRequest(resource, true), toRustResponse(response), std::move(state));
     }
 
     void setResourceOptions(mbgl::ResourceOptions options) override {
@@ -251,6 +238,87 @@ private:
 
 } // namespace
 
+std::shared_ptr<CompletionQueue> CompletionQueue::forCurrentScheduler() {
+    // One scheduler per thread in practice; re-key if the thread's scheduler
+    // changes, and let the queue go once no request holds it. A new run loop
+    // can reuse the address of a destroyed one, so the pointer comparison
+    // alone cannot tell them apart.
+    thread_local mbgl::Scheduler* owner = nullptr;
+    thread_local std::weak_ptr<CompletionQueue> current;
+
+    mbgl::Scheduler* scheduler = mbgl::Scheduler::GetCurrent();
+    auto queue = current.lock();
+    if (!queue || owner != scheduler || !queue->alive()) {
+        queue = std::make_shared<CompletionQueue>(*scheduler);
+        current = queue;
+        owner = scheduler;
+    }
+    return queue;
+}
+
+// Capture the scheduler's weak pointer while it is known to be alive. Late
+// completions become no-ops after scheduler teardown.
+CompletionQueue::CompletionQueue(mbgl::Scheduler& scheduler)
+    : scheduler_(scheduler.makeWeakPtr()) {}
+
+void CompletionQueue::push(std::weak_ptr<RequestState> state) {
+    {
+        std::scoped_lock lock(mutex_);
+        pending_.push_back(std::move(state));
+        if (drainScheduled_) {
+            return;
+        }
+        drainScheduled_ = true;
+    }
+
+    auto guard = scheduler_.lock();
+    if (scheduler_) {
+        scheduler_->schedule([weakQueue = weak_from_this()] {
+            if (auto queue = weakQueue.lock()) {
+                queue->drain();
+            }
+        });
+        return;
+    }
+    // Nothing will drain a queue whose scheduler is gone; drop what it holds
+    // rather than leaving every later push waiting on a drain that never runs.
+    std::scoped_lock lock(mutex_);
+    pending_.clear();
+    drainScheduled_ = false;
+}
+
+bool CompletionQueue::alive() {
+    auto guard = scheduler_.lock();
+    return static_cast<bool>(scheduler_);
+}
+
+void CompletionQueue::drain() {
+    std::vector<std::weak_ptr<RequestState>> batch;
+    {
+        std::scoped_lock lock(mutex_);
+        batch.swap(pending_);
+        drainScheduled_ = false;
+    }
+
+    for (auto& weakState : batch) {
+        auto state = weakState.lock();
+        if (!state || state->cancelled.load()) {
+            continue;
+        }
+
+        std::optional<mbgl::Response> response;
+        {
+            std::scoped_lock lock(state->response_mutex);
+            response = std::move(state->response);
+            state->response.reset();
+        }
+        if (response && !state->cancelled.load()) {
+            traceEnd(TraceSpan::FileDelivery, state->traceId);
+            state->cb(std::move(*response));
+        }
+    }
+}
+
 void responder_complete(std::shared_ptr<RequestState> state, const RawResponse& response) {
     completeState(state, buildResponse(response));
 }
@@ -3,6 +3,7 @@
 // Rust-backed FileSource bridge.
 
 #include "rust/cxx.h"
+#include "trace.h"
 #include <mbgl/actor/scheduler.hpp>
 #include <mbgl/storage/file_source.hpp>
 #include <mbgl/storage/resource.hpp>
@@ -13,6 +14,7 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <vector>
 
 namespace mln {
 namespace bridge {
@@ -27,13 +29,51 @@ struct BoxedFileSource;
 struct RawResourceRequest;
 struct RawResponse;
 
+struct RequestState;
+
+// Completed requests waiting for delivery on one scheduler's thread. Every
+// request issued on that thread shares the queue, so a burst of completions
+// costs one scheduled task instead of one per response.
+class CompletionQueue : public std::enable_shared_from_this<CompletionQueue> {
+public:
+  // The queue of the calling thread's scheduler, created on first use.
+  static std::shared_ptr<CompletionQueue> forCurrentScheduler();
+
+  explicit CompletionQueue(mbgl::Scheduler &scheduler);
+
+  // Any thread: queue `state` and wake the scheduler unless a drain is
+  // already pending.
+  void push(std::weak_ptr<RequestState> state);
+
+  // Whether the scheduler the queue delivers to still exists.
+  bool alive();
+
+private:
+  // Scheduler thread: deliver everything queued so far.
+  void drain();
+
+  mapbox::base::WeakPtr<mbgl::Scheduler> scheduler_;
+  std::mutex mutex_;
+  std::vector<std::weak_ptr<RequestState>> pending_;
+  bool drainScheduled_ = false;
+};
+
 // Native state for one in-flight request
 struct RequestState {
+  // A response can complete on another thread just as the request is
+  // cancelled, opening the delivery span after the cancellation closed it;
+  // close whatever is left once the last owner lets go.
+  ~RequestState() {
+    traceEnd(TraceSpan::FileRequest, traceId);
+    traceEnd(TraceSpan::FileDelivery, traceId);
+  }
+
   mbgl::FileSource::Callback cb;
-  std::function<void()> dispatch;
+  std::shared_ptr<CompletionQueue> queue;
   std::mutex response_mutex;
   std::optional<mbgl::Response> response;
   std::atomic<bool> cancelled{false};
+  uint64_t traceId = nextTraceId();
 };
 
 // Holds a forward's (cache-write) completion callback until `forward_complete`.
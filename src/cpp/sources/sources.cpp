@@ -3,9 +3,141 @@
 #include <mbgl/style/source.hpp>
 #include <mbgl/style/sources/geojson_source.hpp>
 #include <mbgl/style/types.hpp>
+#include <bit>
+#include <cstdint>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace mln::bridge::style::sources {
+    namespace {
+        // Numbers are keyed by value, so `5` and `5u` name the same feature.
+        std::string unsignedKey(std::uint64_t id) {
+            return "u" + std::to_string(id);
+        }
+
+        std::string signedKey(std::int64_t id) {
+            return id >= 0 ? unsignedKey(static_cast<std::uint64_t>(id)) : "i" + std::to_string(id);
+        }
+
+        // Keyed by bit pattern so that ids differing in any digit stay apart;
+        // `-0.0` is folded into `0.0`, which compares equal to it.
+        std::string doubleKey(double id) {
+            return "d" + std::to_string(std::bit_cast<std::uint64_t>(id == 0.0 ? 0.0 : id));
+        }
+
+        std::string stringKey(std::string id) {
+            return "s" + std::move(id);
+        }
+
+        std::string featureKey(const mapbox::feature::identifier& id) {
+            return id.match(
+                [](std::uint64_t value) { return unsignedKey(value); },
+                [](std::int64_t value) { return signedKey(value); },
+                [](double value) { return doubleKey(value); },
+                [](const std::string& value) { return stringKey(value); },
+                [](mapbox::feature::null_value_t) -> std::string {
+                    throw std::invalid_argument("GeoJSON feature has no id");
+                });
+        }
+    }
+
+    FeatureStore::FeatureStore() : collection(mapbox::feature::feature_collection<double>{}) {}
+
+    mapbox::feature::feature_collection<double>& FeatureStore::features() {
+        return collection.get<mapbox::feature::feature_collection<double>>();
+    }
+
+    void FeatureStore::insert(const mapbox::feature::feature<double>& feature) {
+        auto key = featureKey(feature.id);
+        auto& all = features();
+        auto [entry, inserted] = index.try_emplace(std::move(key), all.size());
+        if (inserted) {
+            all.push_back(feature);
+        } else {
+            all[entry->second] = feature;
+        }
+        dirty = true;
+    }
+
+    bool FeatureStore::remove(const std::string& key) {
+        auto entry = index.find(key);
+        if (entry == index.end()) {
+            return false;
+        }
+        // Move the last feature into the gap so that removal stays O(1).
+        auto& all = features();
+        const std::size_t slot = entry->second;
+        index.erase(entry);
+        if (slot + 1 != all.size()) {
+            all[slot] = std::move(all.back());
+            index[featureKey(all[slot].id)] = slot;
+        }
+        all.pop_back();
+        dirty = true;
+        return true;
+    }
+
+    std::size_t FeatureStore::upsert(const mln::bridge::geojson::GeoJson& geojson) {
+        return geojson.get().match(
+            [this](const mapbox::feature::feature<double>& feature) -> std::size_t {
+                insert(feature);
+                return 1;
+            },
+            [this](const mapbox::feature::feature_collection<double>& batch) -> std::size_t {
+                // Validate first so that a bad batch changes nothing.
+                for (const auto& feature : batch) {
+                    featureKey(feature.id);
+                }
+                for (const auto& feature : batch) {
+                    insert(feature);
+                }
+                return batch.size();
+            },
+            [](const mapbox::geometry::geometry<double>&) -> std::size_t {
+                throw std::invalid_argument("expected a GeoJSON Feature or FeatureCollection");
+            });
+    }
+
+    bool FeatureStore::removeUnsigned(std::uint64_t id) {
+        return remove(unsignedKey(id));
+    }
+
+    bool FeatureStore::removeSigned(std::int64_t id) {
+        return remove(signedKey(id));
+    }
+
+    bool FeatureStore::removeDouble(double id) {
+        return remove(doubleKey(id));
+    }
+
+    bool FeatureStore::removeString(rust::Str id) {
+        return remove(stringKey(std::string(id)));
+    }
+
+    void FeatureStore::clear() {
+        dirty = dirty || !index.empty();
+        features().clear();
+        index.clear();
+    }
+
+    std::size_t FeatureStore::len() const {
+        return index.size();
+    }
+
+    const mbgl::GeoJSON& FeatureStore::data() const {
+        return collection;
+    }
+
+    bool FeatureStore::takeDirty() {
+        return std::exchange(dirty, false);
+    }
+
+    std::unique_ptr<FeatureStore> feature_store_new() {
+        return std::make_unique<FeatureStore>();
+    }
+
     rust::String SourceHandle::sourceId() const {
         return source->getID();
     }
@@ -30,6 +162,14 @@ namespace mln::bridge::style::sources {
         source->setGeoJSON(geojson.get());
     }
 
+    void GeoJSONSourceHandle::setFeatures(const FeatureStore& store) {
+        geojson::setFeatures(*source, store);
+    }
+
+    bool GeoJSONSourceHandle::setFeaturesIfChanged(FeatureStore& store) {
+        return geojson::setFeaturesIfChanged(*source, store);
+    }
+
     std::unique_ptr<mbgl::style::Source> geojson_into_source(
         std::unique_ptr<mbgl::style::GeoJSONSource> source) {
         return source;
@@ -49,4 +189,16 @@ namespace mln::bridge::style::sources::geojson {
                     const mln::bridge::geojson::GeoJson& geojson) {
         source.setGeoJSON(geojson.get());
     }
+
+    void setFeatures(mbgl::style::GeoJSONSource& source, const FeatureStore& store) {
+        source.setGeoJSON(store.data());
+    }
+
+    bool setFeaturesIfChanged(mbgl::style::GeoJSONSource& source, FeatureStore& store) {
+        if (!store.takeDirty()) {
+            return false;
+        }
+        source.setGeoJSON(store.data());
+        return true;
+    }
 }
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "rust/cxx.h"
+#include <mbgl/util/geojson.hpp>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace mbgl::style {
 class Source;
@@ -18,6 +21,41 @@ class GeoJson;
 namespace mln::bridge::style::sources {
 class GeoJSONSourceHandle;
 
+// Features of a GeoJSON source, keyed by feature id, that are edited in
+// place and handed to the source as one collection. Upserts and removals
+// cost O(1); only `take()` touches every feature, once per batch.
+class FeatureStore {
+public:
+  FeatureStore();
+
+  // Inserts or replaces every feature of `geojson` (a Feature or a
+  // FeatureCollection) by id. Throws if a feature has no id.
+  std::size_t upsert(const mln::bridge::geojson::GeoJson &geojson);
+  bool removeUnsigned(std::uint64_t id);
+  bool removeSigned(std::int64_t id);
+  bool removeDouble(double id);
+  bool removeString(rust::Str id);
+  void clear();
+
+  std::size_t len() const;
+
+  // The collection to hand to a source.
+  const mbgl::GeoJSON &data() const;
+  // Whether the features changed since the last call; clears the flag.
+  bool takeDirty();
+
+private:
+  mapbox::feature::feature_collection<double> &features();
+  void insert(const mapbox::feature::feature<double> &feature);
+  bool remove(const std::string &key);
+
+  mbgl::GeoJSON collection;
+  std::unordered_map<std::string, std::size_t> index;
+  bool dirty = false;
+};
+
+std::unique_ptr<FeatureStore> feature_store_new();
+
 // Non-owning handle to a source owned by the style.
 // Valid only while the owning style outlives it;
 // the Rust side ties this to a `&mut StyleRef`.
@@ -41,6 +79,8 @@ public:
 
   rust::String sourceId() const;
   void setGeoJson(const mln::bridge::geojson::GeoJson &geojson);
+  void setFeatures(const FeatureStore &store);
+  bool setFeaturesIfChanged(FeatureStore &store);
 
 private:
   mbgl::style::GeoJSONSource *source;
@@ -61,4 +101,10 @@ void setURL(const std::unique_ptr<mbgl::style::GeoJSONSource> &source,
 
 void setGeoJson(mbgl::style::GeoJSONSource &source,
                 const mln::bridge::geojson::GeoJson &geojson);
+
+void setFeatures(mbgl::style::GeoJSONSource &source,
+                 const mln::bridge::style::sources::FeatureStore &store);
+
+bool setFeaturesIfChanged(mbgl::style::GeoJSONSource &source,
+                          mln::bridge::style::sources::FeatureStore &store);
 } // namespace mln::bridge::style::sources::geojson
@@ -3,12 +3,19 @@
 #include <mbgl/style/conversion/geojson.hpp>
 #include <mbgl/style/conversion/layer.hpp>
 #include <mbgl/style/conversion/source.hpp>
+#include <mbgl/style/style.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
+#include <limits>
 #include <locale>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace mln::bridge {
 namespace {
@@ -19,7 +26,7 @@ namespace {
 // Note: open to a cleaner approach than this JSON round-trip in C++.
 
 // Escapes and quotes a string as a JSON string literal.
-void append_json_string(std::ostringstream& out, const std::string& value) {
+void append_json_string(std::ostringstream& out, std::string_view value) {
     out << '"';
     for (unsigned char c : value) {
         switch (c) {
@@ -73,28 +80,24 @@ void append_json(std::ostringstream& out, const StyleValue& value) {
         break;
     case StyleValue::Kind::Array: {
         out << '[';
-        bool first = true;
-        for (const auto& child : value.array()) {
-            if (!first) {
+        for (std::size_t i = 0; i < value.arrayLength(); ++i) {
+            if (i > 0) {
                 out << ',';
             }
-            first = false;
-            append_json(out, *child);
+            append_json(out, value.arrayMember(i));
         }
         out << ']';
         break;
     }
     case StyleValue::Kind::Object: {
         out << '{';
-        bool first = true;
-        for (const auto& entry : value.object()) {
-            if (!first) {
+        for (std::size_t i = 0; i < value.memberCount(); ++i) {
+            if (i > 0) {
                 out << ',';
             }
-            first = false;
-            append_json_string(out, entry.first);
+            append_json_string(out, value.memberKey(i));
             out << ':';
-            append_json(out, *entry.second);
+            append_json(out, value.memberValue(i));
         }
         out << '}';
         break;
@@ -112,42 +115,204 @@ std::string stringify_style_value(const StyleValue& value) {
 
 } // namespace
 
-std::unique_ptr<StyleValue> make_null() {
-    return std::make_unique<StyleValue>();
+StyleValue::Kind StyleValue::kind() const noexcept {
+    return document_->nodes[index_].kind;
 }
 
-std::unique_ptr<StyleValue> make_bool(bool b) {
-    return std::make_unique<StyleValue>(b);
+bool StyleValue::boolean() const {
+    return document_->nodes[index_].boolean;
 }
 
-std::unique_ptr<StyleValue> make_number(double n) {
-    return std::make_unique<StyleValue>(n);
+double StyleValue::number() const {
+    return document_->nodes[index_].number;
 }
 
-std::unique_ptr<StyleValue> make_string(rust::Str s) {
-    return std::make_unique<StyleValue>(std::string(s));
+std::string_view StyleValue::str() const {
+    return document_->text(document_->nodes[index_].span);
 }
 
-std::unique_ptr<StyleValue> make_array() {
-    return std::make_unique<StyleValue>(StyleValue::Array{});
+std::size_t StyleValue::arrayLength() const {
+    return document_->nodes[index_].span.length;
 }
 
-void array_push(StyleValue& arr, std::unique_ptr<StyleValue> child) {
-    arr.push_back(std::move(child));
+StyleValue StyleValue::arrayMember(std::size_t i) const {
+    return {*document_, document_->elements[document_->nodes[index_].span.offset + i]};
 }
 
-std::unique_ptr<StyleValue> make_object() {
-    return std::make_unique<StyleValue>(StyleValue::Object{});
+std::size_t StyleValue::memberCount() const {
+    return document_->nodes[index_].span.length;
 }
 
-void object_insert(StyleValue& obj, rust::Str key, std::unique_ptr<StyleValue> child) {
-    obj.insert(std::string(key), std::move(child));
+std::string_view StyleValue::memberKey(std::size_t i) const {
+    const auto& member = document_->members[document_->nodes[index_].span.offset + i];
+    return document_->text(document_->keys[member.key]);
 }
 
-std::unique_ptr<mbgl::style::Layer> layer_from_value(const StyleValue& value, rust::String& error_message) {
+StyleValue StyleValue::memberValue(std::size_t i) const {
+    return {*document_, document_->members[document_->nodes[index_].span.offset + i].value};
+}
+
+std::optional<StyleValue> StyleValue::objectMember(std::string_view key) const {
+    // Members are sorted by key, so look the key up by bisection.
+    std::size_t low = 0;
+    std::size_t high = memberCount();
+    while (low < high) {
+        const std::size_t mid = low + (high - low) / 2;
+        if (memberKey(mid) < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == memberCount() || memberKey(low) != key) {
+        return {};
+    }
+    return memberValue(low);
+}
+
+// Reads the buffer that `src/style/value.rs` writes: a header of four native
+// `u32` counts (nodes, array elements, object members, string bytes) used to
+// reserve storage, then the root value in pre-order. Each value is a tag byte
+// followed by its payload; lengths and counts are native `u32`s.
+class StyleDocument::Decoder {
+public:
+    Decoder(StyleDocument& target, rust::Slice<const std::uint8_t> input)
+        : document(target),
+          buffer(input) {}
+
+    void decode() {
+        document.nodes.reserve(read<std::uint32_t>());
+        document.elements.reserve(read<std::uint32_t>());
+        document.members.reserve(read<std::uint32_t>());
+        document.strings.reserve(read<std::uint32_t>());
+        value();
+        if (pos != buffer.size()) {
+            throw std::invalid_argument("trailing bytes after style value");
+        }
+    }
+
+private:
+    enum Tag : std::uint8_t { Null, False, True, Number, String, Array, Object };
+
+    void need(std::size_t count) const {
+        if (buffer.size() - pos < count) {
+            throw std::invalid_argument("truncated style value");
+        }
+    }
+
+    template <class T>
+    T read() {
+        need(sizeof(T));
+        T result;
+        std::memcpy(&result, buffer.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return result;
+    }
+
+    std::string_view text() {
+        const auto length = read<std::uint32_t>();
+        need(length);
+        std::string_view result(reinterpret_cast<const char*>(buffer.data()) + pos, length);
+        pos += length;
+        return result;
+    }
+
+    Span store(std::string_view text) {
+        if (document.strings.size() + text.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::invalid_argument("style value strings exceed 4 GiB");
+        }
+        const Span span{static_cast<std::uint32_t>(document.strings.size()), static_cast<std::uint32_t>(text.size())};
+        document.strings.append(text);
+        return span;
+    }
+
+    std::uint32_t key(std::string_view text) {
+        // The views point into the buffer, which outlives the decoder.
+        auto [entry, inserted] = interned.try_emplace(text, static_cast<std::uint32_t>(document.keys.size()));
+        if (inserted) {
+            document.keys.push_back(store(text));
+        }
+        return entry->second;
+    }
+
+    std::uint32_t value() {
+        const auto index = static_cast<std::uint32_t>(document.nodes.size());
+        document.nodes.emplace_back();
+        Node node;
+        const auto tag = read<std::uint8_t>();
+        switch (tag) {
+        case Null:
+            break;
+        case False:
+        case True:
+            node.kind = StyleValue::Kind::Bool;
+            node.boolean = tag == True;
+            break;
+        case Number:
+            node.kind = StyleValue::Kind::Number;
+            node.number = read<double>();
+            break;
+        case String:
+            node.kind = StyleValue::Kind::String;
+            node.span = store(text());
+            break;
+        case Array: {
+            node.kind = StyleValue::Kind::Array;
+            const auto count = read<std::uint32_t>();
+            // Children are decoded depth-first, so collect their indices on a
+            // shared stack and copy them out once the array is complete.
+            const auto mark = elementStack.size();
+            for (std::uint32_t i = 0; i < count; ++i) {
+                elementStack.push_back(value());
+            }
+            node.span = {static_cast<std::uint32_t>(document.elements.size()), count};
+            document.elements.insert(document.elements.end(), elementStack.begin() + mark, elementStack.end());
+            elementStack.resize(mark);
+            break;
+        }
+        case Object: {
+            node.kind = StyleValue::Kind::Object;
+            const auto count = read<std::uint32_t>();
+            const auto mark = memberStack.size();
+            for (std::uint32_t i = 0; i < count; ++i) {
+                const auto name = key(text());
+                memberStack.push_back({name, value()});
+            }
+            // Sort by key for lookups; a stable sort keeps the first of
+            // duplicate keys in front, where lookups find it.
+            std::stable_sort(memberStack.begin() + mark, memberStack.end(), [&](const Member& a, const Member& b) {
+                return document.text(document.keys[a.key]) < document.text(document.keys[b.key]);
+            });
+            node.span = {static_cast<std::uint32_t>(document.members.size()), count};
+            document.members.insert(document.members.end(), memberStack.begin() + mark, memberStack.end());
+            memberStack.resize(mark);
+            break;
+        }
+        default:
+            throw std::invalid_argument("unknown style value tag");
+        }
+        document.nodes[index] = node;
+        return index;
+    }
+
+    StyleDocument& document;
+    rust::Slice<const std::uint8_t> buffer;
+    std::size_t pos = 0;
+    std::unordered_map<std::string_view, std::uint32_t> interned;
+    std::vector<std::uint32_t> elementStack;
+    std::vector<Member> memberStack;
+};
+
+std::unique_ptr<StyleDocument> decode_style_document(rust::Slice<const std::uint8_t> buffer) {
+    auto document = std::make_unique<StyleDocument>();
+    StyleDocument::Decoder(*document, buffer).decode();
+    return document;
+}
+
+std::unique_ptr<mbgl::style::Layer> layer_from_value(const StyleDocument& document, rust::String& error_message) {
     mbgl::style::conversion::Error error;
     auto result = mbgl::style::conversion::Converter<std::unique_ptr<mbgl::style::Layer>>()(
-        mbgl::style::conversion::Convertible(&value), error);
+        mbgl::style::conversion::Convertible(document.root()), error);
     if (!result) {
         error_message = rust::String(error.message);
         return nullptr;
@@ -156,11 +321,11 @@ std::unique_ptr<mbgl::style::Layer> layer_from_value(const StyleValue& value, ru
 }
 
 std::unique_ptr<mbgl::style::Source> source_from_value(rust::Str id,
-                                                       const StyleValue& value,
+                                                       const StyleDocument& document,
                                                        rust::String& error_message) {
     mbgl::style::conversion::Error error;
     auto result = mbgl::style::conversion::Converter<std::unique_ptr<mbgl::style::Source>>()(
-        mbgl::style::conversion::Convertible(&value), error, std::string(id));
+        mbgl::style::conversion::Convertible(document.root()), error, std::string(id));
     if (!result) {
         error_message = rust::String(error.message);
         return nullptr;
@@ -168,6 +333,52 @@ std::unique_ptr<mbgl::style::Source> source_from_value(rust::Str id,
     return std::move(*result);
 }
 
+void set_layer_properties(mbgl::style::Style& style, const StyleDocument& edits) {
+    struct Edit {
+        mbgl::style::Layer* layer;
+        std::string property;
+        StyleValue value;
+    };
+
+    const StyleValue list = edits.root();
+    if (list.kind() != StyleValue::Kind::Array) {
+        throw std::invalid_argument("layer edits must be an array");
+    }
+    // Resolve every layer first, so a bad id leaves the style untouched.
+    std::vector<Edit> resolved;
+    resolved.reserve(list.arrayLength());
+    for (std::size_t i = 0; i < list.arrayLength(); ++i) {
+        const StyleValue edit = list.arrayMember(i);
+        if (edit.kind() != StyleValue::Kind::Array || edit.arrayLength() != 3 ||
+            edit.arrayMember(0).kind() != StyleValue::Kind::String ||
+            edit.arrayMember(1).kind() != StyleValue::Kind::String) {
+            throw std::invalid_argument("layer edits must be [layer id, property, value] arrays");
+        }
+        const std::string layerId(edit.arrayMember(0).str());
+        auto* layer = style.getLayer(layerId);
+        if (!layer) {
+            throw std::invalid_argument("no layer with id '" + layerId + "'");
+        }
+        resolved.push_back({layer, std::string(edit.arrayMember(1).str()), edit.arrayMember(2)});
+    }
+
+    // Each setter only marks the style dirty; the frontend picks all of the
+    // changes up together on the next render.
+    std::string errors;
+    for (const auto& edit : resolved) {
+        const auto error = edit.layer->setProperty(edit.property, mbgl::style::conversion::Convertible(edit.value));
+        if (error) {
+            if (!errors.empty()) {
+                errors += "; ";
+            }
+            errors += edit.layer->getID() + " " + edit.property + ": " + error->message;
+        }
+    }
+    if (!errors.empty()) {
+        throw std::invalid_argument(errors);
+    }
+}
+
 std::optional<mbgl::GeoJSON> style_value_to_geojson(const StyleValue& value,
                                                     mbgl::style::conversion::Error& error) {
     try {
@@ -7,83 +7,117 @@
 #include <mbgl/util/geojson.hpp>
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
-#include <map>
 #include <memory>
 #include <optional>
 #include <string>
-#include <utility>
-#include <variant>
+#include <string_view>
 #include <vector>
 
 #include "rust/cxx.h"
 
+namespace mbgl::style {
+class Style;
+}
+
 namespace mln::bridge {
 
-// JSON-like value tree consumed by MapLibre's style-spec conversion layer.
+class StyleDocument;
+
+// A JSON-like value in a `StyleDocument`, consumed by MapLibre's style-spec
+// conversion layer. Cheap to copy: a document pointer and a node index.
 class StyleValue {
 public:
   enum class Kind : std::uint8_t { Null, Bool, Number, String, Array, Object };
 
-  using Array = std::vector<std::unique_ptr<StyleValue>>;
-  using Object = std::map<std::string, std::unique_ptr<StyleValue>>;
+  StyleValue(const StyleDocument &document, std::uint32_t index)
+      : document_(&document), index_(index) {}
 
-  StyleValue() : storage_(std::monostate{}) {}
-  explicit StyleValue(bool b) : storage_(b) {}
-  explicit StyleValue(double n) : storage_(n) {}
-  explicit StyleValue(std::string s) : storage_(std::move(s)) {}
-  explicit StyleValue(Array a) : storage_(std::move(a)) {}
-  explicit StyleValue(Object o) : storage_(std::move(o)) {}
+  Kind kind() const noexcept;
 
-  void push_back(std::unique_ptr<StyleValue> child) {
-    std::get<Array>(storage_).push_back(std::move(child));
-  }
-  void insert(std::string key, std::unique_ptr<StyleValue> child) {
-    std::get<Object>(storage_).emplace(std::move(key), std::move(child));
-  }
+  bool boolean() const;
+  double number() const;
+  std::string_view str() const;
 
-  Kind kind() const noexcept { return static_cast<Kind>(storage_.index()); }
+  std::size_t arrayLength() const;
+  StyleValue arrayMember(std::size_t i) const;
 
-  bool boolean() const { return std::get<bool>(storage_); }
-  double number() const { return std::get<double>(storage_); }
-  const std::string &str() const { return std::get<std::string>(storage_); }
-  const Array &array() const { return std::get<Array>(storage_); }
-  const Object &object() const { return std::get<Object>(storage_); }
+  // Object members, sorted by key.
+  std::size_t memberCount() const;
+  std::string_view memberKey(std::size_t i) const;
+  StyleValue memberValue(std::size_t i) const;
+  std::optional<StyleValue> objectMember(std::string_view key) const;
 
 private:
-  // Variant order must match `Kind` so `storage_.index()` == `kind()`.
-  using Storage =
-      std::variant<std::monostate, bool, double, std::string, Array, Object>;
-  static_assert(static_cast<std::size_t>(Kind::Null) == 0);
-  static_assert(static_cast<std::size_t>(Kind::Bool) == 1);
-  static_assert(static_cast<std::size_t>(Kind::Number) == 2);
-  static_assert(static_cast<std::size_t>(Kind::String) == 3);
-  static_assert(static_cast<std::size_t>(Kind::Array) == 4);
-  static_assert(static_cast<std::size_t>(Kind::Object) == 5);
-
-  Storage storage_;
+  const StyleDocument *document_;
+  std::uint32_t index_;
 };
 
-// Factory wrappers exposed to the cxx bridge.
-std::unique_ptr<StyleValue> make_null();
-std::unique_ptr<StyleValue> make_bool(bool b);
-std::unique_ptr<StyleValue> make_number(double n);
-std::unique_ptr<StyleValue> make_string(rust::Str s);
-std::unique_ptr<StyleValue> make_array();
-void array_push(StyleValue &arr, std::unique_ptr<StyleValue> child);
-std::unique_ptr<StyleValue> make_object();
-void object_insert(StyleValue &obj, rust::Str key,
-                   std::unique_ptr<StyleValue> child);
+// Flat storage for a style value tree, decoded from one buffer that Rust
+// serializes (see `src/style/value.rs` for the format).
+//
+// Nodes, array elements and object members each live in one vector and refer
+// to each other by index; strings share one pool, and repeated object keys
+// are stored once.
+class StyleDocument {
+public:
+  StyleValue root() const { return {*this, 0}; }
+
+private:
+  friend class StyleValue;
+  friend std::unique_ptr<StyleDocument>
+  decode_style_document(rust::Slice<const std::uint8_t> buffer);
+  class Decoder;
+
+  struct Span {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+  };
+
+  struct Node {
+    StyleValue::Kind kind = StyleValue::Kind::Null;
+    bool boolean = false;
+    double number = 0;
+    // Strings: a span of `strings`. Arrays and objects: a span of `elements`
+    // or `members`.
+    Span span;
+  };
+
+  struct Member {
+    std::uint32_t key;
+    std::uint32_t value;
+  };
+
+  std::string_view text(Span span) const {
+    return {strings.data() + span.offset, span.length};
+  }
+
+  std::vector<Node> nodes;
+  std::vector<std::uint32_t> elements;
+  std::vector<Member> members;
+  std::vector<Span> keys;
+  std::string strings;
+};
+
+// Decodes a style value buffer; throws if it is malformed.
+std::unique_ptr<StyleDocument> decode_style_document(rust::Slice<const std::uint8_t> buffer);
 
 // Parses a style-spec `Layer` object.
 std::unique_ptr<mbgl::style::Layer>
-layer_from_value(const StyleValue &value, rust::String &error_message);
+layer_from_value(const StyleDocument &document, rust::String &error_message);
 
 // Parses a style-spec `Source` object.
 std::unique_ptr<mbgl::style::Source>
-source_from_value(rust::Str id, const StyleValue &value,
+source_from_value(rust::Str id, const StyleDocument &document,
                   rust::String &error_message);
 
+// Applies an array of `[layer id, property, value]` edits to `style`. Throws
+// before changing anything if a layer is missing; otherwise applies every
+// edit MapLibre accepts and throws one error listing those it rejected.
+void set_layer_properties(mbgl::style::Style &style,
+                          const StyleDocument &edits);
+
 std::optional<mbgl::GeoJSON>
 style_value_to_geojson(const StyleValue &value,
                        mbgl::style::conversion::Error &error);
@@ -93,42 +127,33 @@ style_value_to_geojson(const StyleValue &value,
 namespace mbgl::style::conversion {
 
 // Lets MapLibre's conversion layer read from `StyleValue`.
-template <> class ConversionTraits<const mln::bridge::StyleValue *> {
-  using T = const mln::bridge::StyleValue *;
+template <> class ConversionTraits<mln::bridge::StyleValue> {
+  using T = mln::bridge::StyleValue;
   using Kind = mln::bridge::StyleValue::Kind;
 
 public:
-  static bool isUndefined(T value) {
-    return value == nullptr || value->kind() == Kind::Null;
-  }
+  static bool isUndefined(const T &value) { return value.kind() == Kind::Null; }
 
-  static bool isArray(T value) {
-    return value != nullptr && value->kind() == Kind::Array;
-  }
+  static bool isArray(const T &value) { return value.kind() == Kind::Array; }
 
-  static std::size_t arrayLength(T value) { return value->array().size(); }
+  static std::size_t arrayLength(const T &value) { return value.arrayLength(); }
 
-  static T arrayMember(T value, std::size_t i) {
-    return value->array()[i].get();
+  static T arrayMember(const T &value, std::size_t i) {
+    return value.arrayMember(i);
   }
 
-  static bool isObject(T value) {
-    return value != nullptr && value->kind() == Kind::Object;
-  }
+  static bool isObject(const T &value) { return value.kind() == Kind::Object; }
 
-  static std::optional<T> objectMember(T value, const char *name) {
-    const auto &obj = value->object();
-    auto it = obj.find(name);
-    if (it == obj.end()) {
-      return {};
-    }
-    return {it->second.get()};
+  static std::optional<T> objectMember(const T &value, const char *name) {
+    return value.objectMember(name);
   }
 
-  template <class Fn> static std::optional<Error> eachMember(T value, Fn &&fn) {
-    for (const auto &entry : value->object()) {
+  template <class Fn>
+  static std::optional<Error> eachMember(const T &value, Fn &&fn) {
+    for (std::size_t i = 0; i < value.memberCount(); ++i) {
+      const auto key = value.memberKey(i);
       std::optional<Error> result =
-          fn({entry.first.data(), entry.first.size()}, entry.second.get());
+          fn({key.data(), key.size()}, value.memberValue(i));
       if (result) {
         return result;
       }
@@ -136,40 +161,40 @@ public:
     return {};
   }
 
-  static std::optional<bool> toBool(T value) {
-    if (value->kind() != Kind::Bool)
+  static std::optional<bool> toBool(const T &value) {
+    if (value.kind() != Kind::Bool)
       return {};
-    return value->boolean();
+    return value.boolean();
   }
 
-  static std::optional<float> toNumber(T value) {
-    if (value->kind() != Kind::Number)
+  static std::optional<float> toNumber(const T &value) {
+    if (value.kind() != Kind::Number)
       return {};
-    return static_cast<float>(value->number());
+    return static_cast<float>(value.number());
   }
 
-  static std::optional<double> toDouble(T value) {
-    if (value->kind() != Kind::Number)
+  static std::optional<double> toDouble(const T &value) {
+    if (value.kind() != Kind::Number)
       return {};
-    return value->number();
+    return value.number();
   }
 
-  static std::optional<std::string> toString(T value) {
-    if (value->kind() != Kind::String)
+  static std::optional<std::string> toString(const T &value) {
+    if (value.kind() != Kind::String)
       return {};
-    return value->str();
+    return std::string(value.str());
   }
 
-  static std::optional<Value> toValue(T value) {
-    switch (value->kind()) {
+  static std::optional<Value> toValue(const T &value) {
+    switch (value.kind()) {
     case Kind::Null:
       // `toValue` only yields booleans, numbers, and strings; null is reported
       // via `isUndefined` instead (matching the Node binding's adapter).
       return {};
     case Kind::Bool:
-      return {value->boolean()};
+      return {value.boolean()};
     case Kind::Number: {
-      const double d = value->number();
+      const double d = value.number();
       if (std::isfinite(d) && d == std::trunc(d)) {
         if (d >= 0.0 && d < 18446744073709551616.0 /* 2^64 */) {
           return {static_cast<std::uint64_t>(d)};
@@ -182,7 +207,7 @@ public:
       return {d};
     }
     case Kind::String:
-      return {value->str()};
+      return {std::string(value.str())};
     case Kind::Array:
     case Kind::Object:
       return {};
@@ -192,12 +217,8 @@ public:
 
   // A GeoJSON source's `data` may be an inline GeoJSON object (not only a URL
   // string), so source conversion calls this to parse it from the StyleValue tree.
-  static std::optional<GeoJSON> toGeoJSON(T value, Error &error) {
-    if (value == nullptr) {
-      error = {"GeoJSON value must not be null"};
-      return {};
-    }
-    return mln::bridge::style_value_to_geojson(*value, error);
+  static std::optional<GeoJSON> toGeoJSON(const T &value, Error &error) {
+    return mln::bridge::style_value_to_geojson(value, error);
   }
 };
 
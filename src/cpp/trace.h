@@ -0,0 +1,64 @@
+#pragma once
+
+// Span hooks for the Rust `tracing` integration.
+//
+// Spans are reported to Rust only after `setTraceEnabled(true)`; until then
+// every hook is one relaxed atomic load. Span kinds must match `src/trace.rs`.
+
+#include "rust/cxx.h"
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+namespace mln {
+namespace bridge {
+
+enum class TraceSpan : uint8_t {
+    // A file source request until its Rust responder completes.
+    FileRequest = 0,
+    // A completed response until the issuing thread's run loop delivers it.
+    FileDelivery = 1,
+    // A render from submitRender until its image is read back.
+    Render = 2,
+    // A renderStill call until MapLibre Native reports the frame.
+    RenderStill = 3,
+    // Reading a finished frame back from the GPU.
+    Readback = 4,
+};
+
+void trace_begin(uint8_t span, uint64_t id, rust::Str detail) noexcept;
+void trace_end(uint8_t span, uint64_t id) noexcept;
+
+inline std::atomic<bool>& traceFlag() {
+    static std::atomic<bool> enabled{false};
+    return enabled;
+}
+
+inline void setTraceEnabled(bool enabled) {
+    traceFlag().store(enabled, std::memory_order_relaxed);
+}
+
+inline bool traceEnabled() {
+    return traceFlag().load(std::memory_order_relaxed);
+}
+
+// A fresh span id, or 0 (untraced) while tracing is off.
+inline uint64_t nextTraceId() {
+    static std::atomic<uint64_t> next{1};
+    return traceEnabled() ? next.fetch_add(1, std::memory_order_relaxed) : 0;
+}
+
+inline void traceBegin(TraceSpan span, uint64_t id, std::string_view detail = {}) {
+    if (id != 0) {
+        trace_begin(static_cast<uint8_t>(span), id, rust::Str(detail.data(), detail.size()));
+    }
+}
+
+inline void traceEnd(TraceSpan span, uint64_t id) {
+    if (id != 0) {
+        trace_end(static_cast<uint8_t>(span), id);
+    }
+}
+
+} // namespace bridge
+} // namespace mln
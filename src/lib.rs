@@ -3,7 +3,10 @@
 pub(crate) mod bridge;
 mod renderer;
 mod style;
+mod trace;
 pub use renderer::*;
 pub use style::*;
+#[cfg(feature = "tracing")]
+pub use trace::set_tracing_enabled;
 #[cfg(feature = "wgpu")]
 pub use webgpu_shim::*;
@@ -6,8 +6,8 @@ use std::rc::Rc;
 
 use crate::bridge::ffi;
 use crate::renderer::map_observer::MapObserverCallbacks;
-use crate::renderer::{Continuous, ImageRenderer, MapMode, Static, Tile};
-use crate::ResourceOptions;
+use crate::renderer::{Continuous, ImageRenderer, MapMode, MemoryBudget, Static, Tile};
+use crate::{ResourceOptions, Size};
 
 /// Builder for configuring [`ImageRenderer`] instances
 ///
@@ -36,6 +36,7 @@ pub struct ImageRendererBuilder {
     /// Pixel ratio for high-DPI displays
     pixel_ratio: f32,
     resource_options: Option<ResourceOptions>,
+    memory_budget: Option<MemoryBudget>,
 }
 
 impl Default for ImageRendererBuilder {
@@ -46,6 +47,7 @@ impl Default for ImageRendererBuilder {
             height: NonZeroU32::new(512).unwrap(),
             pixel_ratio: 1.0,
             resource_options: None,
+            memory_budget: None,
         }
     }
 }
@@ -85,6 +87,17 @@ impl ImageRendererBuilder {
         self
     }
 
+    /// Bounds the GPU memory each built renderer holds.
+    ///
+    /// See [`MemoryBudget`] for what is counted and how it is enforced.
+    ///
+    /// Default: no budget
+    #[must_use]
+    pub fn with_memory_budget(mut self, budget: MemoryBudget) -> Self {
+        self.memory_budget = Some(budget);
+        self
+    }
+
     /// Builds a static image renderer
     #[must_use]
     pub fn build_static_renderer(self) -> ImageRenderer<Static> {
@@ -122,6 +135,7 @@ impl<S> ImageRenderer<S> {
     /// Creates a new renderer instance
     fn new(map_mode: MapMode, opts: ImageRendererBuilder) -> Self {
         let resource_options = opts.resource_options.unwrap_or_default();
+        let size = Size { width: opts.width.get(), height: opts.height.get() };
         let mut map = ffi::MapRenderer_new(
             map_mode,
             opts.width.get(),
@@ -135,12 +149,20 @@ impl<S> ImageRenderer<S> {
         let observer_callbacks = Rc::new(MapObserverCallbacks::default());
         observer_callbacks.install(&map.pin_mut().observer());
 
-        Self {
+        let mut renderer = Self {
             instance: map,
             observer_callbacks,
             style_specified: false,
+            style_load_time: Rc::default(),
+            tile_size: size,
+            frame_size: size,
+            prefetcher: None,
             _marker: PhantomData,
             _not_send: PhantomData,
+        };
+        if let Some(budget) = opts.memory_budget {
+            renderer.set_memory_budget(budget);
         }
+        renderer
     }
 }
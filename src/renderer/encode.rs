@@ -0,0 +1,346 @@
+//! Off-thread encoding of rendered frames.
+//!
+//! Encoding on the render thread keeps its run loop from starting the next
+//! render. An [`EncoderPool`] moves that work to a shared set of threads, so
+//! the GPU and the encoders overlap.
+
+use std::fmt::Debug;
+use std::io::Cursor;
+use std::num::NonZeroUsize;
+use std::sync::{mpsc, Arc, Mutex, PoisonError};
+use std::thread;
+
+use image::codecs::jpeg::JpegEncoder;
+use image::codecs::png::{CompressionType, FilterType, PngEncoder};
+use image::codecs::webp::WebPEncoder;
+use image::error::{ParameterError, ParameterErrorKind};
+use image::{ExtendedColorType, ImageEncoder};
+
+use crate::{ImagePtr, MetaTile, RenderRequest, RenderingError, Size, TileCoord};
+
+/// Output format of an encoded frame.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[non_exhaustive]
+pub enum EncodeFormat {
+    /// Lossless PNG.
+    Png(PngCompression),
+    /// Lossless WebP.
+    WebP,
+    /// JPEG with the given quality, clamped to `1..=100`.
+    ///
+    /// JPEG has no alpha channel; it is dropped.
+    Jpeg(u8),
+}
+
+impl EncodeFormat {
+    /// The MIME type of the encoded bytes.
+    #[must_use]
+    pub fn mime_type(self) -> &'static str {
+        match self {
+            Self::Png(_) => "image/png",
+            Self::WebP => "image/webp",
+            Self::Jpeg(_) => "image/jpeg",
+        }
+    }
+}
+
+/// Trade-off between PNG encoding speed and output size.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub enum PngCompression {
+    /// Fastest zlib level and no row filtering; larger files.
+    Fast,
+    /// The `image` crate's default level and adaptive filtering.
+    #[default]
+    Default,
+    /// Best zlib compression; slowest.
+    Best,
+}
+
+/// Errors returned when encoding a frame.
+#[derive(thiserror::Error, Debug)]
+#[non_exhaustive]
+pub enum EncodeError {
+    /// The encoder rejected the frame.
+    #[error(transparent)]
+    Image(#[from] image::ImageError),
+    /// The pool shut down before the frame was encoded.
+    #[error("encoder pool has shut down")]
+    PoolClosed,
+    /// The requested tile is not part of the metatile.
+    #[error("tile {0:?} is not part of the metatile")]
+    NotInMetaTile(TileCoord),
+}
+
+/// Encodes unpremultiplied RGBA pixels on the calling thread.
+///
+/// # Errors
+///
+/// If the buffer does not match `size` or the encoder fails.
+pub fn encode_rgba(
+    pixels: &[u8],
+    size: Size,
+    format: EncodeFormat,
+) -> Result<Vec<u8>, EncodeError> {
+    let expected = u64::from(size.width) * u64::from(size.height) * 4;
+    if u64::try_from(pixels.len()).ok() != Some(expected) {
+        return Err(ParameterError::from_kind(ParameterErrorKind::DimensionMismatch).into());
+    }
+
+    let mut out = Vec::new();
+    let writer = Cursor::new(&mut out);
+    match format {
+        EncodeFormat::Png(compression) => {
+            let (compression, filter) = match compression {
+                PngCompression::Fast => (CompressionType::Fast, FilterType::NoFilter),
+                PngCompression::Default => (CompressionType::Default, FilterType::Adaptive),
+                PngCompression::Best => (CompressionType::Best, FilterType::Adaptive),
+            };
+            PngEncoder::new_with_quality(writer, compression, filter).write_image(
+                pixels,
+                size.width,
+                size.height,
+                ExtendedColorType::Rgba8,
+            )?;
+        }
+        EncodeFormat::WebP => {
+            WebPEncoder::new_lossless(writer).write_image(
+                pixels,
+                size.width,
+                size.height,
+                ExtendedColorType::Rgba8,
+            )?;
+        }
+        EncodeFormat::Jpeg(quality) => {
+            let rgb: Vec<u8> =
+                pixels.chunks_exact(4).flat_map(|px| [px[0], px[1], px[2]]).collect();
+            JpegEncoder::new_with_quality(writer, quality.clamp(1, 100)).write_image(
+                &rgb,
+                size.width,
+                size.height,
+                ExtendedColorType::Rgb8,
+            )?;
+        }
+    }
+    Ok(out)
+}
+
+type Job = Box<dyn FnOnce() + Send>;
+
+/// A fixed set of threads that encode rendered frames.
+///
+/// The pool is `Send + Sync`; share it between render threads with an `Arc`.
+/// Dropping it finishes the queued frames, then joins the threads.
+pub struct EncoderPool {
+    sender: Option<mpsc::Sender<Job>>,
+    workers: Vec<thread::JoinHandle<()>>,
+}
+
+impl Debug for EncoderPool {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("EncoderPool").field("threads", &self.workers.len()).finish()
+    }
+}
+
+impl EncoderPool {
+    /// Starts a pool with `threads` encoder threads.
+    ///
+    /// # Panics
+    ///
+    /// If a thread cannot be spawned.
+    #[must_use]
+    pub fn new(threads: NonZeroUsize) -> Self {
+        let (sender, receiver) = mpsc::channel::<Job>();
+        let receiver = Arc::new(Mutex::new(receiver));
+        let workers = (0..threads.get())
+            .map(|index| {
+                let receiver = Arc::clone(&receiver);
+                thread::Builder::new()
+                    .name(format!("mln-encoder-{index}"))
+                    .spawn(move || loop {
+                        // Hold the lock only while dequeuing, not while encoding.
+                        let job = receiver.lock().unwrap_or_else(PoisonError::into_inner).recv();
+                        match job {
+                            Ok(job) => job(),
+                            Err(_) => break,
+                        }
+                    })
+                    .expect("failed to spawn encoder thread")
+            })
+            .collect();
+        Self { sender: Some(sender), workers }
+    }
+
+    /// Queues `image` for encoding and returns a handle to the result.
+    pub fn encode(&self, image: ImagePtr, format: EncodeFormat) -> EncodeHandle {
+        let (sender, receiver) = mpsc::sync_channel(1);
+        self.encode_with(image, format, move |result| {
+            let _ = sender.send(result);
+        });
+        EncodeHandle { receiver }
+    }
+
+    /// Queues `image` for encoding and calls `on_done` on an encoder thread
+    /// with the result.
+    ///
+    /// Use this to hand the bytes to another runtime, e.g. through a
+    /// `tokio::sync::oneshot` channel.
+    pub fn encode_with<F>(&self, image: ImagePtr, format: EncodeFormat, on_done: F)
+    where
+        F: FnOnce(Result<Vec<u8>, EncodeError>) + Send + 'static,
+    {
+        self.execute(Box::new(move || {
+            on_done(encode_rgba(image.buffer(), image.size(), format));
+        }));
+    }
+
+    /// Queues one tile of a shared metatile for encoding and calls `on_done`
+    /// on an encoder thread with the result.
+    ///
+    /// Queue every tile of a block this way to encode them in parallel.
+    pub fn encode_tile_with<F>(
+        &self,
+        metatile: Arc<MetaTile>,
+        tile: TileCoord,
+        format: EncodeFormat,
+        on_done: F,
+    ) where
+        F: FnOnce(Result<Vec<u8>, EncodeError>) + Send + 'static,
+    {
+        self.execute(Box::new(move || {
+            let Some(view) = metatile.tile(tile.x, tile.y) else {
+                on_done(Err(EncodeError::NotInMetaTile(tile)));
+                return;
+            };
+            on_done(match view.as_contiguous() {
+                Some(pixels) => encode_rgba(pixels, view.size(), format),
+                None => encode_rgba(&view.to_rgba_vec(), view.size(), format),
+            });
+        }));
+    }
+
+    fn execute(&self, job: Job) {
+        if let Some(sender) = &self.sender {
+            // Only fails once every worker is gone, which drops the job unrun.
+            let _ = sender.send(job);
+        }
+    }
+}
+
+impl Drop for EncoderPool {
+    fn drop(&mut self) {
+        // Closing the channel lets each worker drain the queue and exit.
+        self.sender = None;
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+/// Pending result of [`EncoderPool::encode`].
+#[derive(Debug)]
+#[must_use = "the encoded bytes are only available through the handle"]
+pub struct EncodeHandle {
+    receiver: mpsc::Receiver<Result<Vec<u8>, EncodeError>>,
+}
+
+impl EncodeHandle {
+    /// Blocks until the frame is encoded.
+    ///
+    /// # Errors
+    ///
+    /// If encoding failed or the pool shut down first.
+    pub fn wait(self) -> Result<Vec<u8>, EncodeError> {
+        self.receiver.recv().unwrap_or(Err(EncodeError::PoolClosed))
+    }
+
+    /// Returns the result if encoding has finished, or the handle otherwise.
+    ///
+    /// # Errors
+    ///
+    /// The inner result fails if encoding failed or the pool shut down first.
+    pub fn try_wait(self) -> Result<Result<Vec<u8>, EncodeError>, Self> {
+        match self.receiver.try_recv() {
+            Ok(result) => Ok(result),
+            Err(mpsc::TryRecvError::Empty) => Err(self),
+            Err(mpsc::TryRecvError::Disconnected) => Ok(Err(EncodeError::PoolClosed)),
+        }
+    }
+}
+
+impl<S> RenderRequest<'_, S> {
+    /// Hands the rendered frame to `pool` for encoding.
+    ///
+    /// The frame is not copied, and the render thread is free to submit the
+    /// next request while the pool encodes this one.
+    ///
+    /// # Panics
+    ///
+    /// If [`is_ready`](Self::is_ready) returns `false`.
+    ///
+    /// # Errors
+    ///
+    /// If the underlying render failed or produced invalid image data.
+    pub fn finish_encoded(
+        self,
+        pool: &EncoderPool,
+        format: EncodeFormat,
+    ) -> Result<EncodeHandle, RenderingError> {
+        Ok(pool.encode(self.finish_image_ptr()?, format))
+    }
+
+    /// Blocks on the current thread until ready, then calls
+    /// [`finish_encoded`](Self::finish_encoded).
+    ///
+    /// Only the render is waited for; encoding continues on the pool.
+    ///
+    /// # Errors
+    ///
+    /// If the underlying render failed or produced invalid image data.
+    pub fn wait_encoded(
+        self,
+        pool: &EncoderPool,
+        format: EncodeFormat,
+    ) -> Result<EncodeHandle, RenderingError> {
+        Ok(pool.encode(self.wait_image_ptr()?, format))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{encode_rgba, EncodeFormat, PngCompression};
+    use crate::Size;
+
+    fn pixels() -> (Vec<u8>, Size) {
+        let size = Size { width: 4, height: 2 };
+        let data = (0..size.width * size.height)
+            .flat_map(|i| [u8::try_from(i * 30).unwrap(), 0x80, 0xff, 0xff])
+            .collect();
+        (data, size)
+    }
+
+    #[test]
+    fn png_round_trips_pixels() {
+        let (data, size) = pixels();
+        for compression in [PngCompression::Fast, PngCompression::Default, PngCompression::Best] {
+            let png = encode_rgba(&data, size, EncodeFormat::Png(compression)).unwrap();
+            let decoded = image::load_from_memory(&png).unwrap().to_rgba8();
+            assert_eq!(decoded.into_raw(), data);
+        }
+    }
+
+    #[test]
+    fn webp_and_jpeg_encode() {
+        let (data, size) = pixels();
+        let webp = encode_rgba(&data, size, EncodeFormat::WebP).unwrap();
+        assert_eq!(&webp[..4], b"RIFF");
+        let jpeg = encode_rgba(&data, size, EncodeFormat::Jpeg(90)).unwrap();
+        assert_eq!(&jpeg[..2], &[0xff, 0xd8]);
+    }
+
+    #[test]
+    fn rejects_mismatched_buffer() {
+        let (data, size) = pixels();
+        let size = Size { width: size.width + 1, ..size };
+        assert!(encode_rgba(&data, size, EncodeFormat::WebP).is_err());
+    }
+}
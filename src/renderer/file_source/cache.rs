@@ -0,0 +1,407 @@
+//! A process-wide, size-bounded cache of fetched resources.
+
+use std::collections::hash_map::RandomState;
+use std::collections::{BTreeMap, HashMap};
+use std::fmt;
+use std::hash::BuildHasher;
+use std::num::NonZeroUsize;
+use std::ops::RangeInclusive;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+use std::time::SystemTime;
+
+use super::{
+    FileSource, ForwardCompletion, RequestHandle, ResourceKind, ResourceRequest, Responder,
+    Response,
+};
+
+/// Snapshot of a [`ResourceCache`]'s counters.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct CacheStats {
+    /// Requests answered from the cache.
+    pub hits: u64,
+    /// Requests passed on to the inner source.
+    pub misses: u64,
+    /// Entries dropped to stay within the byte budget.
+    pub evictions: u64,
+    /// Entries currently held.
+    pub entries: u64,
+    /// Bytes currently held, counting each entry's URL and body.
+    pub bytes: u64,
+}
+
+/// A size-bounded LRU cache of resource responses, shared between threads.
+///
+/// Every renderer owns its own map and would otherwise fetch the same tiles,
+/// glyphs and sprites separately. Share one cache behind the sources of every
+/// [`FileSourceType`](super::FileSourceType) with [`CachingFileSource`], and
+/// keep the `Arc` to read [`stats`](Self::stats).
+///
+/// The cache is split into shards, each with its own lock and an equal share
+/// of the byte budget, so concurrent lookups rarely contend. Only successful
+/// responses with a body or `no_content` are kept; errors, `not_modified`
+/// and `must-revalidate` responses always reach the inner source. Entries past
+/// their `Expires` time are treated as misses.
+///
+/// Only the fetched bytes are cached: parsed and laid-out tiles live inside
+/// each renderer's map and cannot be shared.
+pub struct ResourceCache {
+    shards: Box<[Mutex<Shard>]>,
+    hasher: RandomState,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    evictions: AtomicU64,
+}
+
+impl fmt::Debug for ResourceCache {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("ResourceCache")
+            .field("shards", &self.shards.len())
+            .field("stats", &self.stats())
+            .finish_non_exhaustive()
+    }
+}
+
+impl ResourceCache {
+    /// Default number of shards.
+    pub const DEFAULT_SHARDS: usize = 16;
+
+    /// A cache holding at most `max_bytes` of responses.
+    #[must_use]
+    pub fn new(max_bytes: usize) -> Arc<Self> {
+        Self::with_shards(max_bytes, NonZeroUsize::new(Self::DEFAULT_SHARDS).unwrap())
+    }
+
+    /// A cache holding at most `max_bytes` of responses, split into
+    /// `shards` independently locked parts.
+    #[must_use]
+    pub fn with_shards(max_bytes: usize, shards: NonZeroUsize) -> Arc<Self> {
+        let budget = max_bytes / shards.get();
+        Arc::new(Self {
+            shards: (0..shards.get()).map(|_| Mutex::new(Shard::new(budget))).collect(),
+            hasher: RandomState::new(),
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            evictions: AtomicU64::new(0),
+        })
+    }
+
+    /// Current counters.
+    #[must_use]
+    pub fn stats(&self) -> CacheStats {
+        let (entries, bytes) = self.shards.iter().fold((0, 0), |(entries, bytes), shard| {
+            let shard = lock(shard);
+            (entries + shard.entries.len() as u64, bytes + shard.bytes as u64)
+        });
+        CacheStats {
+            hits: self.hits.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+            evictions: self.evictions.load(Ordering::Relaxed),
+            entries,
+            bytes,
+        }
+    }
+
+    /// Drops every entry. The counters are kept.
+    pub fn clear(&self) {
+        for shard in &*self.shards {
+            let mut shard = lock(shard);
+            shard.entries.clear();
+            shard.recency.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    fn shard(&self, key: &CacheKey) -> &Mutex<Shard> {
+        let index = self.hasher.hash_one(key) % self.shards.len() as u64;
+        &self.shards[usize::try_from(index).unwrap_or_default()]
+    }
+
+    fn get(&self, key: &CacheKey) -> Option<Response> {
+        let found = lock(self.shard(key)).get(key, SystemTime::now());
+        let counter = if found.is_some() { &self.hits } else { &self.misses };
+        counter.fetch_add(1, Ordering::Relaxed);
+        found
+    }
+
+    fn insert(&self, key: CacheKey, response: &Response) {
+        if !is_cacheable(response) {
+            return;
+        }
+        let evicted = lock(self.shard(&key)).insert(key, response.clone());
+        self.evictions.fetch_add(evicted, Ordering::Relaxed);
+    }
+}
+
+fn is_cacheable(response: &Response) -> bool {
+    response.error.is_none()
+        && !response.not_modified
+        && !response.must_revalidate
+        && (response.data.is_some() || response.no_content)
+}
+
+/// A [`FileSource`] wrapper that answers repeated requests from a shared
+/// [`ResourceCache`].
+///
+/// Wrap the innermost source so that cached responses skip coalescing,
+/// rate limiting and the network:
+///
+/// ```ignore
+/// let cache = ResourceCache::new(256 << 20);
+/// register_file_source(
+///     FileSourceType::Network,
+///     CachingFileSource::new(CoalescingFileSource::new(source), Arc::clone(&cache)),
+/// );
+/// ```
+pub struct CachingFileSource<S> {
+    inner: S,
+    cache: Arc<ResourceCache>,
+}
+
+impl<S: FileSource> CachingFileSource<S> {
+    /// Wraps `inner`, storing its responses in `cache`.
+    #[must_use]
+    pub fn new(inner: S, cache: Arc<ResourceCache>) -> Self {
+        Self { inner, cache }
+    }
+
+    /// The shared cache.
+    #[must_use]
+    pub fn cache(&self) -> &Arc<ResourceCache> {
+        &self.cache
+    }
+}
+
+impl<S> fmt::Debug for CachingFileSource<S> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("CachingFileSource").field("cache", &self.cache).finish_non_exhaustive()
+    }
+}
+
+impl<S: FileSource> FileSource for CachingFileSource<S> {
+    fn can_request(&self, request: &ResourceRequest) -> bool {
+        self.inner.can_request(request)
+    }
+
+    fn request(&self, request: ResourceRequest, responder: Responder) -> RequestHandle {
+        let key = CacheKey::new(&request);
+        if let Some(response) = self.cache.get(&key) {
+            responder.complete(response);
+            return RequestHandle::Done;
+        }
+        let cache = Arc::clone(&self.cache);
+        self.inner.request(
+            request,
+            Responder::from_fn(move |response| {
+                cache.insert(key, &response);
+                responder.complete(response);
+            }),
+        )
+    }
+
+    fn forward(&self, request: ResourceRequest, response: Response, completion: ForwardCompletion) {
+        self.cache.insert(CacheKey::new(&request), &response);
+        self.inner.forward(request, response, completion);
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+struct CacheKey {
+    url: String,
+    kind: ResourceKind,
+    data_range: Option<RangeInclusive<u64>>,
+}
+
+impl CacheKey {
+    fn new(request: &ResourceRequest) -> Self {
+        Self {
+            url: request.url.clone(),
+            kind: request.kind,
+            data_range: request.data_range.clone(),
+        }
+    }
+}
+
+/// One LRU partition. `recency` orders keys by their last use.
+struct Shard {
+    entries: HashMap<CacheKey, Entry>,
+    recency: BTreeMap<u64, CacheKey>,
+    clock: u64,
+    bytes: usize,
+    budget: usize,
+}
+
+struct Entry {
+    response: Response,
+    last_used: u64,
+}
+
+impl Shard {
+    fn new(budget: usize) -> Self {
+        Self { entries: HashMap::new(), recency: BTreeMap::new(), clock: 0, bytes: 0, budget }
+    }
+
+    fn tick(&mut self) -> u64 {
+        self.clock += 1;
+        self.clock
+    }
+
+    fn get(&mut self, key: &CacheKey, now: SystemTime) -> Option<Response> {
+        let expired = self.entries.get(key)?.response.expires.is_some_and(|expires| expires <= now);
+        if expired {
+            self.remove(key);
+            return None;
+        }
+        let tick = self.tick();
+        let entry = self.entries.get_mut(key)?;
+        let key = self.recency.remove(&entry.last_used)?;
+        entry.last_used = tick;
+        let response = entry.response.clone();
+        self.recency.insert(tick, key);
+        Some(response)
+    }
+
+    /// Inserts `response` and returns how many entries were evicted for it.
+    fn insert(&mut self, key: CacheKey, response: Response) -> u64 {
+        let size = entry_size(&key, &response);
+        self.remove(&key);
+        if size > self.budget {
+            return 0;
+        }
+        let mut evicted = 0;
+        while self.bytes + size > self.budget {
+            let Some((_, oldest)) = self.recency.pop_first() else { break };
+            if let Some(entry) = self.entries.remove(&oldest) {
+                self.bytes -= entry_size(&oldest, &entry.response);
+                evicted += 1;
+            }
+        }
+        let tick = self.tick();
+        self.recency.insert(tick, key.clone());
+        self.entries.insert(key, Entry { response, last_used: tick });
+        self.bytes += size;
+        evicted
+    }
+
+    fn remove(&mut self, key: &CacheKey) {
+        if let Some(entry) = self.entries.remove(key) {
+            self.recency.remove(&entry.last_used);
+            self.bytes -= entry_size(key, &entry.response);
+        }
+    }
+}
+
+// Counting the URL keeps bodiless `no_content` entries bounded too.
+fn entry_size(key: &CacheKey, response: &Response) -> usize {
+    key.url.len() + response.data.as_ref().map_or(0, Vec::len)
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+#[cfg(test)]
+mod tests {
+    use std::num::NonZeroUsize;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::sync::{mpsc, Arc};
+    use std::time::{Duration, SystemTime};
+
+    use super::{CacheStats, CachingFileSource, ResourceCache};
+    use crate::renderer::file_source::{
+        ErrorReason, FileSource, RequestHandle, ResourceKind, ResourceRequest, Responder, Response,
+    };
+
+    /// Answers every request inline with a body the size of its URL's number.
+    #[derive(Default)]
+    struct Generated {
+        requests: AtomicUsize,
+    }
+
+    impl FileSource for Arc<Generated> {
+        fn can_request(&self, _: &ResourceRequest) -> bool {
+            true
+        }
+
+        fn request(&self, request: ResourceRequest, responder: Responder) -> RequestHandle {
+            self.requests.fetch_add(1, Ordering::SeqCst);
+            let response = match request.url.parse::<usize>() {
+                Ok(size) => Response::data(vec![0; size]),
+                Err(_) => Response::error(ErrorReason::NotFound, "no such tile"),
+            };
+            responder.complete(response);
+            RequestHandle::Done
+        }
+    }
+
+    fn fetch<S: FileSource>(source: &S, url: &str) -> Response {
+        let (sender, receiver) = mpsc::channel();
+        let responder = Responder::from_fn(move |response| sender.send(response).unwrap());
+        let _ = source.request(ResourceRequest::for_test(url, ResourceKind::Tile), responder);
+        receiver.try_recv().unwrap()
+    }
+
+    fn single_shard(max_bytes: usize) -> Arc<ResourceCache> {
+        ResourceCache::with_shards(max_bytes, NonZeroUsize::MIN)
+    }
+
+    #[test]
+    fn repeats_are_served_from_the_cache() {
+        let inner = Arc::new(Generated::default());
+        let source = CachingFileSource::new(Arc::clone(&inner), ResourceCache::new(1 << 20));
+
+        assert_eq!(fetch(&source, "100").data.map(|data| data.len()), Some(100));
+        assert_eq!(fetch(&source, "100").data.map(|data| data.len()), Some(100));
+        assert_eq!(inner.requests.load(Ordering::SeqCst), 1);
+        assert_eq!(
+            source.cache().stats(),
+            CacheStats { hits: 1, misses: 1, evictions: 0, entries: 1, bytes: 103 }
+        );
+    }
+
+    #[test]
+    fn errors_are_not_cached() {
+        let inner = Arc::new(Generated::default());
+        let source = CachingFileSource::new(Arc::clone(&inner), ResourceCache::new(1 << 20));
+
+        assert!(fetch(&source, "missing").error.is_some());
+        assert!(fetch(&source, "missing").error.is_some());
+        assert_eq!(inner.requests.load(Ordering::SeqCst), 2);
+        assert_eq!(source.cache().stats().entries, 0);
+    }
+
+    #[test]
+    fn least_recently_used_entries_are_evicted_first() {
+        let inner = Arc::new(Generated::default());
+        let source = CachingFileSource::new(Arc::clone(&inner), single_shard(300));
+
+        fetch(&source, "100");
+        fetch(&source, "101");
+        fetch(&source, "100");
+        // Needs room for 105 bytes: "101" is the least recently used.
+        fetch(&source, "102");
+        assert_eq!(source.cache().stats().evictions, 1);
+        assert_eq!(inner.requests.load(Ordering::SeqCst), 3);
+
+        fetch(&source, "100");
+        assert_eq!(inner.requests.load(Ordering::SeqCst), 3);
+        fetch(&source, "101");
+        assert_eq!(inner.requests.load(Ordering::SeqCst), 4);
+
+        // Bodies larger than a shard are passed through.
+        fetch(&source, "1000");
+        assert!(source.cache().stats().bytes <= 300);
+    }
+
+    #[test]
+    fn expired_entries_are_misses() {
+        let cache = single_shard(1 << 20);
+        let request = ResourceRequest::for_test("tile", ResourceKind::Tile);
+        let key = super::CacheKey::new(&request);
+        let past = SystemTime::now() - Duration::from_secs(1);
+        cache.insert(key.clone(), &Response::data(vec![1]).with_expires(past));
+        assert!(cache.get(&key).is_none());
+        assert_eq!(cache.stats().entries, 0);
+    }
+}
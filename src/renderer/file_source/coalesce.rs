@@ -0,0 +1,357 @@
+//! In-flight request deduplication for a [`FileSource`].
+
+use std::collections::HashMap;
+use std::fmt;
+use std::ops::RangeInclusive;
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+use std::time::SystemTime;
+
+use super::{
+    CancelHook, FileSource, ForwardCompletion, RequestHandle, ResourceKind, ResourceRequest,
+    Responder, Response,
+};
+
+type FlightMap = Mutex<HashMap<FlightKey, Arc<Flight>>>;
+
+/// A [`FileSource`] wrapper that shares one upstream request between
+/// identical concurrent requests.
+///
+/// Renderers on different threads that show neighbouring tiles ask for the
+/// same vector tiles, glyph ranges and sprites at the same time. While a
+/// request is in flight, later requests for the same URL, kind and byte range
+/// (and the same cache validators) attach to it instead of reaching the inner
+/// source. Every requester receives a copy of the one response on its own
+/// renderer thread.
+///
+/// Cancellation is reference counted: the inner request is only cancelled
+/// once every attached requester has cancelled.
+///
+/// ```ignore
+/// register_file_source(FileSourceType::Network, CoalescingFileSource::new(source));
+/// ```
+pub struct CoalescingFileSource<S> {
+    inner: S,
+    in_flight: Arc<FlightMap>,
+}
+
+impl<S: FileSource> CoalescingFileSource<S> {
+    /// Wraps `inner`.
+    #[must_use]
+    pub fn new(inner: S) -> Self {
+        Self { inner, in_flight: Arc::default() }
+    }
+
+    /// The wrapped source.
+    #[must_use]
+    pub fn inner(&self) -> &S {
+        &self.inner
+    }
+
+    /// Number of distinct upstream requests in flight.
+    #[must_use]
+    pub fn in_flight(&self) -> usize {
+        lock(&self.in_flight).len()
+    }
+
+    fn waiter_handle(&self, key: FlightKey, flight: Arc<Flight>, waiter: u64) -> RequestHandle {
+        let in_flight = Arc::clone(&self.in_flight);
+        RequestHandle::pending(move || {
+            if flight.detach(waiter) {
+                remove_if_current(&in_flight, &key, &flight);
+            }
+        })
+    }
+}
+
+impl<S> fmt::Debug for CoalescingFileSource<S> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("CoalescingFileSource")
+            .field("in_flight", &lock(&self.in_flight).len())
+            .finish_non_exhaustive()
+    }
+}
+
+impl<S: FileSource> FileSource for CoalescingFileSource<S> {
+    fn can_request(&self, request: &ResourceRequest) -> bool {
+        self.inner.can_request(request)
+    }
+
+    fn request(&self, request: ResourceRequest, responder: Responder) -> RequestHandle {
+        let key = FlightKey::new(&request);
+
+        let (flight, waiter) = {
+            let mut in_flight = lock(&self.in_flight);
+            let existing = in_flight.get(&key).map(Arc::clone);
+            let responder = match existing {
+                Some(flight) => match flight.attach(responder) {
+                    Ok(waiter) => {
+                        drop(in_flight);
+                        return self.waiter_handle(key, flight, waiter);
+                    }
+                    // It finished between lookup and attach; start a new one.
+                    Err(responder) => responder,
+                },
+                None => responder,
+            };
+            let flight = Arc::new(Flight::default());
+            let Ok(waiter) = flight.attach(responder) else {
+                unreachable!("a new flight accepts waiters");
+            };
+            in_flight.insert(key.clone(), Arc::clone(&flight));
+            (flight, waiter)
+        };
+
+        let on_complete = {
+            let in_flight = Arc::clone(&self.in_flight);
+            let flight = Arc::clone(&flight);
+            let key = key.clone();
+            move |response| {
+                remove_if_current(&in_flight, &key, &flight);
+                flight.complete(response);
+            }
+        };
+        if let RequestHandle::Pending(hook) =
+            self.inner.request(request, Responder::from_fn(on_complete))
+        {
+            flight.set_cancel_hook(hook);
+        }
+
+        self.waiter_handle(key, flight, waiter)
+    }
+
+    fn forward(&self, request: ResourceRequest, response: Response, completion: ForwardCompletion) {
+        self.inner.forward(request, response, completion);
+    }
+}
+
+/// The fields that make two requests interchangeable.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+struct FlightKey {
+    url: String,
+    kind: ResourceKind,
+    data_range: Option<RangeInclusive<u64>>,
+    // A 304 only answers requests holding the same cached copy.
+    prior_etag: Option<String>,
+    prior_modified: Option<SystemTime>,
+}
+
+impl FlightKey {
+    fn new(request: &ResourceRequest) -> Self {
+        Self {
+            url: request.url.clone(),
+            kind: request.kind,
+            data_range: request.data_range.clone(),
+            prior_etag: request.prior_etag.clone(),
+            prior_modified: request.prior_modified,
+        }
+    }
+}
+
+/// One upstream request and the requesters attached to it.
+#[derive(Default)]
+struct Flight {
+    state: Mutex<FlightState>,
+}
+
+#[derive(Default)]
+struct FlightState {
+    waiters: Vec<(u64, Responder)>,
+    next_waiter: u64,
+    cancel_hook: Option<CancelHook>,
+    /// Completed, or cancelled by every waiter. No new waiters attach.
+    finished: bool,
+    /// Finished because every waiter cancelled, not because it completed.
+    abandoned: bool,
+}
+
+impl Flight {
+    /// Adds a waiter and returns its id, or hands the responder back once the
+    /// flight has finished.
+    fn attach(&self, responder: Responder) -> Result<u64, Responder> {
+        let mut state = lock(&self.state);
+        if state.finished {
+            return Err(responder);
+        }
+        let waiter = state.next_waiter;
+        state.next_waiter += 1;
+        state.waiters.push((waiter, responder));
+        Ok(waiter)
+    }
+
+    /// Stores the inner request's cancel hook, or runs it right away if every
+    /// waiter already cancelled.
+    fn set_cancel_hook(&self, hook: CancelHook) {
+        let mut state = lock(&self.state);
+        if state.abandoned {
+            drop(state);
+            hook();
+        } else if !state.finished {
+            state.cancel_hook = Some(hook);
+        }
+    }
+
+    /// Removes a cancelled waiter. Returns `true` if it was the last one, in
+    /// which case the inner request is cancelled too.
+    fn detach(&self, waiter: u64) -> bool {
+        let mut state = lock(&self.state);
+        // The native side already took the responder's state, so dropping it
+        // delivers nothing.
+        let Some(index) = state.waiters.iter().position(|(id, _)| *id == waiter) else {
+            return false;
+        };
+        let cancelled = state.waiters.swap_remove(index);
+        if state.finished || !state.waiters.is_empty() {
+            return false;
+        }
+        state.finished = true;
+        state.abandoned = true;
+        let hook = state.cancel_hook.take();
+        drop(state);
+        drop(cancelled);
+        if let Some(hook) = hook {
+            hook();
+        }
+        true
+    }
+
+    /// Delivers `response` to every waiter still attached.
+    fn complete(&self, response: Response) {
+        let waiters = {
+            let mut state = lock(&self.state);
+            state.finished = true;
+            state.cancel_hook = None;
+            std::mem::take(&mut state.waiters)
+        };
+        let mut waiters = waiters.into_iter().map(|(_, responder)| responder);
+        let last = waiters.next_back();
+        for responder in waiters {
+            responder.complete(response.clone());
+        }
+        if let Some(responder) = last {
+            responder.complete(response);
+        }
+    }
+}
+
+/// Drops `flight` from the map unless a newer flight already replaced it.
+fn remove_if_current(in_flight: &FlightMap, key: &FlightKey, flight: &Arc<Flight>) {
+    let mut in_flight = lock(in_flight);
+    if in_flight.get(key).is_some_and(|current| Arc::ptr_eq(current, flight)) {
+        in_flight.remove(key);
+    }
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+#[cfg(test)]
+mod tests {
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::sync::{mpsc, Arc, Mutex};
+
+    use super::CoalescingFileSource;
+    use crate::renderer::file_source::{
+        FileSource, RequestHandle, ResourceKind, ResourceRequest, Responder, Response,
+    };
+
+    /// Holds every responder it is given until the test completes it.
+    #[derive(Default)]
+    struct Parked {
+        requests: AtomicUsize,
+        cancels: Arc<AtomicUsize>,
+        responders: Mutex<Vec<Responder>>,
+    }
+
+    impl FileSource for Arc<Parked> {
+        fn can_request(&self, _: &ResourceRequest) -> bool {
+            true
+        }
+
+        fn request(&self, _: ResourceRequest, responder: Responder) -> RequestHandle {
+            self.requests.fetch_add(1, Ordering::SeqCst);
+            self.responders.lock().unwrap().push(responder);
+            let cancels = Arc::clone(&self.cancels);
+            RequestHandle::pending(move || {
+                cancels.fetch_add(1, Ordering::SeqCst);
+            })
+        }
+    }
+
+    impl Parked {
+        fn complete_all(&self, response: &Response) {
+            for responder in self.responders.lock().unwrap().drain(..) {
+                responder.complete(response.clone());
+            }
+        }
+    }
+
+    fn request(url: &str) -> ResourceRequest {
+        ResourceRequest::for_test(url, ResourceKind::Tile)
+    }
+
+    fn listener() -> (Responder, mpsc::Receiver<Response>) {
+        let (sender, receiver) = mpsc::channel();
+        (Responder::from_fn(move |response| sender.send(response).unwrap()), receiver)
+    }
+
+    fn cancel(handle: RequestHandle) {
+        if let RequestHandle::Pending(hook) = handle {
+            hook();
+        }
+    }
+
+    #[test]
+    fn identical_requests_share_one_upstream_request() {
+        let inner = Arc::new(Parked::default());
+        let source = CoalescingFileSource::new(Arc::clone(&inner));
+
+        let (first, first_rx) = listener();
+        let (second, second_rx) = listener();
+        let (other, other_rx) = listener();
+        let _first = source.request(request("tile/1"), first);
+        let _second = source.request(request("tile/1"), second);
+        let _other = source.request(request("tile/2"), other);
+        assert_eq!(inner.requests.load(Ordering::SeqCst), 2);
+        assert_eq!(source.in_flight(), 2);
+
+        inner.complete_all(&Response::data(b"pbf".to_vec()));
+        for rx in [first_rx, second_rx, other_rx] {
+            assert_eq!(rx.try_recv().unwrap().data.as_deref(), Some(b"pbf".as_slice()));
+        }
+        assert_eq!(source.in_flight(), 0);
+
+        // Finished flights are not reused.
+        let (again, _again_rx) = listener();
+        let _again = source.request(request("tile/1"), again);
+        assert_eq!(inner.requests.load(Ordering::SeqCst), 3);
+    }
+
+    #[test]
+    fn upstream_is_cancelled_only_by_the_last_waiter() {
+        let inner = Arc::new(Parked::default());
+        let source = CoalescingFileSource::new(Arc::clone(&inner));
+
+        let (first, first_rx) = listener();
+        let (second, second_rx) = listener();
+        let first = source.request(request("glyphs"), first);
+        let second = source.request(request("glyphs"), second);
+
+        cancel(first);
+        assert_eq!(inner.cancels.load(Ordering::SeqCst), 0);
+        // A native responder is already spent when its hook runs; this one
+        // reports the drop instead.
+        assert!(first_rx.try_recv().unwrap().error.is_some());
+        inner.complete_all(&Response::no_content());
+        assert!(first_rx.try_recv().is_err());
+        assert!(second_rx.try_recv().unwrap().no_content);
+        cancel(second);
+        assert_eq!(inner.cancels.load(Ordering::SeqCst), 0);
+
+        let (third, _third_rx) = listener();
+        let third = source.request(request("glyphs"), third);
+        cancel(third);
+        assert_eq!(inner.cancels.load(Ordering::SeqCst), 1);
+        assert_eq!(source.in_flight(), 0);
+    }
+}
@@ -8,8 +8,14 @@
 //! Use [`FileSource`] directly for synchronous responses, custom runtimes,
 //! or explicit cancellation control.
 
+mod cache;
+mod coalesce;
+#[cfg(feature = "pmtiles")]
+mod pmtiles;
 mod request;
 mod response;
+#[cfg(feature = "tokio")]
+mod scheduler;
 mod source;
 #[cfg(feature = "tokio")]
 mod tokio;
@@ -17,15 +23,24 @@ mod tokio;
 use std::time::{Duration, SystemTime};
 
 pub use crate::bridge::file_source::{ErrorReason, FileSourceType, ResourceKind};
+pub use cache::{CacheStats, CachingFileSource, ResourceCache};
+pub use coalesce::CoalescingFileSource;
+#[cfg(feature = "pmtiles")]
+pub use pmtiles::{
+    Compression, PmTilesArchive, PmTilesError, PmTilesFileSource, PmTilesHeader, TileType,
+};
 pub use request::{LoadingMethods, Priority, ResourceRequest, StoragePolicy, TileRequest, Usage};
 pub use response::{Error, Response};
+#[cfg(feature = "tokio")]
+pub use scheduler::{RequestLane, RequestScheduler, SchedulerPermit};
+pub(crate) use source::{bytes_from_native, BoxedFileSource, RequestHandleFfi};
 pub use source::{
     register_file_source, CancelHook, FileSource, ForwardCompletion, RequestHandle, Responder,
 };
-pub(crate) use source::{BoxedFileSource, RequestHandleFfi};
 #[cfg(feature = "tokio")]
 pub use tokio::{
-    register_tokio_file_source, register_tokio_file_source_with_handle, TokioFileSource,
+    register_tokio_file_source, register_tokio_file_source_with_handle,
+    register_tokio_file_source_with_scheduler, TokioFileSource,
 };
 
 // Epoch-seconds conversions shared by the `Response` and `ResourceRequest`
@@ -0,0 +1,777 @@
+//! A built-in file source for local `PMTiles` archives.
+//!
+//! Archives are memory-mapped. Opening one reads only the fixed header and
+//! the root directory; leaf directories are parsed the first time a lookup
+//! lands in them. See <https://github.com/protomaps/PMTiles/blob/main/spec/v3/spec.md>.
+
+use std::borrow::Cow;
+use std::collections::HashMap;
+use std::fmt;
+use std::fs::File;
+use std::io::{self, Read};
+use std::ops::RangeInclusive;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+
+use flate2::read::GzDecoder;
+use memmap2::Mmap;
+
+use super::{ErrorReason, FileSource, RequestHandle, ResourceRequest, Responder, Response};
+
+const SCHEME: &str = "pmtiles://";
+const TILE_SUFFIX: &str = "/{z}/{x}/{y}";
+const HEADER_LEN: usize = 127;
+/// The spec allows a root directory plus at most three levels of leaves.
+const MAX_DIRECTORY_DEPTH: usize = 4;
+/// Parsed leaf directories kept per archive before the cache is reset.
+const LEAF_CACHE_ENTRIES: usize = 64;
+
+/// Errors returned when reading a `PMTiles` archive.
+#[derive(thiserror::Error, Debug)]
+#[non_exhaustive]
+pub enum PmTilesError {
+    /// The archive could not be opened or read.
+    #[error(transparent)]
+    Io(#[from] io::Error),
+    /// The file is not a `PMTiles` v3 archive.
+    #[error("not a PMTiles v3 archive")]
+    InvalidHeader,
+    /// A directory, the metadata or a tile uses a compression this reader
+    /// lacks.
+    #[error("unsupported compression {0:?}")]
+    UnsupportedCompression(Compression),
+    /// A directory is malformed or points outside the archive.
+    #[error("corrupt PMTiles directory")]
+    CorruptDirectory,
+    /// The URL does not name a local archive.
+    #[error("not a local pmtiles:// URL: {0}")]
+    InvalidUrl(String),
+    /// The archive's metadata is not valid JSON.
+    #[error(transparent)]
+    Metadata(#[from] serde_json::Error),
+}
+
+/// Compression of directories, metadata or tiles in an archive.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[non_exhaustive]
+pub enum Compression {
+    /// Not specified by the archive.
+    Unknown,
+    /// Stored as is.
+    None,
+    /// gzip.
+    Gzip,
+    /// Brotli.
+    Brotli,
+    /// Zstandard.
+    Zstd,
+}
+
+impl Compression {
+    fn from_byte(byte: u8) -> Self {
+        match byte {
+            1 => Self::None,
+            2 => Self::Gzip,
+            3 => Self::Brotli,
+            4 => Self::Zstd,
+            _ => Self::Unknown,
+        }
+    }
+}
+
+/// Format of the tiles in an archive.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[non_exhaustive]
+pub enum TileType {
+    /// Not specified by the archive.
+    Unknown,
+    /// Mapbox Vector Tiles.
+    Mvt,
+    /// PNG images.
+    Png,
+    /// JPEG images.
+    Jpeg,
+    /// WebP images.
+    Webp,
+    /// AVIF images.
+    Avif,
+}
+
+impl TileType {
+    fn from_byte(byte: u8) -> Self {
+        match byte {
+            1 => Self::Mvt,
+            2 => Self::Png,
+            3 => Self::Jpeg,
+            4 => Self::Webp,
+            5 => Self::Avif,
+            _ => Self::Unknown,
+        }
+    }
+}
+
+/// The fixed-size header of a `PMTiles` v3 archive.
+#[derive(Debug, Clone, Copy, PartialEq)]
+#[non_exhaustive]
+pub struct PmTilesHeader {
+    /// Compression of the directories and metadata.
+    pub internal_compression: Compression,
+    /// Compression of each tile, as stored.
+    pub tile_compression: Compression,
+    /// Format of the tiles.
+    pub tile_type: TileType,
+    /// Lowest zoom with tiles.
+    pub min_zoom: u8,
+    /// Highest zoom with tiles.
+    pub max_zoom: u8,
+    /// West, south, east and north edges in degrees.
+    pub bounds: [f64; 4],
+    /// Longitude and latitude in degrees, then zoom.
+    pub center: [f64; 3],
+    root: Section,
+    metadata: Section,
+    leaves: Section,
+    tile_data: Section,
+}
+
+/// A byte range of the archive, as offset and length.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct Section {
+    offset: u64,
+    length: u64,
+}
+
+impl PmTilesHeader {
+    fn parse(bytes: &[u8]) -> Result<Self, PmTilesError> {
+        let bytes: &[u8; HEADER_LEN] = bytes
+            .get(..HEADER_LEN)
+            .and_then(|header| header.try_into().ok())
+            .ok_or(PmTilesError::InvalidHeader)?;
+        if &bytes[..7] != b"PMTiles" || bytes[7] != 3 {
+            return Err(PmTilesError::InvalidHeader);
+        }
+        let u64_at = |at: usize| u64::from_le_bytes(bytes[at..at + 8].try_into().unwrap());
+        let degrees_at =
+            |at: usize| f64::from(i32::from_le_bytes(bytes[at..at + 4].try_into().unwrap())) / 1e7;
+        let section_at = |at: usize| Section { offset: u64_at(at), length: u64_at(at + 8) };
+        Ok(Self {
+            internal_compression: Compression::from_byte(bytes[97]),
+            tile_compression: Compression::from_byte(bytes[98]),
+            tile_type: TileType::from_byte(bytes[99]),
+            min_zoom: bytes[100],
+            max_zoom: bytes[101],
+            bounds: [degrees_at(102), degrees_at(106), degrees_at(110), degrees_at(114)],
+            center: [degrees_at(119), degrees_at(123), f64::from(bytes[118])],
+            root: section_at(8),
+            metadata: section_at(24),
+            leaves: section_at(40),
+            tile_data: section_at(56),
+        })
+    }
+}
+
+/// One directory entry. `run_length == 0` marks a pointer to a leaf
+/// directory instead of a run of tiles.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+struct DirEntry {
+    tile_id: u64,
+    offset: u64,
+    length: u64,
+    run_length: u32,
+}
+
+/// A memory-mapped `PMTiles` v3 archive.
+pub struct PmTilesArchive {
+    path: PathBuf,
+    map: Mmap,
+    header: PmTilesHeader,
+    root: Arc<[DirEntry]>,
+    leaves: Mutex<HashMap<u64, Arc<[DirEntry]>>>,
+}
+
+impl fmt::Debug for PmTilesArchive {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("PmTilesArchive")
+            .field("path", &self.path)
+            .field("header", &self.header)
+            .finish_non_exhaustive()
+    }
+}
+
+impl PmTilesArchive {
+    /// Maps the archive at `path` and reads its header and root directory.
+    ///
+    /// The file must not be modified or truncated while the archive is open.
+    ///
+    /// # Errors
+    ///
+    /// If the file cannot be mapped or is not a valid `PMTiles` v3 archive.
+    pub fn open(path: impl AsRef<Path>) -> Result<Self, PmTilesError> {
+        let path = path.as_ref().to_path_buf();
+        let file = File::open(&path)?;
+        // SAFETY: The mapping is read-only, and archives are not modified
+        // while they are served, as documented above.
+        let map = unsafe { Mmap::map(&file)? };
+        let header = PmTilesHeader::parse(&map)?;
+        let mut archive = Self { path, map, header, root: Arc::new([]), leaves: Mutex::default() };
+        archive.root = archive.directory(header.root.offset, header.root.length)?.into();
+        Ok(archive)
+    }
+
+    /// The archive's header.
+    #[must_use]
+    pub fn header(&self) -> &PmTilesHeader {
+        &self.header
+    }
+
+    /// The file the archive was opened from.
+    #[must_use]
+    pub fn path(&self) -> &Path {
+        &self.path
+    }
+
+    /// The stored bytes of tile `z`/`x`/`y`, still compressed with
+    /// [`tile_compression`](PmTilesHeader::tile_compression), or `None` if the
+    /// archive has no such tile.
+    ///
+    /// # Errors
+    ///
+    /// If a directory on the way is corrupt.
+    pub fn tile(&self, z: u8, x: u32, y: u32) -> Result<Option<&[u8]>, PmTilesError> {
+        if z > 31 || u64::from(x) >> z != 0 || u64::from(y) >> z != 0 {
+            return Ok(None);
+        }
+        let tile_id = tile_id(z, x, y);
+        let mut entries = Arc::clone(&self.root);
+        for _ in 0..MAX_DIRECTORY_DEPTH {
+            let Some(entry) = find_entry(&entries, tile_id) else {
+                return Ok(None);
+            };
+            if entry.run_length > 0 {
+                let offset = self
+                    .header
+                    .tile_data
+                    .offset
+                    .checked_add(entry.offset)
+                    .ok_or(PmTilesError::CorruptDirectory)?;
+                return self.section(offset, entry.length).map(Some);
+            }
+            entries = self.leaf(entry.offset, entry.length)?;
+        }
+        Err(PmTilesError::CorruptDirectory)
+    }
+
+    /// Raw archive bytes in `range`, clamped to the end of the file.
+    #[must_use]
+    pub fn bytes(&self, range: RangeInclusive<u64>) -> &[u8] {
+        let len = self.map.len();
+        let start = usize::try_from(*range.start()).unwrap_or(len).min(len);
+        let end = usize::try_from(range.end().saturating_add(1)).unwrap_or(len).min(len);
+        &self.map[start..end.max(start)]
+    }
+
+    /// A `TileJSON` document for the archive, serving tiles from `tiles_url`.
+    ///
+    /// The archive's JSON metadata (`vector_layers`, attribution, ...) is
+    /// included as is.
+    ///
+    /// # Errors
+    ///
+    /// If the metadata cannot be decompressed or is not valid JSON.
+    pub fn tilejson(&self, tiles_url: &str) -> Result<String, PmTilesError> {
+        let metadata = self.section(self.header.metadata.offset, self.header.metadata.length)?;
+        let metadata = self.decompress(metadata)?;
+        let mut document = match serde_json::from_slice(&metadata) {
+            Ok(serde_json::Value::Object(object)) => object,
+            Ok(_) => serde_json::Map::new(),
+            Err(_) if metadata.is_empty() => serde_json::Map::new(),
+            Err(error) => return Err(error.into()),
+        };
+        let header = &self.header;
+        let fields = serde_json::json!({
+            "tilejson": "3.0.0",
+            "scheme": "xyz",
+            "tiles": [tiles_url],
+            "minzoom": header.min_zoom,
+            "maxzoom": header.max_zoom,
+            "bounds": header.bounds,
+            "center": header.center,
+        });
+        if let serde_json::Value::Object(fields) = fields {
+            document.extend(fields);
+        }
+        Ok(serde_json::Value::Object(document).to_string())
+    }
+
+    fn section(&self, offset: u64, length: u64) -> Result<&[u8], PmTilesError> {
+        let start = usize::try_from(offset).map_err(|_| PmTilesError::CorruptDirectory)?;
+        let length = usize::try_from(length).map_err(|_| PmTilesError::CorruptDirectory)?;
+        start
+            .checked_add(length)
+            .and_then(|end| self.map.get(start..end))
+            .ok_or(PmTilesError::CorruptDirectory)
+    }
+
+    fn decompress<'a>(&self, bytes: &'a [u8]) -> Result<Cow<'a, [u8]>, PmTilesError> {
+        decompress(self.header.internal_compression, bytes)
+    }
+
+    fn directory(&self, offset: u64, length: u64) -> Result<Vec<DirEntry>, PmTilesError> {
+        parse_directory(&self.decompress(self.section(offset, length)?)?)
+    }
+
+    fn leaf(&self, offset: u64, length: u64) -> Result<Arc<[DirEntry]>, PmTilesError> {
+        if let Some(leaf) = lock(&self.leaves).get(&offset) {
+            return Ok(Arc::clone(leaf));
+        }
+        let start =
+            self.header.leaves.offset.checked_add(offset).ok_or(PmTilesError::CorruptDirectory)?;
+        let leaf: Arc<[DirEntry]> = self.directory(start, length)?.into();
+        let mut leaves = lock(&self.leaves);
+        if leaves.len() >= LEAF_CACHE_ENTRIES {
+            leaves.clear();
+        }
+        leaves.insert(offset, Arc::clone(&leaf));
+        Ok(leaf)
+    }
+}
+
+/// Undoes `compression` on `bytes`.
+fn decompress(compression: Compression, bytes: &[u8]) -> Result<Cow<'_, [u8]>, PmTilesError> {
+    match compression {
+        Compression::None => Ok(Cow::Borrowed(bytes)),
+        Compression::Gzip => {
+            let mut out = Vec::new();
+            GzDecoder::new(bytes).read_to_end(&mut out)?;
+            Ok(Cow::Owned(out))
+        }
+        other => Err(PmTilesError::UnsupportedCompression(other)),
+    }
+}
+
+/// The Hilbert-curve tile id of `z`/`x`/`y`: tiles of lower zooms first,
+/// then along the curve.
+fn tile_id(z: u8, x: u32, y: u32) -> u64 {
+    let base = ((1_u64 << (2 * u32::from(z))) - 1) / 3;
+    let (mut x, mut y) = (u64::from(x), u64::from(y));
+    let mut d = 0;
+    let mut s = (1_u64 << z) >> 1;
+    while s > 0 {
+        let rx = u64::from(x & s != 0);
+        let ry = u64::from(y & s != 0);
+        d += s * s * ((3 * rx) ^ ry);
+        if ry == 0 {
+            if rx == 1 {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+            std::mem::swap(&mut x, &mut y);
+        }
+        s >>= 1;
+    }
+    base + d
+}
+
+/// The entry covering `tile_id`: a run containing it, or the leaf directory
+/// whose range starts at or before it.
+fn find_entry(entries: &[DirEntry], tile_id: u64) -> Option<DirEntry> {
+    let index = entries.partition_point(|entry| entry.tile_id <= tile_id).checked_sub(1)?;
+    let entry = entries[index];
+    (entry.run_length == 0 || tile_id - entry.tile_id < u64::from(entry.run_length))
+        .then_some(entry)
+}
+
+/// Decodes a directory: the entry count, then each column as varints.
+fn parse_directory(bytes: &[u8]) -> Result<Vec<DirEntry>, PmTilesError> {
+    let mut varints = Varints(bytes);
+    let count = usize::try_from(varints.next()?).map_err(|_| PmTilesError::CorruptDirectory)?;
+    // Every entry takes at least four bytes, which bounds the allocation.
+    if count > bytes.len() {
+        return Err(PmTilesError::CorruptDirectory);
+    }
+    let mut entries = vec![DirEntry::default(); count];
+
+    let mut tile_id = 0_u64;
+    for entry in &mut entries {
+        tile_id = tile_id.checked_add(varints.next()?).ok_or(PmTilesError::CorruptDirectory)?;
+        entry.tile_id = tile_id;
+    }
+    for entry in &mut entries {
+        entry.run_length =
+            u32::try_from(varints.next()?).map_err(|_| PmTilesError::CorruptDirectory)?;
+    }
+    for entry in &mut entries {
+        entry.length = varints.next()?;
+    }
+    // An offset of 0 means "right after the previous entry"; others are +1.
+    let mut next_offset = None;
+    for entry in &mut entries {
+        entry.offset = match (varints.next()?, next_offset) {
+            (0, Some(next)) => next,
+            (0, None) => return Err(PmTilesError::CorruptDirectory),
+            (value, _) => value - 1,
+        };
+        next_offset = entry.offset.checked_add(entry.length);
+    }
+    Ok(entries)
+}
+
+/// Reads unsigned LEB128 varints from the front of a slice.
+struct Varints<'a>(&'a [u8]);
+
+impl Varints<'_> {
+    fn next(&mut self) -> Result<u64, PmTilesError> {
+        let mut value = 0_u64;
+        for (index, &byte) in self.0.iter().enumerate().take(10) {
+            value |= u64::from(byte & 0x7f) << (7 * index);
+            if byte & 0x80 == 0 {
+                self.0 = &self.0[index + 1..];
+                return Ok(value);
+            }
+        }
+        Err(PmTilesError::CorruptDirectory)
+    }
+}
+
+/// A [`FileSource`] serving `pmtiles://` URLs from local archives.
+///
+/// Register it for [`FileSourceType::Pmtiles`](super::FileSourceType::Pmtiles)
+/// and point a style source at `pmtiles://file:///path/to/archive.pmtiles` (or
+/// `pmtiles:///path/to/archive.pmtiles`). The source answers the `TileJSON`
+/// request from the archive header and metadata, tile requests from its
+/// directories, and requests carrying a byte range with the raw archive bytes.
+/// Tiles are served decompressed; archives whose tiles are compressed with
+/// anything but gzip are answered with an error.
+///
+/// Archives are opened on first use and kept open.
+#[derive(Default)]
+pub struct PmTilesFileSource {
+    archives: Mutex<HashMap<PathBuf, Arc<PmTilesArchive>>>,
+}
+
+impl fmt::Debug for PmTilesFileSource {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("PmTilesFileSource")
+            .field("archives", &lock(&self.archives).len())
+            .finish_non_exhaustive()
+    }
+}
+
+impl PmTilesFileSource {
+    /// A source with no archives open yet.
+    #[must_use]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Adds an already opened archive, e.g. to check it before registering.
+    #[must_use]
+    pub fn with_archive(self, archive: PmTilesArchive) -> Self {
+        lock(&self.archives).insert(archive.path.clone(), Arc::new(archive));
+        self
+    }
+
+    fn archive(&self, path: &Path) -> Result<Arc<PmTilesArchive>, PmTilesError> {
+        if let Some(archive) = lock(&self.archives).get(path) {
+            return Ok(Arc::clone(archive));
+        }
+        // Opening maps the file and parses the root directory; keep it out of
+        // the lock.
+        let archive = Arc::new(PmTilesArchive::open(path)?);
+        Ok(Arc::clone(lock(&self.archives).entry(path.to_path_buf()).or_insert(archive)))
+    }
+
+    fn respond(&self, request: &ResourceRequest) -> Result<Response, PmTilesError> {
+        let url = request.tile.as_ref().map_or(&request.url, |tile| &tile.url_template);
+        let (archive_url, path) = archive_path(url)?;
+        let archive = self.archive(&path)?;
+
+        if let Some(range) = &request.data_range {
+            return Ok(Response::data(archive.bytes(range.clone()).to_vec()));
+        }
+        let Some(tile) = &request.tile else {
+            let tilejson = archive.tilejson(&format!("{archive_url}{TILE_SUFFIX}"))?;
+            return Ok(Response::data(tilejson.into_bytes()));
+        };
+        let coords = (u8::try_from(tile.z), u32::try_from(tile.x), u32::try_from(tile.y));
+        let (Ok(z), Ok(x), Ok(y)) = coords else {
+            return Ok(Response::no_content());
+        };
+        // MapLibre Native's parsers expect tiles as served over HTTP, where
+        // the client has already undone the content encoding.
+        Ok(match archive.tile(z, x, y)? {
+            Some(bytes) => {
+                Response::data(decompress(archive.header.tile_compression, bytes)?.into_owned())
+            }
+            None => Response::no_content(),
+        })
+    }
+}
+
+impl FileSource for PmTilesFileSource {
+    fn can_request(&self, request: &ResourceRequest) -> bool {
+        request.url.starts_with(SCHEME)
+    }
+
+    fn request(&self, request: ResourceRequest, responder: Responder) -> RequestHandle {
+        responder.complete(self.respond(&request).unwrap_or_else(|error| {
+            let reason = match &error {
+                PmTilesError::Io(error) if error.kind() == io::ErrorKind::NotFound => {
+                    ErrorReason::NotFound
+                }
+                _ => ErrorReason::Other,
+            };
+            Response::error(reason, error.to_string())
+        }));
+        RequestHandle::Done
+    }
+}
+
+/// Splits a `pmtiles://` URL or tile template into the archive URL and its
+/// file path.
+fn archive_path(url: &str) -> Result<(&str, PathBuf), PmTilesError> {
+    let invalid = || PmTilesError::InvalidUrl(url.to_owned());
+    let archive_url = url.strip_suffix(TILE_SUFFIX).unwrap_or(url);
+    let location = archive_url.strip_prefix(SCHEME).ok_or_else(invalid)?;
+    let path = if location.starts_with("file://") {
+        url::Url::parse(location)
+            .ok()
+            .and_then(|url| url.to_file_path().ok())
+            .ok_or_else(invalid)?
+    } else if location.starts_with('/') {
+        PathBuf::from(location)
+    } else {
+        return Err(invalid());
+    };
+    Ok((archive_url, path))
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+#[cfg(test)]
+mod tests {
+    use std::io::Write;
+    use std::path::PathBuf;
+    use std::sync::mpsc;
+
+    use flate2::write::GzEncoder;
+
+    use super::{parse_directory, tile_id, DirEntry, PmTilesArchive, PmTilesFileSource};
+    use crate::renderer::file_source::{
+        FileSource, ResourceKind, ResourceRequest, Responder, Response, TileRequest,
+    };
+
+    fn varint(mut value: u64, out: &mut Vec<u8>) {
+        while value >= 0x80 {
+            out.push(u8::try_from(value & 0x7f).unwrap() | 0x80);
+            value >>= 7;
+        }
+        out.push(u8::try_from(value).unwrap());
+    }
+
+    fn encode_directory(entries: &[DirEntry]) -> Vec<u8> {
+        let mut out = Vec::new();
+        varint(entries.len() as u64, &mut out);
+        let mut last = 0;
+        for entry in entries {
+            varint(entry.tile_id - last, &mut out);
+            last = entry.tile_id;
+        }
+        for entry in entries {
+            varint(u64::from(entry.run_length), &mut out);
+        }
+        for entry in entries {
+            varint(entry.length, &mut out);
+        }
+        for (index, entry) in entries.iter().enumerate() {
+            let contiguous =
+                index > 0 && entry.offset == entries[index - 1].offset + entries[index - 1].length;
+            varint(if contiguous { 0 } else { entry.offset + 1 }, &mut out);
+        }
+        out
+    }
+
+    fn gzip(bytes: &[u8]) -> Vec<u8> {
+        let mut encoder = GzEncoder::new(Vec::new(), flate2::Compression::default());
+        encoder.write_all(bytes).unwrap();
+        encoder.finish().unwrap()
+    }
+
+    /// An archive with tiles 0/0/0 and 1/1/0 in the root directory and 2/3/3
+    /// behind a leaf directory. Directories and metadata are uncompressed;
+    /// tiles are stored as `compress` returns them, marked with the header's
+    /// `tile_compression` byte.
+    fn write_archive(
+        name: &str,
+        tile_compression: u8,
+        compress: impl Fn(&[u8]) -> Vec<u8>,
+    ) -> PathBuf {
+        let tiles: Vec<Vec<u8>> =
+            [b"zoom-0".as_slice(), b"one-one-zero", b"leaf-tile"].map(compress).into();
+        let lengths = tiles.iter().map(|tile| tile.len() as u64).collect::<Vec<_>>();
+        let leaf = encode_directory(&[DirEntry {
+            tile_id: tile_id(2, 3, 3),
+            offset: lengths[0] + lengths[1],
+            length: lengths[2],
+            run_length: 1,
+        }]);
+        let root = encode_directory(&[
+            DirEntry { tile_id: 0, offset: 0, length: lengths[0], run_length: 1 },
+            DirEntry {
+                tile_id: tile_id(1, 1, 0),
+                offset: lengths[0],
+                length: lengths[1],
+                run_length: 1,
+            },
+            DirEntry {
+                tile_id: tile_id(2, 0, 0),
+                offset: 0,
+                length: leaf.len() as u64,
+                run_length: 0,
+            },
+        ]);
+        let metadata = br#"{"name":"test","vector_layers":[]}"#;
+
+        let root_offset = 127_u64;
+        let metadata_offset = root_offset + root.len() as u64;
+        let leaves_offset = metadata_offset + metadata.len() as u64;
+        let data_offset = leaves_offset + leaf.len() as u64;
+        let data: Vec<u8> = tiles.concat();
+
+        let mut file = b"PMTiles\x03".to_vec();
+        for value in [
+            root_offset,
+            root.len() as u64,
+            metadata_offset,
+            metadata.len() as u64,
+            leaves_offset,
+            leaf.len() as u64,
+            data_offset,
+            data.len() as u64,
+            3,
+            3,
+            3,
+        ] {
+            file.extend_from_slice(&value.to_le_bytes());
+        }
+        file.extend_from_slice(&[0, 1, tile_compression, 1, 0, 2]);
+        for e7 in [-1_800_000_000_i32, -850_000_000, 1_800_000_000, 850_000_000] {
+            file.extend_from_slice(&e7.to_le_bytes());
+        }
+        file.push(1);
+        file.extend_from_slice(&[0; 8]);
+        assert_eq!(file.len(), 127);
+        for section in [&root[..], metadata, &leaf, &data] {
+            file.extend_from_slice(section);
+        }
+
+        let path = std::env::temp_dir().join(format!("mln-{}-{name}.pmtiles", std::process::id()));
+        std::fs::write(&path, file).unwrap();
+        path
+    }
+
+    #[test]
+    fn tile_ids_follow_the_hilbert_curve() {
+        assert_eq!(tile_id(0, 0, 0), 0);
+        assert_eq!(tile_id(1, 0, 0), 1);
+        assert_eq!(tile_id(1, 0, 1), 2);
+        assert_eq!(tile_id(1, 1, 1), 3);
+        assert_eq!(tile_id(1, 1, 0), 4);
+        assert_eq!(tile_id(2, 0, 0), 5);
+        assert_eq!(tile_id(3, 7, 0), 84);
+    }
+
+    #[test]
+    fn directories_round_trip() {
+        let entries = [
+            DirEntry { tile_id: 5, offset: 0, length: 10, run_length: 1 },
+            DirEntry { tile_id: 6, offset: 10, length: 4, run_length: 3 },
+            DirEntry { tile_id: 100, offset: 2, length: 10, run_length: 1 },
+        ];
+        assert_eq!(parse_directory(&encode_directory(&entries)).unwrap(), entries);
+        assert!(parse_directory(&[0x05, 0x01]).is_err());
+    }
+
+    #[test]
+    fn reads_tiles_through_root_and_leaf_directories() {
+        let path = write_archive("tiles", 1, <[u8]>::to_vec);
+        let archive = PmTilesArchive::open(&path).unwrap();
+        assert_eq!(archive.header().max_zoom, 2);
+
+        assert_eq!(archive.tile(0, 0, 0).unwrap(), Some(b"zoom-0".as_slice()));
+        assert_eq!(archive.tile(1, 1, 0).unwrap(), Some(b"one-one-zero".as_slice()));
+        assert_eq!(archive.tile(2, 3, 3).unwrap(), Some(b"leaf-tile".as_slice()));
+        assert_eq!(archive.tile(1, 0, 0).unwrap(), None);
+        assert_eq!(archive.tile(2, 1, 1).unwrap(), None);
+        assert_eq!(archive.tile(1, 2, 0).unwrap(), None);
+        let _ = std::fs::remove_file(path);
+    }
+
+    fn fetch(source: &PmTilesFileSource, request: ResourceRequest) -> Response {
+        let (sender, receiver) = mpsc::channel();
+        let responder = Responder::from_fn(move |response| sender.send(response).unwrap());
+        let _ = source.request(request, responder);
+        receiver.try_recv().unwrap()
+    }
+
+    #[test]
+    fn file_source_serves_tilejson_tiles_and_ranges() {
+        let path = write_archive("source", 1, <[u8]>::to_vec);
+        let url = format!("pmtiles://{}", path.display());
+        let source = PmTilesFileSource::new();
+
+        let tilejson = fetch(&source, ResourceRequest::for_test(&url, ResourceKind::Source));
+        let tilejson: serde_json::Value = serde_json::from_slice(&tilejson.data.unwrap()).unwrap();
+        assert_eq!(tilejson["name"], "test");
+        assert_eq!(tilejson["maxzoom"], 2);
+        let template = tilejson["tiles"][0].as_str().unwrap().to_owned();
+        assert_eq!(template, format!("{url}/{{z}}/{{x}}/{{y}}"));
+
+        let mut tile = ResourceRequest::for_test(&format!("{url}/2/3/3"), ResourceKind::Tile);
+        tile.tile = Some(TileRequest::for_test(&template, 2, 3, 3));
+        assert_eq!(fetch(&source, tile.clone()).data.as_deref(), Some(b"leaf-tile".as_slice()));
+        tile.tile = Some(TileRequest::for_test(&template, 2, 2, 2));
+        assert!(fetch(&source, tile).no_content);
+
+        let mut range = ResourceRequest::for_test(&url, ResourceKind::Source);
+        range.data_range = Some(0..=6);
+        assert_eq!(fetch(&source, range).data.as_deref(), Some(b"PMTiles".as_slice()));
+
+        let missing = ResourceRequest::for_test("pmtiles:///no/such.pmtiles", ResourceKind::Source);
+        assert!(fetch(&source, missing).error.is_some());
+        let _ = std::fs::remove_file(path);
+    }
+
+    #[test]
+    fn file_source_decompresses_gzip_tiles() {
+        let path = write_archive("gzip", 2, gzip);
+        let url = format!("pmtiles://{}", path.display());
+        let source = PmTilesFileSource::new();
+        let template = format!("{url}/{{z}}/{{x}}/{{y}}");
+
+        let archive = PmTilesArchive::open(&path).unwrap();
+        assert_eq!(archive.tile(2, 3, 3).unwrap(), Some(gzip(b"leaf-tile").as_slice()));
+        let mut tile = ResourceRequest::for_test(&format!("{url}/2/3/3"), ResourceKind::Tile);
+        tile.tile = Some(TileRequest::for_test(&template, 2, 3, 3));
+        assert_eq!(fetch(&source, tile).data.as_deref(), Some(b"leaf-tile".as_slice()));
+        let _ = std::fs::remove_file(path);
+    }
+
+    #[test]
+    fn file_source_rejects_unsupported_tile_compression() {
+        // Brotli; the bytes are never decoded.
+        let path = write_archive("brotli", 3, <[u8]>::to_vec);
+        let url = format!("pmtiles://{}", path.display());
+        let source = PmTilesFileSource::new();
+        let template = format!("{url}/{{z}}/{{x}}/{{y}}");
+
+        let mut tile = ResourceRequest::for_test(&format!("{url}/0/0/0"), ResourceKind::Tile);
+        tile.tile = Some(TileRequest::for_test(&template, 0, 0, 0));
+        let response = fetch(&source, tile);
+        assert!(response.data.is_none());
+        assert!(response.error.is_some());
+        let _ = std::fs::remove_file(path);
+    }
+}
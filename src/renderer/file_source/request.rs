@@ -40,9 +40,11 @@ pub struct ResourceRequest {
 }
 
 impl ResourceRequest {
-    pub(super) fn from_ffi(raw: &RawResourceRequest) -> Self {
+    /// Takes ownership of the FFI request, so the URL and prior body move
+    /// without another copy.
+    pub(super) fn from_ffi(raw: RawResourceRequest) -> Self {
         Self {
-            url: raw.url.clone(),
+            url: raw.url,
             kind: raw.kind,
             loading_methods: LoadingMethods::from_bits(raw.loading_methods),
             storage_policy: if raw.is_volatile {
@@ -53,7 +55,7 @@ impl ResourceRequest {
             priority: if raw.is_low_priority { Priority::Low } else { Priority::Regular },
             usage: if raw.is_offline { Usage::Offline } else { Usage::Online },
             tile: raw.has_tile.then(|| TileRequest {
-                url_template: raw.tile_url_template.clone(),
+                url_template: raw.tile_url_template,
                 pixel_ratio: raw.tile_pixel_ratio,
                 x: raw.tile_x,
                 y: raw.tile_y,
@@ -62,13 +64,34 @@ impl ResourceRequest {
             data_range: raw.has_data_range.then_some(raw.data_range_start..=raw.data_range_end),
             prior_modified: from_epoch(raw.has_prior_modified, raw.prior_modified_epoch_s),
             prior_expires: from_epoch(raw.has_prior_expires, raw.prior_expires_epoch_s),
-            prior_etag: raw.has_prior_etag.then(|| raw.prior_etag.clone()),
-            prior_data: raw.has_prior_data.then(|| raw.prior_data.clone()),
+            prior_etag: raw.has_prior_etag.then_some(raw.prior_etag),
+            prior_data: raw.has_prior_data.then_some(raw.prior_data),
             minimum_update_interval: Duration::from_millis(
                 u64::try_from(raw.minimum_update_interval_ms).unwrap_or(0),
             ),
         }
     }
+
+    #[cfg(test)]
+    pub(crate) fn for_test(url: &str, kind: ResourceKind) -> Self {
+        Self {
+            url: url.to_owned(),
+            kind,
+            loading_methods: LoadingMethods::from_bits(
+                LoadingMethods::CACHE | LoadingMethods::NETWORK,
+            ),
+            storage_policy: StoragePolicy::Permanent,
+            priority: Priority::Regular,
+            usage: Usage::Online,
+            tile: None,
+            data_range: None,
+            prior_modified: None,
+            prior_expires: None,
+            prior_etag: None,
+            prior_data: None,
+            minimum_update_interval: Duration::ZERO,
+        }
+    }
 }
 
 /// MapLibre Native loading-method flags for a resource request.
@@ -141,3 +164,10 @@ pub struct TileRequest {
     /// Tile z coordinate.
     pub z: i8,
 }
+
+#[cfg(test)]
+impl TileRequest {
+    pub(crate) fn for_test(url_template: &str, z: i8, x: i32, y: i32) -> Self {
+        Self { url_template: url_template.to_owned(), pixel_ratio: 1, x, y, z }
+    }
+}
@@ -154,21 +154,21 @@ impl Response {
         }
     }
 
-    /// Reconstruct from the flat FFI shape (for `forward`).
-    pub(super) fn from_ffi(ffi: &RawResponse) -> Self {
+    /// Reconstruct from the flat FFI shape (for `forward`), moving the body.
+    pub(super) fn from_ffi(ffi: RawResponse) -> Self {
         Self {
             error: ffi.has_error.then(|| Error {
                 reason: ffi.error_reason,
-                message: ffi.error_message.clone(),
+                message: ffi.error_message,
                 retry_after: from_epoch(ffi.has_retry_after, ffi.retry_after_epoch_s),
             }),
             no_content: ffi.no_content,
             not_modified: ffi.not_modified,
             must_revalidate: ffi.must_revalidate,
-            data: ffi.has_data.then(|| ffi.data.clone()),
+            data: ffi.has_data.then_some(ffi.data),
             modified: from_epoch(ffi.has_modified, ffi.modified_epoch_s),
             expires: from_epoch(ffi.has_expires, ffi.expires_epoch_s),
-            etag: ffi.has_etag.then(|| ffi.etag.clone()),
+            etag: ffi.has_etag.then_some(ffi.etag),
         }
     }
 }
@@ -183,7 +183,7 @@ mod tests {
 
     fn roundtrip(response: Response) -> Response {
         let raw = roundtrip_response_for_test(&response.into_ffi());
-        Response::from_ffi(&raw)
+        Response::from_ffi(raw)
     }
 
     #[test]
@@ -231,6 +231,14 @@ mod tests {
         assert!(!back.must_revalidate);
     }
 
+    #[test]
+    fn large_binary_body_roundtrips_byte_for_byte() {
+        let body: Vec<u8> =
+            (0..512 * 1024_u32).map(|i| i.to_le_bytes()[0] ^ i.to_le_bytes()[1]).collect();
+        let back = roundtrip(Response::data(body.clone()));
+        assert_eq!(back.data, Some(body));
+    }
+
     #[test]
     fn pre_unix_epoch_timestamps_roundtrip() {
         let modified = SystemTime::UNIX_EPOCH - Duration::from_secs(1);
@@ -0,0 +1,245 @@
+//! Per-host, priority-ordered admission for `tokio` file sources.
+
+use std::collections::{HashMap, VecDeque};
+use std::fmt;
+use std::num::NonZeroUsize;
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+
+use ::tokio::sync::oneshot;
+
+use super::{Priority, ResourceKind, ResourceRequest, Usage};
+
+/// Scheduling class of a request, most urgent first.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum RequestLane {
+    /// Styles, `TileJSON`, sprites and glyphs: nothing renders without them.
+    Blocking,
+    /// Regular tile and image requests.
+    Normal,
+    /// Low-priority and offline requests, such as prefetching.
+    Low,
+}
+
+impl RequestLane {
+    const COUNT: usize = 3;
+
+    /// The lane MapLibre Native's request metadata puts `request` in.
+    #[must_use]
+    pub fn of(request: &ResourceRequest) -> Self {
+        if request.priority == Priority::Low || request.usage == Usage::Offline {
+            return Self::Low;
+        }
+        match request.kind {
+            ResourceKind::Style
+            | ResourceKind::Source
+            | ResourceKind::SpriteImage
+            | ResourceKind::SpriteJSON
+            | ResourceKind::Glyphs => Self::Blocking,
+            _ => Self::Normal,
+        }
+    }
+}
+
+/// Limits concurrent requests per host and admits waiting ones by lane.
+///
+/// A request whose host is at its limit waits in its [`RequestLane`]; when a
+/// request finishes, the slot goes to the oldest waiter of the most urgent
+/// lane. Cancelled requests leave the queue before reaching the source.
+/// Requests without a host (`file://`, `asset://`, ...) are not limited.
+///
+/// Pass it to [`register_tokio_file_source_with_scheduler`](super::register_tokio_file_source_with_scheduler).
+pub struct RequestScheduler {
+    max_per_host: usize,
+    hosts: Mutex<HashMap<String, Arc<HostSlots>>>,
+}
+
+impl fmt::Debug for RequestScheduler {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("RequestScheduler")
+            .field("max_per_host", &self.max_per_host)
+            .finish_non_exhaustive()
+    }
+}
+
+impl RequestScheduler {
+    /// A scheduler allowing `max_per_host` concurrent requests to each host.
+    #[must_use]
+    pub fn new(max_per_host: NonZeroUsize) -> Self {
+        Self { max_per_host: max_per_host.get(), hosts: Mutex::default() }
+    }
+
+    /// Waits until `request` may reach the source.
+    ///
+    /// Hold the returned permit until the response is complete. Dropping the
+    /// future while it waits gives up the place in the queue.
+    pub async fn admit(&self, request: &ResourceRequest) -> Option<SchedulerPermit> {
+        let host = url::Url::parse(&request.url).ok()?.host_str()?.to_owned();
+        let slots = Arc::clone(
+            lock(&self.hosts)
+                .entry(host)
+                .or_insert_with(|| Arc::new(HostSlots::new(self.max_per_host))),
+        );
+        let waiting = {
+            let mut state = lock(&slots.state);
+            if state.active < slots.limit {
+                state.active += 1;
+                None
+            } else {
+                let (sender, receiver) = oneshot::channel();
+                state.waiting[RequestLane::of(request) as usize].push_back(sender);
+                Some(receiver)
+            }
+        };
+        match waiting {
+            None => Some(SchedulerPermit { slots: Some(slots) }),
+            // `slots` keeps the queue alive, and senders are only dropped unsent
+            // once their receiver is gone, so this always yields a permit.
+            Some(receiver) => receiver.await.ok(),
+        }
+    }
+}
+
+struct HostSlots {
+    limit: usize,
+    state: Mutex<HostState>,
+}
+
+struct HostState {
+    active: usize,
+    waiting: [VecDeque<oneshot::Sender<SchedulerPermit>>; RequestLane::COUNT],
+}
+
+impl HostSlots {
+    fn new(limit: usize) -> Self {
+        Self { limit, state: Mutex::new(HostState { active: 0, waiting: Default::default() }) }
+    }
+}
+
+/// A request's slot at its host, released on drop.
+#[must_use = "the slot is released when the permit is dropped"]
+pub struct SchedulerPermit {
+    slots: Option<Arc<HostSlots>>,
+}
+
+impl fmt::Debug for SchedulerPermit {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("SchedulerPermit").finish_non_exhaustive()
+    }
+}
+
+impl Drop for SchedulerPermit {
+    fn drop(&mut self) {
+        let Some(slots) = self.slots.take() else {
+            return;
+        };
+        // Hand the slot to the most urgent waiter still listening.
+        loop {
+            let next = {
+                let mut state = lock(&slots.state);
+                let next = state.waiting.iter_mut().find_map(VecDeque::pop_front);
+                if next.is_none() {
+                    state.active -= 1;
+                }
+                next
+            };
+            let Some(next) = next else {
+                return;
+            };
+            // A waiter that received the permit but is then dropped releases
+            // it through this same path.
+            match next.send(Self { slots: Some(Arc::clone(&slots)) }) {
+                Ok(()) => return,
+                Err(mut unsent) => unsent.slots = None,
+            }
+        }
+    }
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+#[cfg(test)]
+mod tests {
+    use std::future::Future;
+    use std::num::NonZeroUsize;
+    use std::pin::pin;
+    use std::task::{Context, Poll, Waker};
+
+    use super::{RequestLane, RequestScheduler};
+    use crate::renderer::file_source::{Priority, ResourceKind, ResourceRequest};
+
+    fn request(url: &str, kind: ResourceKind) -> ResourceRequest {
+        ResourceRequest::for_test(url, kind)
+    }
+
+    fn prefetch(url: &str) -> ResourceRequest {
+        let mut request = request(url, ResourceKind::Tile);
+        request.priority = Priority::Low;
+        request
+    }
+
+    fn poll<F: Future>(future: std::pin::Pin<&mut F>) -> Poll<F::Output> {
+        future.poll(&mut Context::from_waker(Waker::noop()))
+    }
+
+    #[test]
+    fn lanes_follow_request_metadata() {
+        assert_eq!(
+            RequestLane::of(&request("https://a/s", ResourceKind::Style)),
+            RequestLane::Blocking
+        );
+        assert_eq!(
+            RequestLane::of(&request("https://a/t", ResourceKind::Tile)),
+            RequestLane::Normal
+        );
+        assert_eq!(RequestLane::of(&prefetch("https://a/t")), RequestLane::Low);
+    }
+
+    #[test]
+    fn urgent_waiters_are_admitted_first() {
+        let scheduler = RequestScheduler::new(NonZeroUsize::MIN);
+        let low = prefetch("https://tiles.example/1");
+        let blocking = request("https://tiles.example/glyphs", ResourceKind::Glyphs);
+
+        let Poll::Ready(Some(first)) = poll(pin!(scheduler.admit(&low))) else {
+            panic!("a free host admits right away");
+        };
+        let mut waiting_low = pin!(scheduler.admit(&low));
+        let mut waiting_blocking = pin!(scheduler.admit(&blocking));
+        assert!(poll(waiting_low.as_mut()).is_pending());
+        assert!(poll(waiting_blocking.as_mut()).is_pending());
+
+        drop(first);
+        assert!(poll(waiting_low.as_mut()).is_pending());
+        let Poll::Ready(Some(second)) = poll(waiting_blocking.as_mut()) else {
+            panic!("the blocking request is admitted first");
+        };
+        drop(second);
+        assert!(matches!(poll(waiting_low.as_mut()), Poll::Ready(Some(_))));
+
+        // Other hosts and hostless URLs are not affected.
+        let other = request("https://other.example/1", ResourceKind::Tile);
+        assert!(matches!(poll(pin!(scheduler.admit(&other))), Poll::Ready(Some(_))));
+        let local = request("file:///tmp/style.json", ResourceKind::Style);
+        assert!(matches!(poll(pin!(scheduler.admit(&local))), Poll::Ready(None)));
+    }
+
+    #[test]
+    fn cancelled_waiters_give_up_their_place() {
+        let scheduler = RequestScheduler::new(NonZeroUsize::MIN);
+        let tile = request("https://tiles.example/1", ResourceKind::Tile);
+
+        let Poll::Ready(Some(first)) = poll(pin!(scheduler.admit(&tile))) else {
+            panic!("a free host admits right away");
+        };
+        {
+            let mut cancelled = pin!(scheduler.admit(&tile));
+            assert!(poll(cancelled.as_mut()).is_pending());
+        }
+        let mut next = pin!(scheduler.admit(&tile));
+        assert!(poll(next.as_mut()).is_pending());
+        drop(first);
+        assert!(matches!(poll(next.as_mut()), Poll::Ready(Some(_))));
+    }
+}
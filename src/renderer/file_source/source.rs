@@ -80,30 +80,56 @@ impl fmt::Debug for RequestHandle {
 /// reports an error unless the request was already cancelled.
 #[must_use = "complete() the Responder, or MapLibre Native receives a dropped-responder error"]
 pub struct Responder {
-    state: Arc<NativeRequest>,
+    target: Option<ResponseTarget>,
+}
+
+/// Where a [`Responder`] delivers its response.
+enum ResponseTarget {
+    /// A native request issued by MapLibre Native.
+    Native(Arc<NativeRequest>),
+    /// A Rust-side consumer, e.g. a wrapping source fanning the response out.
+    Callback(Box<dyn FnOnce(Response) + Send>),
 }
 
 impl Responder {
     fn new(state: Arc<NativeRequest>) -> Self {
-        Self { state }
+        Self { target: Some(ResponseTarget::Native(state)) }
+    }
+
+    /// A responder that hands the response to `on_complete` instead of
+    /// MapLibre Native.
+    ///
+    /// Wrapping sources use this to post-process what an inner source
+    /// delivers. Dropping it uncompleted passes an error response.
+    pub(crate) fn from_fn(on_complete: impl FnOnce(Response) + Send + 'static) -> Self {
+        Self { target: Some(ResponseTarget::Callback(Box::new(on_complete))) }
     }
 
     /// Deliver `response`. No-op if the request was already cancelled.
-    pub fn complete(self, response: Response) {
-        if let Some(state) = self.state.take() {
-            responder_complete(state, &response.into_ffi());
+    pub fn complete(mut self, response: Response) {
+        self.deliver(response);
+    }
+
+    fn deliver(&mut self, response: Response) {
+        match self.target.take() {
+            Some(ResponseTarget::Native(state)) => {
+                if let Some(state) = state.take() {
+                    responder_complete(state, &response.into_ffi());
+                }
+            }
+            Some(ResponseTarget::Callback(on_complete)) => on_complete(response),
+            None => {}
         }
     }
 }
 
 impl Drop for Responder {
     fn drop(&mut self) {
-        if let Some(state) = self.state.take() {
-            let error = Response::error(
+        if self.target.is_some() {
+            self.deliver(Response::error(
                 ErrorReason::Other,
                 "Rust FileSource responder dropped without completing",
-            );
-            responder_complete(state, &error.into_ffi());
+            ));
         }
     }
 }
@@ -226,6 +252,12 @@ impl fmt::Debug for RequestHandleFfi {
 
 // cxx bridge glue (not called directly by user code)
 
+/// Copies a native buffer into a Rust `Vec` in one pass; `rust::Vec` offers
+/// C++ only per-element `push_back`.
+pub(crate) fn bytes_from_native(data: &[u8]) -> Vec<u8> {
+    data.to_vec()
+}
+
 /// Opaque wrapper handed to C++.
 pub(crate) struct BoxedFileSource(Box<dyn FileSource>);
 
@@ -236,7 +268,7 @@ impl fmt::Debug for BoxedFileSource {
 }
 
 impl BoxedFileSource {
-    pub(crate) fn can_request(&self, request: &RawResourceRequest) -> bool {
+    pub(crate) fn can_request(&self, request: RawResourceRequest) -> bool {
         let request = ResourceRequest::from_ffi(request);
         self.0.can_request(&request)
     }
@@ -244,7 +276,7 @@ impl BoxedFileSource {
     #[allow(clippy::unnecessary_box_returns)]
     pub(crate) fn request(
         &self,
-        request: &RawResourceRequest,
+        request: RawResourceRequest,
         native_state: SharedPtr<RequestState>,
     ) -> Box<RequestHandleFfi> {
         let request = ResourceRequest::from_ffi(request);
@@ -255,8 +287,8 @@ impl BoxedFileSource {
 
     pub(crate) fn forward(
         &self,
-        request: &RawResourceRequest,
-        response: &RawResponse,
+        request: RawResourceRequest,
+        response: RawResponse,
         completion: SharedPtr<ForwardState>,
     ) {
         let request = ResourceRequest::from_ffi(request);
@@ -4,7 +4,7 @@ use std::{future::Future, sync::Arc};
 
 use super::{
     register_file_source, FileSource, FileSourceType, ForwardCompletion, RequestHandle,
-    ResourceRequest, Responder, Response,
+    RequestScheduler, ResourceRequest, Responder, Response,
 };
 
 /// An async, `tokio`-native file source.
@@ -39,6 +39,7 @@ pub trait TokioFileSource: Send + Sync + 'static {
 struct Adapter<S> {
     source: Arc<S>,
     handle: ::tokio::runtime::Handle,
+    scheduler: Option<Arc<RequestScheduler>>,
 }
 
 impl<S: TokioFileSource> FileSource for Adapter<S> {
@@ -48,9 +49,15 @@ impl<S: TokioFileSource> FileSource for Adapter<S> {
 
     fn request(&self, request: ResourceRequest, responder: Responder) -> RequestHandle {
         let source = Arc::clone(&self.source);
+        let scheduler = self.scheduler.clone();
         let abort = self
             .handle
             .spawn(async move {
+                // Cancellation while queued aborts here, before the source runs.
+                let _permit = match &scheduler {
+                    Some(scheduler) => scheduler.admit(&request).await,
+                    None => None,
+                };
                 let response = source.request(request).await;
                 responder.complete(response); // no-op if already cancelled
             })
@@ -77,7 +84,27 @@ pub fn register_tokio_file_source_with_handle<S: TokioFileSource>(
     handle: ::tokio::runtime::Handle,
     source: S,
 ) {
-    let adapter = Adapter { source: Arc::new(source), handle };
+    let adapter = Adapter { source: Arc::new(source), handle, scheduler: None };
+    register_file_source(source_type, adapter);
+}
+
+/// Register a `tokio`-native file source whose requests pass through
+/// `scheduler` before reaching it.
+///
+/// The scheduler limits concurrent requests per host and admits waiting
+/// requests render-blocking first, prefetches last. Share one scheduler
+/// between source types that reach the same hosts.
+///
+/// Keep the Tokio runtime alive while renderers may use this source.
+/// Register before constructing renderers. Re-registering does not update
+/// already-cached MapLibre Native file source instances.
+pub fn register_tokio_file_source_with_scheduler<S: TokioFileSource>(
+    source_type: FileSourceType,
+    handle: ::tokio::runtime::Handle,
+    source: S,
+    scheduler: Arc<RequestScheduler>,
+) {
+    let adapter = Adapter { source: Arc::new(source), handle, scheduler: Some(scheduler) };
     register_file_source(source_type, adapter);
 }
 
@@ -1,9 +1,14 @@
-use std::cell::RefCell;
+use std::cell::{Cell, RefCell};
 use std::f64::consts::PI;
 use std::fmt::Debug;
+#[cfg(feature = "tokio")]
+use std::future::{Future, IntoFuture};
 use std::marker::PhantomData;
 use std::path::Path;
+#[cfg(feature = "tokio")]
+use std::pin::Pin;
 use std::rc::Rc;
+use std::time::{Duration, Instant};
 
 use cxx::UniquePtr;
 use image::{ImageBuffer, Rgba};
@@ -12,7 +17,9 @@ use super::MapObserver;
 use crate::bridge::ffi;
 use crate::bridge::ffi::BridgeImage;
 use crate::renderer::map_observer::MapObserverCallbacks;
-use crate::renderer::{MapDebugOptions, MapLoadError, MapLoadErrorKind};
+use crate::renderer::prefetch::Prefetcher;
+use crate::renderer::{MapDebugOptions, MapLoadError, MapLoadErrorKind, PrefetchPolicy};
+use crate::trace::StyleLoadTrace;
 use crate::{
     CameraUpdate, EdgeInsets, GeoJson, LatLng, LatLngBounds, RunLoopHandle, ScreenCoordinate, Size,
     StyleRef,
@@ -47,20 +54,16 @@ use crate::{
 /// # }
 /// ```
 #[derive(Clone, Debug, Hash, PartialEq, Eq)]
-pub struct Image(ImageBuffer<Rgba<u8>, Vec<u8>>);
+pub struct Image(pub(crate) ImageBuffer<Rgba<u8>, Vec<u8>>);
 
 impl Image {
-    /// Create an Image from raw RGBA data
-    pub(crate) fn from_raw(bytes: &[u8]) -> Option<Self> {
-        // Parse dimensions from first 8 bytes
-        if bytes.len() < 8 {
-            return None;
-        }
-
-        let width = u32::from_ne_bytes([bytes[0], bytes[1], bytes[2], bytes[3]]);
-        let height = u32::from_ne_bytes([bytes[4], bytes[5], bytes[6], bytes[7]]);
-        let data = bytes[8..].to_vec();
-        ImageBuffer::from_vec(width, height, data).map(Image)
+    /// Create an Image from a native RGBA buffer.
+    ///
+    /// This is the single copy on the readback path: the pixels move into a
+    /// Rust-owned `Vec` so the image can outlive the native allocation.
+    pub(crate) fn from_image_ptr(image: &ImagePtr) -> Option<Self> {
+        let size = image.size();
+        ImageBuffer::from_vec(size.width, size.height, image.buffer().to_vec()).map(Image)
     }
 
     /// Get access to the underlying image buffer.
@@ -90,16 +93,31 @@ pub struct ImageRenderer<S> {
     // Makes this type !Send and !Sync: the underlying run loop is thread-affine.
     pub(crate) _not_send: PhantomData<*mut ()>,
     pub(crate) style_specified: bool,
+    /// How long the current style took to load, once it has.
+    pub(crate) style_load_time: Rc<Cell<Option<Duration>>>,
+    /// The size set by the builder or [`set_map_size`](Self::set_map_size).
+    pub(crate) tile_size: Size,
+    /// The size the native map currently renders at; larger than `tile_size`
+    /// after a metatile render until the next regular render.
+    pub(crate) frame_size: Size,
+    /// Plans speculative tile requests; only set on continuous renderers.
+    pub(crate) prefetcher: Option<Prefetcher>,
 }
 
+/// A boxed future that stays on the thread that created it.
+#[cfg(feature = "tokio")]
+type LocalBoxFuture<'a, T> = Pin<Box<dyn Future<Output = T> + 'a>>;
+
 /// In-flight render request.
 ///
 /// Tick the current thread's run loop via [`RunLoopHandle::tick`] until
 /// [`is_ready`](Self::is_ready), then call [`finish`](Self::finish), or call
-/// [`wait`](Self::wait) to block.
+/// [`wait`](Self::wait) to block. With the `tokio` feature the request can
+/// also be awaited, which resolves to the result of [`finish`](Self::finish).
 #[must_use = "render requests must be finished or waited on to complete the render"]
 pub struct RenderRequest<'a, S> {
-    instance: UniquePtr<ffi::RenderRequest>,
+    pub(crate) instance: UniquePtr<ffi::RenderRequest>,
+    pub(crate) style_load: Option<Duration>,
     _renderer: PhantomData<&'a mut ImageRenderer<S>>,
     // Makes this type !Send and !Sync: the underlying run loop is thread-affine.
     _not_send: PhantomData<*mut ()>,
@@ -112,12 +130,28 @@ impl<S> Debug for RenderRequest<'_, S> {
 }
 
 impl<S> RenderRequest<'_, S> {
+    fn new(instance: UniquePtr<ffi::RenderRequest>, style_load: Option<Duration>) -> Self {
+        Self { instance, style_load, _renderer: PhantomData, _not_send: PhantomData }
+    }
+
     /// Returns whether the render request has completed.
     #[must_use]
     pub fn is_ready(&self) -> bool {
         self.instance.isReady()
     }
 
+    /// Returns the colour of a completed frame in which every pixel is the
+    /// same, such as an open-ocean tile.
+    ///
+    /// The check runs during readback at no extra cost. Use it to answer with
+    /// a cached single-colour response and drop the request without taking the
+    /// image. Returns `None` until the request is ready, if it failed, or if
+    /// the frame has more than one colour.
+    #[must_use]
+    pub fn uniform_color(&self) -> Option<[u8; 4]> {
+        self.instance.isUniform().then(|| self.instance.uniformPixel().to_ne_bytes())
+    }
+
     /// Returns the rendered image.
     ///
     /// # Panics
@@ -127,16 +161,35 @@ impl<S> RenderRequest<'_, S> {
     /// # Errors
     ///
     /// If the underlying render failed or produced invalid image data.
-    pub fn finish(mut self) -> Result<Image, RenderingError> {
+    pub fn finish(self) -> Result<Image, RenderingError> {
+        let image = self.finish_image_ptr()?;
+        Image::from_image_ptr(&image).ok_or(RenderingError::InvalidImageData)
+    }
+
+    /// Returns the rendered image without copying it out of the native buffer.
+    ///
+    /// Prefer this over [`finish`](Self::finish) when the pixels are only read
+    /// (e.g. to encode them), as it avoids copying the frame into a `Vec`.
+    ///
+    /// # Panics
+    ///
+    /// If [`is_ready`](Self::is_ready) returns `false`.
+    ///
+    /// # Errors
+    ///
+    /// If the underlying render failed or produced invalid image data.
+    pub fn finish_image_ptr(mut self) -> Result<ImagePtr, RenderingError> {
         assert!(self.is_ready(), "render request is not ready");
 
         if self.instance.hasError() {
             return Err(RenderingError::Native(self.instance.errorMessage()));
         }
 
-        let data = self.instance.pin_mut().takeImage();
-        let bytes = data.as_bytes();
-        Image::from_raw(bytes).ok_or(RenderingError::InvalidImageData)
+        let image = self.instance.pin_mut().takeImage();
+        if image.is_null() {
+            return Err(RenderingError::InvalidImageData);
+        }
+        Ok(ImagePtr::new(image))
     }
 
     /// Blocks on the current thread until ready, then calls
@@ -146,12 +199,51 @@ impl<S> RenderRequest<'_, S> {
     ///
     /// If the underlying render failed or produced invalid image data.
     pub fn wait(self) -> Result<Image, RenderingError> {
+        self.block_until_ready();
+        self.finish()
+    }
+
+    /// Blocks on the current thread until ready, then calls
+    /// [`finish_image_ptr`](Self::finish_image_ptr).
+    ///
+    /// # Errors
+    ///
+    /// If the underlying render failed or produced invalid image data.
+    pub fn wait_image_ptr(self) -> Result<ImagePtr, RenderingError> {
+        self.block_until_ready();
+        self.finish_image_ptr()
+    }
+
+    /// Waits without blocking the thread until [`is_ready`](Self::is_ready).
+    ///
+    /// See [`RunLoopHandle::tick_when_ready`] for the runtime requirements.
+    #[cfg(feature = "tokio")]
+    pub async fn ready(&self) {
+        let run_loop = RunLoopHandle::current();
+        while !self.is_ready() {
+            run_loop.tick_when_ready().await;
+        }
+    }
+
+    fn block_until_ready(&self) {
         let run_loop = RunLoopHandle::current();
         while !self.is_ready() {
             // Blocks until the loop processes an event, rather than busy-polling.
             run_loop.wait_for_event();
         }
-        self.finish()
+    }
+}
+
+#[cfg(feature = "tokio")]
+impl<'a, S: 'a> IntoFuture for RenderRequest<'a, S> {
+    type Output = Result<Image, RenderingError>;
+    type IntoFuture = LocalBoxFuture<'a, Self::Output>;
+
+    fn into_future(self) -> Self::IntoFuture {
+        Box::pin(async move {
+            self.ready().await;
+            self.finish()
+        })
     }
 }
 
@@ -164,6 +256,8 @@ enum StyleLoadState {
 /// In-flight style load request.
 ///
 /// Keep the request only when you need to wait for completion or observe the load result.
+/// With the `tokio` feature the request can also be awaited, which resolves to
+/// the result of [`finish`](Self::finish).
 pub struct StyleLoadRequest<'a, S> {
     state: Rc<RefCell<StyleLoadState>>,
     _renderer: PhantomData<&'a mut ImageRenderer<S>>,
@@ -223,6 +317,30 @@ impl<S> StyleLoadRequest<'_, S> {
         }
         self.finish()
     }
+
+    /// Waits without blocking the thread until [`is_ready`](Self::is_ready).
+    ///
+    /// See [`RunLoopHandle::tick_when_ready`] for the runtime requirements.
+    #[cfg(feature = "tokio")]
+    pub async fn ready(&self) {
+        let run_loop = RunLoopHandle::current();
+        while !self.is_ready() {
+            run_loop.tick_when_ready().await;
+        }
+    }
+}
+
+#[cfg(feature = "tokio")]
+impl<'a, S: 'a> IntoFuture for StyleLoadRequest<'a, S> {
+    type Output = Result<(), StyleLoadError>;
+    type IntoFuture = LocalBoxFuture<'a, Self::Output>;
+
+    fn into_future(self) -> Self::IntoFuture {
+        Box::pin(async move {
+            self.ready().await;
+            self.finish()
+        })
+    }
 }
 
 /// Error returned when a style fails to load.
@@ -328,6 +446,9 @@ impl<S> ImageRenderer<S> {
 
     fn begin_style_load(&mut self) -> Rc<RefCell<StyleLoadState>> {
         self.style_specified = true;
+        self.style_load_time.set(None);
+        let started = Instant::now();
+        let trace = StyleLoadTrace::begin();
         let state = Rc::new(RefCell::new(StyleLoadState::Pending));
         // MapLibre Native core reports style-load failures through
         // `onDidFailLoadingMap` from `Map::Impl::onStyleError`; treat it as the
@@ -335,7 +456,13 @@ impl<S> ImageRenderer<S> {
         self.map_observer().set_style_load_request_callbacks(
             {
                 let weak = Rc::downgrade(&state);
+                let load_time = Rc::clone(&self.style_load_time);
+                let trace = trace.clone();
                 move || {
+                    trace.end();
+                    if load_time.get().is_none() {
+                        load_time.set(Some(started.elapsed()));
+                    }
                     if let Some(s) = weak.upgrade() {
                         let mut state = s.borrow_mut();
                         if matches!(*state, StyleLoadState::Pending) {
@@ -350,6 +477,7 @@ impl<S> ImageRenderer<S> {
             {
                 let weak = Rc::downgrade(&state);
                 move |error| {
+                    trace.end();
                     if let Some(s) = weak.upgrade() {
                         let mut state = s.borrow_mut();
                         if matches!(*state, StyleLoadState::Pending) {
@@ -371,9 +499,37 @@ impl<S> ImageRenderer<S> {
         self
     }
 
+    /// Clears the renderer so it can be handed a different style.
+    ///
+    /// This is much cheaper than building a new renderer: the native map, its
+    /// GPU context and compiled shaders are kept. The style with its sources,
+    /// layers and images is removed, the camera and debug flags return to
+    /// their defaults, and a style must be loaded again before rendering. The
+    /// output size, file sources and observer callbacks are unchanged; the
+    /// blank style that replaces the old one reports a finished style load.
+    ///
+    /// With `keep_caches`, decoded tiles, glyphs and images stay in the
+    /// renderer, and a next style that uses the same sources and fonts reuses
+    /// them. Without it, they are released right away.
+    pub fn reset(&mut self, keep_caches: bool) {
+        self.observer_callbacks.clear_style_load_request();
+        self.instance.pin_mut().reset(keep_caches);
+        self.style_specified = false;
+        self.style_load_time.set(None);
+    }
+
     /// Set the renderer output size.
     pub fn set_map_size(&mut self, size: Size) {
-        self.instance.pin_mut().setSize(&size);
+        self.tile_size = size;
+        self.set_frame_size(size);
+    }
+
+    /// Resizes the native map only when `size` differs from the current frame.
+    pub(crate) fn set_frame_size(&mut self, size: Size) {
+        if self.frame_size != size {
+            self.instance.pin_mut().setSize(&size);
+            self.frame_size = size;
+        }
     }
 
     /// Get access to the map observer to setup callbacks.
@@ -444,13 +600,77 @@ impl<S> ImageRenderer<S> {
     fn submit_with_camera(
         &mut self,
         camera: &CameraUpdate,
+    ) -> Result<RenderRequest<'_, S>, RenderingError> {
+        self.submit_with_camera_at(camera, self.tile_size)
+    }
+
+    pub(crate) fn submit_with_camera_at(
+        &mut self,
+        camera: &CameraUpdate,
+        frame_size: Size,
     ) -> Result<RenderRequest<'_, S>, RenderingError> {
         if !self.style_specified {
             return Err(RenderingError::StyleNotSpecified);
         }
-        self.instance.pin_mut().jumpTo(&camera.to_camera_options());
-        let request = self.instance.pin_mut().submitRender();
-        Ok(RenderRequest { instance: request, _renderer: PhantomData, _not_send: PhantomData })
+        self.set_frame_size(frame_size);
+        let request = self.instance.pin_mut().submitRender(&camera.to_camera_options());
+        Ok(RenderRequest::new(request, self.style_load_time.get()))
+    }
+
+    /// Opens a queue of renders that run back to back on this renderer.
+    ///
+    /// Each queued render starts as soon as the previous one has been read
+    /// back, without waiting for the caller to collect it, so the GPU stays
+    /// busy while earlier frames are encoded or sent.
+    ///
+    /// # Errors
+    /// If no style has been loaded.
+    pub fn render_queue(&mut self) -> Result<RenderQueue<'_, S>, RenderingError> {
+        if !self.style_specified {
+            return Err(RenderingError::StyleNotSpecified);
+        }
+        // Every queued render shares the frame size, so settle it up front.
+        self.set_frame_size(self.tile_size);
+        Ok(RenderQueue { renderer: self })
+    }
+}
+
+/// A queue of renders that run back to back on one [`ImageRenderer`].
+///
+/// Created by [`ImageRenderer::render_queue`]. Requests complete in the order
+/// they were pushed and keep the renderer borrowed until they are dropped.
+///
+/// ```no_run
+/// # fn foo(renderer: &mut maplibre_native::ImageRenderer<maplibre_native::Tile>) {
+/// let mut queue = renderer.render_queue().unwrap();
+/// let requests: Vec<_> = (0..4).map(|x| queue.push_tile(2, x, 1)).collect();
+/// for request in requests {
+///     let image = request.wait().unwrap();
+/// }
+/// # }
+/// ```
+pub struct RenderQueue<'a, S> {
+    renderer: &'a mut ImageRenderer<S>,
+}
+
+impl<S> Debug for RenderQueue<'_, S> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("RenderQueue").finish_non_exhaustive()
+    }
+}
+
+impl<'a, S> RenderQueue<'a, S> {
+    /// Queues a render using camera options.
+    pub fn push(&mut self, camera: &CameraUpdate) -> RenderRequest<'a, S> {
+        let request = self.renderer.instance.pin_mut().submitRender(&camera.to_camera_options());
+        RenderRequest::new(request, self.renderer.style_load_time.get())
+    }
+}
+
+impl<'a> RenderQueue<'a, Tile> {
+    /// Queues a top-down tile render.
+    pub fn push_tile(&mut self, zoom: u8, x: u32, y: u32) -> RenderRequest<'a, Tile> {
+        self.push(&tile_camera(zoom, x, y))
     }
 }
 
@@ -502,15 +722,20 @@ impl ImageRenderer<Tile> {
         x: u32,
         y: u32,
     ) -> Result<RenderRequest<'_, Tile>, RenderingError> {
-        let center = tile_coords_to_latlng(f64::from(zoom), x, y);
-        self.submit_with_camera(
-            &CameraUpdate::new().center(center).zoom(f64::from(zoom)).bearing(0.0).pitch(0.0),
-        )
+        self.submit_with_camera(&tile_camera(zoom, x, y))
     }
 }
 
-/// Keeps information about an image including a buffer
-/// This is used, so no unneccesary copy of the data must be made
+fn tile_camera(zoom: u8, x: u32, y: u32) -> CameraUpdate {
+    let center = tile_coords_to_latlng(f64::from(zoom), x, y);
+    CameraUpdate::new().center(center).zoom(f64::from(zoom)).bearing(0.0).pitch(0.0)
+}
+
+/// A rendered RGBA image still owned by MapLibre Native.
+///
+/// The pixel buffer is the one produced by the readback, so reading it through
+/// [`buffer`](Self::buffer) does not copy. Use [`to_image`](Self::to_image) to
+/// get an owned [`Image`].
 pub struct ImagePtr {
     instance: UniquePtr<BridgeImage>,
 }
@@ -526,12 +751,40 @@ impl ImagePtr {
         Self { instance: image }
     }
 
+    /// Returns the image dimensions in pixels.
+    #[must_use]
     pub fn size(&self) -> Size {
         self.instance.size()
     }
 
+    /// Returns the unpremultiplied RGBA pixels, row by row without padding.
+    #[must_use]
     pub fn buffer(&self) -> &[u8] {
-        unsafe { std::slice::from_raw_parts(self.instance.get(), self.instance.bufferLength()) }
+        let len = self.instance.bufferLength();
+        if len == 0 {
+            return &[];
+        }
+        // SAFETY: the native image owns `len` bytes for as long as `self` lives.
+        unsafe { std::slice::from_raw_parts(self.instance.get(), len) }
+    }
+
+    /// Copies the pixels into an owned [`Image`].
+    ///
+    /// Returns `None` if the buffer does not match the reported size.
+    #[must_use]
+    pub fn to_image(&self) -> Option<Image> {
+        Image::from_image_ptr(self)
+    }
+
+    /// Returns the unpremultiplied RGBA colour if every pixel is the same.
+    ///
+    /// See [`RenderRequest::uniform_color`].
+    #[must_use]
+    pub fn uniform_color(&self) -> Option<[u8; 4]> {
+        if !self.instance.isUniform() {
+            return None;
+        }
+        self.buffer().first_chunk().copied()
     }
 }
 
@@ -591,6 +844,48 @@ impl ImageRenderer<Continuous> {
     /// it itself (see [`RunLoopHandle`]).
     pub fn render_once(&mut self) {
         self.instance.pin_mut().render_once();
+        self.prefetch();
+    }
+
+    /// Sets which tiles to prefetch ahead of camera motion, or turns
+    /// prefetching off with `None`.
+    ///
+    /// Prefetching starts with the next camera change and is planned in
+    /// [`render_once`](Self::render_once). Changing the policy cancels the
+    /// prefetch requests still in flight.
+    ///
+    /// Prefetching needs a coalescing file source to pay off; see
+    /// [`PrefetchPolicy`].
+    pub fn set_prefetch_policy(&mut self, policy: Option<PrefetchPolicy>) {
+        // Without a policy, parent tiles fall back to MapLibre Native's default.
+        let delta = policy.as_ref().map_or(4, PrefetchPolicy::parent_zoom_delta);
+        self.instance.pin_mut().setPrefetchZoomDelta(delta);
+        self.instance.pin_mut().cancelPrefetches();
+        self.prefetcher = policy.map(Prefetcher::new);
+    }
+
+    /// Requests the tiles that the camera is about to reveal, if it moved.
+    fn prefetch(&mut self) {
+        if !self.observer_callbacks.take_camera_changed() {
+            return;
+        }
+        let Some(prefetcher) = self.prefetcher.as_mut() else {
+            return;
+        };
+        let camera = self.instance.cameraOptions();
+        let plan = prefetcher.observe(Instant::now(), camera.center, camera.zoom, self.frame_size);
+        if plan.cancel {
+            self.instance.pin_mut().cancelPrefetches();
+        }
+        for tile in &plan.tiles {
+            // Tiles at zoom 24 and below always fit.
+            let (Ok(x), Ok(y)) = (i32::try_from(tile.x), i32::try_from(tile.y)) else {
+                continue;
+            };
+            for template in prefetcher.policy().tile_templates() {
+                self.instance.pin_mut().prefetchTile(template, x, y, tile.z);
+            }
+        }
     }
 
     /// Reading rendered image
@@ -613,10 +908,16 @@ impl ImageRenderer<Continuous> {
 
 #[allow(clippy::cast_precision_loss)]
 fn tile_coords_to_latlng(zoom: f64, x: u32, y: u32) -> LatLng {
+    tile_fraction_to_latlng(zoom, f64::from(x) + 0.5, f64::from(y) + 0.5)
+}
+
+/// Converts a position in tile units (`x = 1.5` is the middle of column 1) to
+/// geographic coordinates.
+pub(crate) fn tile_fraction_to_latlng(zoom: f64, x: f64, y: f64) -> LatLng {
     // https://github.com/oldmammuth/slippy_map_tilenames/blob/058678480f4b50b622cda7a48b98647292272346/src/lib.rs#L114
     let zz = 2_f64.powf(zoom);
-    let lng = (f64::from(x) + 0.5) / zz * 360_f64 - 180_f64;
-    let lat = ((PI * (1_f64 - 2_f64 * (f64::from(y) + 0.5) / zz)).sinh()).atan().to_degrees();
+    let lng = x / zz * 360_f64 - 180_f64;
+    let lat = ((PI * (1_f64 - 2_f64 * y / zz)).sinh()).atan().to_degrees();
     LatLng { lat, lng }
 }
 
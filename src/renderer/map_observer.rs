@@ -1,6 +1,6 @@
 //! Map observer wrapper and callback registration helpers.
 
-use std::cell::RefCell;
+use std::cell::{Cell, RefCell};
 use std::fmt::Debug;
 use std::rc::Rc;
 
@@ -13,6 +13,7 @@ use crate::renderer::callbacks::{
 
 type VoidCallbackFn = Rc<dyn Fn() + 'static>;
 type FailLoadingMapCallbackFn = Rc<dyn Fn(MapLoadError) + 'static>;
+type CameraDidChangeCallbackFn = Rc<dyn Fn(map_observer::MapObserverCameraChangeMode) + 'static>;
 
 /// Error kind reported while loading a map or style.
 #[derive(Debug, Clone, Copy, PartialEq, Eq, thiserror::Error)]
@@ -66,11 +67,13 @@ pub(crate) struct MapObserverCallbacks {
     did_fail_loading_map: RefCell<Option<FailLoadingMapCallbackFn>>,
     style_load_request_finished: RefCell<Option<VoidCallbackFn>>,
     style_load_request_failed: RefCell<Option<FailLoadingMapCallbackFn>>,
+    camera_did_change: RefCell<Option<CameraDidChangeCallbackFn>>,
+    camera_changed: Cell<bool>,
 }
 
 impl MapObserverCallbacks {
-    /// Installs the C++ dispatchers that fan the style-load events out to both
-    /// the internal style-load-request slots and the user-facing slots.
+    /// Installs the C++ dispatchers that fan the style-load and camera events
+    /// out to both the internal slots and the user-facing slots.
     ///
     /// Called once, when the renderer is created. Afterwards the `set_*`
     /// methods only swap the stored closures, so user callbacks and
@@ -104,6 +107,27 @@ impl MapObserverCallbacks {
                 }
             }
         })));
+        observer.setCameraDidChangeCallback(Box::new(CameraDidChangeCallback::new({
+            let callbacks = Rc::clone(self);
+            move |mode| {
+                callbacks.camera_changed.set(true);
+                let callback = callbacks.camera_did_change.borrow().clone();
+                if let Some(callback) = callback {
+                    callback(mode);
+                }
+            }
+        })));
+    }
+
+    /// Returns whether the camera moved since the last call, and resets the flag.
+    pub(crate) fn take_camera_changed(&self) -> bool {
+        self.camera_changed.replace(false)
+    }
+
+    /// Detaches the pending [`StyleLoadRequest`](crate::StyleLoadRequest), if any.
+    pub(crate) fn clear_style_load_request(&self) {
+        *self.style_load_request_finished.borrow_mut() = None;
+        *self.style_load_request_failed.borrow_mut() = None;
     }
 }
 
@@ -166,7 +190,7 @@ impl MapObserver {
         &self,
         callback: F,
     ) {
-        self.instance.setCameraDidChangeCallback(Box::new(CameraDidChangeCallback::new(callback)));
+        *self.callbacks.camera_did_change.borrow_mut() = Some(Rc::new(callback));
     }
 
     /// Set a callback to react on finished rendering frames
@@ -0,0 +1,122 @@
+//! Per-renderer memory budgets and usage snapshots.
+
+use crate::bridge::ffi;
+use crate::ImageRenderer;
+
+/// Bounds the memory one renderer holds on to, set with
+/// [`ImageRendererBuilder::with_memory_budget`](crate::ImageRendererBuilder::with_memory_budget).
+///
+/// The budget covers the renderer's GPU textures and buffers, the memory
+/// that releasing tiles can free. Whenever a render ends over the budget, the
+/// renderer releases its cached tiles outside the view, which frees their
+/// decoded data and GPU buffers, and counts an
+/// [eviction](MemoryUsage::evictions). Memory the view itself needs is
+/// kept, so a budget below it is exceeded rather than enforced. Finished
+/// frames not yet taken from their [`RenderRequest`](crate::RenderRequest)
+/// are [reported](MemoryUsage::held_image_bytes) but not counted; they are
+/// freed by finishing or dropping their requests.
+///
+/// # Example
+///
+/// ```no_run
+/// use maplibre_native::{ImageRendererBuilder, MemoryBudget};
+///
+/// let mut renderer = ImageRendererBuilder::new()
+///     .with_memory_budget(MemoryBudget::new(256 << 20))
+///     .build_tile_renderer();
+/// let usage = renderer.memory_usage();
+/// println!("{} bytes in use, {} evictions", usage.total(), usage.evictions);
+/// ```
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct MemoryBudget {
+    max_bytes: u64,
+    tile_cache: bool,
+}
+
+impl MemoryBudget {
+    /// Creates a budget of `max_bytes`, keeping the tile cache.
+    #[must_use]
+    pub fn new(max_bytes: u64) -> Self {
+        Self { max_bytes, tile_cache: true }
+    }
+
+    /// Keeps or drops tiles that leave the view.
+    ///
+    /// MapLibre Native sizes its tile cache from the viewport, so it can be
+    /// turned off but not resized. Without it, every tile is released as soon
+    /// as it leaves the view, which suits renderers that rarely revisit an
+    /// area, such as tile seeders.
+    ///
+    /// Default: `true`
+    #[must_use]
+    pub fn with_tile_cache(mut self, tile_cache: bool) -> Self {
+        self.tile_cache = tile_cache;
+        self
+    }
+}
+
+/// A snapshot of the memory one renderer holds, from
+/// [`ImageRenderer::memory_usage`].
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct MemoryUsage {
+    /// GPU textures, including the render target, glyph and icon atlases,
+    /// and raster tiles, in bytes.
+    pub texture_bytes: u64,
+    /// GPU vertex buffers, in bytes.
+    pub vertex_buffer_bytes: u64,
+    /// GPU index buffers, in bytes.
+    pub index_buffer_bytes: u64,
+    /// GPU uniform buffers, in bytes.
+    pub uniform_buffer_bytes: u64,
+    /// Other GPU buffers, in bytes.
+    pub other_buffer_bytes: u64,
+    /// Finished frames still held by their render requests, in bytes.
+    pub held_image_bytes: u64,
+    /// How often the renderer released cached tiles to stay within its
+    /// [`MemoryBudget`].
+    pub evictions: u64,
+}
+
+impl MemoryUsage {
+    /// The GPU bytes, which are counted against a [`MemoryBudget`].
+    #[must_use]
+    pub fn gpu_bytes(&self) -> u64 {
+        self.texture_bytes
+            + self.vertex_buffer_bytes
+            + self.index_buffer_bytes
+            + self.uniform_buffer_bytes
+            + self.other_buffer_bytes
+    }
+
+    /// All bytes held, including unclaimed frames.
+    #[must_use]
+    pub fn total(&self) -> u64 {
+        self.gpu_bytes() + self.held_image_bytes
+    }
+}
+
+impl From<ffi::FfiMemoryUsage> for MemoryUsage {
+    fn from(usage: ffi::FfiMemoryUsage) -> Self {
+        Self {
+            texture_bytes: usage.texture_bytes,
+            vertex_buffer_bytes: usage.vertex_buffer_bytes,
+            index_buffer_bytes: usage.index_buffer_bytes,
+            uniform_buffer_bytes: usage.uniform_buffer_bytes,
+            other_buffer_bytes: usage.other_buffer_bytes,
+            held_image_bytes: usage.held_image_bytes,
+            evictions: usage.evictions,
+        }
+    }
+}
+
+impl<S> ImageRenderer<S> {
+    /// Returns how much memory the renderer holds, by category.
+    pub fn memory_usage(&mut self) -> MemoryUsage {
+        self.instance.pin_mut().memoryUsage().into()
+    }
+
+    pub(crate) fn set_memory_budget(&mut self, budget: MemoryBudget) {
+        self.instance.pin_mut().setMemoryBudget(budget.max_bytes, budget.tile_cache);
+    }
+}
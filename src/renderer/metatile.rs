@@ -0,0 +1,304 @@
+//! Rendering a block of tiles in one pass.
+//!
+//! A metatile is an `n`×`n` block of neighbouring tiles rendered as a single
+//! frame, as mod_tile does. Layout, symbol placement and collision run once for
+//! the whole block, and labels that cross inner tile edges are not clipped. The
+//! tiles are then read as strided views into the one readback buffer.
+
+use std::fmt::Debug;
+use std::num::NonZeroU32;
+
+use image::ImageBuffer;
+
+use crate::renderer::image_renderer::tile_fraction_to_latlng;
+use crate::{
+    CameraUpdate, Image, ImagePtr, ImageRenderer, RenderRequest, RenderingError, Size, Tile,
+    TileCoord,
+};
+
+impl ImageRenderer<Tile> {
+    /// Renders the `n`×`n` metatile containing tile `x`, `y` and blocks until
+    /// it is ready.
+    ///
+    /// # Errors
+    /// If no style has been loaded or the render fails.
+    pub fn render_metatile(
+        &mut self,
+        zoom: u8,
+        x: u32,
+        y: u32,
+        n: NonZeroU32,
+    ) -> Result<MetaTile, RenderingError> {
+        self.submit_render_metatile(zoom, x, y, n)?.wait()
+    }
+
+    /// Submits a render of the `n`×`n` metatile containing tile `x`, `y`.
+    ///
+    /// Metatiles are aligned to multiples of `n`, so every tile belongs to
+    /// exactly one. At zooms with fewer than `n` tiles per side, the metatile
+    /// covers the whole world.
+    ///
+    /// The frame is resized to `n` times the tile size for this render; the
+    /// next regular tile render restores it.
+    ///
+    /// # Errors
+    /// If no style has been loaded.
+    pub fn submit_render_metatile(
+        &mut self,
+        zoom: u8,
+        x: u32,
+        y: u32,
+        n: NonZeroU32,
+    ) -> Result<MetaTileRequest<'_>, RenderingError> {
+        let (origin, n) = metatile_origin(TileCoord::new(zoom, x, y), n);
+        let center = tile_fraction_to_latlng(
+            f64::from(zoom),
+            f64::from(origin.x) + f64::from(n) / 2.0,
+            f64::from(origin.y) + f64::from(n) / 2.0,
+        );
+        let camera =
+            CameraUpdate::new().center(center).zoom(f64::from(zoom)).bearing(0.0).pitch(0.0);
+        let frame_size = Size {
+            width: self.tile_size.width.saturating_mul(n),
+            height: self.tile_size.height.saturating_mul(n),
+        };
+        let request = self.submit_with_camera_at(&camera, frame_size)?;
+        Ok(MetaTileRequest { request, origin, n })
+    }
+}
+
+/// Top-left tile and side length of the metatile containing `tile`.
+fn metatile_origin(tile: TileCoord, n: NonZeroU32) -> (TileCoord, u32) {
+    let tiles_per_side = 1_u64.checked_shl(u32::from(tile.z)).unwrap_or(u64::MAX);
+    let n = u32::try_from(u64::from(n.get()).min(tiles_per_side)).unwrap_or(u32::MAX);
+    (TileCoord { z: tile.z, x: tile.x / n * n, y: tile.y / n * n }, n)
+}
+
+/// In-flight metatile render.
+///
+/// Created by [`ImageRenderer::submit_render_metatile`].
+#[derive(Debug)]
+#[must_use = "a metatile is only available through the request"]
+pub struct MetaTileRequest<'a> {
+    request: RenderRequest<'a, Tile>,
+    origin: TileCoord,
+    n: u32,
+}
+
+impl MetaTileRequest<'_> {
+    /// Returns whether the render has completed.
+    #[must_use]
+    pub fn is_ready(&self) -> bool {
+        self.request.is_ready()
+    }
+
+    /// Returns the rendered metatile.
+    ///
+    /// # Panics
+    ///
+    /// If [`is_ready`](Self::is_ready) returns `false`.
+    ///
+    /// # Errors
+    ///
+    /// If the underlying render failed or produced invalid image data.
+    pub fn finish(self) -> Result<MetaTile, RenderingError> {
+        MetaTile::new(self.request.finish_image_ptr()?, self.origin, self.n)
+    }
+
+    /// Blocks on the current thread until ready, then calls
+    /// [`finish`](Self::finish).
+    ///
+    /// # Errors
+    ///
+    /// If the underlying render failed or produced invalid image data.
+    pub fn wait(self) -> Result<MetaTile, RenderingError> {
+        MetaTile::new(self.request.wait_image_ptr()?, self.origin, self.n)
+    }
+}
+
+/// An `n`×`n` block of tiles rendered as one frame.
+///
+/// The pixels are kept in the native readback buffer; [`tile`](Self::tile)
+/// and [`tiles`](Self::tiles) borrow views into it without copying.
+pub struct MetaTile {
+    image: ImagePtr,
+    origin: TileCoord,
+    n: u32,
+    tile_size: Size,
+}
+
+impl Debug for MetaTile {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("MetaTile")
+            .field("origin", &self.origin)
+            .field("n", &self.n)
+            .field("tile_size", &self.tile_size)
+            .finish_non_exhaustive()
+    }
+}
+
+impl MetaTile {
+    fn new(image: ImagePtr, origin: TileCoord, n: u32) -> Result<Self, RenderingError> {
+        let size = image.size();
+        if size.width % n != 0 || size.height % n != 0 {
+            return Err(RenderingError::InvalidImageData);
+        }
+        let tile_size = Size { width: size.width / n, height: size.height / n };
+        Ok(Self { image, origin, n, tile_size })
+    }
+
+    /// The top-left tile of the block.
+    #[must_use]
+    pub fn origin(&self) -> TileCoord {
+        self.origin
+    }
+
+    /// Number of tiles along each side of the block.
+    #[must_use]
+    pub fn tiles_per_side(&self) -> u32 {
+        self.n
+    }
+
+    /// Size of one tile in physical pixels.
+    #[must_use]
+    pub fn tile_size(&self) -> Size {
+        self.tile_size
+    }
+
+    /// The whole rendered block.
+    #[must_use]
+    pub fn image(&self) -> &ImagePtr {
+        &self.image
+    }
+
+    /// Releases the whole rendered block.
+    #[must_use]
+    pub fn into_image(self) -> ImagePtr {
+        self.image
+    }
+
+    /// A view of tile `x`, `y`, or `None` if the block does not contain it.
+    ///
+    /// `x` and `y` are tile coordinates at the metatile's zoom, not offsets
+    /// within the block.
+    #[must_use]
+    pub fn tile(&self, x: u32, y: u32) -> Option<TileView<'_>> {
+        let column = x.checked_sub(self.origin.x).filter(|&c| c < self.n)?;
+        let row = y.checked_sub(self.origin.y).filter(|&r| r < self.n)?;
+
+        let stride = self.image.size().width as usize * 4;
+        let row_bytes = self.tile_size.width as usize * 4;
+        let height = self.tile_size.height as usize;
+        let start = row as usize * height * stride + column as usize * row_bytes;
+        // The last row ends at the tile's right edge, not the buffer's.
+        let end = start + height.checked_sub(1)? * stride + row_bytes;
+        Some(TileView {
+            data: &self.image.buffer()[start..end],
+            stride,
+            coord: TileCoord { z: self.origin.z, x, y },
+            size: self.tile_size,
+        })
+    }
+
+    /// Views of every tile in the block, row by row.
+    pub fn tiles(&self) -> impl Iterator<Item = TileView<'_>> + '_ {
+        let TileCoord { x, y, .. } = self.origin;
+        (y..y + self.n)
+            .flat_map(move |row| (x..x + self.n).map(move |column| (column, row)))
+            .filter_map(move |(column, row)| self.tile(column, row))
+    }
+}
+
+/// A borrowed, strided view of one tile inside a [`MetaTile`].
+#[derive(Clone, Copy)]
+pub struct TileView<'a> {
+    data: &'a [u8],
+    stride: usize,
+    coord: TileCoord,
+    size: Size,
+}
+
+impl Debug for TileView<'_> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("TileView")
+            .field("coord", &self.coord)
+            .field("size", &self.size)
+            .finish_non_exhaustive()
+    }
+}
+
+impl<'a> TileView<'a> {
+    /// Coordinates of this tile.
+    #[must_use]
+    pub fn coord(&self) -> TileCoord {
+        self.coord
+    }
+
+    /// Size of the tile in physical pixels.
+    #[must_use]
+    pub fn size(&self) -> Size {
+        self.size
+    }
+
+    /// Distance in bytes between the starts of consecutive rows.
+    #[must_use]
+    pub fn stride(&self) -> usize {
+        self.stride
+    }
+
+    /// The unpremultiplied RGBA rows of the tile, top to bottom.
+    pub fn rows(&self) -> impl Iterator<Item = &'a [u8]> + 'a {
+        let row_bytes = self.size.width as usize * 4;
+        let data = self.data;
+        data.chunks(self.stride).map(move |row| &row[..row_bytes])
+    }
+
+    /// The tile's pixels as one slice, if its rows are contiguous in the
+    /// block, as they are for a 1×1 metatile.
+    #[must_use]
+    pub fn as_contiguous(&self) -> Option<&'a [u8]> {
+        (self.stride == self.size.width as usize * 4).then_some(self.data)
+    }
+
+    /// Copies the tile into a contiguous RGBA buffer, e.g. for
+    /// [`encode_rgba`](crate::encode_rgba).
+    #[must_use]
+    pub fn to_rgba_vec(&self) -> Vec<u8> {
+        let mut pixels =
+            Vec::with_capacity(self.size.width as usize * self.size.height as usize * 4);
+        for row in self.rows() {
+            pixels.extend_from_slice(row);
+        }
+        pixels
+    }
+
+    /// Copies the tile into an owned [`Image`].
+    #[must_use]
+    pub fn to_image(&self) -> Image {
+        let buffer = ImageBuffer::from_vec(self.size.width, self.size.height, self.to_rgba_vec())
+            .expect("tile view rows match its size");
+        Image(buffer)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::num::NonZeroU32;
+
+    use super::metatile_origin;
+    use crate::TileCoord;
+
+    #[test]
+    fn aligns_metatiles_to_multiples_of_n() {
+        let n = NonZeroU32::new(8).unwrap();
+        assert_eq!(metatile_origin(TileCoord::new(10, 17, 31), n), (TileCoord::new(10, 16, 24), 8));
+        assert_eq!(metatile_origin(TileCoord::new(10, 16, 24), n), (TileCoord::new(10, 16, 24), 8));
+    }
+
+    #[test]
+    fn clamps_n_at_low_zooms() {
+        let n = NonZeroU32::new(8).unwrap();
+        assert_eq!(metatile_origin(TileCoord::new(0, 0, 0), n), (TileCoord::new(0, 0, 0), 1));
+        assert_eq!(metatile_origin(TileCoord::new(2, 3, 1), n), (TileCoord::new(2, 0, 0), 4));
+    }
+}
@@ -1,31 +1,61 @@
 mod builder;
 pub mod callbacks;
 mod camera;
+mod encode;
 pub mod file_source;
 mod image_renderer;
 mod map_observer;
+mod memory;
+mod metatile;
+mod prefetch;
+mod render_pool;
+mod render_stats;
 mod resource_options;
 mod run_loop;
+mod seed;
+mod shader_cache;
+mod style_template;
+#[cfg(feature = "wgpu")]
+mod texture_ring;
 pub mod tile_server_options;
 
 pub use builder::ImageRendererBuilder;
 pub use camera::CameraUpdate;
+pub use encode::{
+    encode_rgba, EncodeError, EncodeFormat, EncodeHandle, EncoderPool, PngCompression,
+};
 pub use file_source::{
-    register_file_source, CancelHook, FileSource, FileSourceType, ForwardCompletion,
-    LoadingMethods, Priority, RequestHandle, ResourceKind, ResourceRequest, Responder,
-    StoragePolicy, TileRequest, Usage,
+    register_file_source, CacheStats, CachingFileSource, CancelHook, CoalescingFileSource,
+    FileSource, FileSourceType, ForwardCompletion, LoadingMethods, Priority, RequestHandle,
+    ResourceCache, ResourceKind, ResourceRequest, Responder, StoragePolicy, TileRequest, Usage,
 };
 #[cfg(feature = "tokio")]
 pub use file_source::{
-    register_tokio_file_source, register_tokio_file_source_with_handle, TokioFileSource,
+    register_tokio_file_source, register_tokio_file_source_with_handle,
+    register_tokio_file_source_with_scheduler, RequestLane, RequestScheduler, TokioFileSource,
 };
+#[cfg(feature = "pmtiles")]
+pub use file_source::{PmTilesArchive, PmTilesError, PmTilesFileSource};
 pub use image_renderer::{
-    Continuous, Image, ImageRenderer, RenderRequest, RenderingError, Static, StyleLoadError,
-    StyleLoadRequest, Tile,
+    Continuous, Image, ImagePtr, ImageRenderer, RenderQueue, RenderRequest, RenderingError, Static,
+    StyleLoadError, StyleLoadRequest, Tile,
 };
 pub use map_observer::{MapLoadError, MapLoadErrorKind, MapObserver};
+pub use memory::{MemoryBudget, MemoryUsage};
+pub use metatile::{MetaTile, MetaTileRequest, TileView};
+pub use prefetch::PrefetchPolicy;
+pub use render_pool::{JobHandle, RenderPool, RenderPoolBuilder, RenderPoolError, TileCoord};
+pub use render_stats::RenderStats;
 pub use resource_options::ResourceOptions;
 pub use run_loop::RunLoopHandle;
+pub use seed::{
+    DirectorySink, SeedError, SeedPlan, SeedReport, SeedUnit, Seeder, TileOrder, TileRange,
+    TileSink, MAX_SEED_ZOOM,
+};
+pub use shader_cache::shader_cache_env;
+pub use style_template::StyleTemplate;
+#[cfg(feature = "wgpu")]
+pub use texture_ring::{RingFrame, TextureRing, TextureRingError};
 
 pub use crate::bridge::ffi::{EdgeInsets, LatLng, LatLngBounds, MapDebugOptions, MapMode};
 pub use crate::bridge::map_observer::MapObserverCameraChangeMode;
@@ -0,0 +1,420 @@
+//! Speculative tile prefetching driven by camera motion.
+
+use std::collections::HashSet;
+use std::f64::consts::PI;
+use std::time::{Duration, Instant};
+
+use crate::{LatLng, Size};
+
+/// World size in logical pixels at zoom 0, whatever the tile size.
+const WORLD_SIZE: f64 = 512.0;
+/// The deepest tile zoom level that is ever requested.
+const MAX_TILE_ZOOM: u8 = 24;
+/// Samples further apart than this belong to separate gestures.
+const MAX_SAMPLE_GAP: Duration = Duration::from_millis(250);
+/// Weight of the newest sample in the smoothed velocity.
+const SMOOTHING: f64 = 0.5;
+/// Slower panning, in logical pixels per second, counts as standing still.
+const MIN_PAN_SPEED: f64 = 20.0;
+/// Slower zooming, in zoom levels per second, counts as standing still.
+const MIN_ZOOM_SPEED: f64 = 0.05;
+
+/// Which tiles a [`Continuous`](crate::Continuous) renderer warms ahead of
+/// camera motion.
+///
+/// While the camera moves, its velocity is tracked from camera changes and
+/// extrapolated by [`lookahead`](Self::with_lookahead). Tiles of the
+/// predicted viewport that are not visible yet are requested at low
+/// priority from every [tile template](Self::with_tile_template), through
+/// the same file sources and caches as regular tile requests. When the
+/// motion changes direction, the requests still in flight are cancelled.
+///
+/// A prefetch only saves a download if the file source lets the regular
+/// request for the same tile reuse it. Register the network source wrapped
+/// in a [`CoalescingFileSource`](crate::CoalescingFileSource), so that a
+/// regular request joins a prefetch still in flight, and in a
+/// [`CachingFileSource`](crate::CachingFileSource) to serve tiles whose
+/// prefetch has finished. Without them, the prefetch and the regular
+/// request each download the tile.
+///
+/// The prediction treats the viewport as unrotated and top-down, so bearing
+/// and pitch are ignored.
+///
+/// # Example
+///
+/// ```no_run
+/// use std::num::NonZeroU32;
+/// use std::time::Duration;
+///
+/// use maplibre_native::{ImageRendererBuilder, PrefetchPolicy};
+///
+/// let mut renderer = ImageRendererBuilder::new()
+///     .with_size(NonZeroU32::new(1024).unwrap(), NonZeroU32::new(768).unwrap())
+///     .build_continuous_renderer();
+/// renderer.set_prefetch_policy(Some(
+///     PrefetchPolicy::new()
+///         .with_tile_template("https://tiles.example.com/planet/{z}/{x}/{y}.mvt")
+///         .with_lookahead(Duration::from_millis(400)),
+/// ));
+/// ```
+#[derive(Debug, Clone, PartialEq)]
+pub struct PrefetchPolicy {
+    tile_templates: Vec<String>,
+    tile_size: u16,
+    max_zoom: u8,
+    parent_zoom_delta: u8,
+    child_zoom_delta: u8,
+    lookahead: Duration,
+    max_tiles: usize,
+}
+
+impl Default for PrefetchPolicy {
+    fn default() -> Self {
+        Self {
+            tile_templates: Vec::new(),
+            tile_size: 512,
+            max_zoom: 14,
+            parent_zoom_delta: 4,
+            child_zoom_delta: 1,
+            lookahead: Duration::from_millis(500),
+            max_tiles: 32,
+        }
+    }
+}
+
+impl PrefetchPolicy {
+    /// Creates a policy with the default settings and no tile templates.
+    #[must_use]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Adds an XYZ tile URL template, as in a source's `tiles` array, to
+    /// prefetch from.
+    ///
+    /// Use the same template as the style so that prefetched tiles match the
+    /// requests MapLibre Native makes later.
+    #[must_use]
+    pub fn with_tile_template(mut self, url_template: impl Into<String>) -> Self {
+        self.tile_templates.push(url_template.into());
+        self
+    }
+
+    /// Sets the tile size of the templates in logical pixels (default 512).
+    #[must_use]
+    pub fn with_tile_size(mut self, tile_size: u16) -> Self {
+        self.tile_size = tile_size.max(1);
+        self
+    }
+
+    /// Sets the deepest zoom level the templates serve (default 14).
+    #[must_use]
+    pub fn with_max_zoom(mut self, max_zoom: u8) -> Self {
+        self.max_zoom = max_zoom.min(MAX_TILE_ZOOM);
+        self
+    }
+
+    /// Sets how many zoom levels above the visible tiles MapLibre Native
+    /// loads parent tiles, which stand in while the visible tiles load
+    /// (default 4, MapLibre Native's own default; 0 disables them).
+    #[must_use]
+    pub fn with_parent_zoom_delta(mut self, delta: u8) -> Self {
+        self.parent_zoom_delta = delta;
+        self
+    }
+
+    /// Sets how many zoom levels below the visible tiles are prefetched
+    /// while zooming in (default 1; 0 only prefetches while panning).
+    #[must_use]
+    pub fn with_child_zoom_delta(mut self, delta: u8) -> Self {
+        self.child_zoom_delta = delta;
+        self
+    }
+
+    /// Sets how far ahead camera motion is extrapolated (default 500 ms).
+    #[must_use]
+    pub fn with_lookahead(mut self, lookahead: Duration) -> Self {
+        self.lookahead = lookahead;
+        self
+    }
+
+    /// Caps the tiles requested per camera change, nearest to the predicted
+    /// center first (default 32).
+    #[must_use]
+    pub fn with_max_tiles(mut self, max_tiles: usize) -> Self {
+        self.max_tiles = max_tiles;
+        self
+    }
+
+    pub(crate) fn tile_templates(&self) -> &[String] {
+        &self.tile_templates
+    }
+
+    pub(crate) fn parent_zoom_delta(&self) -> u8 {
+        self.parent_zoom_delta
+    }
+}
+
+/// An XYZ tile address.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub(crate) struct TileId {
+    pub(crate) z: u8,
+    pub(crate) x: u32,
+    pub(crate) y: u32,
+}
+
+/// What to do after a camera change.
+#[derive(Debug, Default)]
+pub(crate) struct Plan {
+    /// Whether the motion changed direction, so requests in flight are stale.
+    pub(crate) cancel: bool,
+    /// Tiles to request, nearest to the predicted center first.
+    pub(crate) tiles: Vec<TileId>,
+}
+
+/// A camera position in normalized Web Mercator coordinates, where the world
+/// spans `0..1` on both axes.
+#[derive(Debug, Clone, Copy)]
+struct Sample {
+    at: Instant,
+    x: f64,
+    y: f64,
+    zoom: f64,
+}
+
+impl Sample {
+    fn new(at: Instant, center: LatLng, zoom: f64) -> Self {
+        let lat = center.lat.clamp(-85.051_128_78, 85.051_128_78).to_radians();
+        let x = (center.lng + 180.0) / 360.0;
+        let y = (1.0 - (lat.tan() + 1.0 / lat.cos()).ln() / PI) / 2.0;
+        Self { at, x: x.rem_euclid(1.0), y, zoom }
+    }
+
+    /// The world size in logical pixels at this zoom.
+    fn scale(&self) -> f64 {
+        WORLD_SIZE * self.zoom.exp2()
+    }
+}
+
+/// Camera velocity in normalized units and zoom levels per second.
+#[derive(Debug, Clone, Copy)]
+struct Velocity {
+    x: f64,
+    y: f64,
+    zoom: f64,
+}
+
+impl Velocity {
+    fn blend(self, newest: Self) -> Self {
+        let mix = |old: f64, new: f64| old + (new - old) * SMOOTHING;
+        Self {
+            x: mix(self.x, newest.x),
+            y: mix(self.y, newest.y),
+            zoom: mix(self.zoom, newest.zoom),
+        }
+    }
+
+    fn pans(&self, scale: f64) -> bool {
+        self.x.hypot(self.y) * scale >= MIN_PAN_SPEED
+    }
+
+    fn zooms(&self) -> bool {
+        self.zoom.abs() >= MIN_ZOOM_SPEED
+    }
+
+    /// Whether `newest` heads away from `self` on the pan or the zoom axis.
+    fn reversed_by(&self, newest: &Self, scale: f64) -> bool {
+        let pan =
+            self.pans(scale) && newest.pans(scale) && self.x * newest.x + self.y * newest.y < 0.0;
+        let zoom = self.zooms() && newest.zooms() && self.zoom * newest.zoom < 0.0;
+        pan || zoom
+    }
+}
+
+/// Tracks camera motion and plans the tiles to prefetch.
+#[derive(Debug)]
+pub(crate) struct Prefetcher {
+    policy: PrefetchPolicy,
+    last: Option<Sample>,
+    velocity: Option<Velocity>,
+}
+
+impl Prefetcher {
+    pub(crate) fn new(policy: PrefetchPolicy) -> Self {
+        Self { policy, last: None, velocity: None }
+    }
+
+    pub(crate) fn policy(&self) -> &PrefetchPolicy {
+        &self.policy
+    }
+
+    /// Records the camera after a change and returns what to prefetch.
+    pub(crate) fn observe(
+        &mut self,
+        at: Instant,
+        center: LatLng,
+        zoom: f64,
+        viewport: Size,
+    ) -> Plan {
+        let sample = Sample::new(at, center, zoom);
+        let Some(last) = self.last.replace(sample) else {
+            return Plan::default();
+        };
+        let elapsed = sample.at.saturating_duration_since(last.at);
+        if elapsed > MAX_SAMPLE_GAP {
+            self.velocity = None;
+            return Plan::default();
+        }
+        let seconds = elapsed.as_secs_f64();
+        if seconds <= 0.0 {
+            return Plan::default();
+        }
+        // Take the short way around the antimeridian.
+        let dx = (sample.x - last.x + 0.5).rem_euclid(1.0) - 0.5;
+        let newest = Velocity {
+            x: dx / seconds,
+            y: (sample.y - last.y) / seconds,
+            zoom: (sample.zoom - last.zoom) / seconds,
+        };
+        let cancel = self.velocity.is_some_and(|v| v.reversed_by(&newest, sample.scale()));
+        let velocity = match self.velocity {
+            Some(velocity) if !cancel => velocity.blend(newest),
+            _ => newest,
+        };
+        self.velocity = Some(velocity);
+        Plan { cancel, tiles: self.tiles_ahead(&sample, velocity, viewport) }
+    }
+
+    /// Tiles of the predicted viewport that the current one does not show.
+    fn tiles_ahead(&self, sample: &Sample, velocity: Velocity, viewport: Size) -> Vec<TileId> {
+        if self.policy.max_tiles == 0 || !(velocity.pans(sample.scale()) || velocity.zooms()) {
+            return Vec::new();
+        }
+        let ahead = self.policy.lookahead.as_secs_f64();
+        let predicted = Sample {
+            at: sample.at,
+            x: (sample.x + velocity.x * ahead).rem_euclid(1.0),
+            y: (sample.y + velocity.y * ahead).clamp(0.0, 1.0),
+            zoom: (sample.zoom + velocity.zoom * ahead).clamp(0.0, f64::from(MAX_TILE_ZOOM)),
+        };
+
+        let current_z = self.tile_zoom(sample.zoom);
+        let predicted_z = self.tile_zoom(predicted.zoom);
+        let deepest = predicted_z.min(current_z.saturating_add(self.policy.child_zoom_delta));
+        let levels =
+            if predicted_z > current_z { current_z..=deepest } else { predicted_z..=predicted_z };
+
+        let visible: HashSet<TileId> = covering(sample, current_z, viewport).collect();
+        let mut tiles: Vec<TileId> = levels
+            .flat_map(|z| covering(&predicted, z, viewport))
+            .filter(|tile| !visible.contains(tile))
+            .collect();
+        tiles.sort_by(|a, b| distance(&predicted, a).total_cmp(&distance(&predicted, b)));
+        tiles.truncate(self.policy.max_tiles);
+        tiles
+    }
+
+    /// The tile zoom level that covers the camera zoom `zoom`.
+    #[allow(
+        clippy::cast_possible_truncation,
+        clippy::cast_sign_loss,
+        reason = "clamped to 0..=max_zoom before the cast"
+    )]
+    fn tile_zoom(&self, zoom: f64) -> u8 {
+        let z = zoom + (WORLD_SIZE / f64::from(self.policy.tile_size)).log2();
+        z.floor().clamp(0.0, f64::from(self.policy.max_zoom)) as u8
+    }
+}
+
+/// The tiles at zoom `z` that the viewport around `sample` shows.
+#[allow(
+    clippy::cast_possible_truncation,
+    clippy::cast_sign_loss,
+    reason = "rows and columns are clamped or wrapped into 0..2^z"
+)]
+fn covering(sample: &Sample, z: u8, viewport: Size) -> impl Iterator<Item = TileId> {
+    let tiles = f64::from(1_u32 << z);
+    let half_width = f64::from(viewport.width) / 2.0 / sample.scale();
+    let half_height = f64::from(viewport.height) / 2.0 / sample.scale();
+    let columns = ((sample.x - half_width) * tiles).floor() as i64
+        ..=((sample.x + half_width) * tiles).floor() as i64;
+    let top = ((sample.y - half_height) * tiles).floor().clamp(0.0, tiles - 1.0) as u32;
+    let bottom = ((sample.y + half_height) * tiles).floor().clamp(0.0, tiles - 1.0) as u32;
+    // A viewport wider than the world would repeat columns.
+    let columns = columns.take(1 << z);
+    columns.flat_map(move |column| {
+        let x = column.rem_euclid(1 << z) as u32;
+        (top..=bottom).map(move |y| TileId { z, x, y })
+    })
+}
+
+/// Squared distance from the center of `tile` to the camera center.
+fn distance(sample: &Sample, tile: &TileId) -> f64 {
+    let tiles = f64::from(1_u32 << tile.z);
+    let dx = ((f64::from(tile.x) + 0.5) / tiles - sample.x + 0.5).rem_euclid(1.0) - 0.5;
+    let dy = (f64::from(tile.y) + 0.5) / tiles - sample.y;
+    dx * dx + dy * dy
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::{Duration, Instant};
+
+    use super::{PrefetchPolicy, Prefetcher, TileId};
+    use crate::{LatLng, Size};
+
+    const VIEWPORT: Size = Size { width: 512, height: 512 };
+
+    /// Feeds camera positions 16 ms apart and returns the last plan.
+    fn observe(prefetcher: &mut Prefetcher, cameras: &[(f64, f64)]) -> super::Plan {
+        let start = Instant::now();
+        let mut plan = super::Plan::default();
+        for (i, &(lng, zoom)) in cameras.iter().enumerate() {
+            let at = start + Duration::from_millis(16) * u32::try_from(i).unwrap();
+            plan = prefetcher.observe(at, LatLng { lat: 0.0, lng }, zoom, VIEWPORT);
+        }
+        plan
+    }
+
+    #[test]
+    fn panning_prefetches_tiles_ahead() {
+        let mut prefetcher = Prefetcher::new(PrefetchPolicy::new());
+        let plan = observe(&mut prefetcher, &[(0.0, 4.0), (1.0, 4.0), (2.0, 4.0)]);
+        assert!(!plan.cancel);
+        assert!(!plan.tiles.is_empty());
+        // Zoom 4 has 16 columns; the viewport spans columns 7 and 8 and the
+        // camera heads east.
+        assert!(plan.tiles.iter().all(|tile| tile.z == 4 && tile.x >= 9), "{:?}", plan.tiles);
+    }
+
+    #[test]
+    fn standing_still_prefetches_nothing() {
+        let mut prefetcher = Prefetcher::new(PrefetchPolicy::new());
+        let plan = observe(&mut prefetcher, &[(0.0, 4.0), (0.0, 4.0)]);
+        assert!(plan.tiles.is_empty());
+    }
+
+    #[test]
+    fn reversing_cancels() {
+        let mut prefetcher = Prefetcher::new(PrefetchPolicy::new());
+        let plan = observe(&mut prefetcher, &[(0.0, 4.0), (1.0, 4.0), (0.0, 4.0)]);
+        assert!(plan.cancel);
+        assert!(plan.tiles.iter().all(|tile| tile.x <= 6), "{:?}", plan.tiles);
+    }
+
+    #[test]
+    fn zooming_in_prefetches_children() {
+        let policy = PrefetchPolicy::new().with_child_zoom_delta(2).with_max_tiles(usize::MAX);
+        let mut prefetcher = Prefetcher::new(policy);
+        let plan = observe(&mut prefetcher, &[(0.0, 4.0), (0.0, 4.1), (0.0, 4.2)]);
+        let levels: Vec<u8> = plan.tiles.iter().map(|tile| tile.z).collect();
+        assert!(levels.contains(&5) && levels.contains(&6), "{levels:?}");
+    }
+
+    #[test]
+    fn caps_and_orders_tiles() {
+        let mut prefetcher = Prefetcher::new(PrefetchPolicy::new().with_max_tiles(1));
+        let plan = observe(&mut prefetcher, &[(0.0, 4.0), (1.0, 4.0), (2.0, 4.0)]);
+        assert_eq!(plan.tiles, [TileId { z: 4, x: 9, y: 7 }]);
+    }
+}
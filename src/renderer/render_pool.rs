@@ -0,0 +1,531 @@
+//! A multi-threaded pool of tile renderers.
+//!
+//! Each worker owns one [`ImageRenderer<Tile>`] on its own OS thread, driven by
+//! that thread's MapLibre Native run loop. Jobs are routed so that neighbouring
+//! tiles land on the same worker and reuse its tile cache, and idle workers
+//! steal queued jobs from busy ones so a slow tile does not hold up the rest.
+
+use std::collections::VecDeque;
+use std::fmt::Debug;
+use std::hash::{DefaultHasher, Hash, Hasher};
+use std::num::{NonZeroU32, NonZeroUsize};
+use std::panic::{self, AssertUnwindSafe};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{mpsc, Arc, Condvar, Mutex, MutexGuard, PoisonError};
+use std::thread;
+
+use crate::{ImagePtr, ImageRenderer, MetaTile, RenderRequest, RenderingError, Tile};
+
+/// Coordinates of a tile in the XYZ scheme.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct TileCoord {
+    /// Zoom level.
+    pub z: u8,
+    /// Column, counted from the west.
+    pub x: u32,
+    /// Row, counted from the north.
+    pub y: u32,
+}
+
+impl TileCoord {
+    /// Creates tile coordinates.
+    #[must_use]
+    pub fn new(z: u8, x: u32, y: u32) -> Self {
+        Self { z, x, y }
+    }
+
+    /// The tile `levels` zoom levels up that contains this one.
+    ///
+    /// Stops at zoom 0.
+    #[must_use]
+    pub fn ancestor(self, levels: u8) -> Self {
+        let levels = levels.min(self.z);
+        Self { z: self.z - levels, x: self.x >> levels, y: self.y >> levels }
+    }
+}
+
+/// Errors returned by a [`RenderPool`].
+#[derive(thiserror::Error, Debug)]
+#[non_exhaustive]
+pub enum RenderPoolError {
+    /// The pool already holds its maximum number of queued jobs.
+    #[error("render pool queue is full")]
+    QueueFull,
+    /// The job was cancelled before a worker started it.
+    #[error("render job was cancelled")]
+    Cancelled,
+    /// The pool shut down before the job ran.
+    #[error("render pool has shut down")]
+    Closed,
+    /// The worker panicked while rendering the job, or no worker is left
+    /// because every renderer factory panicked.
+    #[error("render worker panicked")]
+    WorkerPanicked,
+    /// The worker failed to render the tile.
+    #[error(transparent)]
+    Rendering(#[from] RenderingError),
+}
+
+type Callback<T> = Box<dyn FnOnce(Result<T, RenderPoolError>) + Send>;
+
+enum Work {
+    Tile(Callback<ImagePtr>),
+    MetaTile(NonZeroU32, Callback<MetaTile>),
+}
+
+impl Work {
+    fn fail(self, error: RenderPoolError) {
+        match self {
+            Self::Tile(on_done) => on_done(Err(error)),
+            Self::MetaTile(_, on_done) => on_done(Err(error)),
+        }
+    }
+}
+
+struct Job {
+    tile: TileCoord,
+    cancelled: Arc<AtomicBool>,
+    work: Work,
+}
+
+struct PoolState {
+    queues: Vec<VecDeque<Job>>,
+    /// Workers waiting for a job that no submit has woken yet.
+    idle: Vec<bool>,
+    /// Workers whose renderer factory panicked; they take no jobs.
+    retired: Vec<bool>,
+    queued: usize,
+    shutdown: bool,
+}
+
+impl PoolState {
+    fn live_workers(&self) -> impl Iterator<Item = usize> + '_ {
+        self.retired.iter().enumerate().filter(|&(_, retired)| !retired).map(|(index, _)| index)
+    }
+
+    /// Claims an idle worker for one new job, preferring `target`, so that
+    /// every job wakes a different worker.
+    fn claim_idle(&mut self, target: usize) -> Option<usize> {
+        let worker =
+            if self.idle[target] { target } else { self.idle.iter().position(|&idle| idle)? };
+        self.idle[worker] = false;
+        Some(worker)
+    }
+}
+
+struct Shared {
+    state: Mutex<PoolState>,
+    // One per worker, so a job routed to an idle worker wakes that worker.
+    wakeups: Vec<Condvar>,
+    capacity: usize,
+    locality_levels: u8,
+}
+
+impl Shared {
+    fn lock(&self) -> MutexGuard<'_, PoolState> {
+        self.state.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    fn next_job(&self, worker: usize) -> Option<Job> {
+        let mut state = self.lock();
+        loop {
+            if state.shutdown {
+                return None;
+            }
+            let job = state.queues[worker].pop_front().or_else(|| steal(&mut state.queues));
+            if let Some(job) = job {
+                state.queued -= 1;
+                return Some(job);
+            }
+            state.idle[worker] = true;
+            state = self.wakeups[worker].wait(state).unwrap_or_else(PoisonError::into_inner);
+            state.idle[worker] = false;
+        }
+    }
+
+    /// Takes a worker whose factory panicked out of the pool. Its queued jobs
+    /// move to the other workers, or fail if none is left.
+    fn retire(&self, worker: usize) {
+        let mut state = self.lock();
+        state.retired[worker] = true;
+        let jobs: Vec<Job> = state.queues[worker].drain(..).collect();
+        if state.live_workers().next().is_none() {
+            let mut failed = jobs;
+            failed.extend(state.queues.iter_mut().flat_map(|queue| queue.drain(..)));
+            state.queued = 0;
+            drop(state);
+            for job in failed {
+                deliver(|| job.work.fail(RenderPoolError::WorkerPanicked));
+            }
+            return;
+        }
+        for job in jobs {
+            let shortest = state
+                .live_workers()
+                .min_by_key(|&index| state.queues[index].len())
+                .expect("a live worker is left");
+            state.queues[shortest].push_back(job);
+            if let Some(idle) = state.claim_idle(shortest) {
+                self.wakeups[idle].notify_one();
+            }
+        }
+    }
+}
+
+/// Takes the newest job from the longest queue, leaving its owner the jobs
+/// that are most likely to hit a warm cache.
+fn steal<T>(queues: &mut [VecDeque<T>]) -> Option<T> {
+    queues.iter_mut().max_by_key(|queue| queue.len())?.pop_back()
+}
+
+/// Configures and starts a [`RenderPool`].
+#[derive(Debug, Clone)]
+pub struct RenderPoolBuilder {
+    workers: NonZeroUsize,
+    queue_capacity: usize,
+    locality_levels: u8,
+}
+
+impl Default for RenderPoolBuilder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl RenderPoolBuilder {
+    /// Creates a builder with one worker per available CPU.
+    #[must_use]
+    pub fn new() -> Self {
+        let workers = thread::available_parallelism().unwrap_or(NonZeroUsize::MIN);
+        Self { workers, queue_capacity: workers.get() * 128, locality_levels: 2 }
+    }
+
+    /// Sets the number of worker threads.
+    #[must_use]
+    pub fn with_workers(mut self, workers: NonZeroUsize) -> Self {
+        self.workers = workers;
+        self
+    }
+
+    /// Sets how many jobs may wait across all workers before
+    /// [`RenderPool::submit_tile`] returns [`RenderPoolError::QueueFull`].
+    #[must_use]
+    pub fn with_queue_capacity(mut self, capacity: usize) -> Self {
+        self.queue_capacity = capacity;
+        self
+    }
+
+    /// Sets how many zoom levels up tiles are grouped for routing.
+    ///
+    /// With the default of 2, the 16 tiles sharing an ancestor two levels up
+    /// prefer the same worker. Use 0 to rely on load balancing alone.
+    #[must_use]
+    pub fn with_locality_levels(mut self, levels: u8) -> Self {
+        self.locality_levels = levels;
+        self
+    }
+
+    /// Starts the workers.
+    ///
+    /// `factory` runs once on each worker thread with the worker's index and
+    /// returns that worker's renderer. Load the style there, and wait for it if
+    /// the first tiles should not race the style load. With the `wgpu` backend,
+    /// it can also bind a shared device through
+    /// [`ImageRenderer::set_device_queue`]. If `factory` panics, that worker
+    /// leaves the pool and the others take its jobs; once no worker is left,
+    /// jobs fail with [`RenderPoolError::WorkerPanicked`].
+    ///
+    /// # Panics
+    ///
+    /// If a thread cannot be spawned.
+    pub fn build<F>(self, factory: F) -> RenderPool
+    where
+        F: Fn(usize) -> ImageRenderer<Tile> + Send + Sync + 'static,
+    {
+        let count = self.workers.get();
+        let shared = Arc::new(Shared {
+            state: Mutex::new(PoolState {
+                queues: (0..count).map(|_| VecDeque::new()).collect(),
+                idle: vec![false; count],
+                retired: vec![false; count],
+                queued: 0,
+                shutdown: false,
+            }),
+            wakeups: (0..count).map(|_| Condvar::new()).collect(),
+            capacity: self.queue_capacity,
+            locality_levels: self.locality_levels,
+        });
+        let factory = Arc::new(factory);
+        let workers = (0..count)
+            .map(|index| {
+                let shared = Arc::clone(&shared);
+                let factory = Arc::clone(&factory);
+                thread::Builder::new()
+                    .name(format!("mln-render-{index}"))
+                    .spawn(move || run_worker(index, &shared, &*factory))
+                    .expect("failed to spawn render thread")
+            })
+            .collect();
+        RenderPool { shared, workers }
+    }
+}
+
+fn run_worker<F>(index: usize, shared: &Shared, factory: &F)
+where
+    F: Fn(usize) -> ImageRenderer<Tile>,
+{
+    let Ok(mut renderer) = panic::catch_unwind(AssertUnwindSafe(|| factory(index))) else {
+        shared.retire(index);
+        return;
+    };
+    while let Some(job) = shared.next_job(index) {
+        if job.cancelled.load(Ordering::Acquire) {
+            deliver(|| job.work.fail(RenderPoolError::Cancelled));
+            continue;
+        }
+        let TileCoord { z, x, y } = job.tile;
+        match job.work {
+            Work::Tile(on_done) => {
+                let result = render(|| {
+                    renderer.submit_render_tile(z, x, y).and_then(RenderRequest::wait_image_ptr)
+                });
+                deliver(|| on_done(result));
+            }
+            Work::MetaTile(n, on_done) => {
+                let result = render(|| renderer.render_metatile(z, x, y, n));
+                deliver(|| on_done(result));
+            }
+        }
+    }
+}
+
+/// Runs one render, turning a panic into [`RenderPoolError::WorkerPanicked`]
+/// so the job still completes and the worker keeps serving the others.
+fn render<T>(render: impl FnOnce() -> Result<T, RenderingError>) -> Result<T, RenderPoolError> {
+    panic::catch_unwind(AssertUnwindSafe(render))
+        .map_or(Err(RenderPoolError::WorkerPanicked), |result| result.map_err(From::from))
+}
+
+/// Calls a job's callback; a panicking callback must not take the worker
+/// down with the jobs queued behind it.
+fn deliver(callback: impl FnOnce()) {
+    let _ = panic::catch_unwind(AssertUnwindSafe(callback));
+}
+
+/// A pool of worker threads, each rendering tiles with its own renderer.
+///
+/// The pool is `Send + Sync`; share it between request handlers with an `Arc`.
+/// Dropping it fails the queued jobs with [`RenderPoolError::Closed`], lets the
+/// running ones finish, then joins the threads.
+///
+/// ```no_run
+/// # fn foo() {
+/// use maplibre_native::{ImageRendererBuilder, RenderPoolBuilder, TileCoord};
+///
+/// let style: url::Url = "https://demotiles.maplibre.org/style.json".parse().unwrap();
+/// let pool = RenderPoolBuilder::new().build(move |_| {
+///     let mut renderer = ImageRendererBuilder::new().build_tile_renderer();
+///     renderer.load_style_from_url(&style);
+///     renderer
+/// });
+/// let tile = pool.render_tile(TileCoord::new(0, 0, 0)).unwrap();
+/// # }
+/// ```
+pub struct RenderPool {
+    shared: Arc<Shared>,
+    workers: Vec<thread::JoinHandle<()>>,
+}
+
+impl Debug for RenderPool {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("RenderPool")
+            .field("workers", &self.workers.len())
+            .field("queued", &self.queued())
+            .finish()
+    }
+}
+
+impl RenderPool {
+    /// The number of jobs waiting for a worker.
+    #[must_use]
+    pub fn queued(&self) -> usize {
+        self.shared.lock().queued
+    }
+
+    /// Queues `tile` and calls `on_done` on a worker thread with the result.
+    ///
+    /// Use this to hand the image to another runtime, e.g. through a
+    /// `tokio::sync::oneshot` channel.
+    ///
+    /// # Errors
+    ///
+    /// [`RenderPoolError::QueueFull`] if the queue is at capacity; `on_done` is
+    /// not called in that case.
+    pub fn submit_tile<F>(&self, tile: TileCoord, on_done: F) -> Result<JobHandle, RenderPoolError>
+    where
+        F: FnOnce(Result<ImagePtr, RenderPoolError>) + Send + 'static,
+    {
+        self.submit(tile, Work::Tile(Box::new(on_done)))
+    }
+
+    /// Queues the `n`×`n` metatile containing `tile` and calls `on_done` on a
+    /// worker thread with the result.
+    ///
+    /// See [`ImageRenderer::submit_render_metatile`] for how the block is
+    /// chosen.
+    ///
+    /// # Errors
+    ///
+    /// [`RenderPoolError::QueueFull`] if the queue is at capacity; `on_done` is
+    /// not called in that case.
+    pub fn submit_metatile<F>(
+        &self,
+        tile: TileCoord,
+        n: NonZeroU32,
+        on_done: F,
+    ) -> Result<JobHandle, RenderPoolError>
+    where
+        F: FnOnce(Result<MetaTile, RenderPoolError>) + Send + 'static,
+    {
+        self.submit(tile, Work::MetaTile(n, Box::new(on_done)))
+    }
+
+    fn submit(&self, tile: TileCoord, work: Work) -> Result<JobHandle, RenderPoolError> {
+        let cancelled = Arc::new(AtomicBool::new(false));
+        let job = Job { tile, cancelled: Arc::clone(&cancelled), work };
+
+        let mut state = self.shared.lock();
+        if state.shutdown {
+            return Err(RenderPoolError::Closed);
+        }
+        if state.live_workers().next().is_none() {
+            return Err(RenderPoolError::WorkerPanicked);
+        }
+        if state.queued >= self.shared.capacity {
+            return Err(RenderPoolError::QueueFull);
+        }
+        let target = self.route(&state, tile);
+        state.queues[target].push_back(job);
+        state.queued += 1;
+        // Wake the owner if it is idle; otherwise any idle worker, which will
+        // steal the job. A woken worker is no longer idle, so the next job
+        // wakes another one.
+        let wake = state.claim_idle(target);
+        drop(state);
+        if let Some(worker) = wake {
+            self.shared.wakeups[worker].notify_one();
+        }
+        Ok(JobHandle { cancelled })
+    }
+
+    /// Renders `tile` on a worker, blocking the calling thread until done.
+    ///
+    /// # Errors
+    ///
+    /// If the job cannot be queued or the render fails.
+    pub fn render_tile(&self, tile: TileCoord) -> Result<ImagePtr, RenderPoolError> {
+        let (sender, receiver) = mpsc::sync_channel(1);
+        self.submit_tile(tile, move |result| {
+            let _ = sender.send(result);
+        })?;
+        receiver.recv().unwrap_or(Err(RenderPoolError::Closed))
+    }
+
+    /// Picks the worker that rendered this tile's neighbours, unless it left
+    /// the pool or its queue is clearly longer than the shortest one.
+    fn route(&self, state: &PoolState, tile: TileCoord) -> usize {
+        const MAX_IMBALANCE: usize = 4;
+
+        let mut hasher = DefaultHasher::new();
+        tile.ancestor(self.shared.locality_levels).hash(&mut hasher);
+        #[allow(clippy::cast_possible_truncation, reason = "only the low bits pick a worker")]
+        let preferred = hasher.finish() as usize % state.queues.len();
+
+        let (shortest, shortest_len) = state
+            .live_workers()
+            .map(|index| (index, state.queues[index].len()))
+            .min_by_key(|&(_, len)| len)
+            .unwrap_or((preferred, 0));
+        if state.retired[preferred] || state.queues[preferred].len() > shortest_len + MAX_IMBALANCE
+        {
+            shortest
+        } else {
+            preferred
+        }
+    }
+}
+
+impl Drop for RenderPool {
+    fn drop(&mut self) {
+        let pending: Vec<Job> = {
+            let mut state = self.shared.lock();
+            state.shutdown = true;
+            state.queued = 0;
+            state.queues.iter_mut().flat_map(|queue| queue.drain(..)).collect()
+        };
+        for wakeup in &self.shared.wakeups {
+            wakeup.notify_all();
+        }
+        for job in pending {
+            deliver(|| job.work.fail(RenderPoolError::Closed));
+        }
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+/// Handle to a job queued with [`RenderPool::submit_tile`].
+///
+/// Dropping the handle does not cancel the job.
+#[derive(Debug, Clone)]
+pub struct JobHandle {
+    cancelled: Arc<AtomicBool>,
+}
+
+impl JobHandle {
+    /// Cancels the job if no worker has started it yet.
+    ///
+    /// A cancelled job completes with [`RenderPoolError::Cancelled`]. A job that
+    /// is already rendering runs to completion.
+    pub fn cancel(&self) {
+        self.cancelled.store(true, Ordering::Release);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::VecDeque;
+
+    use super::{steal, PoolState, TileCoord};
+
+    #[test]
+    fn ancestor_stops_at_zoom_zero() {
+        assert_eq!(TileCoord::new(5, 17, 9).ancestor(2), TileCoord::new(3, 4, 2));
+        assert_eq!(TileCoord::new(1, 1, 0).ancestor(4), TileCoord::new(0, 0, 0));
+    }
+
+    #[test]
+    fn each_job_claims_a_different_idle_worker() {
+        let mut state = PoolState {
+            queues: (0..3).map(|_| VecDeque::new()).collect(),
+            idle: vec![true, false, true],
+            retired: vec![false; 3],
+            queued: 0,
+            shutdown: false,
+        };
+        assert_eq!(state.claim_idle(2), Some(2));
+        assert_eq!(state.claim_idle(2), Some(0), "the target was already woken");
+        assert_eq!(state.claim_idle(2), None);
+    }
+
+    #[test]
+    fn steal_takes_newest_job_from_longest_queue() {
+        let mut queues = vec![VecDeque::from([1]), VecDeque::from([2, 3, 4]), VecDeque::new()];
+        assert_eq!(steal(&mut queues), Some(4));
+        assert_eq!(queues[1], [2, 3]);
+
+        let mut empty: Vec<VecDeque<u32>> = vec![VecDeque::new(); 2];
+        assert_eq!(steal(&mut empty), None);
+    }
+}
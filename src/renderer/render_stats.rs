@@ -0,0 +1,79 @@
+//! Per-render timings and GPU resource counts.
+
+use std::time::Duration;
+
+use crate::RenderRequest;
+
+/// Measurements of one completed render, from [`RenderRequest::stats`].
+///
+/// The phases follow each other without gaps, so they add up to
+/// [`total`](Self::total): the time from submitting the render until its
+/// pixels are on the CPU. Encoding happens after that, in the caller.
+///
+/// ```no_run
+/// # fn foo(renderer: &mut maplibre_native::ImageRenderer<maplibre_native::Tile>) {
+/// use maplibre_native::RunLoopHandle;
+///
+/// let request = renderer.submit_render_tile(3, 4, 2).unwrap();
+/// let run_loop = RunLoopHandle::current();
+/// while !request.is_ready() {
+///     run_loop.tick();
+/// }
+/// let stats = request.stats().unwrap();
+/// println!("{:?} waiting for tiles, {:?} drawing", stats.loading, stats.frame);
+/// let image = request.finish_image_ptr().unwrap();
+/// # }
+/// ```
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct RenderStats {
+    /// Waiting behind earlier renders queued on the same renderer.
+    pub queued: Duration,
+    /// Waiting for the tiles, glyphs and sprites of the view, including their
+    /// parsing, layout and symbol placement on worker threads.
+    pub loading: Duration,
+    /// Preparing the frame and submitting its draw calls to the GPU.
+    pub frame: Duration,
+    /// Reading the frame back, including waiting for the GPU to finish
+    /// drawing it, and unpremultiplying the pixels.
+    pub readback: Duration,
+    /// How long the renderer's style took to load, or `None` if it was still
+    /// loading when the render was submitted. The remaining load time is then
+    /// part of `loading`.
+    pub style_load: Option<Duration>,
+    /// Draw calls issued for the frame.
+    pub draw_calls: u64,
+    /// GPU memory held by the renderer's textures, in bytes.
+    pub texture_bytes: u64,
+    /// GPU memory held by the renderer's vertex, index and uniform buffers,
+    /// in bytes.
+    pub buffer_bytes: u64,
+}
+
+impl RenderStats {
+    /// Time from submitting the render until its pixels were read back.
+    #[must_use]
+    pub fn total(&self) -> Duration {
+        self.queued + self.loading + self.frame + self.readback
+    }
+}
+
+impl<S> RenderRequest<'_, S> {
+    /// Returns the timings and GPU resource counts of a successful render, or
+    /// `None` until it is ready or if it failed.
+    ///
+    /// Read them before [`finish`](Self::finish) consumes the request.
+    #[must_use]
+    pub fn stats(&self) -> Option<RenderStats> {
+        let instance = &self.instance;
+        (instance.isReady() && !instance.hasError()).then(|| RenderStats {
+            queued: Duration::from_nanos(instance.queuedNanos()),
+            loading: Duration::from_nanos(instance.loadingNanos()),
+            frame: Duration::from_nanos(instance.frameNanos()),
+            readback: Duration::from_nanos(instance.readbackNanos()),
+            style_load: self.style_load,
+            draw_calls: instance.drawCalls(),
+            texture_bytes: instance.textureBytes(),
+            buffer_bytes: instance.bufferBytes(),
+        })
+    }
+}
@@ -1,9 +1,17 @@
 //! MapLibre Native run loop handle.
 
 use std::marker::PhantomData;
+#[cfg(unix)]
+use std::os::fd::RawFd;
+use std::time::Duration;
 
 use crate::bridge::ffi;
 
+/// How often [`RunLoopHandle::tick_when_ready`] ticks a run loop that cannot
+/// be polled through a file descriptor.
+#[cfg(feature = "tokio")]
+const FALLBACK_TICK_INTERVAL: Duration = Duration::from_millis(1);
+
 /// Handle to the current thread's MapLibre Native run loop.
 ///
 /// Use [`tick`](Self::tick) to advance pending render requests on this thread.
@@ -33,6 +41,64 @@ impl RunLoopHandle {
         ffi::currentThreadRunLoopTick();
     }
 
+    /// Returns the libuv loop's polling file descriptor.
+    ///
+    /// The descriptor (an epoll or kqueue instance) becomes readable whenever
+    /// the loop has I/O to process, including completions posted from
+    /// MapLibre Native's worker threads. Register it with an event loop, and
+    /// call [`tick`](Self::tick) once it is readable or once
+    /// [`backend_timeout`](Self::backend_timeout) has passed.
+    ///
+    /// Returns `None` on the CoreFoundation (Darwin) backend.
+    #[cfg(unix)]
+    #[must_use]
+    #[allow(clippy::unused_self, reason = "method syntax ties the fd to a run-loop handle")]
+    pub fn backend_fd(&self) -> Option<RawFd> {
+        let fd = ffi::currentThreadRunLoopBackendFd();
+        (fd >= 0).then_some(fd)
+    }
+
+    /// Returns how long the libuv loop can wait before its next timer is due.
+    ///
+    /// `Some(Duration::ZERO)` means work is already pending and the loop
+    /// should be ticked right away. Returns `None` if no timer is armed, in
+    /// which case only [`backend_fd`](Self::backend_fd) readiness needs a
+    /// tick, and on the CoreFoundation (Darwin) backend.
+    #[must_use]
+    #[allow(clippy::unused_self, reason = "method syntax ties the timeout to a run-loop handle")]
+    pub fn backend_timeout(&self) -> Option<Duration> {
+        let timeout = ffi::currentThreadRunLoopBackendTimeout();
+        u64::try_from(timeout).ok().map(Duration::from_millis)
+    }
+
+    /// Waits without blocking the thread until the run loop has work, then
+    /// ticks it once.
+    ///
+    /// On the libuv backend this registers [`backend_fd`](Self::backend_fd)
+    /// with the Tokio reactor and also wakes up for
+    /// [`backend_timeout`](Self::backend_timeout), so an idle loop costs
+    /// nothing. Other backends are ticked every millisecond.
+    ///
+    /// Like the handle, the future is not `Send`: run it on a current-thread
+    /// runtime or a [`LocalSet`](tokio::task::LocalSet), where many renderers
+    /// can share one thread.
+    ///
+    /// # Panics
+    ///
+    /// If called outside a Tokio runtime with the I/O and time drivers enabled.
+    #[cfg(feature = "tokio")]
+    pub async fn tick_when_ready(&self) {
+        #[cfg(unix)]
+        if let Some(fd) = self.backend_fd() {
+            if backend::wait(fd, self.backend_timeout()).await.is_ok() {
+                self.tick();
+                return;
+            }
+        }
+        tokio::time::sleep(FALLBACK_TICK_INTERVAL).await;
+        self.tick();
+    }
+
     /// Blocks the calling thread, advancing the run loop until it is woken by
     /// pending work (a render or style-load completion).
     ///
@@ -57,3 +123,72 @@ impl RunLoopHandle {
         ffi::currentThreadRunLoopStop();
     }
 }
+
+/// Tokio registration of the libuv backend fd.
+#[cfg(all(feature = "tokio", unix))]
+mod backend {
+    use std::cell::RefCell;
+    use std::future::{poll_fn, Future};
+    use std::io;
+    use std::os::fd::{AsRawFd, RawFd};
+    use std::pin::pin;
+    use std::rc::{Rc, Weak};
+    use std::task::Poll;
+    use std::time::Duration;
+
+    use tokio::io::unix::AsyncFd;
+    use tokio::io::Interest;
+
+    struct BackendFd(RawFd);
+
+    impl AsRawFd for BackendFd {
+        fn as_raw_fd(&self) -> RawFd {
+            self.0
+        }
+    }
+
+    thread_local! {
+        // The reactor rejects registering one fd twice, so every task waiting
+        // on this thread's loop shares a registration while any is waiting.
+        static REGISTRATION: RefCell<Weak<AsyncFd<BackendFd>>> = const {
+            RefCell::new(Weak::new())
+        };
+    }
+
+    fn registration(fd: RawFd) -> io::Result<Rc<AsyncFd<BackendFd>>> {
+        REGISTRATION.with(|cell| {
+            if let Some(registration) = cell.borrow().upgrade() {
+                return Ok(registration);
+            }
+            let registration = Rc::new(AsyncFd::with_interest(BackendFd(fd), Interest::READABLE)?);
+            *cell.borrow_mut() = Rc::downgrade(&registration);
+            Ok(registration)
+        })
+    }
+
+    /// Waits until `fd` is readable or `timeout` has passed.
+    ///
+    /// Readiness is cleared before returning, and so before the caller ticks
+    /// the loop: events arriving during the tick wake the next wait.
+    pub(super) async fn wait(fd: RawFd, timeout: Option<Duration>) -> io::Result<()> {
+        if timeout == Some(Duration::ZERO) {
+            // Work is pending already; let other tasks run before ticking.
+            tokio::task::yield_now().await;
+            return Ok(());
+        }
+        let registration = registration(fd)?;
+        let mut readable = pin!(registration.readable());
+        let mut sleep = pin!(timeout.map(tokio::time::sleep));
+        poll_fn(|cx| {
+            if let Poll::Ready(guard) = readable.as_mut().poll(cx) {
+                guard?.clear_ready();
+                return Poll::Ready(Ok(()));
+            }
+            match sleep.as_mut().as_pin_mut().map(|sleep| sleep.poll(cx)) {
+                Some(Poll::Ready(())) => Poll::Ready(Ok(())),
+                _ => Poll::Pending,
+            }
+        })
+        .await
+    }
+}
@@ -0,0 +1,846 @@
+//! Pre-rendering tile pyramids.
+//!
+//! A [`SeedPlan`] lists the tiles covering some bounds over a range of zooms,
+//! walked along a space-filling curve so consecutive renders share source
+//! tiles. A [`Seeder`] feeds the plan to a [`RenderPool`] as metatiles, keeps
+//! a bounded number of them in flight so the workers never run dry, encodes
+//! the tiles on an [`EncoderPool`] and hands them to a [`TileSink`]. Progress
+//! is checkpointed to a file so an interrupted run picks up where it stopped.
+
+use std::collections::{BTreeSet, HashMap};
+use std::f64::consts::PI;
+use std::fmt::Debug;
+use std::fs;
+use std::io;
+use std::num::NonZeroU32;
+use std::ops::RangeInclusive;
+use std::path::{Path, PathBuf};
+use std::sync::{mpsc, Arc};
+use std::thread;
+use std::time::Duration;
+
+use crate::{
+    EncodeError, EncodeFormat, EncoderPool, LatLng, LatLngBounds, MetaTile, PngCompression,
+    RenderPool, RenderPoolError, TileCoord,
+};
+
+/// Highest zoom a [`SeedPlan`] covers; tile columns must fit in a `u32`.
+pub const MAX_SEED_ZOOM: u8 = 30;
+
+const MAX_MERCATOR_LAT: f64 = 85.051_128_779_806_59;
+
+/// Order in which a [`SeedPlan`] visits the tiles of one zoom level.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum TileOrder {
+    /// Row by row, west to east.
+    RowMajor,
+    /// Z-order curve: quadrant by quadrant, recursively.
+    Morton,
+    /// Hilbert curve: like Morton, but consecutive tiles are always adjacent.
+    #[default]
+    Hilbert,
+}
+
+/// A rectangle of tiles at one zoom level, inclusive on both ends.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TileRange {
+    /// Zoom level.
+    pub zoom: u8,
+    /// Westernmost column.
+    pub min_x: u32,
+    /// Northernmost row.
+    pub min_y: u32,
+    /// Easternmost column.
+    pub max_x: u32,
+    /// Southernmost row.
+    pub max_y: u32,
+}
+
+impl TileRange {
+    /// The tiles at `zoom` that intersect `bounds`.
+    ///
+    /// Latitudes are clamped to the Web Mercator limit. Bounds crossing the
+    /// antimeridian are not supported.
+    #[must_use]
+    pub fn covering(bounds: LatLngBounds, zoom: u8) -> Self {
+        let zoom = zoom.min(MAX_SEED_ZOOM);
+        let (min_x, max_y) = lat_lng_to_tile(bounds.southwest, zoom);
+        let (max_x, min_y) = lat_lng_to_tile(bounds.northeast, zoom);
+        Self { zoom, min_x, min_y, max_x: max_x.max(min_x), max_y: max_y.max(min_y) }
+    }
+
+    /// Whether `tile` lies in this range.
+    #[must_use]
+    pub fn contains(&self, tile: TileCoord) -> bool {
+        tile.z == self.zoom
+            && (self.min_x..=self.max_x).contains(&tile.x)
+            && (self.min_y..=self.max_y).contains(&tile.y)
+    }
+
+    /// Number of tiles in the range.
+    #[must_use]
+    pub fn tile_count(&self) -> u64 {
+        u64::from(self.max_x - self.min_x + 1) * u64::from(self.max_y - self.min_y + 1)
+    }
+}
+
+#[allow(
+    clippy::cast_possible_truncation,
+    clippy::cast_sign_loss,
+    reason = "clamped to the tile grid first"
+)]
+fn lat_lng_to_tile(point: LatLng, zoom: u8) -> (u32, u32) {
+    let tiles = 2_f64.powi(i32::from(zoom));
+    let lat = point.lat.clamp(-MAX_MERCATOR_LAT, MAX_MERCATOR_LAT).to_radians();
+    let x = (point.lng + 180.0) / 360.0 * tiles;
+    let y = (1.0 - lat.tan().asinh() / PI) / 2.0 * tiles;
+    let max = tiles - 1.0;
+    (x.floor().clamp(0.0, max) as u32, y.floor().clamp(0.0, max) as u32)
+}
+
+/// The bounds, zooms and order of a seeding run.
+#[derive(Debug, Clone)]
+pub struct SeedPlan {
+    bounds: LatLngBounds,
+    zooms: RangeInclusive<u8>,
+    order: TileOrder,
+    metatile: NonZeroU32,
+}
+
+impl SeedPlan {
+    /// A plan covering `bounds` at each zoom in `zooms`, lowest zoom first.
+    ///
+    /// Zooms above [`MAX_SEED_ZOOM`] are dropped. Defaults to
+    /// [`TileOrder::Hilbert`] and single-tile renders.
+    #[must_use]
+    pub fn new(bounds: LatLngBounds, zooms: RangeInclusive<u8>) -> Self {
+        let zooms = *zooms.start()..=(*zooms.end()).min(MAX_SEED_ZOOM);
+        Self { bounds, zooms, order: TileOrder::default(), metatile: NonZeroU32::MIN }
+    }
+
+    /// Sets the order tiles are visited in within each zoom.
+    #[must_use]
+    pub fn with_order(mut self, order: TileOrder) -> Self {
+        self.order = order;
+        self
+    }
+
+    /// Renders `n`×`n` metatiles instead of single tiles.
+    ///
+    /// The curve then walks metatiles, and each render produces up to `n²`
+    /// tiles. See [`ImageRenderer::render_metatile`](crate::ImageRenderer::render_metatile).
+    #[must_use]
+    pub fn with_metatile_size(mut self, n: NonZeroU32) -> Self {
+        self.metatile = n;
+        self
+    }
+
+    /// The tile range of each zoom level, lowest zoom first.
+    pub fn ranges(&self) -> impl Iterator<Item = TileRange> + '_ {
+        self.zooms.clone().map(move |zoom| TileRange::covering(self.bounds, zoom))
+    }
+
+    /// Number of tiles in the plan.
+    #[must_use]
+    pub fn tile_count(&self) -> u64 {
+        self.ranges().map(|range| range.tile_count()).sum()
+    }
+
+    /// The renders of the plan, in order.
+    ///
+    /// The sequence is deterministic, which is what lets a checkpoint resume
+    /// by position.
+    pub fn units(&self) -> impl Iterator<Item = SeedUnit> + '_ {
+        self.ranges().flat_map(move |range| {
+            let tiles_per_side = 1_u64 << range.zoom;
+            let n = u32::try_from(u64::from(self.metatile.get()).min(tiles_per_side))
+                .unwrap_or(u32::MAX);
+            let cells = Cells::new(
+                self.order,
+                (range.min_x / n, range.min_y / n),
+                (range.max_x / n, range.max_y / n),
+            );
+            cells.map(move |(x, y)| SeedUnit {
+                origin: TileCoord { z: range.zoom, x: x * n, y: y * n },
+                n,
+                range,
+            })
+        })
+    }
+
+    /// Identifies the plan in a checkpoint, so a checkpoint cannot be resumed
+    /// against a different plan.
+    fn fingerprint(&self) -> String {
+        let LatLngBounds { southwest: sw, northeast: ne } = self.bounds;
+        format!(
+            "mln-seed 1 z{}-{} {:?} n{} {},{},{},{}",
+            self.zooms.start(),
+            self.zooms.end(),
+            self.order,
+            self.metatile,
+            sw.lat,
+            sw.lng,
+            ne.lat,
+            ne.lng,
+        )
+    }
+}
+
+/// One render of a [`SeedPlan`]: a metatile and the plan's tiles inside it.
+#[derive(Debug, Clone, Copy)]
+pub struct SeedUnit {
+    /// Top-left tile of the metatile.
+    pub origin: TileCoord,
+    /// Tiles along each side of the metatile.
+    pub n: u32,
+    range: TileRange,
+}
+
+impl SeedUnit {
+    /// The tiles of the plan inside this metatile, row by row.
+    ///
+    /// Metatiles on the edge of the plan's bounds also render tiles outside
+    /// it; those are left out.
+    pub fn tiles(&self) -> impl Iterator<Item = TileCoord> {
+        let TileCoord { z, x, y } = self.origin;
+        let range = self.range;
+        let columns = x.max(range.min_x)..=x.saturating_add(self.n - 1).min(range.max_x);
+        let rows = y.max(range.min_y)..=y.saturating_add(self.n - 1).min(range.max_y);
+        rows.flat_map(move |y| columns.clone().map(move |x| TileCoord { z, x, y }))
+    }
+}
+
+/// A symmetry of the unit square, applied to a quadrant's `(x, y)` bits.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct Transform {
+    swap: bool,
+    flip_x: bool,
+    flip_y: bool,
+}
+
+impl Transform {
+    const IDENTITY: Self = Self { swap: false, flip_x: false, flip_y: false };
+    const TRANSPOSE: Self = Self { swap: true, flip_x: false, flip_y: false };
+    const ANTI_TRANSPOSE: Self = Self { swap: true, flip_x: true, flip_y: true };
+
+    fn apply(self, (x, y): (u64, u64)) -> (u64, u64) {
+        let (x, y) = if self.swap { (y, x) } else { (x, y) };
+        (x ^ u64::from(self.flip_x), y ^ u64::from(self.flip_y))
+    }
+
+    /// `self` applied after `inner`.
+    fn compose(self, inner: Self) -> Self {
+        let origin = self.apply(inner.apply((0, 0)));
+        let unit_x = self.apply(inner.apply((1, 0)));
+        Self { swap: unit_x.0 == origin.0, flip_x: origin.0 == 1, flip_y: origin.1 == 1 }
+    }
+}
+
+/// Child quadrants in visiting order, each with the transform of its sub-curve.
+const MORTON: [((u64, u64), Transform); 4] = [
+    ((0, 0), Transform::IDENTITY),
+    ((1, 0), Transform::IDENTITY),
+    ((0, 1), Transform::IDENTITY),
+    ((1, 1), Transform::IDENTITY),
+];
+const HILBERT: [((u64, u64), Transform); 4] = [
+    ((0, 0), Transform::TRANSPOSE),
+    ((0, 1), Transform::IDENTITY),
+    ((1, 1), Transform::IDENTITY),
+    ((1, 0), Transform::ANTI_TRANSPOSE),
+];
+
+#[derive(Debug, Clone, Copy)]
+struct Quad {
+    x: u64,
+    y: u64,
+    size: u64,
+    transform: Transform,
+}
+
+/// The cells of an inclusive rectangle in a [`TileOrder`].
+///
+/// Curves descend from a square aligned to the origin of the grid and skip
+/// quadrants outside the rectangle, so a thin strip costs no more than a
+/// logarithmic factor per cell.
+struct Cells {
+    order: TileOrder,
+    min: (u32, u32),
+    max: (u32, u32),
+    next_row_major: Option<(u32, u32)>,
+    stack: Vec<Quad>,
+}
+
+impl Cells {
+    fn new(order: TileOrder, min: (u32, u32), max: (u32, u32)) -> Self {
+        let mut cells = Self { order, min, max, next_row_major: None, stack: Vec::new() };
+        if order == TileOrder::RowMajor {
+            cells.next_row_major = Some(min);
+        } else {
+            let size = u64::from(max.0.max(max.1)).saturating_add(1).next_power_of_two();
+            cells.stack.push(Quad { x: 0, y: 0, size, transform: Transform::IDENTITY });
+        }
+        cells
+    }
+
+    fn intersects(&self, quad: &Quad) -> bool {
+        quad.x <= u64::from(self.max.0)
+            && quad.y <= u64::from(self.max.1)
+            && quad.x + quad.size > u64::from(self.min.0)
+            && quad.y + quad.size > u64::from(self.min.1)
+    }
+}
+
+impl Iterator for Cells {
+    type Item = (u32, u32);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.order == TileOrder::RowMajor {
+            let (x, y) = self.next_row_major?;
+            self.next_row_major = if x < self.max.0 {
+                Some((x + 1, y))
+            } else if y < self.max.1 {
+                Some((self.min.0, y + 1))
+            } else {
+                None
+            };
+            return Some((x, y));
+        }
+
+        let children = if self.order == TileOrder::Morton { &MORTON } else { &HILBERT };
+        while let Some(quad) = self.stack.pop() {
+            if !self.intersects(&quad) {
+                continue;
+            }
+            if quad.size == 1 {
+                // `intersects` bounds both coordinates by `self.max`.
+                return Some((quad.x.try_into().ok()?, quad.y.try_into().ok()?));
+            }
+            let half = quad.size / 2;
+            // Reversed, so the first child is popped first.
+            for &(child, inner) in children.iter().rev() {
+                let (cx, cy) = quad.transform.apply(child);
+                self.stack.push(Quad {
+                    x: quad.x + cx * half,
+                    y: quad.y + cy * half,
+                    size: half,
+                    transform: quad.transform.compose(inner),
+                });
+            }
+        }
+        None
+    }
+}
+
+/// Destination for seeded tiles.
+pub trait TileSink {
+    /// Stores the encoded bytes of `tile`, replacing any earlier version.
+    ///
+    /// # Errors
+    ///
+    /// If the tile cannot be stored; the run stops with [`SeedError::Io`].
+    fn write_tile(&mut self, tile: TileCoord, data: &[u8]) -> io::Result<()>;
+
+    /// Makes every tile written so far durable.
+    ///
+    /// Called before each checkpoint, so a resumed run never skips a tile that
+    /// was lost.
+    ///
+    /// # Errors
+    ///
+    /// If buffered tiles cannot be stored.
+    fn flush(&mut self) -> io::Result<()> {
+        Ok(())
+    }
+}
+
+/// Writes tiles to `{root}/{z}/{x}/{y}.{extension}`.
+#[derive(Debug, Clone)]
+pub struct DirectorySink {
+    root: PathBuf,
+    extension: &'static str,
+}
+
+impl DirectorySink {
+    /// Writes under `root`, naming files for `format`.
+    #[must_use]
+    pub fn new(root: impl Into<PathBuf>, format: EncodeFormat) -> Self {
+        let extension = match format {
+            EncodeFormat::Png(_) => "png",
+            EncodeFormat::WebP => "webp",
+            EncodeFormat::Jpeg(_) => "jpg",
+        };
+        Self { root: root.into(), extension }
+    }
+
+    /// The path a tile is written to.
+    #[must_use]
+    pub fn tile_path(&self, tile: TileCoord) -> PathBuf {
+        self.root
+            .join(tile.z.to_string())
+            .join(tile.x.to_string())
+            .join(format!("{}.{}", tile.y, self.extension))
+    }
+}
+
+impl TileSink for DirectorySink {
+    fn write_tile(&mut self, tile: TileCoord, data: &[u8]) -> io::Result<()> {
+        let path = self.tile_path(tile);
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+        fs::write(path, data)
+    }
+}
+
+/// Errors that stop a seeding run.
+#[derive(thiserror::Error, Debug)]
+#[non_exhaustive]
+pub enum SeedError {
+    /// Writing a tile or the checkpoint failed.
+    #[error(transparent)]
+    Io(#[from] io::Error),
+    /// A metatile failed to render.
+    #[error("failed to render {tile:?}: {source}")]
+    Render {
+        /// Top-left tile of the metatile.
+        tile: TileCoord,
+        /// The pool's error.
+        source: RenderPoolError,
+    },
+    /// A tile failed to encode.
+    #[error("failed to encode {tile:?}: {source}")]
+    Encode {
+        /// The tile.
+        tile: TileCoord,
+        /// The encoder's error.
+        source: EncodeError,
+    },
+    /// The checkpoint file belongs to a different plan.
+    #[error("checkpoint {0} was written for a different seed plan")]
+    CheckpointMismatch(PathBuf),
+}
+
+/// Counts from a finished seeding run.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+#[non_exhaustive]
+pub struct SeedReport {
+    /// Renders skipped because the checkpoint marked them done.
+    pub resumed_units: u64,
+    /// Renders submitted to the pool.
+    pub rendered_units: u64,
+    /// Tiles written to the sink.
+    pub written_tiles: u64,
+    /// Tiles rejected by the filter.
+    pub skipped_tiles: u64,
+}
+
+type TileFilter = Box<dyn Fn(TileCoord) -> bool + Send + Sync>;
+
+/// Drives a [`SeedPlan`] through a [`RenderPool`].
+pub struct Seeder {
+    plan: SeedPlan,
+    format: EncodeFormat,
+    filter: Option<TileFilter>,
+    checkpoint: Option<PathBuf>,
+    checkpoint_interval: u64,
+    max_in_flight: usize,
+}
+
+impl Debug for Seeder {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("Seeder")
+            .field("plan", &self.plan)
+            .field("format", &self.format)
+            .field("checkpoint", &self.checkpoint)
+            .field("max_in_flight", &self.max_in_flight)
+            .finish_non_exhaustive()
+    }
+}
+
+impl Seeder {
+    /// A seeder for `plan` writing fast-compressed PNGs.
+    #[must_use]
+    pub fn new(plan: SeedPlan) -> Self {
+        Self {
+            plan,
+            format: EncodeFormat::Png(PngCompression::Fast),
+            filter: None,
+            checkpoint: None,
+            checkpoint_interval: 64,
+            max_in_flight: 64,
+        }
+    }
+
+    /// Sets the encoding of written tiles.
+    #[must_use]
+    pub fn with_format(mut self, format: EncodeFormat) -> Self {
+        self.format = format;
+        self
+    }
+
+    /// Renders only tiles for which `filter` returns `true`.
+    ///
+    /// Use this to skip tiles with no source data, e.g. by checking the
+    /// source's own tile index. Metatiles whose tiles are all rejected are not
+    /// rendered.
+    #[must_use]
+    pub fn with_filter<F>(mut self, filter: F) -> Self
+    where
+        F: Fn(TileCoord) -> bool + Send + Sync + 'static,
+    {
+        self.filter = Some(Box::new(filter));
+        self
+    }
+
+    /// Records progress in `path` and resumes from it on the next run.
+    #[must_use]
+    pub fn with_checkpoint(mut self, path: impl Into<PathBuf>) -> Self {
+        self.checkpoint = Some(path.into());
+        self
+    }
+
+    /// Sets how many renders are queued or running at once.
+    ///
+    /// Keep it at or below the pool's queue capacity, and above its worker
+    /// count so workers never wait for the seeder.
+    #[must_use]
+    pub fn with_max_in_flight(mut self, renders: usize) -> Self {
+        self.max_in_flight = renders.max(1);
+        self
+    }
+
+    /// Renders the plan, blocking until every tile is written or a render,
+    /// encode or write fails.
+    ///
+    /// The pool and encoder may be shared with other work.
+    ///
+    /// # Errors
+    ///
+    /// On the first failure, after the renders in flight have drained. The
+    /// checkpoint then points at the first unfinished render.
+    pub fn run(
+        &self,
+        pool: &RenderPool,
+        encoder: &EncoderPool,
+        sink: &mut dyn TileSink,
+    ) -> Result<SeedReport, SeedError> {
+        let resumed = self.read_checkpoint()?;
+        let mut run = Run {
+            seeder: self,
+            sink,
+            progress: Progress::new(resumed),
+            since_checkpoint: 0,
+            pending: HashMap::new(),
+            error: None,
+            report: SeedReport { resumed_units: resumed, ..SeedReport::default() },
+        };
+        let (sender, receiver) = mpsc::channel();
+        let mut units =
+            (0_u64..).zip(self.plan.units()).skip(usize::try_from(resumed).unwrap_or(usize::MAX));
+        let mut retry = None;
+
+        loop {
+            while run.error.is_none() && run.pending.len() < self.max_in_flight {
+                let Some((seq, unit)) = retry.take().or_else(|| units.next()) else {
+                    break;
+                };
+                let tiles: Vec<_> = unit.tiles().collect();
+                let total = tiles.len();
+                let tiles: Vec<_> = match &self.filter {
+                    Some(filter) => tiles.into_iter().filter(|&tile| filter(tile)).collect(),
+                    None => tiles,
+                };
+                if tiles.is_empty() {
+                    run.report.skipped_tiles += total as u64;
+                    run.complete(seq);
+                    continue;
+                }
+
+                let sender = sender.clone();
+                let submitted = pool.submit_metatile(
+                    unit.origin,
+                    NonZeroU32::new(unit.n).unwrap_or(NonZeroU32::MIN),
+                    move |result| {
+                        let _ = sender.send(Event::Rendered { seq, result });
+                    },
+                );
+                match submitted {
+                    Ok(_) => {
+                        run.report.skipped_tiles += (total - tiles.len()) as u64;
+                        run.report.rendered_units += 1;
+                        let remaining = tiles.len();
+                        run.pending.insert(
+                            seq,
+                            Pending { origin: unit.origin, tiles, remaining, failed: false },
+                        );
+                    }
+                    Err(RenderPoolError::QueueFull) => {
+                        retry = Some((seq, unit));
+                        if run.pending.is_empty() {
+                            // The pool is full with other work; nothing of ours
+                            // will complete to wake us.
+                            thread::sleep(Duration::from_millis(10));
+                            continue;
+                        }
+                        break;
+                    }
+                    Err(source) => {
+                        run.error = Some(SeedError::Render { tile: unit.origin, source });
+                    }
+                }
+            }
+
+            if run.pending.is_empty() {
+                break;
+            }
+            // `sender` is still alive, so the channel cannot disconnect.
+            let Ok(event) = receiver.recv() else { break };
+            run.handle(event, encoder, &sender);
+        }
+
+        let checkpointed = run.checkpoint();
+        match run.error {
+            Some(error) => Err(error),
+            None => checkpointed.map(|()| run.report),
+        }
+    }
+
+    fn read_checkpoint(&self) -> Result<u64, SeedError> {
+        let Some(path) = &self.checkpoint else {
+            return Ok(0);
+        };
+        let contents = match fs::read_to_string(path) {
+            Ok(contents) => contents,
+            Err(error) if error.kind() == io::ErrorKind::NotFound => return Ok(0),
+            Err(error) => return Err(error.into()),
+        };
+        let mut lines = contents.lines();
+        if lines.next() != Some(self.plan.fingerprint().as_str()) {
+            return Err(SeedError::CheckpointMismatch(path.clone()));
+        }
+        lines
+            .next()
+            .and_then(|line| line.parse().ok())
+            .ok_or_else(|| SeedError::CheckpointMismatch(path.clone()))
+    }
+
+    fn write_checkpoint(&self, path: &Path, completed: u64) -> io::Result<()> {
+        // Write-then-rename, so a crash mid-write leaves the old checkpoint.
+        let temp = path.with_extension("tmp");
+        fs::write(&temp, format!("{}\n{completed}\n", self.plan.fingerprint()))?;
+        fs::rename(temp, path)
+    }
+}
+
+enum Event {
+    Rendered { seq: u64, result: Result<MetaTile, RenderPoolError> },
+    Encoded { seq: u64, tile: TileCoord, result: Result<Vec<u8>, EncodeError> },
+}
+
+struct Pending {
+    origin: TileCoord,
+    tiles: Vec<TileCoord>,
+    remaining: usize,
+    failed: bool,
+}
+
+/// State of one [`Seeder::run`] on the calling thread.
+struct Run<'a> {
+    seeder: &'a Seeder,
+    sink: &'a mut dyn TileSink,
+    progress: Progress,
+    since_checkpoint: u64,
+    pending: HashMap<u64, Pending>,
+    error: Option<SeedError>,
+    report: SeedReport,
+}
+
+impl Run<'_> {
+    fn handle(&mut self, event: Event, encoder: &EncoderPool, sender: &mpsc::Sender<Event>) {
+        match event {
+            Event::Rendered { seq, result: Ok(metatile) } => {
+                if self.error.is_some() {
+                    // The run is stopping; do not write more tiles.
+                    self.pending.remove(&seq);
+                    return;
+                }
+                let Some(pending) = self.pending.get(&seq) else { return };
+                let metatile = Arc::new(metatile);
+                for &tile in &pending.tiles {
+                    let sender = sender.clone();
+                    encoder.encode_tile_with(
+                        Arc::clone(&metatile),
+                        tile,
+                        self.seeder.format,
+                        move |result| {
+                            let _ = sender.send(Event::Encoded { seq, tile, result });
+                        },
+                    );
+                }
+            }
+            Event::Rendered { seq, result: Err(source) } => {
+                if let Some(pending) = self.pending.remove(&seq) {
+                    self.fail(SeedError::Render { tile: pending.origin, source });
+                }
+            }
+            Event::Encoded { seq, tile, result } => {
+                if !self.pending.contains_key(&seq) {
+                    return;
+                }
+                let written = match result {
+                    Ok(data) if self.error.is_none() => match self.sink.write_tile(tile, &data) {
+                        Ok(()) => true,
+                        Err(error) => {
+                            self.fail(error.into());
+                            false
+                        }
+                    },
+                    // The run is stopping; drain without writing.
+                    Ok(_) => false,
+                    Err(source) => {
+                        self.fail(SeedError::Encode { tile, source });
+                        false
+                    }
+                };
+                if written {
+                    self.report.written_tiles += 1;
+                }
+                let Some(pending) = self.pending.get_mut(&seq) else { return };
+                pending.failed |= !written;
+                pending.remaining -= 1;
+                if pending.remaining == 0 {
+                    let failed = pending.failed;
+                    self.pending.remove(&seq);
+                    if !failed {
+                        self.complete(seq);
+                    }
+                }
+            }
+        }
+    }
+
+    fn fail(&mut self, error: SeedError) {
+        if self.error.is_none() {
+            self.error = Some(error);
+        }
+    }
+
+    fn complete(&mut self, seq: u64) {
+        self.progress.complete(seq);
+        self.since_checkpoint += 1;
+        if self.since_checkpoint >= self.seeder.checkpoint_interval {
+            if let Err(error) = self.checkpoint() {
+                self.fail(error);
+            }
+        }
+    }
+
+    fn checkpoint(&mut self) -> Result<(), SeedError> {
+        self.since_checkpoint = 0;
+        self.sink.flush()?;
+        if let Some(path) = &self.seeder.checkpoint {
+            self.seeder.write_checkpoint(path, self.progress.completed())?;
+        }
+        Ok(())
+    }
+}
+
+/// Tracks the longest prefix of renders that have all completed.
+#[derive(Debug)]
+struct Progress {
+    watermark: u64,
+    done_above: BTreeSet<u64>,
+}
+
+impl Progress {
+    fn new(watermark: u64) -> Self {
+        Self { watermark, done_above: BTreeSet::new() }
+    }
+
+    fn complete(&mut self, seq: u64) {
+        if seq != self.watermark {
+            self.done_above.insert(seq);
+            return;
+        }
+        self.watermark += 1;
+        while self.done_above.remove(&self.watermark) {
+            self.watermark += 1;
+        }
+    }
+
+    /// Number of leading renders that are done; a resumed run skips these.
+    fn completed(&self) -> u64 {
+        self.watermark
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::collections::HashSet;
+    use std::num::NonZeroU32;
+
+    use super::{Cells, Progress, SeedPlan, TileOrder, TileRange};
+    use crate::{LatLng, LatLngBounds, TileCoord};
+
+    const WORLD: LatLngBounds = LatLngBounds {
+        southwest: LatLng { lat: -90.0, lng: -180.0 },
+        northeast: LatLng { lat: 90.0, lng: 180.0 },
+    };
+
+    #[test]
+    fn hilbert_visits_adjacent_cells() {
+        let cells: Vec<_> = Cells::new(TileOrder::Hilbert, (0, 0), (15, 15)).collect();
+        assert_eq!(cells.len(), 256);
+        assert_eq!(cells.iter().collect::<HashSet<_>>().len(), 256);
+        for pair in cells.windows(2) {
+            let (a, b) = (pair[0], pair[1]);
+            assert_eq!(a.0.abs_diff(b.0) + a.1.abs_diff(b.1), 1, "{a:?} -> {b:?}");
+        }
+    }
+
+    #[test]
+    fn morton_visits_quadrants_in_z_order() {
+        let cells: Vec<_> = Cells::new(TileOrder::Morton, (0, 0), (1, 1)).collect();
+        assert_eq!(cells, [(0, 0), (1, 0), (0, 1), (1, 1)]);
+    }
+
+    #[test]
+    fn curves_cover_exactly_the_rectangle() {
+        for order in [TileOrder::RowMajor, TileOrder::Morton, TileOrder::Hilbert] {
+            let cells: HashSet<_> = Cells::new(order, (3, 5), (9, 6)).collect();
+            let expected: HashSet<_> = (5..=6).flat_map(|y| (3..=9).map(move |x| (x, y))).collect();
+            assert_eq!(cells, expected, "{order:?}");
+        }
+    }
+
+    #[test]
+    fn covers_the_world() {
+        let range = TileRange::covering(WORLD, 2);
+        assert_eq!((range.min_x, range.min_y, range.max_x, range.max_y), (0, 0, 3, 3));
+        assert_eq!(SeedPlan::new(WORLD, 0..=2).tile_count(), 1 + 4 + 16);
+    }
+
+    #[test]
+    fn metatile_units_keep_only_planned_tiles() {
+        let bounds = LatLngBounds {
+            southwest: LatLng { lat: -10.0, lng: -10.0 },
+            northeast: LatLng { lat: 10.0, lng: 10.0 },
+        };
+        let plan = SeedPlan::new(bounds, 3..=3).with_metatile_size(NonZeroU32::new(4).unwrap());
+        let units: Vec<_> = plan.units().collect();
+        assert_eq!(units.len(), 4);
+        let tiles: Vec<TileCoord> = units.iter().flat_map(super::SeedUnit::tiles).collect();
+        assert_eq!(tiles.len() as u64, plan.tile_count());
+    }
+
+    #[test]
+    fn progress_waits_for_gaps() {
+        let mut progress = Progress::new(2);
+        progress.complete(4);
+        progress.complete(3);
+        assert_eq!(progress.completed(), 2);
+        progress.complete(2);
+        assert_eq!(progress.completed(), 5);
+    }
+}
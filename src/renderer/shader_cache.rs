@@ -0,0 +1,44 @@
+//! Environment for the GPU driver's on-disk shader cache.
+
+use std::ffi::OsStr;
+use std::path::Path;
+
+/// Returns the environment variables that keep compiled shaders and
+/// pipelines in `dir` across processes.
+///
+/// Every renderer compiles its shader programs when its backend is created,
+/// which dominates cold start on Vulkan. MapLibre Native does not expose a
+/// pipeline cache of its own, so the GPU driver's cache is the one to reuse:
+/// with these variables, Mesa (GL and Vulkan) and the NVIDIA driver load it
+/// when a backend is created and write new entries as programs compile, so
+/// later processes, such as freshly scaled render nodes sharing a volume,
+/// skip most compilation. Metal already caches compiled shaders per user.
+///
+/// Drivers read the environment on their own threads, so set the variables
+/// where the process is launched, such as a service unit or container spec,
+/// or at the top of `main` before any thread or renderer exists. This
+/// function only names them; create `dir` beforehand.
+///
+/// ```no_run
+/// use std::path::Path;
+///
+/// let dir = Path::new("/var/cache/tiles/shaders");
+/// std::fs::create_dir_all(dir).unwrap();
+/// for (name, value) in maplibre_native::shader_cache_env(dir) {
+///     if std::env::var_os(name).is_none() {
+///         // No other thread has started yet.
+///         std::env::set_var(name, value);
+///     }
+/// }
+/// ```
+#[must_use]
+pub fn shader_cache_env(dir: &Path) -> [(&'static str, &OsStr); 4] {
+    let dir = dir.as_os_str();
+    [
+        ("MESA_SHADER_CACHE_DIR", dir),
+        ("__GL_SHADER_DISK_CACHE", "1".as_ref()),
+        ("__GL_SHADER_DISK_CACHE_PATH", dir),
+        // Otherwise the NVIDIA driver trims caches it did not create.
+        ("__GL_SHADER_DISK_CACHE_SKIP_CLEANUP", "1".as_ref()),
+    ]
+}
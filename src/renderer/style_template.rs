@@ -0,0 +1,103 @@
+//! Loading one style document into many renderers.
+
+use std::fmt::Debug;
+use std::path::Path;
+use std::sync::Arc;
+
+use crate::{ImageRenderer, StyleLoadRequest};
+
+/// A style document fetched once and loaded into any number of renderers.
+///
+/// Loading a style by URL makes every renderer fetch the document through
+/// its file sources. A template holds the JSON in shared memory instead, so
+/// a [`RenderPool`](crate::RenderPool) factory can load it into each worker
+/// without another request. The template is cheap to clone and `Send +
+/// Sync`.
+///
+/// Each renderer still parses the document and compiles its expressions:
+/// a parsed style is bound to its map's thread. Put a
+/// [`ResourceCache`](crate::ResourceCache) in front of the network source
+/// so sprites and glyphs are also fetched only once.
+///
+/// ```no_run
+/// # fn foo() -> Result<(), Box<dyn std::error::Error>> {
+/// use maplibre_native::{ImageRendererBuilder, RenderPoolBuilder, StyleTemplate};
+///
+/// let style = StyleTemplate::from_path("style.json")?;
+/// let pool = RenderPoolBuilder::new().build(move |_| {
+///     let mut renderer = ImageRendererBuilder::new().build_tile_renderer();
+///     renderer.load_style_template(&style);
+///     renderer
+/// });
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone)]
+pub struct StyleTemplate {
+    json: Arc<str>,
+}
+
+impl Debug for StyleTemplate {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("StyleTemplate").field("len", &self.json.len()).finish()
+    }
+}
+
+impl StyleTemplate {
+    /// A template for the style JSON `json`.
+    ///
+    /// The JSON is not validated here; errors surface when a renderer loads
+    /// it.
+    #[must_use]
+    pub fn from_json_str(json: impl Into<Arc<str>>) -> Self {
+        Self { json: json.into() }
+    }
+
+    /// A template for the style JSON value `value`.
+    ///
+    /// # Errors
+    /// Returns an error if the value cannot be serialized to a JSON string.
+    #[cfg(feature = "json")]
+    pub fn from_json_value(value: &serde_json::Value) -> Result<Self, serde_json::Error> {
+        Ok(Self::from_json_str(serde_json::to_string(value)?))
+    }
+
+    /// Reads the style JSON at `path` once.
+    ///
+    /// # Errors
+    /// Returns an error if the file cannot be read or is not valid UTF-8.
+    pub fn from_path(path: impl AsRef<Path>) -> std::io::Result<Self> {
+        Ok(Self::from_json_str(std::fs::read_to_string(path)?))
+    }
+
+    /// The style JSON.
+    #[must_use]
+    pub fn json(&self) -> &str {
+        &self.json
+    }
+}
+
+impl<S> ImageRenderer<S> {
+    /// Starts loading the style held by `template`.
+    ///
+    /// Wait for the returned request before rendering if you need the load result
+    /// or want to add sources or layers.
+    pub fn load_style_template(&mut self, template: &StyleTemplate) -> StyleLoadRequest<'_, S> {
+        self.load_style_from_json_str(template.json())
+    }
+
+    /// Captures the loaded style as a template, or `None` before a style has
+    /// finished loading or after [`reset`](Self::reset).
+    ///
+    /// Use this to fetch a style by URL in one renderer and hand it to the
+    /// rest. Runtime changes made through [`style`](Self::style), such as added
+    /// layers, are not included.
+    #[must_use]
+    pub fn style_template(&self) -> Option<StyleTemplate> {
+        if !self.style_specified {
+            return None;
+        }
+        let json = self.instance.style_json();
+        (!json.is_empty()).then(|| StyleTemplate::from_json_str(json))
+    }
+}
@@ -0,0 +1,186 @@
+//! A ring of GPU textures that continuous frames are handed off through.
+
+use std::rc::Rc;
+
+use crate::{Continuous, ImageRenderer};
+
+/// Errors returned when handing a frame off through a [`TextureRing`].
+#[derive(thiserror::Error, Debug, Clone, Copy, PartialEq, Eq)]
+#[non_exhaustive]
+pub enum TextureRingError {
+    /// Every slot is still held by a [`RingFrame`]; the frame was dropped.
+    #[error("all {0} texture ring slots are in use")]
+    Exhausted(usize),
+    /// The rendered texture cannot be copied out of.
+    #[error("the rendered texture does not allow copies")]
+    NotCopyable,
+}
+
+/// A fixed set of textures that [`ImageRenderer::take_frame`] copies
+/// rendered frames into, like the images of a swapchain.
+///
+/// Frames stay on the GPU: each hand-off is a texture-to-texture copy
+/// submitted to the queue, instead of a readback through
+/// [`read_still_image`](ImageRenderer::read_still_image). The application
+/// composites frame `k` from its slot while MapLibre Native renders frame
+/// `k + 1` into its own target, and a slot is only reused once its
+/// [`RingFrame`] is dropped.
+///
+/// The copies are ordered against other work on the same queue, so
+/// consumers on that queue need no further synchronization. Others can wait
+/// for [`RingFrame::submission`] with `wgpu::Device::poll`.
+///
+/// # Example
+///
+/// ```no_run
+/// # fn foo(
+/// #     renderer: &mut maplibre_native::ImageRenderer<maplibre_native::Continuous>,
+/// #     device: wgpu::Device,
+/// #     queue: wgpu::Queue,
+/// # ) {
+/// use maplibre_native::TextureRing;
+///
+/// renderer.set_device_queue(device.clone(), queue.clone());
+/// let mut ring = TextureRing::new(device, queue, 3);
+/// renderer.render_once();
+/// if let Some(frame) = renderer.take_frame(&mut ring).unwrap() {
+///     // Sample `frame.texture()` while the next frame renders.
+/// }
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct TextureRing {
+    device: wgpu::Device,
+    queue: wgpu::Queue,
+    slots: Vec<Slot>,
+    len: usize,
+    next: usize,
+}
+
+#[derive(Debug)]
+struct Slot {
+    texture: wgpu::Texture,
+    /// Shared with the [`RingFrame`] handed out for this slot, if any.
+    lease: Rc<()>,
+}
+
+/// A frame in one slot of a [`TextureRing`].
+///
+/// The slot is not written again until this is dropped.
+#[derive(Debug)]
+pub struct RingFrame {
+    texture: wgpu::Texture,
+    index: usize,
+    submission: wgpu::SubmissionIndex,
+    _lease: Rc<()>,
+}
+
+impl RingFrame {
+    /// The texture holding the frame.
+    #[must_use]
+    pub fn texture(&self) -> &wgpu::Texture {
+        &self.texture
+    }
+
+    /// The slot of the ring the frame is in.
+    #[must_use]
+    pub fn index(&self) -> usize {
+        self.index
+    }
+
+    /// The queue submission that copies the frame into its slot.
+    #[must_use]
+    pub fn submission(&self) -> &wgpu::SubmissionIndex {
+        &self.submission
+    }
+}
+
+impl TextureRing {
+    /// Creates a ring of `len` slots on the device and queue passed to
+    /// [`ImageRenderer::set_device_queue`].
+    ///
+    /// The slot textures are allocated with the first frame, and again when
+    /// the frame size or format changes. Two slots double-buffer, a third
+    /// lets the application hold on to a frame for one more render.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `len` is zero.
+    #[must_use]
+    pub fn new(device: wgpu::Device, queue: wgpu::Queue, len: usize) -> Self {
+        assert!(len > 0, "a texture ring needs at least one slot");
+        Self { device, queue, slots: Vec::with_capacity(len), len, next: 0 }
+    }
+
+    /// Copies `source` into the next free slot.
+    fn push(&mut self, source: &wgpu::Texture) -> Result<RingFrame, TextureRingError> {
+        if !source.usage().contains(wgpu::TextureUsages::COPY_SRC) {
+            return Err(TextureRingError::NotCopyable);
+        }
+        let size = source.size();
+        let format = source.format();
+        let stale = self
+            .slots
+            .first()
+            .is_some_and(|slot| slot.texture.size() != size || slot.texture.format() != format);
+        if stale {
+            // Slots still leased keep their texture alive until released.
+            self.slots.clear();
+        }
+        if self.slots.is_empty() {
+            self.slots.extend((0..self.len).map(|_| Slot {
+                texture: self.device.create_texture(&wgpu::TextureDescriptor {
+                    label: Some("maplibre texture ring"),
+                    size,
+                    mip_level_count: 1,
+                    sample_count: 1,
+                    dimension: wgpu::TextureDimension::D2,
+                    format,
+                    usage: wgpu::TextureUsages::TEXTURE_BINDING
+                        | wgpu::TextureUsages::COPY_SRC
+                        | wgpu::TextureUsages::COPY_DST,
+                    view_formats: &[],
+                }),
+                lease: Rc::new(()),
+            }));
+            self.next = 0;
+        }
+
+        let index = (0..self.len)
+            .map(|offset| (self.next + offset) % self.len)
+            .find(|&index| Rc::strong_count(&self.slots[index].lease) == 1)
+            .ok_or(TextureRingError::Exhausted(self.len))?;
+        self.next = (index + 1) % self.len;
+
+        let slot = &self.slots[index];
+        let mut encoder = self.device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+            label: Some("maplibre texture ring copy"),
+        });
+        encoder.copy_texture_to_texture(source.as_image_copy(), slot.texture.as_image_copy(), size);
+        let submission = self.queue.submit([encoder.finish()]);
+        Ok(RingFrame {
+            texture: slot.texture.clone(),
+            index,
+            submission,
+            _lease: Rc::clone(&slot.lease),
+        })
+    }
+}
+
+impl ImageRenderer<Continuous> {
+    /// Hands the latest rendered frame off through `ring`, without reading
+    /// it back to the CPU.
+    ///
+    /// Returns `Ok(None)` if no new frame was rendered since the last call.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error, and drops the frame, if every slot of the ring is
+    /// still held, or if the rendered texture cannot be copied.
+    pub fn take_frame(
+        &mut self,
+        ring: &mut TextureRing,
+    ) -> Result<Option<RingFrame>, TextureRingError> {
+        self.take_texture().map(|texture| ring.push(&texture)).transpose()
+    }
+}
@@ -0,0 +1,370 @@
+//! Columnar feature buffers converted straight into MapLibre Native GeoJSON.
+
+use crate::bridge::geojson;
+use crate::style::geojson::native_error;
+use crate::style::{GeoJson, GeoJsonError};
+
+/// A geometry column in the native GeoArrow layout.
+///
+/// `xy` holds interleaved `x, y` (longitude, latitude) coordinates. Each
+/// offset array has one entry more than the items it splits: item `i` spans
+/// `offsets[i]..offsets[i + 1]` of the level below, so Arrow offset buffers
+/// can be passed as they are, without copying.
+#[derive(Debug, Clone, Copy)]
+#[non_exhaustive]
+pub enum GeometryColumn<'a> {
+    /// One point per coordinate.
+    Point {
+        /// Interleaved coordinates.
+        xy: &'a [f64],
+    },
+    /// Line strings split from the coordinates by `geom_offsets`.
+    LineString {
+        /// Interleaved coordinates.
+        xy: &'a [f64],
+        /// Coordinate offsets of each line string.
+        geom_offsets: &'a [i32],
+    },
+    /// Polygons made of the rings that `ring_offsets` split from the coordinates.
+    Polygon {
+        /// Interleaved coordinates.
+        xy: &'a [f64],
+        /// Ring offsets of each polygon.
+        geom_offsets: &'a [i32],
+        /// Coordinate offsets of each ring.
+        ring_offsets: &'a [i32],
+    },
+    /// Multi-points split from the coordinates by `geom_offsets`.
+    MultiPoint {
+        /// Interleaved coordinates.
+        xy: &'a [f64],
+        /// Coordinate offsets of each multi-point.
+        geom_offsets: &'a [i32],
+    },
+    /// Multi-line strings made of the lines that `part_offsets` split from
+    /// the coordinates.
+    MultiLineString {
+        /// Interleaved coordinates.
+        xy: &'a [f64],
+        /// Line offsets of each multi-line string.
+        geom_offsets: &'a [i32],
+        /// Coordinate offsets of each line.
+        part_offsets: &'a [i32],
+    },
+    /// Multi-polygons made of polygons, each made of rings.
+    MultiPolygon {
+        /// Interleaved coordinates.
+        xy: &'a [f64],
+        /// Polygon offsets of each multi-polygon.
+        geom_offsets: &'a [i32],
+        /// Ring offsets of each polygon.
+        part_offsets: &'a [i32],
+        /// Coordinate offsets of each ring.
+        ring_offsets: &'a [i32],
+    },
+}
+
+/// A property column with one value per feature.
+///
+/// `validity` is an Arrow validity bitmap: bit `i`, least significant bit
+/// first, is set if value `i` is valid. Features with a null value do not get
+/// the property. `None` means every value is valid.
+#[derive(Debug, Clone, Copy)]
+#[non_exhaustive]
+pub enum PropertyColumn<'a> {
+    /// Floating-point numbers.
+    Float64 {
+        /// One value per feature.
+        values: &'a [f64],
+        /// Validity bitmap.
+        validity: Option<&'a [u8]>,
+    },
+    /// Signed integers.
+    Int64 {
+        /// One value per feature.
+        values: &'a [i64],
+        /// Validity bitmap.
+        validity: Option<&'a [u8]>,
+    },
+    /// UTF-8 strings in Arrow's layout: `data` holds the strings back to
+    /// back, and string `i` spans `offsets[i]..offsets[i + 1]`.
+    Utf8 {
+        /// String bytes.
+        data: &'a [u8],
+        /// Byte offsets of each string.
+        offsets: &'a [i32],
+        /// Validity bitmap.
+        validity: Option<&'a [u8]>,
+    },
+}
+
+/// Borrowed feature columns for [`GeoJson::from_columns`].
+///
+/// # Example
+///
+/// ```no_run
+/// use maplibre_native::{FeatureColumns, GeoJson, GeometryColumn, PropertyColumn};
+///
+/// let xy = [0.0, 0.0, 10.0, 5.0];
+/// let speed = [12.5, 30.0];
+/// let columns = FeatureColumns::new(GeometryColumn::Point { xy: &xy })
+///     .with_ids(&[7, 8])
+///     .with_property("speed", PropertyColumn::Float64 { values: &speed, validity: None });
+/// let vehicles = GeoJson::from_columns(&columns).unwrap();
+/// ```
+#[derive(Debug, Clone)]
+pub struct FeatureColumns<'a> {
+    geometry: GeometryColumn<'a>,
+    ids: Option<&'a [u64]>,
+    properties: Vec<(&'a str, PropertyColumn<'a>)>,
+}
+
+impl<'a> FeatureColumns<'a> {
+    /// Starts with the geometry column, which decides the number of features.
+    #[must_use]
+    pub fn new(geometry: GeometryColumn<'a>) -> Self {
+        Self { geometry, ids: None, properties: Vec::new() }
+    }
+
+    /// Sets one id per feature.
+    #[must_use]
+    pub fn with_ids(mut self, ids: &'a [u64]) -> Self {
+        self.ids = Some(ids);
+        self
+    }
+
+    /// Adds a property column named `name`.
+    #[must_use]
+    pub fn with_property(mut self, name: &'a str, column: PropertyColumn<'a>) -> Self {
+        self.properties.push((name, column));
+        self
+    }
+}
+
+impl GeoJson {
+    /// Builds a `FeatureCollection` from columnar buffers, e.g. GeoArrow
+    /// arrays, without going through JSON.
+    ///
+    /// The buffers are read once in place and converted straight into
+    /// MapLibre Native's feature representation.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if `xy` has an odd length, if offsets are negative,
+    /// decrease or point past the data they split, if the id or a property
+    /// column does not hold one value per feature, or if a string column is
+    /// not UTF-8.
+    pub fn from_columns(columns: &FeatureColumns<'_>) -> Result<Self, GeoJsonError> {
+        let mut features = match columns.geometry {
+            GeometryColumn::Point { xy } => geojson::points_from_columns(xy),
+            GeometryColumn::LineString { xy, geom_offsets } => {
+                geojson::line_strings_from_columns(xy, geom_offsets)
+            }
+            GeometryColumn::Polygon { xy, geom_offsets, ring_offsets } => {
+                geojson::polygons_from_columns(xy, geom_offsets, ring_offsets)
+            }
+            GeometryColumn::MultiPoint { xy, geom_offsets } => {
+                geojson::multi_points_from_columns(xy, geom_offsets)
+            }
+            GeometryColumn::MultiLineString { xy, geom_offsets, part_offsets } => {
+                geojson::multi_line_strings_from_columns(xy, geom_offsets, part_offsets)
+            }
+            GeometryColumn::MultiPolygon { xy, geom_offsets, part_offsets, ring_offsets } => {
+                geojson::multi_polygons_from_columns(xy, geom_offsets, part_offsets, ring_offsets)
+            }
+        }
+        .map_err(native_error)?;
+
+        if let Some(ids) = columns.ids {
+            geojson::set_feature_ids(features.pin_mut(), ids).map_err(native_error)?;
+        }
+        for &(name, column) in &columns.properties {
+            match column {
+                PropertyColumn::Float64 { values, validity } => geojson::set_number_property(
+                    features.pin_mut(),
+                    name,
+                    values,
+                    validity.unwrap_or_default(),
+                ),
+                PropertyColumn::Int64 { values, validity } => geojson::set_integer_property(
+                    features.pin_mut(),
+                    name,
+                    values,
+                    validity.unwrap_or_default(),
+                ),
+                PropertyColumn::Utf8 { data, offsets, validity } => {
+                    check_utf8(name, data, offsets)?;
+                    geojson::set_string_property(
+                        features.pin_mut(),
+                        name,
+                        data,
+                        offsets,
+                        validity.unwrap_or_default(),
+                    )
+                }
+            }
+            .map_err(native_error)?;
+        }
+        Ok(Self::from_inner(features))
+    }
+}
+
+/// Checks that `data` is UTF-8 and that every offset in it starts a
+/// character. Offsets past `data` are left to the native side to reject.
+fn check_utf8(name: &str, data: &[u8], offsets: &[i32]) -> Result<(), GeoJsonError> {
+    let text = std::str::from_utf8(data).map_err(|error| {
+        GeoJsonError::Native(format!("string column `{name}` is not valid UTF-8: {error}"))
+    })?;
+    let splits_character = |&offset: &i32| {
+        usize::try_from(offset)
+            .is_ok_and(|offset| offset < text.len() && !text.is_char_boundary(offset))
+    };
+    if offsets.iter().any(splits_character) {
+        return Err(GeoJsonError::Native(format!(
+            "string column `{name}` has an offset inside a UTF-8 character"
+        )));
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{FeatureColumns, GeometryColumn, PropertyColumn};
+    use crate::bridge::geojson::equals_for_test;
+    use crate::{GeoJson, GeoJsonFeatureStore};
+
+    /// Two unit squares and a triangle, as rings of closed coordinates.
+    const XY: [f64; 28] = [
+        0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0, 0.0, 0.0, // square
+        2.0, 0.0, 3.0, 0.0, 3.0, 1.0, 2.0, 1.0, 2.0, 0.0, // square
+        4.0, 0.0, 5.0, 0.0, 4.0, 1.0, 4.0, 0.0, // triangle
+    ];
+    const RINGS: [i32; 4] = [0, 5, 10, 14];
+
+    fn feature_count(geojson: &GeoJson) -> usize {
+        GeoJsonFeatureStore::new().upsert(geojson).expect("features have ids")
+    }
+
+    fn assert_same(actual: &GeoJson, expected: &str) {
+        let expected = expected.parse::<GeoJson>().expect("expected GeoJSON should parse");
+        assert!(
+            equals_for_test(actual.as_inner(), expected.as_inner()),
+            "{actual:?} should equal {expected:?}"
+        );
+    }
+
+    #[test]
+    fn builds_polygons_with_properties() {
+        let names = b"squaretriangle";
+        let geometry =
+            GeometryColumn::Polygon { xy: &XY, geom_offsets: &[0, 2, 3], ring_offsets: &RINGS };
+        let columns = FeatureColumns::new(geometry)
+            .with_ids(&[1, 2])
+            .with_property("area", PropertyColumn::Float64 { values: &[2.5, 0.5], validity: None })
+            .with_property(
+                "rank",
+                PropertyColumn::Int64 { values: &[-3, -4], validity: Some(&[0b01]) },
+            )
+            .with_property(
+                "name",
+                PropertyColumn::Utf8 { data: names, offsets: &[0, 6, 14], validity: Some(&[0b10]) },
+            );
+        let geojson = GeoJson::from_columns(&columns).expect("columns are consistent");
+        assert_eq!(feature_count(&geojson), 2);
+        // Null values leave the property out of their feature.
+        assert_same(
+            &geojson,
+            r#"{"type":"FeatureCollection","features":[
+                {"type":"Feature","id":1,"properties":{"area":2.5,"rank":-3},
+                 "geometry":{"type":"Polygon","coordinates":[
+                    [[0,0],[1,0],[1,1],[0,1],[0,0]],
+                    [[2,0],[3,0],[3,1],[2,1],[2,0]]]}},
+                {"type":"Feature","id":2,"properties":{"area":0.5,"name":"triangle"},
+                 "geometry":{"type":"Polygon","coordinates":[
+                    [[4,0],[5,0],[4,1],[4,0]]]}}
+            ]}"#,
+        );
+    }
+
+    #[test]
+    fn builds_multi_geometries_in_place() {
+        let geometry = GeometryColumn::MultiLineString {
+            xy: &XY[..20],
+            geom_offsets: &[0, 1, 2],
+            part_offsets: &[0, 2, 5],
+        };
+        let geojson = GeoJson::from_columns(&FeatureColumns::new(geometry).with_ids(&[10, 11]))
+            .expect("columns are consistent");
+        assert_same(
+            &geojson,
+            r#"{"type":"FeatureCollection","features":[
+                {"type":"Feature","id":10,"properties":{},
+                 "geometry":{"type":"MultiLineString","coordinates":[[[0,0],[1,0]]]}},
+                {"type":"Feature","id":11,"properties":{},
+                 "geometry":{"type":"MultiLineString","coordinates":[[[1,1],[0,1],[0,0]]]}}
+            ]}"#,
+        );
+    }
+
+    #[test]
+    fn rejects_strings_that_are_not_utf8() {
+        let point = GeometryColumn::Point { xy: &XY[..4] };
+        for (data, offsets) in [
+            (&b"ok\xff"[..], &[0, 2, 3][..]),
+            // Both strings are valid together but not on their own.
+            ("é".as_bytes(), &[0, 1, 2][..]),
+        ] {
+            let columns = FeatureColumns::new(point)
+                .with_property("name", PropertyColumn::Utf8 { data, offsets, validity: None });
+            assert!(GeoJson::from_columns(&columns).is_err(), "{offsets:?} should be rejected");
+        }
+    }
+
+    #[test]
+    fn builds_every_geometry_kind() {
+        let geometries = [
+            GeometryColumn::Point { xy: &XY },
+            GeometryColumn::LineString { xy: &XY, geom_offsets: &[0, 5, 14] },
+            GeometryColumn::MultiPoint { xy: &XY, geom_offsets: &[0, 10, 14] },
+            GeometryColumn::MultiLineString {
+                xy: &XY,
+                geom_offsets: &[0, 3],
+                part_offsets: &RINGS,
+            },
+            GeometryColumn::MultiPolygon {
+                xy: &XY,
+                geom_offsets: &[0, 2],
+                part_offsets: &[0, 2, 3],
+                ring_offsets: &RINGS,
+            },
+        ];
+        let ids: Vec<u64> = (0..14).collect();
+        for (geometry, count) in geometries.into_iter().zip([14, 2, 2, 1, 1]) {
+            let columns = FeatureColumns::new(geometry).with_ids(&ids[..count]);
+            let geojson = GeoJson::from_columns(&columns).expect("columns are consistent");
+            assert_eq!(feature_count(&geojson), count);
+        }
+    }
+
+    #[test]
+    fn rejects_inconsistent_columns() {
+        let point = GeometryColumn::Point { xy: &XY };
+        let invalid = [
+            FeatureColumns::new(GeometryColumn::Point { xy: &XY[..3] }),
+            FeatureColumns::new(GeometryColumn::LineString { xy: &XY, geom_offsets: &[0, 5, 4] }),
+            FeatureColumns::new(GeometryColumn::LineString { xy: &XY, geom_offsets: &[0, 15] }),
+            FeatureColumns::new(GeometryColumn::LineString { xy: &XY, geom_offsets: &[-1, 5] }),
+            FeatureColumns::new(GeometryColumn::LineString { xy: &XY, geom_offsets: &[] }),
+            FeatureColumns::new(point).with_ids(&[1]),
+            FeatureColumns::new(point)
+                .with_property("v", PropertyColumn::Float64 { values: &[1.0], validity: None }),
+            FeatureColumns::new(point).with_property(
+                "v",
+                PropertyColumn::Int64 { values: &[0; 14], validity: Some(&[0xff]) },
+            ),
+        ];
+        for columns in &invalid {
+            assert!(GeoJson::from_columns(columns).is_err(), "{columns:?} should be rejected");
+        }
+    }
+}
@@ -1,5 +1,8 @@
 use std::fmt;
+use std::num::NonZeroUsize;
+use std::path::Path;
 use std::str::FromStr;
+use std::thread;
 
 use cxx::UniquePtr;
 
@@ -13,6 +16,10 @@ pub enum GeoJsonError {
     #[error("GeoJSON error: {0}")]
     Native(String),
 
+    /// The GeoJSON file could not be read.
+    #[error("cannot read GeoJSON file: {0}")]
+    Io(#[from] std::io::Error),
+
     /// The supplied JSON value could not be serialized.
     #[cfg(feature = "json")]
     #[error("invalid JSON: {0}")]
@@ -33,9 +40,92 @@ impl GeoJson {
     ///
     /// Returns an error if MapLibre Native rejects the GeoJSON.
     pub fn from_json_str(json: &str) -> Result<Self, GeoJsonError> {
-        Ok(Self {
-            inner: geojson::parse(json).map_err(|error| GeoJsonError::Native(error.to_string()))?,
-        })
+        Ok(Self { inner: geojson::parse(json).map_err(native_error)? })
+    }
+
+    /// Parses GeoJSON from JSON bytes, e.g. a memory-mapped file.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if MapLibre Native rejects the GeoJSON.
+    pub fn from_slice(json: &[u8]) -> Result<Self, GeoJsonError> {
+        Ok(Self { inner: geojson::parse_bytes(json).map_err(native_error)? })
+    }
+
+    /// Reads and parses a GeoJSON file.
+    ///
+    /// The file is read straight into MapLibre Native's parse buffer, so it is
+    /// held in memory once rather than once in Rust and again in C++.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if `path` is not a UTF-8 path to a readable file, or if
+    /// MapLibre Native rejects the GeoJSON.
+    pub fn from_path(path: impl AsRef<Path>) -> Result<Self, GeoJsonError> {
+        let path = path.as_ref();
+        if !path.is_file() {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::NotFound,
+                format!("Path {} is not a file", path.display()),
+            )
+            .into());
+        }
+        let Some(path) = path.to_str() else {
+            return Err(std::io::Error::new(
+                std::io::ErrorKind::InvalidData,
+                format!("Path {} is not valid UTF-8", path.display()),
+            )
+            .into());
+        };
+        Ok(Self { inner: geojson::parse_file(path).map_err(native_error)? })
+    }
+
+    /// Parses a large `FeatureCollection` on up to `threads` threads.
+    ///
+    /// The `features` array is split into byte-balanced runs of whole
+    /// features, each run is parsed on its own thread, and the results are
+    /// moved into one collection without copying the features. Other GeoJSON
+    /// values, and collections too small to be worth splitting, are parsed on
+    /// the calling thread like [`GeoJson::from_slice`].
+    ///
+    /// # Errors
+    ///
+    /// Returns an error if MapLibre Native rejects the GeoJSON.
+    ///
+    /// # Panics
+    ///
+    /// If a parser thread cannot be spawned.
+    pub fn from_slice_parallel(json: &[u8], threads: NonZeroUsize) -> Result<Self, GeoJsonError> {
+        Self::parse_parallel(json, threads, MIN_CHUNK_BYTES)
+    }
+
+    /// [`from_slice_parallel`](Self::from_slice_parallel) with runs of at
+    /// least about `min_chunk_bytes`.
+    fn parse_parallel(
+        json: &[u8],
+        threads: NonZeroUsize,
+        min_chunk_bytes: usize,
+    ) -> Result<Self, GeoJsonError> {
+        let Some(chunks) = split_features(json, threads.get(), min_chunk_bytes) else {
+            return Self::from_slice(json);
+        };
+        let parsed: Vec<_> = thread::scope(|scope| {
+            let workers: Vec<_> = chunks
+                .into_iter()
+                .map(|chunk| scope.spawn(move || geojson::parse_features(chunk)))
+                .collect();
+            workers
+                .into_iter()
+                .map(|worker| worker.join().expect("GeoJSON parser panicked"))
+                .collect()
+        });
+        let mut parsed = parsed.into_iter();
+        let mut inner = parsed.next().expect("at least one chunk").map_err(native_error)?;
+        for chunk in parsed {
+            geojson::append_features(inner.pin_mut(), chunk.map_err(native_error)?)
+                .map_err(native_error)?;
+        }
+        Ok(Self { inner })
     }
 
     /// Parses GeoJSON from a JSON value.
@@ -61,11 +151,170 @@ impl GeoJson {
     //     geojson::stringify(&self.inner).map_err(|error| GeoJsonError::Native(error.to_string()))
     // }
 
+    pub(super) fn from_inner(inner: UniquePtr<geojson::GeoJson>) -> Self {
+        Self { inner }
+    }
+
     pub(crate) fn as_inner(&self) -> &geojson::GeoJson {
         self.inner.as_ref().expect("GeoJson bridge value is unexpectedly null")
     }
 }
 
+#[allow(clippy::needless_pass_by_value, reason = "passed to `map_err`")]
+pub(super) fn native_error(error: cxx::Exception) -> GeoJsonError {
+    GeoJsonError::Native(error.to_string())
+}
+
+/// Smallest run of features worth parsing on its own thread.
+const MIN_CHUNK_BYTES: usize = 1 << 20;
+
+/// Splits the `features` array of a `FeatureCollection` into at most `chunks`
+/// runs of whole, comma-separated features of roughly equal size, each at
+/// least about `min_chunk_bytes` long.
+///
+/// Returns `None` if `json` is not a `FeatureCollection` this scanner
+/// understands or is too small to split; the caller then parses it whole,
+/// which also reports any syntax errors.
+fn split_features(json: &[u8], chunks: usize, min_chunk_bytes: usize) -> Option<Vec<&[u8]>> {
+    let chunks = chunks.min(json.len() / min_chunk_bytes);
+    if chunks < 2 {
+        return None;
+    }
+    let mut scan = Scanner { json, pos: 0 };
+    let mut features = None;
+    let mut is_collection = false;
+    scan.expect(b'{')?;
+    loop {
+        let key = scan.string()?;
+        scan.expect(b':')?;
+        match key {
+            b"type" => is_collection = scan.string()? == b"FeatureCollection",
+            b"features" => features = Some(scan.elements()?),
+            _ => scan.value()?,
+        }
+        match scan.next()? {
+            b',' => {}
+            b'}' => break,
+            _ => return None,
+        }
+    }
+    let features = features.filter(|_| is_collection)?;
+    let (first, last) = (features.first()?.0, features.last()?.1);
+    let target = (last - first).div_ceil(chunks);
+
+    let mut runs = Vec::with_capacity(chunks);
+    let mut run_start = first;
+    for (index, &(_, end)) in features.iter().enumerate() {
+        if end - run_start >= target || index + 1 == features.len() {
+            runs.push(&json[run_start..end]);
+            if let Some(&(next, _)) = features.get(index + 1) {
+                run_start = next;
+            }
+        }
+    }
+    (runs.len() > 1).then_some(runs)
+}
+
+/// A minimal JSON scanner that finds value boundaries without parsing them.
+struct Scanner<'a> {
+    json: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Scanner<'a> {
+    fn skip_whitespace(&mut self) -> usize {
+        while self.json.get(self.pos).is_some_and(u8::is_ascii_whitespace) {
+            self.pos += 1;
+        }
+        self.pos
+    }
+
+    fn next(&mut self) -> Option<u8> {
+        self.skip_whitespace();
+        let byte = *self.json.get(self.pos)?;
+        self.pos += 1;
+        Some(byte)
+    }
+
+    fn expect(&mut self, byte: u8) -> Option<()> {
+        (self.next()? == byte).then_some(())
+    }
+
+    /// Skips a string and returns its raw contents, escapes included.
+    fn string(&mut self) -> Option<&'a [u8]> {
+        self.expect(b'"')?;
+        let start = self.pos;
+        loop {
+            match *self.json.get(self.pos)? {
+                b'"' => break,
+                b'\\' => self.pos += 2,
+                _ => self.pos += 1,
+            }
+        }
+        self.pos += 1;
+        Some(&self.json[start..self.pos - 1])
+    }
+
+    /// Skips any value.
+    fn value(&mut self) -> Option<()> {
+        match *self.json.get(self.skip_whitespace())? {
+            b'"' => {
+                self.string()?;
+            }
+            b'{' | b'[' => {
+                let mut depth = 0_usize;
+                loop {
+                    match *self.json.get(self.pos)? {
+                        b'"' => {
+                            self.string()?;
+                            continue;
+                        }
+                        b'{' | b'[' => depth += 1,
+                        b'}' | b']' => depth -= 1,
+                        _ => {}
+                    }
+                    self.pos += 1;
+                    if depth == 0 {
+                        break;
+                    }
+                }
+            }
+            _ => {
+                let start = self.pos;
+                while self.json.get(self.pos).is_some_and(|byte| {
+                    !matches!(byte, b',' | b'}' | b']') && !byte.is_ascii_whitespace()
+                }) {
+                    self.pos += 1;
+                }
+                if self.pos == start {
+                    return None;
+                }
+            }
+        }
+        Some(())
+    }
+
+    /// Skips an array and returns the byte range of each element.
+    fn elements(&mut self) -> Option<Vec<(usize, usize)>> {
+        self.expect(b'[')?;
+        let mut elements = Vec::new();
+        if self.json.get(self.skip_whitespace()) == Some(&b']') {
+            self.pos += 1;
+            return Some(elements);
+        }
+        loop {
+            let start = self.skip_whitespace();
+            self.value()?;
+            elements.push((start, self.pos));
+            match self.next()? {
+                b',' => {}
+                b']' => return Some(elements),
+                _ => return None,
+            }
+        }
+    }
+}
+
 #[cfg(feature = "geojson")]
 impl TryFrom<&::geojson::GeoJson> for GeoJson {
     type Error = GeoJsonError;
@@ -108,7 +357,10 @@ impl fmt::Debug for GeoJson {
 
 #[cfg(test)]
 mod tests {
-    use super::GeoJson;
+    use std::num::NonZeroUsize;
+
+    use super::{split_features, GeoJson, GeoJsonError};
+    use crate::bridge::geojson::equals_for_test;
 
     #[test]
     fn clone_survives_original_drop() {
@@ -127,6 +379,80 @@ mod tests {
         assert!("not json".parse::<GeoJson>().is_err());
     }
 
+    #[test]
+    fn split_features_keeps_features_whole() {
+        let json = br#"{"type": "FeatureCollection", "bbox": [0, 0, 1, 1], "features": [
+            {"type": "Feature", "properties": {"name": "a ] \" }"}, "geometry": null},
+            {"type": "Feature", "properties": {"rank": 1.5e3}, "geometry": null} ,
+            {"type": "Feature", "properties": {}, "geometry": {"type": "Point", "coordinates": [1, 2]}}
+        ]}"#;
+        let runs = split_features(json, 3, 1).expect("collection should split");
+        assert!(runs.len() > 1);
+        assert!(runs[0].starts_with(b"{"));
+        assert!(runs[runs.len() - 1].ends_with(b"[1, 2]}}"));
+        for run in runs {
+            GeoJson::from_slice(
+                &[br#"{"type":"FeatureCollection","features":["#, run, b"]}"].concat(),
+            )
+            .expect("each run should be valid features");
+        }
+
+        assert!(split_features(json, 1, 1).is_none());
+        assert!(split_features(br#"{"type":"Feature","geometry":null}"#, 4, 1).is_none());
+        assert!(split_features(br#"{"type":"FeatureCollection","features":[]}"#, 4, 1).is_none());
+        assert!(split_features(br#"{"type":"FeatureCollection","#, 4, 1).is_none());
+    }
+
+    #[test]
+    fn parallel_parse_matches_serial_parse() {
+        let features: Vec<_> = (0..64)
+            .map(|i| format!(r#"{{"type":"Feature","id":{i},"properties":{{"name":"f{i}"}},"geometry":{{"type":"Point","coordinates":[{i},0]}}}}"#))
+            .collect();
+        let json = format!(r#"{{"type":"FeatureCollection","features":[{}]}}"#, features.join(","));
+        let threads = NonZeroUsize::new(4).unwrap();
+        assert!(
+            split_features(json.as_bytes(), threads.get(), 1).is_some_and(|runs| runs.len() > 1)
+        );
+
+        let parallel = GeoJson::parse_parallel(json.as_bytes(), threads, 1).expect("runs parse");
+        let serial = GeoJson::from_slice(json.as_bytes()).expect("collection parses");
+        assert!(equals_for_test(parallel.as_inner(), serial.as_inner()));
+
+        let mut store = crate::GeoJsonFeatureStore::new();
+        assert_eq!(store.upsert(&parallel).expect("parsed features have ids"), 64);
+        assert_eq!(store.len(), 64);
+
+        // Small collections fall back to a serial parse.
+        let fallback = GeoJson::from_slice_parallel(json.as_bytes(), threads).expect("parses");
+        assert!(equals_for_test(fallback.as_inner(), serial.as_inner()));
+    }
+
+    #[test]
+    fn feature_store_keeps_close_fractional_ids_apart() {
+        let geojson = r#"{"type":"FeatureCollection","features":[
+            {"type":"Feature","id":0.1234561,"geometry":null,"properties":{}},
+            {"type":"Feature","id":0.1234564,"geometry":null,"properties":{}},
+            {"type":"Feature","id":1e300,"geometry":null,"properties":{}},
+            {"type":"Feature","id":1.0000000000000002e300,"geometry":null,"properties":{}}
+        ]}"#
+        .parse::<GeoJson>()
+        .expect("fractional ids should parse");
+        let mut store = crate::GeoJsonFeatureStore::new();
+        assert_eq!(store.upsert(&geojson).expect("features have ids"), 4);
+        assert_eq!(store.len(), 4);
+
+        assert!(store.remove(0.123_456_4));
+        assert!(!store.remove(0.123_456_4));
+        assert!(!store.remove(0.123_456), "no feature has this id");
+        assert!(store.remove(1e300));
+        assert_eq!(store.len(), 2);
+    }
+
+    #[test]
+    fn from_path_reports_missing_files() {
+        assert!(matches!(GeoJson::from_path("does-not-exist.geojson"), Err(GeoJsonError::Io(_))));
+    }
+
     #[cfg(feature = "geojson")]
     #[test]
     fn converts_from_geojson_crate_value() {
@@ -0,0 +1,68 @@
+use serde_json::Value;
+
+/// A batch of layer property changes, applied together by
+/// [`StyleRef::set_layer_properties`](crate::StyleRef::set_layer_properties).
+///
+/// Each edit names a layer, a style-spec property and its new value, in the
+/// same JSON form as a style document. Any layer type is supported, and so is
+/// any paint or layout property of it, as well as `filter`, `minzoom`,
+/// `maxzoom` and `visibility`.
+///
+/// # Example
+///
+/// ```no_run
+/// use maplibre_native::LayerEdits;
+/// use serde_json::json;
+///
+/// let mut edits = LayerEdits::new();
+/// edits
+///     .set("roads", "line-width", json!(["interpolate", ["linear"], ["zoom"], 5, 1, 15, 8]))
+///     .set("water", "fill-color", json!("#4a90d9"))
+///     .set("labels", "visibility", json!("none"));
+/// ```
+#[derive(Debug, Clone, Default)]
+pub struct LayerEdits {
+    edits: Vec<(String, String, Value)>,
+}
+
+impl LayerEdits {
+    /// Creates an empty batch.
+    #[must_use]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Adds an edit setting `property` of the layer `layer_id` to `value`.
+    ///
+    /// Edits are applied in order, so a later edit of the same property wins.
+    pub fn set(
+        &mut self,
+        layer_id: impl Into<String>,
+        property: impl Into<String>,
+        value: Value,
+    ) -> &mut Self {
+        self.edits.push((layer_id.into(), property.into(), value));
+        self
+    }
+
+    /// Returns the number of edits in the batch.
+    #[must_use]
+    pub fn len(&self) -> usize {
+        self.edits.len()
+    }
+
+    /// Returns `true` if the batch holds no edits.
+    #[must_use]
+    pub fn is_empty(&self) -> bool {
+        self.edits.is_empty()
+    }
+
+    /// Removes every edit, keeping the allocation for the next batch.
+    pub fn clear(&mut self) {
+        self.edits.clear();
+    }
+
+    pub(crate) fn as_slice(&self) -> &[(String, String, Value)] {
+        &self.edits
+    }
+}
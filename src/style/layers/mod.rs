@@ -1,5 +1,7 @@
 mod any;
 mod circle;
+#[cfg(feature = "json")]
+mod edits;
 mod fill;
 mod id;
 mod line;
@@ -8,6 +10,8 @@ mod traits;
 
 pub use any::{AnyLayer, OpaqueLayer};
 pub use circle::CircleLayer;
+#[cfg(feature = "json")]
+pub use edits::LayerEdits;
 pub use fill::FillLayer;
 pub use id::LayerId;
 pub use line::{LineCap, LineJoin, LineLayer};
@@ -1,6 +1,7 @@
 //! Style abstractions for sources, layers, and images.
 
 mod color;
+mod columns;
 mod error;
 mod geojson;
 mod image;
@@ -11,15 +12,18 @@ mod style_ref;
 mod value;
 
 pub use color::Color;
+pub use columns::{FeatureColumns, GeometryColumn, PropertyColumn};
 pub use error::StyleError;
 pub use geojson::{GeoJson, GeoJsonError};
 pub use image::ImageId;
+#[cfg(feature = "json")]
+pub use layers::LayerEdits;
 pub use layers::{
     AnyLayer, CircleLayer, FillLayer, Layer, LayerId, LineCap, LineJoin, LineLayer, OpaqueLayer,
     SymbolAnchor, SymbolLayer,
 };
 pub use sources::{
-    AnySource, GeoJsonSource, GeoJsonSourceRefMut, OpaqueSource, OpaqueSourceRefMut, Source,
-    SourceId, SourceRefMut, SourceType,
+    AnySource, FeatureId, GeoJsonFeatureStore, GeoJsonSource, GeoJsonSourceRefMut, OpaqueSource,
+    OpaqueSourceRefMut, Source, SourceId, SourceRefMut, SourceType,
 };
 pub use style_ref::StyleRef;
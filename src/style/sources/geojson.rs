@@ -1,10 +1,173 @@
 use std::fmt;
+use std::hash::{Hash, Hasher};
 use std::marker::PhantomData;
+use std::mem;
 
 use cxx::UniquePtr;
 
 use crate::bridge::sources;
-use crate::style::{GeoJson, SourceId};
+use crate::style::{GeoJson, GeoJsonError, SourceId};
+
+/// The id of a GeoJSON feature.
+///
+/// Non-negative [`FeatureId::Signed`] ids name the same feature as the equal
+/// [`FeatureId::Unsigned`] id, as MapLibre Native stores them either way.
+#[derive(Debug, Clone)]
+pub enum FeatureId {
+    /// An unsigned integer id.
+    Unsigned(u64),
+    /// A signed integer id.
+    Signed(i64),
+    /// A floating-point id, such as one with a fraction. It never names a
+    /// feature stored with an integer id. Ids compare by bit pattern, with
+    /// `-0.0` equal to `0.0`.
+    Float(f64),
+    /// A string id.
+    String(String),
+}
+
+impl FeatureId {
+    /// The bits that key a float id, matching the native store.
+    fn float_bits(id: f64) -> u64 {
+        if id == 0.0 { 0.0_f64 } else { id }.to_bits()
+    }
+}
+
+impl PartialEq for FeatureId {
+    fn eq(&self, other: &Self) -> bool {
+        match (self, other) {
+            (Self::Unsigned(a), Self::Unsigned(b)) => a == b,
+            (Self::Signed(a), Self::Signed(b)) => a == b,
+            (Self::Float(a), Self::Float(b)) => Self::float_bits(*a) == Self::float_bits(*b),
+            (Self::String(a), Self::String(b)) => a == b,
+            _ => false,
+        }
+    }
+}
+
+impl Eq for FeatureId {}
+
+impl Hash for FeatureId {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        mem::discriminant(self).hash(state);
+        match self {
+            Self::Unsigned(id) => id.hash(state),
+            Self::Signed(id) => id.hash(state),
+            Self::Float(id) => Self::float_bits(*id).hash(state),
+            Self::String(id) => id.hash(state),
+        }
+    }
+}
+
+impl From<u64> for FeatureId {
+    fn from(id: u64) -> Self {
+        Self::Unsigned(id)
+    }
+}
+
+impl From<i64> for FeatureId {
+    fn from(id: i64) -> Self {
+        Self::Signed(id)
+    }
+}
+
+impl From<f64> for FeatureId {
+    fn from(id: f64) -> Self {
+        Self::Float(id)
+    }
+}
+
+impl From<String> for FeatureId {
+    fn from(id: String) -> Self {
+        Self::String(id)
+    }
+}
+
+impl From<&str> for FeatureId {
+    fn from(id: &str) -> Self {
+        Self::String(id.to_owned())
+    }
+}
+
+/// GeoJSON features keyed by id, for sources that change a few features at a
+/// time.
+///
+/// Adding, replacing and removing features costs O(1) each, independent of how
+/// many features the store holds. Apply the accumulated changes with
+/// [`GeoJsonSource::set_features`] or [`GeoJsonSourceRefMut::set_features`]
+/// once per frame rather than after every change: MapLibre Native re-indexes
+/// the whole source each time its data is set, so applying a batch of changes
+/// costs the same as applying one.
+///
+/// A store that feeds a single source can skip unchanged frames with
+/// `set_features_if_changed`. The store only remembers whether it changed
+/// since its features were last applied anywhere, so give every other source,
+/// and a source that was re-added or rebuilt with its style, the data with
+/// `set_features`.
+pub struct GeoJsonFeatureStore {
+    store: UniquePtr<sources::FeatureStore>,
+}
+
+impl GeoJsonFeatureStore {
+    /// Creates an empty store.
+    #[must_use]
+    pub fn new() -> Self {
+        Self { store: sources::feature_store_new() }
+    }
+
+    /// Inserts the features of a `Feature` or `FeatureCollection`, replacing
+    /// stored features with the same id. Returns the number of features given.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error, and leaves the store unchanged, if `geojson` is a bare
+    /// geometry or contains a feature without an id.
+    pub fn upsert(&mut self, geojson: &GeoJson) -> Result<usize, GeoJsonError> {
+        self.store
+            .pin_mut()
+            .upsert(geojson.as_inner())
+            .map_err(|error| GeoJsonError::Native(error.to_string()))
+    }
+
+    /// Removes the feature with the given id. Returns whether it was stored.
+    pub fn remove(&mut self, id: impl Into<FeatureId>) -> bool {
+        match id.into() {
+            FeatureId::Unsigned(id) => self.store.pin_mut().removeUnsigned(id),
+            FeatureId::Signed(id) => self.store.pin_mut().removeSigned(id),
+            FeatureId::Float(id) => self.store.pin_mut().removeDouble(id),
+            FeatureId::String(id) => self.store.pin_mut().removeString(&id),
+        }
+    }
+
+    /// Removes every feature.
+    pub fn clear(&mut self) {
+        self.store.pin_mut().clear();
+    }
+
+    /// Returns the number of stored features.
+    #[must_use]
+    pub fn len(&self) -> usize {
+        self.store.len()
+    }
+
+    /// Returns `true` if the store holds no features.
+    #[must_use]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+impl Default for GeoJsonFeatureStore {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl fmt::Debug for GeoJsonFeatureStore {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("GeoJsonFeatureStore").field("len", &self.len()).finish()
+    }
+}
 
 /// A GeoJSON source for rendering geographic data.
 pub struct GeoJsonSource {
@@ -33,6 +196,21 @@ impl GeoJsonSource {
         sources::setGeoJson(self.source.pin_mut(), geojson.as_inner());
     }
 
+    /// Sets this source's data to the features of `store`.
+    pub fn set_features(&mut self, store: &GeoJsonFeatureStore) {
+        sources::setFeatures(self.source.pin_mut(), &store.store);
+    }
+
+    /// Sets this source's data to the features of `store` if they changed
+    /// since they were last applied to any source. Returns whether the data
+    /// was set.
+    ///
+    /// Only suits a store that feeds this source alone; see
+    /// [`GeoJsonFeatureStore`].
+    pub fn set_features_if_changed(&mut self, store: &mut GeoJsonFeatureStore) -> bool {
+        sources::setFeaturesIfChanged(self.source.pin_mut(), store.store.pin_mut())
+    }
+
     pub(crate) fn into_inner(self) -> UniquePtr<sources::GeoJSONSource> {
         self.source
     }
@@ -69,6 +247,21 @@ impl GeoJsonSourceRefMut<'_> {
     pub fn set_geojson(&mut self, geojson: &GeoJson) {
         self.source.pin_mut().setGeoJson(geojson.as_inner());
     }
+
+    /// Sets this source's data to the features of `store`.
+    pub fn set_features(&mut self, store: &GeoJsonFeatureStore) {
+        self.source.pin_mut().setFeatures(&store.store);
+    }
+
+    /// Sets this source's data to the features of `store` if they changed
+    /// since they were last applied to any source. Returns whether the data
+    /// was set.
+    ///
+    /// Only suits a store that feeds this source alone; see
+    /// [`GeoJsonFeatureStore`].
+    pub fn set_features_if_changed(&mut self, store: &mut GeoJsonFeatureStore) -> bool {
+        self.source.pin_mut().setFeaturesIfChanged(store.store.pin_mut())
+    }
 }
 
 impl fmt::Debug for GeoJsonSourceRefMut<'_> {
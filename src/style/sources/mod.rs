@@ -5,7 +5,7 @@ mod refs;
 mod traits;
 
 pub use any::{AnySource, OpaqueSource};
-pub use geojson::{GeoJsonSource, GeoJsonSourceRefMut};
+pub use geojson::{FeatureId, GeoJsonFeatureStore, GeoJsonSource, GeoJsonSourceRefMut};
 pub use id::SourceId;
 pub use refs::{OpaqueSourceRefMut, SourceRefMut, SourceType};
 pub use traits::Source;
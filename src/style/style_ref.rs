@@ -1,6 +1,10 @@
 use image::DynamicImage;
 
 use crate::bridge::ffi;
+#[cfg(feature = "json")]
+use crate::style::value::build_layer_edits;
+#[cfg(feature = "json")]
+use crate::LayerEdits;
 use crate::{
     AnyLayer, ImageId, ImageRenderer, Layer, LayerId, Source, SourceId, SourceRefMut, StyleError,
 };
@@ -21,6 +25,9 @@ impl<'a, S> StyleRef<'a, S> {
     /// Pass `true` for `signed_distance_field` to register the image as an SDF (signed
     /// distance field) icon; pass `false` for a regular bitmap icon.
     ///
+    /// The image is converted to straight-alpha RGBA8 and premultiplied on the
+    /// native side, as MapLibre Native expects.
+    ///
     /// # Errors
     ///
     /// Returns an error if MapLibre Native rejects the image.
@@ -122,6 +129,28 @@ impl<'a, S> StyleRef<'a, S> {
         )
     }
 
+    /// Applies a batch of layer property edits in one native call.
+    ///
+    /// This is cheaper than setting properties one by one when many change at
+    /// once, e.g. for theme switches or data-driven restyling, and works for
+    /// every layer type, including those without a typed wrapper. The style
+    /// is redrawn once, on the next render.
+    ///
+    /// # Errors
+    ///
+    /// Returns an error without changing the style if an edit names a layer
+    /// that does not exist. Otherwise every valid edit is applied, and an
+    /// error lists the ones MapLibre Native rejected.
+    #[cfg(feature = "json")]
+    pub fn set_layer_properties(&mut self, edits: &LayerEdits) -> Result<(), StyleError> {
+        if edits.is_empty() {
+            return Ok(());
+        }
+        let edits = build_layer_edits(edits.as_slice())?;
+        self.image_renderer.instance.pin_mut().style_set_layer_properties(&edits)?;
+        Ok(())
+    }
+
     /// Removes a source from the current map style by ID.
     ///
     /// No-op if `source_id` does not match an existing source.
@@ -1,36 +1,191 @@
-//! Builds C++ `StyleValue` trees from `serde_json::Value`.
+//! Builds C++ `StyleDocument`s from `serde_json::Value`.
+//!
+//! The value is serialized into one buffer and decoded by C++ in a single
+//! call, instead of one FFI call and heap allocation per node. The buffer
+//! starts with four native-endian `u32` counts (nodes, array elements, object
+//! members, string bytes) that let C++ reserve its storage up front. The root
+//! value follows in pre-order: a tag byte, then
+//!
+//! - nothing for null, false and true,
+//! - a native-endian `f64` for numbers,
+//! - a `u32` byte length and UTF-8 bytes for strings,
+//! - a `u32` count and the elements for arrays,
+//! - a `u32` count and, per member, a string key and its value for objects.
+//!
+//! Keep the format in sync with `StyleDocument::Decoder` in `style_value.cpp`.
+//!
+//! A batch of layer property edits is encoded the same way, as an array of
+//! `[layer id, property name, value]` arrays.
 
 use cxx::UniquePtr;
 use serde_json::Value;
 
-use crate::bridge::style_value::{self, StyleValue};
+use crate::bridge::style_value::{self, StyleDocument};
 use crate::style::StyleError;
 
-/// Builds an owned `StyleValue` tree mirroring the given JSON value.
-pub(crate) fn build_style_value(value: &Value) -> Result<UniquePtr<StyleValue>, StyleError> {
-    Ok(match value {
-        Value::Null => style_value::make_null(),
-        Value::Bool(b) => style_value::make_bool(*b),
-        Value::Number(n) => {
-            let Some(f) = n.as_f64().filter(|f| f.is_finite()) else {
-                return Err(StyleError::JsonNumber(n.to_string()));
-            };
-            style_value::make_number(f)
+const NULL: u8 = 0;
+const FALSE: u8 = 1;
+const TRUE: u8 = 2;
+const NUMBER: u8 = 3;
+const STRING: u8 = 4;
+const ARRAY: u8 = 5;
+const OBJECT: u8 = 6;
+
+const HEADER_LEN: usize = 16;
+
+/// Builds an owned `StyleDocument` mirroring the given JSON value.
+pub(crate) fn build_style_value(value: &Value) -> Result<UniquePtr<StyleDocument>, StyleError> {
+    let buffer = encode(value)?;
+    Ok(style_value::decode_style_document(&buffer)?)
+}
+
+/// Builds one `StyleDocument` holding a batch of layer property edits.
+pub(crate) fn build_layer_edits(
+    edits: &[(String, String, Value)],
+) -> Result<UniquePtr<StyleDocument>, StyleError> {
+    let mut encoder = Encoder::new();
+    encoder.array(edits.len())?;
+    for (layer_id, property, value) in edits {
+        encoder.array(3)?;
+        encoder.string_value(layer_id)?;
+        encoder.string_value(property)?;
+        encoder.value(value)?;
+    }
+    Ok(style_value::decode_style_document(&encoder.finish())?)
+}
+
+/// Serializes `value` in the format described in the module docs.
+fn encode(value: &Value) -> Result<Vec<u8>, StyleError> {
+    let mut encoder = Encoder::new();
+    encoder.value(value)?;
+    Ok(encoder.finish())
+}
+
+#[derive(Default)]
+struct Encoder {
+    buffer: Vec<u8>,
+    nodes: u32,
+    elements: u32,
+    members: u32,
+    string_bytes: u32,
+}
+
+impl Encoder {
+    fn new() -> Self {
+        Self { buffer: vec![0; HEADER_LEN], ..Self::default() }
+    }
+
+    /// Fills in the header and returns the buffer.
+    fn finish(mut self) -> Vec<u8> {
+        let header = [self.nodes, self.elements, self.members, self.string_bytes];
+        for (slot, count) in self.buffer.chunks_exact_mut(4).zip(header) {
+            slot.copy_from_slice(&count.to_ne_bytes());
         }
-        Value::String(s) => style_value::make_string(s),
-        Value::Array(items) => {
-            let mut arr = style_value::make_array();
-            for item in items {
-                style_value::array_push(arr.pin_mut(), build_style_value(item)?);
+        self.buffer
+    }
+
+    fn value(&mut self, value: &Value) -> Result<(), StyleError> {
+        match value {
+            Value::Null => self.tag(NULL),
+            Value::Bool(b) => self.tag(if *b { TRUE } else { FALSE }),
+            Value::Number(n) => {
+                let Some(f) = n.as_f64().filter(|f| f.is_finite()) else {
+                    return Err(StyleError::JsonNumber(n.to_string()));
+                };
+                self.tag(NUMBER);
+                self.buffer.extend_from_slice(&f.to_ne_bytes());
             }
-            arr
-        }
-        Value::Object(map) => {
-            let mut obj = style_value::make_object();
-            for (key, child) in map {
-                style_value::object_insert(obj.pin_mut(), key, build_style_value(child)?);
+            Value::String(s) => self.string_value(s)?,
+            Value::Array(items) => {
+                self.array(items.len())?;
+                for item in items {
+                    self.value(item)?;
+                }
+            }
+            Value::Object(map) => {
+                self.tag(OBJECT);
+                let count = self.count(map.len())?;
+                self.members = self.members.saturating_add(count);
+                for (key, child) in map {
+                    // Keys are interned by C++, so their bytes are not counted.
+                    self.count(key.len())?;
+                    self.buffer.extend_from_slice(key.as_bytes());
+                    self.value(child)?;
+                }
             }
-            obj
         }
-    })
+        Ok(())
+    }
+
+    /// Starts a node with the given tag.
+    fn tag(&mut self, tag: u8) {
+        self.nodes = self.nodes.saturating_add(1);
+        self.buffer.push(tag);
+    }
+
+    /// Starts an array of `len` elements, which must follow.
+    fn array(&mut self, len: usize) -> Result<(), StyleError> {
+        self.tag(ARRAY);
+        let count = self.count(len)?;
+        self.elements = self.elements.saturating_add(count);
+        Ok(())
+    }
+
+    fn string_value(&mut self, s: &str) -> Result<(), StyleError> {
+        self.tag(STRING);
+        self.string(s)
+    }
+
+    fn string(&mut self, s: &str) -> Result<(), StyleError> {
+        let len = self.count(s.len())?;
+        self.string_bytes = self.string_bytes.saturating_add(len);
+        self.buffer.extend_from_slice(s.as_bytes());
+        Ok(())
+    }
+
+    /// Writes a length or count and returns it.
+    fn count(&mut self, len: usize) -> Result<u32, StyleError> {
+        let count = u32::try_from(len)
+            .map_err(|_| StyleError::Native(format!("style value of length {len} is too large")))?;
+        self.buffer.extend_from_slice(&count.to_ne_bytes());
+        Ok(count)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use serde_json::json;
+
+    use super::{build_layer_edits, build_style_value, encode, HEADER_LEN};
+
+    #[test]
+    fn encodes_header_counts() {
+        let buffer = encode(&json!({"a": [1, "xy", null], "b": true})).unwrap();
+        let header: Vec<u32> = buffer[..HEADER_LEN]
+            .chunks_exact(4)
+            .map(|count| u32::from_ne_bytes(count.try_into().unwrap()))
+            .collect();
+        assert_eq!(header, [6, 3, 2, 2]);
+    }
+
+    #[test]
+    fn decodes_nested_values() {
+        let value = json!({
+            "id": "roads",
+            "type": "line",
+            "filter": ["all", ["==", ["get", "class"], "motorway"], true, null],
+            "paint": {"line-width": 2.5, "line-color": "#fff"},
+            "layout": {}
+        });
+        assert!(build_style_value(&value).is_ok());
+    }
+
+    #[test]
+    fn decodes_layer_edits() {
+        let edits = [
+            ("roads".to_owned(), "line-width".to_owned(), json!(["get", "width"])),
+            ("water".to_owned(), "visibility".to_owned(), json!("none")),
+        ];
+        assert!(build_layer_edits(&edits).is_ok());
+    }
 }
@@ -0,0 +1,124 @@
+//! Native span hooks mapped to the `tracing` crate.
+//!
+//! MapLibre Native reports spans by kind and request id through
+//! [`trace_begin`] and [`trace_end`]. Without the `tracing` feature these are
+//! never called: the native side only reports spans once
+//! [`set_tracing_enabled`] has switched them on.
+
+#[cfg(feature = "tracing")]
+use std::collections::HashMap;
+#[cfg(feature = "tracing")]
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+#[cfg(feature = "tracing")]
+use std::sync::{LazyLock, Mutex, MutexGuard, PoisonError};
+
+#[cfg(feature = "tracing")]
+use crate::bridge::ffi;
+
+// Span kinds, matching `TraceSpan` in `trace.h`.
+#[cfg(feature = "tracing")]
+const FILE_REQUEST: u8 = 0;
+#[cfg(feature = "tracing")]
+const FILE_DELIVERY: u8 = 1;
+#[cfg(feature = "tracing")]
+const RENDER: u8 = 2;
+#[cfg(feature = "tracing")]
+const RENDER_STILL: u8 = 3;
+#[cfg(feature = "tracing")]
+const READBACK: u8 = 4;
+
+#[cfg(feature = "tracing")]
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// Open native spans by kind and request id.
+#[cfg(feature = "tracing")]
+static SPANS: LazyLock<Mutex<HashMap<(u8, u64), tracing::Span>>> = LazyLock::new(Mutex::default);
+
+#[cfg(feature = "tracing")]
+fn spans() -> MutexGuard<'static, HashMap<(u8, u64), tracing::Span>> {
+    SPANS.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+/// Turns the native tracing spans on or off.
+///
+/// While enabled, MapLibre Native reports these spans at `INFO` level, each
+/// with the `id` of its request:
+///
+/// - `file_source.request`: a file source request (with its `url`) until the
+///   Rust [`FileSource`](crate::FileSource) responds.
+/// - `file_source.delivery`: that response until the renderer's run loop
+///   hands it to MapLibre Native.
+/// - `render`: a submitted render until its image has been read back.
+/// - `render.still`: a render from the moment it leaves the queue until the
+///   frame is drawn, which includes waiting for its resources.
+/// - `render.readback`: reading the frame back from the GPU.
+/// - `style_load`: a style load until it finishes or fails.
+///
+/// Spans start with no parent, so file source requests are not nested under
+/// the renders that need them; correlate them by time. While disabled, each
+/// hook costs one atomic load.
+#[cfg(feature = "tracing")]
+pub fn set_tracing_enabled(enabled: bool) {
+    // Spans that are already open still end after disabling.
+    ENABLED.store(enabled, Ordering::Relaxed);
+    ffi::setTraceEnabled(enabled);
+}
+
+/// Opens a native span.
+pub(crate) fn trace_begin(kind: u8, id: u64, detail: &str) {
+    #[cfg(not(feature = "tracing"))]
+    let _ = (kind, id, detail);
+
+    #[cfg(feature = "tracing")]
+    {
+        let span = match kind {
+            FILE_REQUEST => tracing::info_span!("file_source.request", id, url = detail),
+            FILE_DELIVERY => tracing::info_span!("file_source.delivery", id),
+            RENDER => tracing::info_span!("render", id),
+            RENDER_STILL => tracing::info_span!("render.still", id),
+            READBACK => tracing::info_span!("render.readback", id),
+            _ => return,
+        };
+        spans().insert((kind, id), span);
+    }
+}
+
+/// Closes a native span; ids that were never opened are ignored.
+pub(crate) fn trace_end(kind: u8, id: u64) {
+    #[cfg(not(feature = "tracing"))]
+    let _ = (kind, id);
+
+    #[cfg(feature = "tracing")]
+    {
+        // Close the span outside the lock, the subscriber runs on drop.
+        let span = spans().remove(&(kind, id));
+        drop(span);
+    }
+}
+
+/// A style load span, closed once the load finishes or fails.
+#[derive(Clone, Default)]
+pub(crate) struct StyleLoadTrace {
+    #[cfg(feature = "tracing")]
+    span: std::rc::Rc<std::cell::RefCell<Option<tracing::Span>>>,
+}
+
+impl StyleLoadTrace {
+    /// Opens the span if tracing is enabled.
+    pub(crate) fn begin() -> Self {
+        #[cfg(feature = "tracing")]
+        if ENABLED.load(Ordering::Relaxed) {
+            static NEXT_ID: AtomicU64 = AtomicU64::new(1);
+            let id = NEXT_ID.fetch_add(1, Ordering::Relaxed);
+            let span = tracing::info_span!("style_load", id);
+            return Self { span: std::rc::Rc::new(std::cell::RefCell::new(Some(span))) };
+        }
+        Self::default()
+    }
+
+    /// Closes the span; later calls do nothing.
+    pub(crate) fn end(&self) {
+        #[cfg(feature = "tracing")]
+        self.span.borrow_mut().take();
+    }
+}
@@ -9,7 +9,8 @@ use std::time::{Duration, Instant};
 
 use maplibre_native::{
     CameraUpdate, Color, Continuous, EdgeInsets, FillLayer, GeoJson, GeoJsonSource, ImageRenderer,
-    ImageRendererBuilder, LatLng, LatLngBounds, MapLoadErrorKind, RunLoopHandle, Static, Tile,
+    ImageRendererBuilder, LatLng, LatLngBounds, MapLoadErrorKind, MemoryBudget, RenderRequest,
+    RenderingError, RunLoopHandle, Static, Tile, TileCoord,
 };
 
 const RENDER_TIMEOUT: Duration = Duration::from_secs(5);
@@ -129,6 +130,36 @@ fn load_style_from_json_str_renders() {
     assert_eq!(image.as_image().height(), 128);
 }
 
+#[test]
+fn uniform_frames_report_their_colour() {
+    let mut renderer = tile_renderer();
+    renderer.load_style_from_json_str(
+        r##"{"version": 8, "sources": {}, "layers": [
+            {"id": "background", "type": "background", "paint": {"background-color": "#336699"}}
+        ]}"##,
+    );
+
+    let request = renderer.submit_render_tile(3, 2, 5).expect("tile render should submit");
+    tick_until_ready(|| request.is_ready());
+    assert_eq!(request.uniform_color(), Some([0x33, 0x66, 0x99, 0xff]));
+    let image = request.finish_image_ptr().expect("tile renderer should render");
+    assert_eq!(image.uniform_color(), Some([0x33, 0x66, 0x99, 0xff]));
+
+    renderer.load_style_from_json_str(
+        r##"{"version": 8, "sources": {"west": {"type": "geojson", "data": {"type": "Polygon",
+            "coordinates": [[[-180, -80], [0, -80], [0, 80], [-180, 80], [-180, -80]]]}}},
+        "layers": [
+            {"id": "background", "type": "background", "paint": {"background-color": "#336699"}},
+            {"id": "west", "type": "fill", "source": "west", "paint": {"fill-color": "#000000"}}
+        ]}"##,
+    );
+    let image = renderer
+        .submit_render_tile(0, 0, 0)
+        .and_then(RenderRequest::wait_image_ptr)
+        .expect("tile renderer should render");
+    assert_eq!(image.uniform_color(), None);
+}
+
 #[cfg(feature = "json")]
 #[test]
 fn load_style_from_json_value_loads() {
@@ -143,6 +174,134 @@ fn load_style_from_json_value_loads() {
         .expect("JSON style should load");
 }
 
+#[test]
+fn style_template_loads_into_other_renderers() {
+    let mut source = static_renderer();
+    assert!(source.style_template().is_none());
+    source
+        .load_style_from_path(fixture_path("test-style.json"))
+        .expect("test style path should be valid")
+        .wait()
+        .expect("style should load");
+    let template = source.style_template().expect("a loaded style yields a template");
+
+    // Templates are shared across threads, one renderer per thread.
+    let colour = thread::spawn(move || {
+        let mut renderer = static_renderer();
+        renderer.load_style_template(&template).wait().expect("template should load");
+        let request = renderer.submit_render_static(&test_camera()).expect("render should submit");
+        tick_until_ready(|| request.is_ready());
+        request.uniform_color()
+    })
+    .join()
+    .expect("render thread should not panic");
+    assert_eq!(colour, Some([0xff, 0x00, 0xf0, 0xff]));
+}
+
+#[test]
+fn completed_renders_report_stats() {
+    let mut renderer = tile_renderer();
+    renderer
+        .load_style_from_json_str(include_str!("fixtures/test-style.json"))
+        .wait()
+        .expect("style should load");
+
+    let mut queue = renderer.render_queue().expect("style is loaded");
+    let first = queue.push_tile(0, 0, 0);
+    let second = queue.push_tile(1, 1, 1);
+    assert_eq!(first.stats(), None);
+    tick_until_ready(|| first.is_ready() && second.is_ready());
+
+    let stats = second.stats().expect("a finished render has stats");
+    assert!(stats.style_load.is_some());
+    // The second render waited for the first one on the same renderer.
+    assert!(stats.queued > Duration::ZERO, "{stats:?}");
+    assert!(stats.frame > Duration::ZERO, "{stats:?}");
+    assert!(stats.readback > Duration::ZERO, "{stats:?}");
+    assert!(stats.draw_calls > 0, "{stats:?}");
+    assert!(stats.total() <= RENDER_TIMEOUT);
+    first.finish_image_ptr().expect("tile renderer should render");
+    second.finish_image_ptr().expect("tile renderer should render");
+}
+
+#[test]
+fn renders_over_memory_budget_evict_caches() {
+    let mut renderer = ImageRendererBuilder::new()
+        .with_size(NonZeroU32::new(128).unwrap(), NonZeroU32::new(128).unwrap())
+        .with_pixel_ratio(1.0)
+        .with_memory_budget(MemoryBudget::new(1).with_tile_cache(false))
+        .build_tile_renderer();
+    renderer.load_style_from_json_str(include_str!("fixtures/test-style.json"));
+    let request = renderer.submit_render_tile(0, 0, 0).expect("tile render should submit");
+    tick_until_ready(|| request.is_ready());
+    request.finish_image_ptr().expect("tile renderer should render");
+
+    // The render target alone exceeds a one-byte budget.
+    let usage = renderer.memory_usage();
+    assert!(usage.gpu_bytes() > 1);
+    assert_eq!(usage.held_image_bytes, 0);
+    assert_eq!(usage.evictions, 1);
+}
+
+#[test]
+fn unclaimed_frames_do_not_evict_caches() {
+    let build = |budget: Option<MemoryBudget>| {
+        let mut builder = ImageRendererBuilder::new()
+            .with_size(NonZeroU32::new(128).unwrap(), NonZeroU32::new(128).unwrap())
+            .with_pixel_ratio(1.0);
+        if let Some(budget) = budget {
+            builder = builder.with_memory_budget(budget);
+        }
+        let mut renderer = builder.build_tile_renderer();
+        renderer.load_style_from_json_str(include_str!("fixtures/test-style.json"));
+        renderer
+    };
+    let mut unbounded = build(None);
+    unbounded.render_tile(0, 0, 0).expect("tile renderer should render");
+    let gpu_bytes = unbounded.memory_usage().gpu_bytes();
+
+    // Room for the GPU memory and one frame, but not for the three frames
+    // the queue holds before they are collected.
+    let frame_bytes = 128 * 128 * 4;
+    let mut renderer = build(Some(MemoryBudget::new(gpu_bytes + frame_bytes)));
+    {
+        let mut queue = renderer.render_queue().expect("style should be set");
+        let requests: Vec<_> = (0..3).map(|_| queue.push_tile(0, 0, 0)).collect();
+        tick_until_ready(|| requests.iter().all(RenderRequest::is_ready));
+    }
+    let usage = renderer.memory_usage();
+    assert_eq!(usage.held_image_bytes, 0, "dropped requests release their frames");
+    assert_eq!(usage.evictions, 0, "only GPU memory counts against the budget");
+}
+
+#[test]
+fn reset_renderer_accepts_a_new_style() {
+    let mut renderer = tile_renderer();
+    renderer.load_style_from_json_str(include_str!("fixtures/test-style.json"));
+    let request = renderer.submit_render_tile(0, 0, 0).expect("tile render should submit");
+    tick_until_ready(|| request.is_ready());
+    assert_eq!(request.uniform_color(), Some([0xff, 0x00, 0xf0, 0xff]));
+    drop(request);
+
+    for keep_caches in [true, false] {
+        renderer.reset(keep_caches);
+        assert!(renderer.style_template().is_none());
+        assert!(matches!(
+            renderer.submit_render_tile(0, 0, 0),
+            Err(RenderingError::StyleNotSpecified)
+        ));
+
+        renderer.load_style_from_json_str(
+            r##"{"version": 8, "sources": {}, "layers": [
+                {"id": "background", "type": "background", "paint": {"background-color": "#336699"}}
+            ]}"##,
+        );
+        let request = renderer.submit_render_tile(1, 0, 1).expect("tile render should submit");
+        tick_until_ready(|| request.is_ready());
+        assert_eq!(request.uniform_color(), Some([0x33, 0x66, 0x99, 0xff]));
+    }
+}
+
 #[test]
 fn style_load_request_polls_to_completion() {
     let mut renderer = static_renderer();
@@ -169,6 +328,85 @@ fn tile_render_request_renders() {
     assert_eq!(image.as_image().height(), 128);
 }
 
+#[test]
+fn image_ptr_readback_matches_owned_image() {
+    let mut renderer = tile_renderer();
+
+    renderer
+        .load_style_from_path(fixture_path("test-style.json"))
+        .expect("test style path should be valid");
+
+    let image = renderer
+        .submit_render_tile(0, 0, 0)
+        .expect("tile render should submit")
+        .wait_image_ptr()
+        .expect("tile renderer should render");
+    assert_eq!(image.size().width, 128);
+    assert_eq!(image.size().height, 128);
+    assert_eq!(image.buffer().len(), 128 * 128 * 4);
+
+    let owned = renderer.render_tile(0, 0, 0).expect("tile renderer should render");
+    assert_eq!(image.to_image().expect("buffer should match size"), owned);
+}
+
+#[test]
+fn render_queue_completes_in_order() {
+    let mut renderer = tile_renderer();
+
+    renderer
+        .load_style_from_path(fixture_path("test-style.json"))
+        .expect("test style path should be valid");
+
+    let mut queue = renderer.render_queue().expect("style should be specified");
+    let requests: Vec<_> =
+        [(0, 0), (1, 0), (0, 1), (1, 1)].map(|(x, y)| queue.push_tile(1, x, y)).into();
+    tick_until_ready(|| requests.iter().all(|request| request.is_ready()));
+    let queued: Vec<_> = requests
+        .into_iter()
+        .map(|request| request.finish().expect("queued tile should render"))
+        .collect();
+
+    for (image, (x, y)) in queued.iter().zip([(0, 0), (1, 0), (0, 1), (1, 1)]) {
+        let single = renderer.render_tile(1, x, y).expect("tile renderer should render");
+        assert_eq!(image, &single);
+    }
+}
+
+#[test]
+fn render_queue_requires_style() {
+    let mut renderer = tile_renderer();
+    assert!(renderer.render_queue().is_err());
+}
+
+#[test]
+fn metatile_slices_into_tile_views() {
+    let mut renderer = tile_renderer();
+
+    renderer
+        .load_style_from_path(fixture_path("test-style.json"))
+        .expect("test style path should be valid");
+
+    let metatile = renderer
+        .render_metatile(2, 3, 1, NonZeroU32::new(2).unwrap())
+        .expect("metatile should render");
+    assert_eq!(metatile.origin(), TileCoord::new(2, 2, 0));
+    assert_eq!(metatile.image().size().width, 256);
+
+    let views: Vec<_> = metatile.tiles().collect();
+    assert_eq!(views.len(), 4);
+    for view in &views {
+        assert_eq!(view.size().width, 128);
+        assert_eq!(view.rows().count(), 128);
+        assert_eq!(view.to_image().as_image().dimensions(), (128, 128));
+    }
+    assert_eq!(views[3].coord(), TileCoord::new(2, 3, 1));
+    assert!(metatile.tile(0, 0).is_none());
+
+    // The next regular render goes back to the tile size.
+    let image = renderer.render_tile(2, 3, 1).expect("tile renderer should render");
+    assert_eq!(image.as_image().dimensions(), (128, 128));
+}
+
 #[test]
 fn camera_for_bounds_renders() {
     let mut renderer = static_renderer();
@@ -0,0 +1,134 @@
+//! Integration tests for the multi-threaded render pool.
+
+use std::num::{NonZeroU32, NonZeroUsize};
+use std::path::PathBuf;
+use std::sync::mpsc;
+
+use maplibre_native::{
+    ImageRendererBuilder, RenderPool, RenderPoolBuilder, RenderPoolError, TileCoord,
+};
+
+fn fixture_path(name: &str) -> PathBuf {
+    PathBuf::from(env!("CARGO_MANIFEST_DIR")).join("tests").join("fixtures").join(name)
+}
+
+fn pool(workers: usize, queue_capacity: usize) -> RenderPool {
+    RenderPoolBuilder::new()
+        .with_workers(NonZeroUsize::new(workers).unwrap())
+        .with_queue_capacity(queue_capacity)
+        .build(|_| {
+            let mut renderer = ImageRendererBuilder::new()
+                .with_size(NonZeroU32::new(64).unwrap(), NonZeroU32::new(64).unwrap())
+                .with_pixel_ratio(1.0)
+                .build_tile_renderer();
+            renderer
+                .load_style_from_path(fixture_path("test-style.json"))
+                .expect("test style path should be valid")
+                .wait()
+                .expect("test style should load");
+            renderer
+        })
+}
+
+#[test]
+fn renders_tiles_on_workers() {
+    let pool = pool(2, 64);
+    let (sender, receiver) = mpsc::channel();
+    for x in 0..4 {
+        for y in 0..4 {
+            let sender = sender.clone();
+            pool.submit_tile(TileCoord::new(2, x, y), move |result| {
+                sender.send(result).unwrap();
+            })
+            .expect("queue should have room");
+        }
+    }
+    drop(sender);
+
+    let images: Vec<_> = receiver.iter().collect();
+    assert_eq!(images.len(), 16);
+    for image in images {
+        let image = image.expect("tile should render");
+        assert_eq!(image.size().width, 64);
+        assert_eq!(image.size().height, 64);
+    }
+}
+
+#[test]
+fn blocking_render_matches_size() {
+    let pool = pool(1, 4);
+    let image = pool.render_tile(TileCoord::new(0, 0, 0)).expect("tile should render");
+    assert_eq!(image.buffer().len(), 64 * 64 * 4);
+}
+
+#[test]
+fn rejects_jobs_beyond_capacity() {
+    let pool = pool(1, 0);
+    let result = pool.submit_tile(TileCoord::new(0, 0, 0), |_| {});
+    assert!(matches!(result, Err(RenderPoolError::QueueFull)));
+}
+
+#[test]
+fn cancelled_jobs_do_not_render() {
+    let pool = pool(1, 64);
+    let (sender, receiver) = mpsc::channel();
+    let handles: Vec<_> = (0..8)
+        .map(|x| {
+            let sender = sender.clone();
+            pool.submit_tile(TileCoord::new(3, x, 0), move |result| {
+                sender.send(result).unwrap();
+            })
+            .expect("queue should have room")
+        })
+        .collect();
+    drop(sender);
+    for handle in &handles {
+        handle.cancel();
+    }
+
+    let results: Vec<_> = receiver.iter().collect();
+    assert_eq!(results.len(), 8);
+    // The worker may already have started the first jobs.
+    let cancelled =
+        results.iter().filter(|result| matches!(result, Err(RenderPoolError::Cancelled))).count();
+    assert!(cancelled >= 6, "only {cancelled} of 8 jobs were cancelled");
+}
+
+#[test]
+fn workers_whose_factory_panics_leave_the_pool() {
+    let pool = RenderPoolBuilder::new()
+        .with_workers(NonZeroUsize::new(2).unwrap())
+        .with_locality_levels(0)
+        .build(|index| {
+            assert_ne!(index, 0, "first worker fails to start");
+            let mut renderer = ImageRendererBuilder::new()
+                .with_size(NonZeroU32::new(64).unwrap(), NonZeroU32::new(64).unwrap())
+                .with_pixel_ratio(1.0)
+                .build_tile_renderer();
+            renderer.load_style_from_path(fixture_path("test-style.json")).unwrap().wait().unwrap();
+            renderer
+        });
+    for x in 0..8 {
+        pool.render_tile(TileCoord::new(3, x, 0)).expect("the other worker renders every tile");
+    }
+}
+
+#[test]
+fn jobs_fail_once_every_factory_panicked() {
+    let pool = RenderPoolBuilder::new()
+        .with_workers(NonZeroUsize::new(1).unwrap())
+        .build(|_| panic!("no renderer"));
+    let (sender, receiver) = mpsc::channel();
+    // Queued before or after the worker gave up, the job must still complete.
+    let submitted = pool.submit_tile(TileCoord::new(0, 0, 0), move |result| {
+        sender.send(result).unwrap();
+    });
+    match submitted {
+        Ok(_) => assert!(matches!(receiver.recv(), Ok(Err(RenderPoolError::WorkerPanicked)))),
+        Err(error) => assert!(matches!(error, RenderPoolError::WorkerPanicked)),
+    }
+    assert!(matches!(
+        pool.render_tile(TileCoord::new(0, 0, 0)),
+        Err(RenderPoolError::WorkerPanicked)
+    ));
+}
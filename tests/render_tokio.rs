@@ -0,0 +1,38 @@
+//! Awaiting style loads and renders on a Tokio current-thread runtime.
+
+use std::num::NonZeroU32;
+use std::path::PathBuf;
+
+use maplibre_native::{CameraUpdate, ImageRenderer, ImageRendererBuilder, LatLng, Static};
+
+fn fixture_path(name: &str) -> PathBuf {
+    PathBuf::from(env!("CARGO_MANIFEST_DIR")).join("tests").join("fixtures").join(name)
+}
+
+fn renderer() -> ImageRenderer<Static> {
+    ImageRendererBuilder::new()
+        .with_size(NonZeroU32::new(64).unwrap(), NonZeroU32::new(64).unwrap())
+        .with_pixel_ratio(1.0)
+        .build_static_renderer()
+}
+
+async fn render(renderer: &mut ImageRenderer<Static>, lng: f64) -> [u8; 4] {
+    renderer
+        .load_style_from_path(fixture_path("test-style.json"))
+        .expect("test style path is valid")
+        .await
+        .expect("style loaded");
+    let camera = CameraUpdate::new().center(LatLng { lat: 0.0, lng }).zoom(0.0);
+    let image = renderer.submit_render_static(&camera).expect("style is loaded").await;
+    image.expect("render").as_image().get_pixel(32, 32).0
+}
+
+#[tokio::test]
+async fn renders_share_one_thread() {
+    let (mut first, mut second) = (renderer(), renderer());
+    let (a, b) = futures::join!(render(&mut first, 0.0), render(&mut second, 90.0));
+    // The test style is a `#ff00f0` background.
+    for pixel in [a, b] {
+        assert_eq!(pixel, [0xff, 0x00, 0xf0, 0xff]);
+    }
+}
@@ -0,0 +1,81 @@
+//! Integration tests for tile pyramid seeding.
+
+use std::fs;
+use std::num::{NonZeroU32, NonZeroUsize};
+use std::path::PathBuf;
+
+use maplibre_native::{
+    DirectorySink, EncodeFormat, EncoderPool, ImageRendererBuilder, LatLng, LatLngBounds,
+    PngCompression, RenderPool, RenderPoolBuilder, SeedPlan, Seeder, TileCoord,
+};
+
+const WORLD: LatLngBounds = LatLngBounds {
+    southwest: LatLng { lat: -85.0, lng: -180.0 },
+    northeast: LatLng { lat: 85.0, lng: 180.0 },
+};
+
+fn fixture_path(name: &str) -> PathBuf {
+    PathBuf::from(env!("CARGO_MANIFEST_DIR")).join("tests").join("fixtures").join(name)
+}
+
+fn scratch_dir(name: &str) -> PathBuf {
+    let dir = std::env::temp_dir().join(format!("mln-seed-{name}-{}", std::process::id()));
+    let _ = fs::remove_dir_all(&dir);
+    fs::create_dir_all(&dir).unwrap();
+    dir
+}
+
+fn pool() -> RenderPool {
+    RenderPoolBuilder::new().with_workers(NonZeroUsize::new(2).unwrap()).build(|_| {
+        let mut renderer = ImageRendererBuilder::new()
+            .with_size(NonZeroU32::new(64).unwrap(), NonZeroU32::new(64).unwrap())
+            .with_pixel_ratio(1.0)
+            .build_tile_renderer();
+        renderer
+            .load_style_from_path(fixture_path("test-style.json"))
+            .expect("test style path should be valid")
+            .wait()
+            .expect("test style should load");
+        renderer
+    })
+}
+
+#[test]
+fn seeds_metatiles_to_directory_and_resumes() {
+    let dir = scratch_dir("resume");
+    let format = EncodeFormat::Png(PngCompression::Fast);
+    let plan = SeedPlan::new(WORLD, 0..=2).with_metatile_size(NonZeroU32::new(2).unwrap());
+    let seeder = Seeder::new(plan).with_format(format).with_checkpoint(dir.join("checkpoint"));
+    let pool = pool();
+    let encoder = EncoderPool::new(NonZeroUsize::new(2).unwrap());
+    let mut sink = DirectorySink::new(dir.join("tiles"), format);
+
+    let report = seeder.run(&pool, &encoder, &mut sink).expect("seeding should succeed");
+    assert_eq!(report.written_tiles, 1 + 4 + 16);
+    // One render at z0 and z1, four 2×2 blocks at z2.
+    assert_eq!(report.rendered_units, 1 + 1 + 4);
+    let tile = fs::read(sink.tile_path(TileCoord::new(2, 3, 3))).expect("tile should be written");
+    assert_eq!(&tile[..4], b"\x89PNG");
+
+    let resumed = seeder.run(&pool, &encoder, &mut sink).expect("resume should succeed");
+    assert_eq!(resumed.resumed_units, 6);
+    assert_eq!(resumed.rendered_units, 0);
+
+    let _ = fs::remove_dir_all(dir);
+}
+
+#[test]
+fn filter_skips_tiles() {
+    let dir = scratch_dir("filter");
+    let seeder = Seeder::new(SeedPlan::new(WORLD, 1..=1)).with_filter(|tile| tile.x == 0);
+    let mut sink = DirectorySink::new(&dir, EncodeFormat::WebP);
+
+    let report = seeder
+        .run(&pool(), &EncoderPool::new(NonZeroUsize::MIN), &mut sink)
+        .expect("seeding should succeed");
+    assert_eq!(report.written_tiles, 2);
+    assert_eq!(report.skipped_tiles, 2);
+    assert!(!sink.tile_path(TileCoord::new(1, 1, 0)).exists());
+
+    let _ = fs::remove_dir_all(dir);
+}
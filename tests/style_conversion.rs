@@ -6,8 +6,9 @@ use std::path::PathBuf;
 
 use maplibre_native::{
     AnyLayer, AnySource, CameraUpdate, GeoJson, GeoJsonSource, ImageRendererBuilder, LatLng,
-    StyleError,
+    LayerEdits, StyleError,
 };
+use serde_json::json;
 
 fn fixture_path(name: &str) -> PathBuf {
     PathBuf::from(env!("CARGO_MANIFEST_DIR")).join("tests").join("fixtures").join(name)
@@ -258,3 +259,43 @@ fn add_layer_from_json_renders() {
     });
     assert!(saw_green, "added fill layer did not render");
 }
+
+#[test]
+fn set_layer_properties_applies_batched_edits() {
+    let mut renderer = ImageRendererBuilder::new()
+        .with_size(NonZeroU32::new(128).unwrap(), NonZeroU32::new(128).unwrap())
+        .with_pixel_ratio(1.0)
+        .build_static_renderer();
+    renderer
+        .load_style_from_path(fixture_path("test-style.json"))
+        .expect("test style path is valid")
+        .wait()
+        .expect("style loaded");
+
+    let mut style = renderer.style();
+    // A missing layer rejects the whole batch, so the background stays pink.
+    let mut edits = LayerEdits::new();
+    edits.set("background", "background-color", json!("#00ff00"));
+    edits.set("missing", "fill-color", json!("#00ff00"));
+    let err = style.set_layer_properties(&edits).expect_err("missing layer must error");
+    assert!(matches!(err, StyleError::Native(_)), "unexpected error: {err:?}");
+
+    // Later edits of the same property win; invalid values are reported after
+    // the valid edits have been applied.
+    edits.clear();
+    edits
+        .set("background", "background-color", json!("#00ff00"))
+        .set("background", "background-color", json!("#0000ff"))
+        .set("background", "background-opacity", json!("opaque"));
+    let err = style.set_layer_properties(&edits).expect_err("invalid value must error");
+    assert!(err.to_string().contains("background-opacity"), "unexpected error: {err}");
+
+    let camera =
+        CameraUpdate::new().center(LatLng { lat: 0.0, lng: 0.0 }).zoom(0.0).bearing(0.0).pitch(0.0);
+    let image = renderer.render_static(&camera).expect("render");
+    let all_blue = image.as_image().pixels().all(|p| {
+        let [r, g, b, a] = p.0;
+        a >= 250 && i32::from(b) > i32::from(r) + 20 && i32::from(b) > i32::from(g) + 20
+    });
+    assert!(all_blue, "batched background color was not applied");
+}
@@ -4,8 +4,9 @@ use std::num::NonZeroU32;
 use std::path::PathBuf;
 
 use maplibre_native::{
-    CameraUpdate, CircleLayer, Color, FillLayer, GeoJson, GeoJsonSource, ImageRenderer,
-    ImageRendererBuilder, LatLng, LineCap, LineJoin, LineLayer, SourceRefMut, Static,
+    CameraUpdate, CircleLayer, Color, FeatureId, FillLayer, GeoJson, GeoJsonFeatureStore,
+    GeoJsonSource, ImageRenderer, ImageRendererBuilder, LatLng, LineCap, LineJoin, LineLayer,
+    SourceRefMut, Static,
 };
 
 fn fixture_path(name: &str) -> PathBuf {
@@ -173,6 +174,84 @@ fn geojson_source_ref_mut_updates_existing_source() {
     assert_eq!(image.height(), 128);
 }
 
+fn square_feature(id: &str, west: f64, east: f64) -> GeoJson {
+    format!(
+        r#"{{
+            "type": "Feature",
+            "id": "{id}",
+            "properties": {{}},
+            "geometry": {{
+                "type": "Polygon",
+                "coordinates": [[[{west}, -45.0], [{east}, -45.0], [{east}, 45.0], [{west}, 45.0], [{west}, -45.0]]]
+            }}
+        }}"#
+    )
+    .parse::<GeoJson>()
+    .expect("inline GeoJSON should parse")
+}
+
+#[test]
+fn geojson_feature_store_applies_incremental_updates() {
+    let mut renderer = renderer();
+
+    let mut features = GeoJsonFeatureStore::new();
+    assert_eq!(features.upsert(&square_feature("center", -45.0, 45.0)).unwrap(), 1);
+    assert_eq!(features.upsert(&square_feature("east", 100.0, 120.0)).unwrap(), 1);
+    assert!(features.upsert(&overlay_geojson()).is_err(), "features without ids are rejected");
+    assert_eq!(features.len(), 2);
+
+    let mut source = GeoJsonSource::new("incremental-source");
+    assert!(source.set_features_if_changed(&mut features));
+    assert!(!source.set_features_if_changed(&mut features), "unchanged features are not set again");
+
+    {
+        let mut style = renderer.style();
+        let source_id = style.add_source(source).expect("GeoJSON source should be added");
+        let mut fill = FillLayer::new("incremental-fill", &source_id);
+        fill.set_fill_color(Color::rgb(0.0, 1.0, 0.0));
+        style.add_layer(fill).expect("fill layer should be added");
+    }
+
+    let [red, green, _blue, _alpha] = center_pixel(&render(&mut renderer)).0;
+    assert!(green > red, "center feature should render");
+
+    assert!(features.remove("center"));
+    assert!(!features.remove(FeatureId::Unsigned(7)));
+    assert_eq!(features.len(), 1);
+    {
+        let mut style = renderer.style();
+        let Some(SourceRefMut::GeoJson(mut source)) = style.source_mut("incremental-source") else {
+            panic!("incremental-source should be a GeoJSON source");
+        };
+        assert!(source.set_features_if_changed(&mut features));
+    }
+
+    let [red, green, _blue, _alpha] = center_pixel(&render(&mut renderer)).0;
+    assert!(red > green, "removed feature should disappear");
+
+    // A source added after the store was applied still gets its features.
+    assert_eq!(features.upsert(&square_feature("center", -45.0, 45.0)).unwrap(), 1);
+    {
+        let mut style = renderer.style();
+        let Some(SourceRefMut::GeoJson(mut source)) = style.source_mut("incremental-source") else {
+            panic!("incremental-source should be a GeoJSON source");
+        };
+        assert!(source.set_features_if_changed(&mut features));
+    }
+    let mut second = GeoJsonSource::new("second-source");
+    second.set_features(&features);
+    {
+        let mut style = renderer.style();
+        let source_id = style.add_source(second).expect("GeoJSON source should be added");
+        let mut fill = FillLayer::new("second-fill", &source_id);
+        fill.set_fill_color(Color::rgb(0.0, 0.0, 1.0));
+        style.add_layer(fill).expect("fill layer should be added");
+    }
+
+    let [_red, green, blue, _alpha] = center_pixel(&render(&mut renderer)).0;
+    assert!(blue > green, "second source should render the stored features");
+}
+
 #[test]
 fn layer_management_methods_smoke_test() {
     let mut renderer = renderer();